@@ -28,12 +28,168 @@
  *
  *               M82 M-Module specific Set/GetStat code:
  *               The driver provides the M31_HYS_MODE Set/GetStat code to
- *               set/get the hysteresis mode of the current channel. This
- *               Set/GetStat code can only be used for M82 M-Modules but
- *               not for M31/M32 M-Modules.
+ *               set/get the hysteresis mode of the current channel and
+ *               the M31_HYS_MASK Set/GetStat code to set/get the mode of
+ *               all channels at once. The mode register is kept in a shadow
+ *               copy, so reads need no bus cycle. These Set/GetStat codes
+ *               can only be used for M82 M-Modules but not for M31/M32
+ *               M-Modules.
+ *
+ *               Timing statistics:
+ *               The interrupt service routine measures its own execution
+ *               time with the cheapest free running counter of the CPU
+ *               (time stamp counter, time base) and keeps a log2 histogram,
+ *               the maximum and the timestamp of the maximum. The statistics
+ *               can be read via M31_BLK_ISR_STAT and cleared via
+ *               M31_ISR_STAT_CLR. M31_TS_FREQ yields the counter frequency.
+ *               The counter is calibrated once in M31_Init. Without a CPU
+ *               counter (M31_NO_CYCLE_COUNTER, other CPUs), timestamps are
+ *               OSS ticks and the execution time is not measured (the
+ *               statistics stay empty).
+ *
+ *               Binary trace:
+ *               Instead of formatted debug output, the entry points
+ *               M31_Read, M31_BlockRead, M31_SetStat, M31_GetStat and
+ *               M31_Irq log a fixed-size record (code, channel, value,
+ *               timestamp) into a per-device trace ring. The ring keeps the
+ *               newest records and is read via M31_BLK_TRACE (see the
+ *               m31_trace tool). Tracing is enabled via the descriptor key
+ *               TRACE_ENABLE or SetStat code M31_TRACE_ENABLE.
+ *
+ *               Lock statistics:
+ *               Normally the driver declares LL_LOCK_CALL and the MDIS
+ *               kernel serialises all calls of a device. Built with
+ *               M31_OWN_LOCK, the driver declares LL_LOCK_NONE and takes
+ *               an own device semaphore around the same entry points, so
+ *               the locking is unchanged but measured: per entry point the
+ *               nr of calls, the calls which found the lock taken and log2
+ *               histograms of the lock wait and hold times. They are read
+ *               via M31_BLK_LOCK_STAT (see the m31_trace tool) and cleared
+ *               via M31_LOCK_STAT_CLR. This build is shipped as driver
+ *               variant m31_ownlock (driver_ownlock.mak).
+ *
+ *               Event records:
+ *               If the interrupt is enabled, each interrupt stores an event
+ *               record (timestamp, states, changed channels, flags) in a
+ *               per-device event FIFO. In block read mode M31_BLKMODE_EVENT
+ *               (see M31_BLK_MODE) M31_BlockRead returns the pending event
+ *               records instead of the channel states.
+ *
+ *               Lost edge detection:
+ *               If a channel toggles twice before the interrupt service
+ *               routine reads the data register, the change is invisible.
+ *               Such interrupts without a visible state change are counted
+ *               as possible lost edges. They are attributed to the channel
+ *               that changed at the previous interrupt if only one channel
+ *               changed there, otherwise they are counted as unattributed.
+ *               An attributed lost edge is flagged in the last change of
+ *               the channel and, if the channel is reported (edge and
+ *               signal masks as for both edges), in an event record with
+ *               flag M31_EVF_LOST_EDGE. It is no edge for debounce, fields,
+ *               quadrature or rules; a lost strobe edge flags the next
+ *               strobed word.
+ *               The M31 has no interrupt pending bit, so any interrupt of
+ *               another device on a shared interrupt line is counted as
+ *               lost edge, too. With shared interrupts the lost edge
+ *               counters are an upper bound only.
+ *
+ *               Capture mode:
+ *               For commissioning, the driver can sample the data register
+ *               at a fixed rate into a preallocated capture buffer
+ *               (descriptor key CAP_BUF_SIZE). Sampling is driven by an OSS
+ *               timer, one sample per timer call, so the shortest period
+ *               is the OSS tick (also the default if longer than 1ms).
+ *               Sample timestamps are nominal (trigger timestamp plus n
+ *               periods); a timer call delayed by a period or more is
+ *               counted as sampling gap, after which they are off.
+ *               A trigger pattern (mask/value) and a pre-trigger depth can
+ *               be set. After the trigger, the samples are read in block
+ *               read mode M31_BLKMODE_CAPTURE while sampling continues.
+ *               Optionally the capture buffer holds run length encoded
+ *               records (state, repeat count) instead of single samples
+ *               (M31_CAP_FORMAT), which saves memory and copy bandwidth
+ *               for slowly changing inputs.
+ *
+ *               Aggregate device:
+ *               Up to 8 modules can be combined into one logical device
+ *               with 16 channels per module (descriptor keys AGGR_xxx).
+ *               All modules register in a driver global table, the device
+ *               with index 0 (master) presents channels 0..16*N-1, reads
+ *               the states of all modules in one block read and merges
+ *               the event records of all modules into one time ordered
+ *               stream (M31_EVENT.dev = module index). A record or change
+ *               flag is consumed by the first path reading it; with
+ *               AGGR_EXCLUSIVE=1 the members' records and change flags
+ *               are reserved for the master and the member paths get
+ *               ERR_LL_DEV_BUSY. Per-channel
+ *               status codes (debounce, quadrature, ...) only accept the
+ *               channels 0..15 of the own module (else ERR_LL_ILL_CHAN).
+ *
+ *               Ready groups:
+ *               Up to 32 devices can share a readiness bit mask (descriptor
+ *               keys READY_xxx). A device with a reportable change sets its
+ *               bit; M31_READY_MASK gets and clears the mask of the group,
+ *               so one thread can wait for all devices and service only
+ *               the ready ones. The signal of a group member is only sent
+ *               if its bit was not set before, i.e. once per device
+ *               between two M31_READY_MASK calls.
+ *
+ *               Debounce:
+ *               Each channel can get a software debounce time. An edge of
+ *               a debounced channel is only reported (event, signal, change
+ *               flags, state in event records) after the input was stable
+ *               for the debounce time. Shorter pulses are suppressed and
+ *               counted as glitches. Settled changes are detected in the
+ *               next interrupt or by a 1ms one-shot OSS timer, so the
+ *               effective window is rounded up to the timer resolution if
+ *               the input stays quiet. The timer is only armed while a
+ *               debounce window, field settle window or rule deadline is
+ *               running.
+ *
+ *               Quadrature decoder:
+ *               Channel pairs (2n, 2n+1) can be switched to quadrature
+ *               decoding of incremental encoder phases A (2n) and B
+ *               (2n+1). The ISR counts a signed position per pair, keeps
+ *               the last direction and counts illegal transitions (both
+ *               phases changed). Edges of these channels are not reported
+ *               (no events, signals, change flags, debounce).
+ *
+ *               Channel fields:
+ *               Adjacent channels can be grouped to fields (e.g. BCD rotary
+ *               switches) with binary, Gray or BCD coding. Edges of field
+ *               channels are not reported. A field is reported once its
+ *               channels are stable for the settle time and decode to a
+ *               new valid value (event flag M31_EVF_FIELD).
+ *
+ *               Sequence rules:
+ *               A preloaded table of up to 8 rules with up to 8 steps each
+ *               (edge on a channel, optionally within a time window, or a
+ *               level held for a time) is evaluated per edge in the ISR
+ *               and by the debounce timer. Only a completed or
+ *               violated rule is reported (event flag M31_EVF_RULE).
+ *
+ *               Strobed words:
+ *               One channel can be the strobe of a parallel data word on
+ *               the other channels. On the selected strobe edge, the ISR
+ *               latches the data register with a timestamp into a word
+ *               FIFO (descriptor key STROBE_BUF_SIZE), which is read in
+ *               block read mode M31_BLKMODE_STROBE.
+ *
+ *               Notification:
+ *               Events and the user signal can be restricted to selected
+ *               channels and edge polarities. Signals can be coalesced, so
+ *               at most one signal per window is sent. All settings and
+ *               the interrupt enable can be preset via descriptor, so the
+ *               driver records events from init on.
  *
  *     Required: -
  *     Switches: _ONE_NAMESPACE_PER_DRIVER_
+ *               M31_NO_CYCLE_COUNTER  use OSS_TickGet() as timestamp counter
+ *               M31_EMU               build against the user space
+ *                                     emulation of m31_emu.h instead of
+ *                                     maccess/dbg/oss/desc/modcom
+ *               M31_OWN_LOCK          own device locking with lock
+ *                                     wait/hold statistics
  *
  *---------------------------------------------------------------------------
  * Copyright 1998-2019, MEN Mikro Elektronik GmbH
@@ -56,11 +212,15 @@
 #define _NO_LL_HANDLE		/* ll_defs.h: don't define LL_HANDLE struct */
 
 #include <MEN/men_typs.h>   /* system dependent definitions   */
+#ifdef M31_EMU
+#include <MEN/m31_emu.h>    /* user space emulation (m31_replay) */
+#else
 #include <MEN/maccess.h>    /* hw access macros and types     */
 #include <MEN/dbg.h>		/* debug functions                */
 #include <MEN/oss.h>        /* oss functions                  */
 #include <MEN/desc.h>       /* descriptor functions           */
 #include <MEN/modcom.h>     /* ID PROM functions              */
+#endif
 #include <MEN/mdis_api.h>   /* MDIS global defs               */
 #include <MEN/mdis_com.h>   /* MDIS common defs               */
 #include <MEN/mdis_err.h>   /* MDIS error codes               */
@@ -87,6 +247,62 @@
 #define MODE_REG			0x04		/* mode register */
 #define IRQCRL_REG			0x80		/* interrupt clear register */
 
+/* timestamp counter */
+#if !defined(M31_NO_CYCLE_COUNTER) && defined(__GNUC__) && \
+	(defined(__i386__) || defined(__x86_64__) || \
+	 defined(__powerpc__) || defined(__PPC__) || defined(__aarch64__))
+# define TS_CYCLE_COUNTER				/* CPU counter, else OSS ticks */
+#endif
+#define TS_CALIB_MSEC		20			/* calibration time for TsFreqGet */
+#define HIST_BUCKETS		32			/* = M31_HIST_BUCKETS */
+
+/* binary trace */
+#define TRACE_SIZE_DEF		256			/* default nr of trace records */
+
+/* events */
+#define EVENT_BUF_SIZE_DEF	64			/* default nr of event records */
+#define EVENT_COPY_CHUNK	32			/* max records copied per irq lock */
+
+/* capture */
+#define CAP_PERIOD_DEF		1000		/* default sample period [us] */
+#define CAP_COPY_CHUNK		256			/* max samples copied per lock */
+
+/* debounce */
+#define DB_TIMER_MSEC		1			/* debounce timer delay [ms] */
+
+/* quadrature decoder */
+#define QUAD_PAIRS			(CH_NUMBER/2)	/* nr of channel pairs */
+#define QUAD_ERR			2			/* illegal transition */
+
+/* channel fields */
+#define FLD_NUMBER			8			/* = M31_FIELD_MAX */
+#define FLD_NAME_LEN		16			/* = M31_FIELD_NAME_LEN */
+
+/* sequence rules */
+#define RULE_NUMBER			8			/* = M31_RULE_MAX */
+#define RULE_STEPS			8			/* = M31_RULE_STEPS */
+#define RULE_TIME_MAX		4294967		/* max step time [ms] */
+
+/* lock statistics */
+#define LOCK_EP_NUM			6			/* = M31_LOCK_EP_NUM */
+
+/* strobed word fifo */
+#define STROBE_BUF_SIZE_DEF	256			/* default nr of word records */
+#define STROBE_COPY_CHUNK	32			/* max records copied per irq lock */
+
+/* aggregate devices */
+#define AGGR_GROUPS			8			/* max nr of aggregate/ready groups */
+#define AGGR_MEMBERS		8			/* = M31_AGGR_MAX */
+
+/* registered aggregate member, events and change flags go to the master */
+#define AGGR_MEMBER(h)		((h)->aggrGroup && (h)->aggrIndex && \
+							 (h)->aggrExcl)		/* reserved for master */
+
+#define TRACE(code,ch,val) \
+	do { if (llHdl->trcEnable) TraceWrite(llHdl,code,ch,val,FALSE); } while(0)
+#define ITRACE(code,ch,val) \
+	do { if (llHdl->trcEnable) TraceWrite(llHdl,code,ch,val,TRUE); } while(0)
+
 /*-----------------------------------------+
 |  TYPEDEFS                                |
 +-----------------------------------------*/
@@ -105,13 +321,159 @@ typedef struct {
 	DBG_HANDLE      *dbgHdl;        /* debug handle */
 	/* id */
     u_int32         idCheck;		/* id check enabled */
+    u_int32         idDefer;		/* id check deferred to first use */
+	u_int8			idRead;			/* id prom magic/id read */
+	u_int8			idFull;			/* id prom cache complete */
+	int32			idError;		/* result of id check */
+	u_int16			idProm[MOD_ID_SIZE/2];	/* id prom cache */
     /* sig */
 	OSS_SIG_HANDLE  *sigHdl;		/* signal handle */
 	/* misc */
 	u_int16			changeFlags;	/* stores level changes */
+	u_int32			chChanges[CH_NUMBER];	/* level changes per channel */
 	u_int16			lastState;		/* last state */
 	u_int8			irqEnable;		/* irq enable flag */
 	u_int32			modId;			/* module id */
+	u_int16			hysMask;		/* shadow of MODE_REG (M82) */
+	u_int8			hysValid;		/* shadow valid */
+	/* isr timing */
+	u_int32			isrCount;		/* nr of measured interrupts */
+	u_int32			isrMax;			/* max execution time */
+	u_int64			isrMaxTs;		/* timestamp of max */
+	u_int32			isrHist[HIST_BUCKETS];	/* log2 histogram */
+	/* binary trace */
+	void			*trcBuf;		/* trace ring (M31_TRACE_REC) */
+	u_int32			trcAlloc;		/* size allocated for the ring */
+	u_int32			trcSize;		/* nr of records (power of 2) */
+	u_int32			trcPut;			/* nr of records written */
+	u_int32			trcGet;			/* nr of records read */
+	u_int8			trcEnable;		/* trace enabled */
+	/* events */
+	void			*evBuf;			/* event fifo (M31_EVENT) */
+	u_int32			evAlloc;		/* size allocated for the fifo */
+	u_int32			evSize;			/* nr of records (power of 2) */
+	u_int32			evPut;			/* nr of records written */
+	u_int32			evGet;			/* nr of records read */
+	u_int32			evLost;			/* nr of lost records */
+	u_int16			evSeq;			/* next sequence number */
+	u_int8			evOverrun;		/* records lost since last put */
+	u_int8			blkMode;		/* block read mode */
+	/* lost edges */
+	u_int16			lastChange;		/* last visible change */
+	u_int32			lostIrqs;		/* irqs without visible change */
+	u_int32			lostUnattr;		/* lost edges not attributable */
+	u_int32			lostEdges[CH_NUMBER];	/* lost edges per channel */
+	/* capture */
+	u_int16			*capBuf;		/* capture buffer */
+	u_int32			capAlloc;		/* size allocated for the buffer */
+	u_int32			capSize;		/* nr of samples (power of 2) */
+	u_int32			capPut;			/* nr of samples written */
+	u_int32			capGet;			/* nr of samples read */
+	u_int32			capLost;		/* samples lost (buffer full) */
+	u_int32			capGaps;		/* sampling gaps (late timer calls) */
+	u_int32			capPeriod;		/* requested sample period [us] */
+	u_int32			capRealPeriod;	/* effective sample period [us] */
+	u_int32			capPreTrig;		/* requested pre-trigger depth */
+	u_int32			capPreTrigCnt;	/* samples stored before trigger */
+	u_int16			capTrigMask;	/* trigger mask */
+	u_int16			capTrigValue;	/* trigger value */
+	u_int8			capState;		/* M31_CAPST_xxx */
+	u_int8			capFormat;		/* M31_CAPFMT_xxx */
+	u_int16			capRunState;	/* state of open run (RLE) */
+	u_int32			capRunCnt;		/* samples in open run (RLE) */
+	u_int32			capHeld;		/* samples held while armed */
+	u_int64			capPeriodTs;	/* sample period [ts counts] */
+	u_int64			capNextTs;		/* timestamp of next sample */
+	u_int64			capTrigTs;		/* timestamp of trigger sample */
+	OSS_TIMER_HANDLE *capTimer;		/* sampling timer */
+	OSS_SPINL_HANDLE *capLock;		/* protects buffer and state */
+	/* notification */
+	u_int16			sigMask;		/* channels which send the signal */
+	u_int16			edgeRise;		/* channels reporting rising edges */
+	u_int16			edgeFall;		/* channels reporting falling edges */
+	u_int8			sigPending;		/* coalesced signal pending */
+	u_int32			sigCoalesce;	/* coalescing window [ms] */
+	u_int64			sigWinTs;		/* coalescing window [ts counts] */
+	u_int64			sigLastTs;		/* timestamp of last signal */
+	u_int32			sigSent;		/* nr of signals sent */
+	u_int32			sigDeferred;	/* nr of signals deferred */
+	OSS_TIMER_HANDLE *sigTimer;		/* coalescing timer */
+	/* last change per channel */
+	u_int16			lcValid;		/* channels which changed */
+	u_int16			lcLost;			/* last change was a lost edge */
+	u_int64			lcTs[CH_NUMBER];	/* timestamp of last change */
+	/* debounce */
+	u_int16			dbMask;			/* debounced channels */
+	u_int16			dbPend;			/* channels in debounce window */
+	u_int16			dbState;		/* settled states */
+	u_int8			dbTimerRun;		/* debounce timer armed */
+	u_int32			dbTime[CH_NUMBER];		/* debounce time [us] */
+	u_int64			dbTs[CH_NUMBER];		/* debounce time [ts counts] */
+	u_int64			dbDeadline[CH_NUMBER];	/* end of debounce window */
+	u_int32			glitches[CH_NUMBER];	/* suppressed glitches */
+	OSS_TIMER_HANDLE *dbTimer;		/* debounce timer */
+	/* quadrature decoder */
+	u_int8			quadMask;		/* decoded pairs */
+	u_int16			quadChMask;		/* channels of decoded pairs */
+	int32			quadPos[QUAD_PAIRS];	/* position */
+	int32			quadDir[QUAD_PAIRS];	/* last direction (1/-1/0) */
+	u_int32			quadErr[QUAD_PAIRS];	/* illegal transitions */
+	/* channel fields */
+	u_int16			fldChMask;		/* channels of all fields */
+	u_int16			fldState;		/* settled states of field channels */
+	u_int8			fldPend;		/* fields in settle window */
+	u_int8			fldValid;		/* fields with valid value */
+	u_int16			fldMask[FLD_NUMBER];	/* channels (0=undefined) */
+	u_int8			fldFirst[FLD_NUMBER];	/* first channel */
+	u_int8			fldCode[FLD_NUMBER];	/* M31_FLDCODE_xxx */
+	u_int32			fldSettle[FLD_NUMBER];	/* settle time [us] */
+	u_int64			fldSettleTs[FLD_NUMBER];	/* settle time [ts counts] */
+	u_int64			fldDeadline[FLD_NUMBER];	/* end of settle window */
+	u_int32			fldValue[FLD_NUMBER];	/* settled decoded value */
+	u_int32			fldChanges[FLD_NUMBER];	/* nr of reported values */
+	u_int32			fldInvalid[FLD_NUMBER];	/* settled on invalid code */
+	char			fldName[FLD_NUMBER][FLD_NAME_LEN];	/* field name */
+	/* sequence rules */
+	u_int8			ruleMask;		/* loaded rules */
+	u_int8			ruleDl;			/* rules with running deadline */
+	u_int8			ruleStep[RULE_NUMBER];	/* current step */
+	u_int64			ruleDeadline[RULE_NUMBER];	/* end of window/hold */
+	u_int32			ruleDone[RULE_NUMBER];	/* nr of completions */
+	u_int32			ruleViol[RULE_NUMBER];	/* nr of violations */
+	u_int8			ruleOp[RULE_NUMBER][RULE_STEPS];	/* M31_ROP_xxx */
+	u_int8			ruleCh[RULE_NUMBER][RULE_STEPS];	/* channel */
+	u_int32			ruleTime[RULE_NUMBER][RULE_STEPS];	/* time [ms] */
+	u_int64			ruleTs[RULE_NUMBER][RULE_STEPS];	/* time [ts counts] */
+	/* strobed word fifo */
+	void			*stbBuf;		/* word fifo (M31_STROBE_REC) */
+	u_int32			stbAlloc;		/* size allocated for the fifo */
+	u_int32			stbSize;		/* nr of records (power of 2) */
+	u_int32			stbPut;			/* nr of records written */
+	u_int32			stbGet;			/* nr of records read */
+	u_int32			stbLost;		/* records lost (fifo full) */
+	u_int32			stbSeq;			/* sequence number */
+	u_int16			stbBit;			/* strobe channel bit */
+	u_int8			stbEdge;		/* M31_STROBE_xxx (0=off) */
+	u_int8			stbLostEdge;	/* strobe edge lost before next word */
+	/* aggregate device */
+	u_int32			aggrGroup;		/* group (0=none) */
+	u_int32			aggrIndex;		/* module index in group */
+	u_int32			aggrCount;		/* nr of modules (master only) */
+	u_int32			aggrExcl;		/* events/flags for master only */
+	/* ready group */
+	u_int32			readyGroup;		/* group (0=none) */
+	u_int32			readyBit;		/* device bit in group */
+#ifdef M31_OWN_LOCK
+	/* lock statistics */
+	OSS_SEM_HANDLE	*lockSem;		/* device lock */
+	u_int64			lockTs;			/* timestamp of lock acquisition */
+	u_int32			lockCount[LOCK_EP_NUM];		/* nr of calls */
+	u_int32			lockCont[LOCK_EP_NUM];		/* nr of contended calls */
+	u_int32			lockWaitMax[LOCK_EP_NUM];	/* max wait [ts counts] */
+	u_int32			lockHoldMax[LOCK_EP_NUM];	/* max hold [ts counts] */
+	u_int32			lockWaitHist[LOCK_EP_NUM][HIST_BUCKETS];	/* log2 */
+	u_int32			lockHoldHist[LOCK_EP_NUM][HIST_BUCKETS];	/* log2 */
+#endif
 } LL_HANDLE;
 
 /* include files which need LL_HANDLE */
@@ -120,6 +482,30 @@ typedef struct {
 
 static const char IdentString[]=MENT_XSTR(MAK_REVISION);
 
+/* timestamp counter frequency (calibrated once, shared by all devices) */
+static u_int32 G_tsFreq;
+static u_int32 G_tsPerUsQ16;		/* counts per us, 16.16 fixed point */
+
+/* quadrature steps [prev AB << 2 | curr AB] (A=ch 2n, B=ch 2n+1) */
+static const int8 G_quadTab[16] = {
+	 0,  1, -1, QUAD_ERR,		/* 00 -> 00, 01, 10, 11 */
+	-1,  0, QUAD_ERR,  1,		/* 01 -> ... */
+	 1, QUAD_ERR,  0, -1,		/* 10 -> ... */
+	QUAD_ERR, -1,  1,  0		/* 11 -> ... */
+};
+
+/* aggregate device registry (shared by all devices) */
+static LL_HANDLE *G_aggr[AGGR_GROUPS][AGGR_MEMBERS];
+static OSS_SPINL_HANDLE *G_aggrLock;	/* protects G_aggr */
+static u_int32 G_aggrUsers;			/* nr of registered devices */
+
+/* ready groups (own lock: taken in the ISR with the device irq masked,
+   while G_aggrLock is held when masking the irqs of members) */
+static u_int32 G_ready[AGGR_GROUPS];	/* devices with pending changes */
+static u_int32 G_readyUsed[AGGR_GROUPS];	/* registered devices */
+static OSS_SPINL_HANDLE *G_readyLock;	/* protects G_ready, G_readyUsed */
+static u_int32 G_readyUsers;		/* nr of registered devices */
+
 /*-----------------------------------------+
 |  PROTOTYPES                              |
 +-----------------------------------------*/
@@ -139,6 +525,86 @@ static int32 M31_Irq(LL_HANDLE *llHdl );
 static int32 M31_Info(int32 infoType, ... );
 static char* Ident( void );
 static int32 Cleanup(LL_HANDLE *llHdl, int32 retCode);
+static u_int64 TsGet(LL_HANDLE *llHdl);
+static u_int32 TsFreqGet(LL_HANDLE *llHdl);
+static u_int32 Log2Bucket(u_int32 val);
+static u_int32 Pow2Floor(u_int32 val);
+static void TraceWrite(LL_HANDLE *llHdl, u_int16 code, int32 ch,
+					   u_int32 value, int32 inIrq);
+static void EventPut(LL_HANDLE *llHdl, u_int64 ts, u_int16 state,
+					 u_int16 change, u_int8 flags);
+static u_int32 EventGet(LL_HANDLE *llHdl, void *buf, u_int32 max);
+static u_int64 UsToTs(LL_HANDLE *llHdl, u_int32 us);
+static u_int32 CapMinPeriod(LL_HANDLE *llHdl);
+static int32 CapStart(LL_HANDLE *llHdl);
+static void CapStop(LL_HANDLE *llHdl);
+static void CapTimer(void *arg);
+static void CapSample(LL_HANDLE *llHdl, u_int16 sample, u_int64 ts);
+static int32 IdPromGet(LL_HANDLE *llHdl, u_int32 full);
+static int32 HysShadowGet(LL_HANDLE *llHdl);
+static int32 SigCoalesceSet(LL_HANDLE *llHdl, u_int32 msec);
+static void SigTimer(void *arg);
+static int32 AggrRegister(LL_HANDLE *llHdl);
+static void AggrUnregister(LL_HANDLE *llHdl);
+static u_int32 AggrMembers(LL_HANDLE *llHdl);
+static int32 ReadyRegister(LL_HANDLE *llHdl);
+static void ReadyUnregister(LL_HANDLE *llHdl);
+static u_int32 ReadySet(LL_HANDLE *llHdl);
+static u_int32 ReadyGet(LL_HANDLE *llHdl);
+static int32 AggrRead(LL_HANDLE *llHdl, int32 ch, int32 *valueP);
+static int32 AggrStateGet(LL_HANDLE *llHdl, u_int16 *buf, int32 *nbrRdBytesP);
+static int32 AggrChangeGet(LL_HANDLE *llHdl, u_int16 *buf);
+static u_int32 AggrEventGet(LL_HANDLE *llHdl, M31_EVENT *buf, u_int32 max);
+static void CapRunStore(LL_HANDLE *llHdl);
+static void ProcessChange(LL_HANDLE *llHdl, u_int64 ts, u_int16 state,
+						  u_int16 change, u_int8 flags);
+static u_int16 DbState(LL_HANDLE *llHdl, u_int16 raw);
+static void DbEdge(LL_HANDLE *llHdl, u_int64 ts, u_int16 raw, u_int16 change);
+static void DbCheck(LL_HANDLE *llHdl, u_int64 now, u_int16 raw);
+static void DbTimer(void *arg);
+static int32 DbSet(LL_HANDLE *llHdl, int32 ch, u_int32 us);
+static int32 DbTimerCreate(LL_HANDLE *llHdl);
+static void DbTimerArm(LL_HANDLE *llHdl);
+static u_int32 CapGet(LL_HANDLE *llHdl, u_int16 *buf, u_int32 max);
+static void QuadSet(LL_HANDLE *llHdl, u_int32 mask);
+static void QuadDecode(LL_HANDLE *llHdl, u_int16 prev, u_int16 curr);
+static void StrobeLatch(LL_HANDLE *llHdl, u_int64 ts, u_int16 state,
+						u_int16 change);
+static u_int32 StrobeGet(LL_HANDLE *llHdl, M31_STROBE_REC *buf, u_int32 max);
+static int32 FieldSet(LL_HANDLE *llHdl, const M31_FIELD_DEF *def);
+static void FieldReset(LL_HANDLE *llHdl, u_int32 fld);
+static int32 FieldDecode(u_int32 code, u_int32 bits, u_int32 width,
+						 u_int32 *valueP);
+static void FieldEdge(LL_HANDLE *llHdl, u_int64 ts, u_int16 raw,
+					  u_int16 change);
+static void FieldCheck(LL_HANDLE *llHdl, u_int64 now, u_int16 raw);
+static void FieldCommit(LL_HANDLE *llHdl, u_int32 fld, u_int64 ts,
+						u_int16 raw);
+static int32 FieldOfCh(LL_HANDLE *llHdl, int32 ch);
+static int32 ChCodeCheck(int32 code, int32 ch);
+static int32 RuleLoad(LL_HANDLE *llHdl, const M31_RULE *rules, u_int32 num);
+static void RuleEnter(LL_HANDLE *llHdl, u_int32 rule, u_int32 step,
+					  u_int64 ts, u_int16 state);
+static void RuleEdge(LL_HANDLE *llHdl, u_int64 ts, u_int16 state,
+					 u_int16 change);
+static void RuleCheck(LL_HANDLE *llHdl, u_int64 now, u_int16 state);
+static void RuleReport(LL_HANDLE *llHdl, u_int32 rule, u_int64 ts,
+					   u_int16 state, u_int32 violated);
+#ifdef M31_OWN_LOCK
+static int32 LockEnter(LL_HANDLE *llHdl, u_int32 ep);
+static void LockLeave(LL_HANDLE *llHdl, u_int32 ep);
+static void LockTime(u_int32 *hist, u_int32 *maxP, u_int64 time);
+static int32 M31_ReadLocked(LL_HANDLE *llHdl, int32 ch, int32 *value);
+static int32 M31_WriteLocked(LL_HANDLE *llHdl, int32 ch, int32 value);
+static int32 M31_SetStatLocked(LL_HANDLE *llHdl, int32 code, int32 ch,
+							   INT32_OR_64 value32_or_64);
+static int32 M31_GetStatLocked(LL_HANDLE *llHdl, int32 code, int32 ch,
+							   INT32_OR_64 *value32_or_64);
+static int32 M31_BlockReadLocked(LL_HANDLE *llHdl, int32 ch, void *buf,
+								 int32 size, int32 *nbrRdBytesP);
+static int32 M31_BlockWriteLocked(LL_HANDLE *llHdl, int32 ch, void *buf,
+								  int32 size, int32 *nbrWrBytesP);
+#endif
 
 
 /**************************** M31_GetEntry *********************************
@@ -160,12 +626,21 @@ static int32 Cleanup(LL_HANDLE *llHdl, int32 retCode);
 {
     drvP->init        = M31_Init;
     drvP->exit        = M31_Exit;
+#ifdef M31_OWN_LOCK
+    drvP->read        = M31_ReadLocked;
+    drvP->write       = M31_WriteLocked;
+    drvP->blockRead   = M31_BlockReadLocked;
+    drvP->blockWrite  = M31_BlockWriteLocked;
+    drvP->setStat     = M31_SetStatLocked;
+    drvP->getStat     = M31_GetStatLocked;
+#else
     drvP->read        = M31_Read;
     drvP->write       = M31_Write;
     drvP->blockRead   = M31_BlockRead;
     drvP->blockWrite  = M31_BlockWrite;
     drvP->setStat     = M31_SetStat;
     drvP->getStat     = M31_GetStat;
+#endif
     drvP->irq         = M31_Irq;
     drvP->info        = M31_Info;
 }
@@ -181,6 +656,93 @@ static int32 Cleanup(LL_HANDLE *llHdl, int32 retCode);
  *                DEBUG_LEVEL_DESC      OSS_DBG_DEFAULT    see dbg.h
  *                DEBUG_LEVEL           OSS_DBG_DEFAULT    see dbg.h
  *                ID_CHECK              1                  0 or 1 
+ *                ID_DEFER              0                  0 or 1
+ *                HYS_MODE              (not changed)      0..0xffff
+ *                TRACE_SIZE            256                0..max [records]
+ *                TRACE_ENABLE          0                  0 or 1
+ *                EVENT_BUF_SIZE        64                 0..max [records]
+ *                CAP_BUF_SIZE          0                  0..max [samples]
+ *                IRQ_ENABLE            0                  0 or 1
+ *                SIG_MASK              0xffff             0..0xffff
+ *                EDGE_RISE             0xffff             0..0xffff
+ *                EDGE_FALL             0xffff             0..0xffff
+ *                SIG_COALESCE          0                  0..max [ms]
+ *                DEBOUNCE              0                  0..max [us]
+ *                DEBOUNCE_<n>          DEBOUNCE           0..max [us]
+ *                QUAD_MASK             0                  0..0xff
+ *                FIELD_<n>_WIDTH       0                  0..16
+ *                FIELD_<n>_CH          0                  0..15
+ *                FIELD_<n>_CODE        0                  0..2
+ *                FIELD_<n>_SETTLE      0                  0..max [us]
+ *                FIELD_<n>_NAME        ""                 string
+ *                STROBE_BUF_SIZE       256                0..max [records]
+ *                STROBE_CH             0                  0..15
+ *                STROBE_EDGE           0                  0..3
+ *                AGGR_GROUP            0                  0..8
+ *                AGGR_INDEX            0                  0..7
+ *                AGGR_COUNT            1                  1..8
+ *                AGGR_EXCLUSIVE        0                  0..1
+ *                READY_GROUP           0                  0..8
+ *                READY_INDEX           0                  0..31
+ *
+ *                The ID PROM is read once into a cache: init reads only the
+ *                magic word and the module ID, the other words are read on
+ *                the first M_LL_BLK_ID_DATA. With ID_DEFER=1 (or
+ *                ID_CHECK=0), nothing is read at init but on first use
+ *                of the ID. A failed ID check is then reported by the
+ *                first call which needs the ID (e.g. M31_HYS_MODE) or by
+ *                M31_ID_REFRESH.
+ *
+ *                HYS_MODE is the hysteresis mode of all channels (M82
+ *                only, see M31_HYS_MASK). It is ignored for M31/M32.
+ *
+ *                TRACE_SIZE is rounded down to a power of 2. 0 disables
+ *                the binary trace completely.
+ *
+ *                EVENT_BUF_SIZE is rounded down to a power of 2. 0 disables
+ *                the event records (block read mode M31_BLKMODE_EVENT then
+ *                fails with ERR_LL_ILL_PARAM, except on an aggregate
+ *                master).
+ *
+ *                CAP_BUF_SIZE is rounded down to a power of 2. 0 disables
+ *                the capture mode.
+ *
+ *                IRQ_ENABLE (also used by the MDIS kernel) arms the
+ *                interrupt processing already in M31_Init, so level
+ *                changes are recorded before the device is used. The other
+ *                keys preset the notification (see M31_SIG_MASK,
+ *                M31_EDGE_RISE, M31_EDGE_FALL, M31_SIG_COALESCE).
+ *
+ *                DEBOUNCE is the debounce time of all channels, DEBOUNCE_<n>
+ *                overrides it for channel n (0..15). 0 disables the
+ *                debounce (see M31_DEBOUNCE).
+ *
+ *                QUAD_MASK enables the quadrature decoder for channel
+ *                pairs (bit n = channels 2n, 2n+1, see M31_QUAD_MASK).
+ *
+ *                FIELD_<n>_xxx (n=0..7) define channel field n, see
+ *                M31_BLK_FIELD_DEF. Fields with width 0 are undefined.
+ *
+ *                STROBE_BUF_SIZE is rounded down to a power of 2. 0
+ *                disables the strobed word mode. STROBE_CH and STROBE_EDGE
+ *                preset M31_STROBE_CH and M31_STROBE_EDGE.
+ *
+ *                AGGR_GROUP (1..8) makes the module a member of an
+ *                aggregate device, 0 disables the aggregation. AGGR_INDEX
+ *                is the module index within the group. AGGR_COUNT is the
+ *                nr of modules and only used by the master (AGGR_INDEX=0).
+ *                AGGR_EXCLUSIVE=1 (member) reserves the event records and
+ *                change flags of the member for the master: the member
+ *                path gets ERR_LL_DEV_BUSY for them. With 0, a record is
+ *                consumed by the first path reading it.
+ *                The member devices must be opened (initialized) and should
+ *                have IRQ_ENABLE=1 to deliver events; a missing member is
+ *                reported as ERR_LL_DEV_NOTRDY by the master.
+ *
+ *                READY_GROUP (1..8) makes the device a member of a ready
+ *                group (independent of the aggregate groups), 0 disables
+ *                it. READY_INDEX is the bit of the device in the group's
+ *                ready mask and must be unique within the group.
  *
  *---------------------------------------------------------------------------
  *  Input......:  descSpec   pointer to descriptor data
@@ -206,8 +768,8 @@ static int32 M31_Init(
     LL_HANDLE	*llHdl = NULL;
     u_int32		gotsize;
     int32		error;
-    u_int32		value;
-    int			modIdMagic;
+    u_int32		value, dbDef;
+    int32		ch;
 
     /*------------------------------+
     |  prepare the handle           |
@@ -226,6 +788,12 @@ static int32 M31_Init(
     llHdl->irqHdl     = irqHdl;
     llHdl->ma		  = *maHdl;
 
+#ifdef M31_OWN_LOCK
+	/* own device lock instead of LL_LOCK_CALL */
+	if ((error = OSS_SemCreate(osHdl, OSS_SEM_BIN, 1, &llHdl->lockSem)))
+		return( Cleanup(llHdl,error) );
+#endif
+
     /*------------------------------+
     |  init id function table       |
     +------------------------------*/
@@ -243,6 +811,12 @@ static int32 M31_Init(
 	DBG_MYLEVEL = OSS_DBG_DEFAULT;	/* set OS specific debug level */
 	DBGINIT((NULL,&DBH));
 
+    /*------------------------------+
+    |  calibrate timestamp counter  |
+    +------------------------------*/
+	/* once for all devices, before any time is converted under a lock */
+	TsFreqGet(llHdl);
+
     /*------------------------------+
     |  scan descriptor              |
     +------------------------------*/
@@ -272,33 +846,333 @@ static int32 M31_Init(
 		error != ERR_DESC_KEY_NOTFOUND)
 		return( Cleanup(llHdl,error) );
 
+    /* ID_DEFER */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &llHdl->idDefer,
+								"ID_DEFER")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+    /* TRACE_SIZE */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, TRACE_SIZE_DEF, &value,
+								"TRACE_SIZE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	llHdl->trcSize = Pow2Floor(value);
+
+    /* TRACE_ENABLE */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+								"TRACE_ENABLE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+    /*------------------------------+
+    |  alloc trace ring             |
+    +------------------------------*/
+	if (llHdl->trcSize) {
+		if ((llHdl->trcBuf = OSS_MemGet(osHdl,
+				llHdl->trcSize * sizeof(M31_TRACE_REC),
+				&llHdl->trcAlloc)) == NULL)
+			return( Cleanup(llHdl,ERR_OSS_MEM_ALLOC) );
+
+		llHdl->trcEnable = value ? TRUE : FALSE;
+	}
+
+    /* EVENT_BUF_SIZE */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, EVENT_BUF_SIZE_DEF, &value,
+								"EVENT_BUF_SIZE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	llHdl->evSize = Pow2Floor(value);
+
+    /*------------------------------+
+    |  alloc event fifo             |
+    +------------------------------*/
+	if (llHdl->evSize) {
+		if ((llHdl->evBuf = OSS_MemGet(osHdl,
+				llHdl->evSize * sizeof(M31_EVENT),
+				&llHdl->evAlloc)) == NULL)
+			return( Cleanup(llHdl,ERR_OSS_MEM_ALLOC) );
+	}
+
+    /* CAP_BUF_SIZE */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+								"CAP_BUF_SIZE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	llHdl->capSize   = Pow2Floor(value);
+	llHdl->capPeriod = CapMinPeriod(llHdl);
+	if (llHdl->capPeriod < CAP_PERIOD_DEF)
+		llHdl->capPeriod = CAP_PERIOD_DEF;
+
+    /*------------------------------+
+    |  alloc capture buffer/timer   |
+    +------------------------------*/
+	if (llHdl->capSize) {
+		if ((llHdl->capBuf = (u_int16*)OSS_MemGet(osHdl,
+				llHdl->capSize * sizeof(u_int16),
+				&llHdl->capAlloc)) == NULL)
+			return( Cleanup(llHdl,ERR_OSS_MEM_ALLOC) );
+
+		if ((error = OSS_SpinLockCreate(osHdl, &llHdl->capLock)))
+			return( Cleanup(llHdl,error) );
+
+		if ((error = OSS_TimerCreate(osHdl, CapTimer, (void*)llHdl,
+									 &llHdl->capTimer)))
+			return( Cleanup(llHdl,error) );
+	}
+
+    /* SIG_MASK */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 0xffff, &value,
+								"SIG_MASK")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	llHdl->sigMask = (u_int16)value;
+
+    /* EDGE_RISE */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 0xffff, &value,
+								"EDGE_RISE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	llHdl->edgeRise = (u_int16)value;
+
+    /* EDGE_FALL */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 0xffff, &value,
+								"EDGE_FALL")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	llHdl->edgeFall = (u_int16)value;
+
+    /* SIG_COALESCE */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+								"SIG_COALESCE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	if ((error = SigCoalesceSet(llHdl, value)))
+		return( Cleanup(llHdl,error) );
+
+    /* AGGR_GROUP */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &llHdl->aggrGroup,
+								"AGGR_GROUP")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	if (llHdl->aggrGroup) {
+	    /* AGGR_INDEX */
+		if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &llHdl->aggrIndex,
+									"AGGR_INDEX")) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+
+	    /* AGGR_COUNT */
+		if ((error = DESC_GetUInt32(llHdl->descHdl, 1, &value,
+									"AGGR_COUNT")) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+
+		if (llHdl->aggrGroup > AGGR_GROUPS ||
+			llHdl->aggrIndex >= AGGR_MEMBERS ||
+			value < 1 || value > AGGR_MEMBERS)
+			return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+		if (llHdl->aggrIndex == 0)
+			llHdl->aggrCount = value;
+
+	    /* AGGR_EXCLUSIVE */
+		if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &llHdl->aggrExcl,
+									"AGGR_EXCLUSIVE")) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+	}
+
+    /* READY_GROUP */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &llHdl->readyGroup,
+								"READY_GROUP")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	if (llHdl->readyGroup) {
+	    /* READY_INDEX */
+		if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+									"READY_INDEX")) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+
+		if (llHdl->readyGroup > AGGR_GROUPS || value >= 32)
+			return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+		llHdl->readyBit = (u_int32)1 << value;
+	}
+
     /*------------------------------+
     |  check M-Module ID            |
     +------------------------------*/
-	if (llHdl->idCheck) {
-		modIdMagic = m_read((U_INT32_OR_64)llHdl->ma, 0);
-		llHdl->modId = m_read((U_INT32_OR_64)llHdl->ma, 1);
+	if (llHdl->idCheck && !llHdl->idDefer) {
+		if ((error = IdPromGet(llHdl, FALSE)))
+			return( Cleanup(llHdl,error) );
+	}
 
-		if (modIdMagic != MOD_ID_MAGIC) {
-			DBGWRT_ERR((DBH,"*** LL - M31_Init: illegal magic=0x%04x\n", modIdMagic));
-			error = ERR_LL_ILL_ID;
+
+    /*------------------------------+
+    |  init hardware                |
+    +------------------------------*/
+	/* HYS_MODE (M82 only) */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+								"HYS_MODE")) == ERR_SUCCESS) {
+		if ((error = IdPromGet(llHdl, FALSE)))
 			return( Cleanup(llHdl,error) );
+
+		if (llHdl->modId == MOD_ID_M82) {
+			llHdl->hysMask  = (u_int16)value;
+			llHdl->hysValid = TRUE;
+			MWRITE_D16(llHdl->ma, MODE_REG, llHdl->hysMask);
 		}
-		if ( (llHdl->modId != MOD_ID_M31) &&
-			 (llHdl->modId != MOD_ID_M32) &&
-			 (llHdl->modId != MOD_ID_M82) ) {
-			DBGWRT_ERR((DBH,"*** LL - M31_Init: illegal id=%d\n", llHdl->modId));
-			error = ERR_LL_ILL_ID;
-			return( Cleanup(llHdl,error) );
+		else {
+			DBGWRT_ERR((DBH,"*** LL - M31_Init: HYS_MODE ignored for M%d\n",
+						llHdl->modId));
 		}
-		DBGWRT_2((DBH," M%d module detected\n", llHdl->modId));
 	}
+	else if (error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	/* IRQ_ENABLE: arm interrupt processing */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+								"IRQ_ENABLE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	if (value) {
+		llHdl->lastState = MREAD_D16(llHdl->ma, DATA_REG);
+		llHdl->irqEnable = TRUE;
+	}
+
+	/* DEBOUNCE, DEBOUNCE_<n> */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &dbDef,
+								"DEBOUNCE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	for (ch=0; ch<CH_NUMBER; ch++) {
+		if ((error = DESC_GetUInt32(llHdl->descHdl, dbDef, &value,
+									"DEBOUNCE_%d", ch)) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+
+		if (value && (error = DbSet(llHdl, ch, value)))
+			return( Cleanup(llHdl,error) );
+	}
+
+	/* FIELD_<n>_xxx */
+	for (ch=0; ch<FLD_NUMBER; ch++) {
+		M31_FIELD_DEF def;
+		u_int32 len = FLD_NAME_LEN;
+
+		OSS_MemFill(osHdl, sizeof(def), (char*)&def, 0x00);
+		def.field = (u_int8)ch;
+
+		if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+									"FIELD_%d_WIDTH", ch)) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+
+		if (value == 0)
+			continue;
+
+		def.width = (u_int8)(value > CH_NUMBER ? 0xff : value);
+
+		if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+									"FIELD_%d_CH", ch)) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+
+		def.first = (u_int8)(value > CH_NUMBER ? 0xff : value);
+
+		if ((error = DESC_GetUInt32(llHdl->descHdl, M31_FLDCODE_BIN, &value,
+									"FIELD_%d_CODE", ch)) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+
+		def.code = (u_int8)(value > 0xff ? 0xff : value);
+
+		if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &def.settle,
+									"FIELD_%d_SETTLE", ch)) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+
+		if ((error = DESC_GetString(llHdl->descHdl, "", def.name, &len,
+									"FIELD_%d_NAME", ch)) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+
+		if ((error = FieldSet(llHdl, &def)))
+			return( Cleanup(llHdl,error) );
+	}
+
+    /* STROBE_BUF_SIZE */
+    if ((error = DESC_GetUInt32(llHdl->descHdl, STROBE_BUF_SIZE_DEF, &value,
+								"STROBE_BUF_SIZE")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
 
+	llHdl->stbSize = Pow2Floor(value);
 
     /*------------------------------+
-    |  init hardware                |
+    |  alloc strobed word fifo      |
+    +------------------------------*/
+	if (llHdl->stbSize) {
+		if ((llHdl->stbBuf = OSS_MemGet(osHdl,
+				llHdl->stbSize * sizeof(M31_STROBE_REC),
+				&llHdl->stbAlloc)) == NULL)
+			return( Cleanup(llHdl,ERR_OSS_MEM_ALLOC) );
+
+	    /* STROBE_CH */
+		if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+									"STROBE_CH")) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+
+		if (value >= CH_NUMBER)
+			return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+		llHdl->stbBit = (u_int16)(1 << value);
+
+	    /* STROBE_EDGE */
+		if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+									"STROBE_EDGE")) &&
+			error != ERR_DESC_KEY_NOTFOUND)
+			return( Cleanup(llHdl,error) );
+
+		if (value > M31_STROBE_BOTH)
+			return( Cleanup(llHdl,ERR_LL_ILL_PARAM) );
+
+		llHdl->stbEdge = (u_int8)value;
+	}
+
+	/* QUAD_MASK */
+	if ((error = DESC_GetUInt32(llHdl->descHdl, 0, &value,
+								"QUAD_MASK")) &&
+		error != ERR_DESC_KEY_NOTFOUND)
+		return( Cleanup(llHdl,error) );
+
+	QuadSet(llHdl, value);
+
+    /*------------------------------+
+    |  register aggregate member    |
     +------------------------------*/
-	/* do nothing */
+	if (llHdl->aggrGroup && (error = AggrRegister(llHdl)))
+		return( Cleanup(llHdl,error) );
+
+	if (llHdl->readyGroup && (error = ReadyRegister(llHdl))) {
+		if (llHdl->aggrGroup)
+			AggrUnregister(llHdl);
+		return( Cleanup(llHdl,error) );
+	}
 
 	return(ERR_SUCCESS);
 }
@@ -326,7 +1200,23 @@ static int32 M31_Exit(
     /*------------------------------+
     |  de-init hardware             |
     +------------------------------*/
-	/* do nothing */
+	/* stop sampling */
+	if (llHdl->capTimer)
+		CapStop(llHdl);
+
+	/* stop signal coalescing */
+	if (llHdl->sigTimer)
+		OSS_TimerStop(llHdl->osHdl, llHdl->sigTimer);
+
+	/* stop debounce timer */
+	if (llHdl->dbTimerRun)
+		OSS_TimerStop(llHdl->osHdl, llHdl->dbTimer);
+
+	/* leave aggregate device and ready group */
+	if (llHdl->aggrGroup)
+		AggrUnregister(llHdl);
+	if (llHdl->readyGroup)
+		ReadyUnregister(llHdl);
 
     /*------------------------------+
     |  clean up memory              |
@@ -364,13 +1254,19 @@ static int32 M31_Read(
 {
 	u_int16		data;
 
-    DBGWRT_1((DBH, "LL - M31_Read: ch=%d\n",ch));
+	/* channel of other module (aggregate device) */
+	if (ch >= CH_NUMBER) {
+		TRACE(M31_TR_READ, ch, 0);
+		return( AggrRead(llHdl, ch, valueP) );
+	}
 
 	/* read all channels */
 	data = MREAD_D16(llHdl->ma, DATA_REG);
 
 	/* extract one channel */
 	*valueP = (int32)( (data >> ch) & 0x01 );
+
+	TRACE(M31_TR_READ, ch, data);
 	
 	return(ERR_SUCCESS);
 }
@@ -414,6 +1310,34 @@ static int32 M31_Write(
  *                M31_SIGSET		   set signal				  1..max
  *                M31_SIGCLR           clear signal				  -
  *                M31_HYS_MODE (M82)   hysteresis of curr chan    0..1
+ *                M31_HYS_MASK (M82)   hysteresis of all channels 0..0xffff
+ *                M31_ISR_STAT_CLR     clear ISR timing stats     -
+ *                M31_LOCK_STAT_CLR    clear lock statistics      -
+ *                M31_TRACE_ENABLE     binary trace disable/enable 0..1
+ *                M31_BLK_MODE         block read mode            0..3
+ *                M31_EVENT_LOST       lost event counter         0..max
+ *                M31_LOST_EDGES       lost edges of curr chan    0..max
+ *                M31_CAP_PERIOD       capture sample period [us] tick..max
+ *                M31_CAP_TRIG_MASK    capture trigger mask       0..0xffff
+ *                M31_CAP_TRIG_VALUE   capture trigger value      0..0xffff
+ *                M31_CAP_PRETRIG      pre-trigger samples        0..size-1
+ *                M31_CAP_CTRL         start/stop capture         0..2
+ *                M31_CAP_FORMAT       capture buffer format      0..1
+ *                M31_ID_REFRESH       re-read ID PROM cache      -
+ *                M31_SIG_MASK         channels sending signal    0..0xffff
+ *                M31_EDGE_RISE        channels rising edges      0..0xffff
+ *                M31_EDGE_FALL        channels falling edges     0..0xffff
+ *                M31_SIG_COALESCE     signal coalescing [ms]     0..max
+ *                M31_DEBOUNCE         debounce time of curr chan 0..max [us]
+ *                M31_GLITCHES         glitches of curr chan      0..max
+ *                M31_QUAD_MASK        quadrature decoded pairs   0..0xff
+ *                M31_QUAD_POS         position of curr pair      int32
+ *                M31_QUAD_ERRORS      errors of curr pair        0..max
+ *                M31_STROBE_CH        strobe channel             0..15
+ *                M31_STROBE_EDGE      strobe edge                0..3
+ *                M31_STROBE_LOST      lost word counter          0..max
+ *                M31_BLK_FIELD_DEF    define channel field       M31_FIELD_DEF
+ *                M31_BLK_RULES        load rule table            M31_RULE[0..8]
  *                -------------------  -------------------------  ----------
  *
  *                M31_SIGSET installs a user signal with the specified signal
@@ -423,12 +1347,147 @@ static int32 M31_Write(
  *
  *                M31_SIGCLR deinstalls the user signal.
  *
+ *                M_MK_IRQ_ENABLE enables/disables the interrupt processing.
+ *                  Enabling saves the current states and clears the change
+ *                  flags, unless the interrupt is already enabled (e.g.
+ *                  via descriptor key IRQ_ENABLE).
+ *
+ *                M31_EDGE_RISE and M31_EDGE_FALL select the channels whose
+ *                  rising (0->1) and falling (1->0) edges are reported as
+ *                  event and may send the signal (default all). Other
+ *                  edges only update the states and change flags.
+ *
+ *                M31_SIG_MASK selects the channels whose reported edges
+ *                  send the user signal (default all).
+ *
+ *                M31_SIG_COALESCE sets the signal coalescing window in ms
+ *                  (0=off, default). The first edge sends the signal
+ *                  immediately, further edges within the window send one
+ *                  signal one window after the first of them (rounded to
+ *                  the OSS timer resolution). Changing the window sends a
+ *                  deferred signal.
+ *
+ *                M31_DEBOUNCE sets the debounce time of the current channel
+ *                  in us (0=off, default). The settled state starts with
+ *                  the current input level.
+ *
+ *                M31_GLITCHES sets the glitch counter of the current
+ *                  channel.
+ *
+ *                M31_QUAD_MASK enables the quadrature decoder for channel
+ *                  pairs (bit n = channels 2n (A) and 2n+1 (B)). The
+ *                  position counts +1 per edge if A leads B.
+ *
+ *                M31_QUAD_POS presets and M31_QUAD_ERRORS sets the position
+ *                  and error counter of the pair of the current channel.
+ *
+ *                M31_STROBE_CH selects the strobe channel of the strobed
+ *                  word mode, M31_STROBE_EDGE the edge which latches the
+ *                  word: M31_STROBE_OFF, M31_STROBE_RISE, M31_STROBE_FALL
+ *                  or M31_STROBE_BOTH. Fails with ERR_LL_ILL_PARAM if the
+ *                  word FIFO was disabled via descriptor (STROBE_BUF_SIZE=0).
+ *                  Edges of the data and strobe channels are still reported
+ *                  as configured (see M31_SIG_MASK, M31_EDGE_RISE/FALL).
+ *                  A lost edge attributed to the strobe channel sets
+ *                  M31_EVF_LOST_EDGE in the next latched word.
+ *
+ *                M31_STROBE_LOST sets the counter of words lost because
+ *                  the word FIFO was full.
+ *
+ *                M31_BLK_FIELD_DEF defines channel field def->field over
+ *                  def->width channels starting at def->first, coded
+ *                  M31_FLDCODE_BIN, _GRAY or _BCD (4 channels per digit,
+ *                  least significant digit first). Width 0 deletes the
+ *                  field. Fields must not overlap. The value is reported
+ *                  when the channels are stable for def->settle us (0 =
+ *                  at the edge) and decode to a new valid value. Field
+ *                  channels are not debounced; their edges are not reported.
+ *
+ *                M31_BLK_RULES loads the rule table (blk->size = n *
+ *                  sizeof(M31_RULE), n = 0..8) and restarts all rules.
+ *                  Rules not passed and rules starting with M31_ROP_END
+ *                  are disabled. Step ops:
+ *                    M31_ROP_RISE/FALL  edge on ch; time != 0: within time
+ *                                       ms after the previous step, else
+ *                                       the rule is violated
+ *                    M31_ROP_HIGH/LOW   ch stays at the level for time ms
+ *                                       (0 = is at the level), else the
+ *                                       rule is violated; as first step
+ *                                       it starts with the edge to the
+ *                                       level and never violates
+ *                  Rules are evaluated on the raw input levels. A completed
+ *                  or violated rule stores an event (flags M31_EVF_RULE and
+ *                  M31_EVF_VIOLATED, change = 1 << rule), sends the signal
+ *                  and restarts.
+ *
  *                M31_HYS_MODE sets the hysteresis mode of the current channel:
  *                  0 = Hysteresis Mode B; 5.5V..15.5V
  *                  1 = Hysteresis Mode A; 5.5V..9.5V
  *                  This SetStat code can only be used for M82 M-Modules but
  *                  not for M31/M32 M-Modules.
  *
+ *                M31_HYS_MASK sets the hysteresis mode of all channels.
+ *                  Bits 15..0 correspond to channels 15..0 (see
+ *                  M31_HYS_MODE). M82 only.
+ *
+ *                M31_ID_REFRESH re-reads the whole ID PROM into the cache
+ *                  and repeats the ID check (if enabled). M_LL_BLK_ID_DATA
+ *                  is served from the cache.
+ *
+ *                M31_ISR_STAT_CLR clears the ISR execution time histogram,
+ *                  the maximum and the number of measured interrupts.
+ *
+ *                M31_LOCK_STAT_CLR clears the lock statistics of all entry
+ *                  points (M31_OWN_LOCK builds, e.g. m31_ownlock, only, else
+ *                  ERR_LL_UNK_CODE).
+ *
+ *                M31_TRACE_ENABLE enables (1) or disables (0) the binary
+ *                  trace. Fails with ERR_LL_ILL_PARAM if the trace ring was
+ *                  disabled via descriptor (TRACE_SIZE=0).
+ *
+ *                M31_BLK_MODE selects what M31_BlockRead returns:
+ *                  M31_BLKMODE_STATE  state of all channels (default)
+ *                  M31_BLKMODE_EVENT  pending event records (M31_EVENT)
+ *                  M31_BLKMODE_CAPTURE  captured samples (u_int16)
+ *                  M31_BLKMODE_STROBE  strobed words (M31_STROBE_REC)
+ *
+ *                M31_EVENT_LOST sets the counter of event records lost
+ *                  because the event FIFO was full.
+ *
+ *                M31_LOST_EDGES sets the possible lost edge counter of the
+ *                  current channel.
+ *
+ *                M31_CAP_PERIOD sets the capture sample period in us
+ *                  (default 1000 or the OSS tick if longer). The period is
+ *                  rounded up to the OSS timer resolution; periods below
+ *                  one OSS tick fail with ERR_LL_ILL_PARAM.
+ *
+ *                M31_CAP_TRIG_MASK/M31_CAP_TRIG_VALUE set the trigger
+ *                  pattern: the capture triggers on the first sample with
+ *                  (sample & mask) == (value & mask). Mask 0 triggers on
+ *                  the first sample.
+ *
+ *                M31_CAP_PRETRIG sets the number of samples before the
+ *                  trigger that are kept (must be less than CAP_BUF_SIZE).
+ *
+ *                M31_CAP_CTRL controls the capture:
+ *                  M31_CAP_START  discard old samples, start sampling and
+ *                                 arm the trigger
+ *                  M31_CAP_STOP   stop sampling (samples remain readable)
+ *                  M31_CAP_FORCE  force the trigger
+ *                  The capture settings can't be changed while sampling
+ *                  (ERR_LL_DEV_BUSY).
+ *
+ *                M31_CAP_FORMAT sets the format of the capture buffer and
+ *                  of the data returned in block read mode
+ *                  M31_BLKMODE_CAPTURE. Pending samples are discarded.
+ *                  M31_CAPFMT_RAW  one u_int16 per sample (default)
+ *                  M31_CAPFMT_RLE  run length encoded: one M31_RLE_REC
+ *                                  (state, repeat count 1..65535) per run
+ *                                  of equal samples. Consecutive runs may
+ *                                  have the same state. The time of a run
+ *                                  is count * sample period.
+ *
  *---------------------------------------------------------------------------
  *  Input......:  llHdl             low-level handle
  *                code              status code
@@ -448,12 +1507,16 @@ static int32 M31_SetStat(
 )
 {
 	int32 error = ERR_SUCCESS;
-	int16 reg;
     int32       value = (int32)value32_or_64;
     /*INT32_OR_64 valueP = value32_or_64; */
+	M_SG_BLOCK  *blk = (M_SG_BLOCK*)value32_or_64;
+	OSS_IRQ_STATE irqState;
+	u_int32		fld;
 
-    DBGWRT_1((DBH, "LL - M31_SetStat: ch=%d code=0x%04x value=%08p\n",
-			  ch,code,value));
+	TRACE(M31_TR_SETSTAT, ch, code);
+
+	if ((error = ChCodeCheck(code, ch)))
+		return(error);
 
     switch(code) {
         /* -------- common setstat codes ----------- */
@@ -480,17 +1543,28 @@ static int32 M31_SetStat(
         |  enable interrupts        |
         +--------------------------*/
         case M_MK_IRQ_ENABLE:
-			/* enable irq */
-			if(value){
+			/* enable irq (keep states if already enabled) */
+			if(value && !llHdl->irqEnable){
 				/* save current states */
 				llHdl->lastState = MREAD_D16(llHdl->ma, DATA_REG);	
 				/* clear change flags */
 				llHdl->changeFlags = 0x00;
+				llHdl->lastChange = 0x00;
+				/* restart debouncing */
+				llHdl->dbState = llHdl->lastState;
+				llHdl->dbPend = 0x00;
+				/* restart channel fields */
+				for (fld=0; fld<FLD_NUMBER; fld++)
+					FieldReset(llHdl, fld);
+				/* restart rules */
+				for (fld=0; fld<RULE_NUMBER; fld++)
+					llHdl->ruleStep[fld] = 0;
+				llHdl->ruleDl = 0x00;
 				/* irq is enabled */
 				llHdl->irqEnable = TRUE;
 			}
 			/* disable irq */
-			else{
+			else if(!value){
 				/* irq is disabled */
 				llHdl->irqEnable = FALSE;
 			}
@@ -540,39 +1614,270 @@ static int32 M31_SetStat(
         +--------------------------*/
         case M31_HYS_MODE:
 			/* M82 only */
-			if( llHdl->modId == MOD_ID_M82 ){
-				/* set hysteresis mode for current channel */
-				reg = MREAD_D16(llHdl->ma, MODE_REG);
-				if( value )
-					reg |= 0x01 << ch;
-				else
-					reg &= ~(0x01 << ch);
-				MWRITE_D16(llHdl->ma, MODE_REG, reg);
-			}
-			else {
-	          error = ERR_LL_UNK_CODE;
-			}
+			if ((error = HysShadowGet(llHdl)))
+				break;
+
+			/* set hysteresis mode for current channel */
+			if( value )
+				llHdl->hysMask |= 0x01 << ch;
+			else
+				llHdl->hysMask &= ~(0x01 << ch);
+			MWRITE_D16(llHdl->ma, MODE_REG, llHdl->hysMask);
+			break;
+        case M31_HYS_MASK:
+			/* M82 only */
+			if ((error = HysShadowGet(llHdl)))
+				break;
+
+			/* set hysteresis mode for all channels */
+			llHdl->hysMask = (u_int16)value;
+			MWRITE_D16(llHdl->ma, MODE_REG, llHdl->hysMask);
 			break;
         /*--------------------------+
-        |  (unknown)                |
+        |  notification             |
         +--------------------------*/
-        default:
-            error = ERR_LL_UNK_CODE;
-    }
+        case M31_SIG_MASK:
+			llHdl->sigMask = (u_int16)value;
+			break;
+        case M31_EDGE_RISE:
+			llHdl->edgeRise = (u_int16)value;
+			break;
+        case M31_EDGE_FALL:
+			llHdl->edgeFall = (u_int16)value;
+			break;
+        case M31_SIG_COALESCE:
+			error = SigCoalesceSet(llHdl, (u_int32)value);
+			break;
+        /*--------------------------+
+        |  debounce                 |
+        +--------------------------*/
+        case M31_DEBOUNCE:
+			error = DbSet(llHdl, ch, (u_int32)value);
+			break;
+        case M31_GLITCHES:
+			llHdl->glitches[ch] = value;
+			break;
+        /*--------------------------+
+        |  strobed words            |
+        +--------------------------*/
+        case M31_STROBE_CH:
+        case M31_STROBE_EDGE:
+			if (llHdl->stbSize == 0)
+				return(ERR_LL_ILL_PARAM);
 
-	return(error);
-}
+			if ((code == M31_STROBE_CH &&
+				 (value < 0 || value >= CH_NUMBER)) ||
+				(code == M31_STROBE_EDGE &&
+				 (value < 0 || value > M31_STROBE_BOTH)))
+				return(ERR_LL_ILL_PARAM);
 
-/****************************** M31_GetStat **********************************
- *
- *  Description:  Get driver status
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			if (code == M31_STROBE_CH)
+				llHdl->stbBit = (u_int16)(1 << value);
+			else
+				llHdl->stbEdge = (u_int8)value;
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+        case M31_STROBE_LOST:
+			llHdl->stbLost = value;
+			break;
+        /*--------------------------+
+        |  channel fields           |
+        +--------------------------*/
+        case M31_BLK_FIELD_DEF:
+			if (blk->size < (int32)sizeof(M31_FIELD_DEF))
+				return(ERR_LL_USERBUF);
+			error = FieldSet(llHdl, (M31_FIELD_DEF*)blk->data);
+			break;
+        /*--------------------------+
+        |  sequence rules           |
+        +--------------------------*/
+        case M31_BLK_RULES:
+			if (blk->size % sizeof(M31_RULE) ||
+				blk->size > (int32)(RULE_NUMBER * sizeof(M31_RULE)))
+				return(ERR_LL_ILL_PARAM);
+			error = RuleLoad(llHdl, (M31_RULE*)blk->data,
+							 blk->size / sizeof(M31_RULE));
+			break;
+        /*--------------------------+
+        |  quadrature decoder       |
+        +--------------------------*/
+        case M31_QUAD_MASK:
+			if (value & ~0xff)
+				return(ERR_LL_ILL_PARAM);
+			QuadSet(llHdl, value);
+			break;
+        case M31_QUAD_POS:
+			llHdl->quadPos[ch/2] = value;
+			break;
+        case M31_QUAD_ERRORS:
+			llHdl->quadErr[ch/2] = value;
+			break;
+        /*--------------------------+
+        |  refresh id prom cache    |
+        +--------------------------*/
+        case M31_ID_REFRESH:
+			llHdl->idRead = FALSE;
+			llHdl->idFull = FALSE;
+			error = IdPromGet(llHdl, TRUE);
+			break;
+        /*--------------------------+
+        |  clear ISR timing stats   |
+        +--------------------------*/
+        case M31_ISR_STAT_CLR:
+		{
+			u_int32 n;
+
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			llHdl->isrCount = 0;
+			llHdl->isrMax   = 0;
+			llHdl->isrMaxTs = 0;
+			for (n=0; n<HIST_BUCKETS; n++)
+				llHdl->isrHist[n] = 0;
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			break;
+		}
+#ifdef M31_OWN_LOCK
+        /*--------------------------+
+        |  clear lock statistics    |
+        +--------------------------*/
+        case M31_LOCK_STAT_CLR:
+			/* called with the lock held */
+			OSS_MemFill(llHdl->osHdl, sizeof(llHdl->lockCount),
+						(char*)llHdl->lockCount, 0x00);
+			OSS_MemFill(llHdl->osHdl, sizeof(llHdl->lockCont),
+						(char*)llHdl->lockCont, 0x00);
+			OSS_MemFill(llHdl->osHdl, sizeof(llHdl->lockWaitMax),
+						(char*)llHdl->lockWaitMax, 0x00);
+			OSS_MemFill(llHdl->osHdl, sizeof(llHdl->lockHoldMax),
+						(char*)llHdl->lockHoldMax, 0x00);
+			OSS_MemFill(llHdl->osHdl, sizeof(llHdl->lockWaitHist),
+						(char*)llHdl->lockWaitHist, 0x00);
+			OSS_MemFill(llHdl->osHdl, sizeof(llHdl->lockHoldHist),
+						(char*)llHdl->lockHoldHist, 0x00);
+			break;
+#endif
+        /*--------------------------+
+        |  binary trace enable      |
+        +--------------------------*/
+        case M31_TRACE_ENABLE:
+			if (llHdl->trcSize == 0)
+				return(ERR_LL_ILL_PARAM);
+
+			llHdl->trcEnable = value ? TRUE : FALSE;
+			break;
+        /*--------------------------+
+        |  block read mode          |
+        +--------------------------*/
+        case M31_BLK_MODE:
+			if (value != M31_BLKMODE_STATE &&
+				value != M31_BLKMODE_EVENT &&
+				value != M31_BLKMODE_CAPTURE &&
+				value != M31_BLKMODE_STROBE)
+				return(ERR_LL_ILL_PARAM);
+
+			llHdl->blkMode = (u_int8)value;
+			break;
+        /*--------------------------+
+        |  lost event counter       |
+        +--------------------------*/
+        case M31_EVENT_LOST:
+			llHdl->evLost = value;
+			break;
+        /*--------------------------+
+        |  lost edge counter        |
+        +--------------------------*/
+        case M31_LOST_EDGES:
+			llHdl->lostEdges[ch] = value;
+			break;
+        /*--------------------------+
+        |  capture settings         |
+        +--------------------------*/
+        case M31_CAP_PERIOD:
+        case M31_CAP_TRIG_MASK:
+        case M31_CAP_TRIG_VALUE:
+        case M31_CAP_PRETRIG:
+        case M31_CAP_FORMAT:
+			if (llHdl->capSize == 0)
+				return(ERR_LL_ILL_PARAM);
+
+			if (llHdl->capState == M31_CAPST_ARMED ||
+				llHdl->capState == M31_CAPST_TRIGGERED)
+				return(ERR_LL_DEV_BUSY);
+
+			switch (code) {
+			case M31_CAP_PERIOD:
+				if (value < (int32)CapMinPeriod(llHdl))
+					return(ERR_LL_ILL_PARAM);
+				llHdl->capPeriod = value;
+				break;
+			case M31_CAP_TRIG_MASK:
+				llHdl->capTrigMask = (u_int16)value;
+				break;
+			case M31_CAP_TRIG_VALUE:
+				llHdl->capTrigValue = (u_int16)value;
+				break;
+			case M31_CAP_FORMAT:
+				if (value != M31_CAPFMT_RAW && value != M31_CAPFMT_RLE)
+					return(ERR_LL_ILL_PARAM);
+				/* discard samples of the old format */
+				OSS_SpinLockAcquire(llHdl->osHdl, llHdl->capLock);
+				llHdl->capFormat = (u_int8)value;
+				llHdl->capGet    = llHdl->capPut;
+				llHdl->capRunCnt = 0;
+				OSS_SpinLockRelease(llHdl->osHdl, llHdl->capLock);
+				break;
+			default:
+				llHdl->capPreTrig = value;
+			}
+			break;
+        /*--------------------------+
+        |  capture control          |
+        +--------------------------*/
+        case M31_CAP_CTRL:
+			if (llHdl->capSize == 0)
+				return(ERR_LL_ILL_PARAM);
+
+			switch (value) {
+			case M31_CAP_START:
+				error = CapStart(llHdl);
+				break;
+			case M31_CAP_STOP:
+				CapStop(llHdl);
+				break;
+			case M31_CAP_FORCE:
+				OSS_SpinLockAcquire(llHdl->osHdl, llHdl->capLock);
+				if (llHdl->capState == M31_CAPST_ARMED) {
+					llHdl->capState = M31_CAPST_TRIGGERED;
+					llHdl->capPreTrigCnt = llHdl->capHeld;
+					llHdl->capTrigTs = TsGet(llHdl);
+				}
+				OSS_SpinLockRelease(llHdl->osHdl, llHdl->capLock);
+				break;
+			default:
+				error = ERR_LL_ILL_PARAM;
+			}
+			break;
+        /*--------------------------+
+        |  (unknown)                |
+        +--------------------------*/
+        default:
+            error = ERR_LL_UNK_CODE;
+    }
+
+	return(error);
+}
+
+/****************************** M31_GetStat **********************************
+ *
+ *  Description:  Get driver status
  *
  *                The following status codes are supported:
  *
  *                Code                 Description                Values
  *                -------------------  -------------------------  ----------
  *                M_LL_DEBUG_LEVEL     driver debug level         see dbg.h
- *                M_LL_CH_NUMBER       number of channels         16
+ *                M_LL_CH_NUMBER       number of channels         16 (*N)
  *                M_LL_CH_DIR          direction of curr chan     M_CH_IN
  *                M_LL_CH_LEN          length of curr chan [bits] 1..max
  *                M_LL_CH_TYP          description of curr chan   M_CH_BINARY
@@ -584,6 +1889,50 @@ static int32 M31_SetStat(
  *                M31_SIGSET		   get signal				  1..max
  *                M31_CHANGE_FLAGS	   get change flags			  0x00..0xff
  *                M31_HYS_MODE (M82)   hysteresis of curr chan    0..1
+ *                M31_HYS_MASK (M82)   hysteresis of all channels 0..0xffff
+ *                M31_TS_FREQ          timestamp frequency [Hz]   1..max
+ *                M31_BLK_ISR_STAT     ISR timing statistics      M31_ISR_STAT
+ *                M31_TRACE_ENABLE     binary trace enabled       0..1
+ *                M31_BLK_TRACE        binary trace records       M31_TRACE_REC
+ *                M31_BLK_MODE         block read mode            0..3
+ *                M31_EVENT_COUNT      nr of pending events       0..max
+ *                M31_EVENT_LOST       lost event counter         0..max
+ *                M31_LOST_EDGES       lost edges of curr chan    0..max
+ *                M31_BLK_LOST_EDGES   lost edge counters         M31_LOST_STAT
+ *                M31_CAP_PERIOD       capture sample period [us] tick..max
+ *                M31_CAP_TRIG_MASK    capture trigger mask       0..0xffff
+ *                M31_CAP_TRIG_VALUE   capture trigger value      0..0xffff
+ *                M31_CAP_PRETRIG      pre-trigger samples        0..size-1
+ *                M31_CAP_CTRL         capture state              0..3
+ *                M31_CAP_FORMAT       capture buffer format      0..1
+ *                M31_BLK_CAP_INFO     capture info               M31_CAP_INFO
+ *                M31_SIG_MASK         channels sending signal    0..0xffff
+ *                M31_EDGE_RISE        channels rising edges      0..0xffff
+ *                M31_EDGE_FALL        channels falling edges     0..0xffff
+ *                M31_SIG_COALESCE     signal coalescing [ms]     0..max
+ *                M31_DEBOUNCE         debounce time of curr chan 0..max [us]
+ *                M31_GLITCHES         glitches of curr chan      0..max
+ *                M31_BLK_GLITCHES     glitches of all channels   u_int32[16]
+ *                M31_QUAD_MASK        quadrature decoded pairs   0..0xff
+ *                M31_QUAD_POS         position of curr pair      int32
+ *                M31_QUAD_DIR         direction of curr pair     -1, 0, 1
+ *                M31_QUAD_ERRORS      errors of curr pair        0..max
+ *                M31_BLK_QUAD         all pairs                  M31_QUAD[8]
+ *                M31_STROBE_CH        strobe channel             0..15
+ *                M31_STROBE_EDGE      strobe edge                0..3
+ *                M31_STROBE_COUNT     nr of pending words        0..max
+ *                M31_STROBE_LOST      lost word counter          0..max
+ *                M31_FIELD_VALUE      value of field of curr ch  0..max
+ *                M31_BLK_FIELD_DEF    all field definitions      M31_FIELD_DEF[8]
+ *                M31_BLK_FIELD_STAT   all field values           M31_FIELD_STAT[8]
+ *                M31_BLK_RULES        rule table                 M31_RULE[8]
+ *                M31_BLK_LAST_CHANGE  last change of all chans   M31_LAST_CHANGE[16]
+ *                M31_BLK_COUNTERS     activity counters          M31_COUNTERS
+ *                M31_BLK_LOCK_STAT    lock statistics            M31_LOCK_STAT[6]
+ *                M31_BLK_RULE_STAT    rule states and counters   M31_RULE_STAT[8]
+ *                M31_AGGR_MEMBERS     registered group members   0..0xff
+ *                M31_READY_MASK       ready devices of group     0..0xffffffff
+ *                M31_BLK_AGGR_CHANGE  change flags of all modules u_int16[N]
  *                -------------------  -------------------------  ----------
  *
  *                M31_SIGSET gets the signal number of the installed user
@@ -596,7 +1945,9 @@ static int32 M31_SetStat(
  *                  belonging channel was changed from 0 to 1 or vice versa
  *                  (regardless how often). The flags are reset to 0 after this
  *                  GetStat call or when the interrupt is enabled (SetStat
- *                  code M_MK_IRQ_ENABLE).
+ *                  code M_MK_IRQ_ENABLE). On a member (AGGR_INDEX > 0) of an
+ *                  aggregate device with AGGR_EXCLUSIVE=1 the flags belong
+ *                  to the master (M31_BLK_AGGR_CHANGE): ERR_LL_DEV_BUSY.
  *
  *                M31_HYS_MODE gets the hysteresis mode of the current channel:
  *                  0 = Hysteresis Mode B; 5.5V..15.5V
@@ -604,6 +1955,119 @@ static int32 M31_SetStat(
  *                  This GetStat code can only be used for M82 M-Modules but
  *                  not for M31/M32 M-Modules.
  *
+ *                M31_HYS_MASK gets the hysteresis mode of all channels.
+ *                  Bits 15..0 correspond to channels 15..0. M82 only.
+ *
+ *                The hysteresis modes are read from a shadow copy of the
+ *                mode register, which is loaded on first use.
+ *
+ *                M31_TS_FREQ gets the frequency of the timestamp counter
+ *                  used for all driver timestamps and time measurements.
+ *                  The counter is calibrated in M31_Init of the first
+ *                  device. Without a CPU counter, this is the OSS tick
+ *                  rate (no high resolution timestamps).
+ *
+ *                M31_BLK_ISR_STAT gets the ISR execution time statistics
+ *                  (see M31_ISR_STAT in m31_drv.h). All times are given in
+ *                  timestamp counts (see M31_TS_FREQ). hist[n] counts the
+ *                  interrupts with an execution time of 2^n..2^(n+1)-1
+ *                  counts (hist[0] includes 0). Without a CPU counter the
+ *                  execution time is not measured and count stays 0.
+ *
+ *                M31_BLK_TRACE gets the trace records written since the
+ *                  last call, oldest first, as many as fit into the buffer.
+ *                  The records are removed from the trace ring. If records
+ *                  were overwritten by the writer, an M31_TR_LOST record
+ *                  with the number of lost records comes first. The buffer
+ *                  must hold at least two records. blk->size is set to the
+ *                  number of bytes returned.
+ *
+ *                M31_EVENT_COUNT gets the number of event records pending
+ *                  in the event FIFO.
+ *
+ *                M31_EVENT_LOST gets the number of event records lost
+ *                  because the event FIFO was full.
+ *
+ *                M31_LOST_EDGES gets the number of possible lost edges of
+ *                  the current channel (interrupts without visible state
+ *                  change attributed to the channel).
+ *
+ *                M31_BLK_LOST_EDGES gets all lost edge counters (see
+ *                  M31_LOST_STAT in m31_drv.h).
+ *
+ *                M31_CAP_CTRL gets the capture state (M31_CAPST_xxx).
+ *
+ *                M31_BLK_CAP_INFO gets the capture state, the effective
+ *                  sample period and the trigger timestamp (see M31_CAP_INFO
+ *                  in m31_drv.h). Sample n read since M31_CAP_START was
+ *                  taken at trigTs + (n - preTrig) * period, exactly only
+ *                  while gaps is 0: gaps counts the timer calls delayed by
+ *                  a period or more (samples missing in between). count is the
+ *                  number of pending samples (M31_CAPFMT_RAW) or runs
+ *                  (M31_CAPFMT_RLE), lost the number of lost samples.
+ *
+ *                M31_GLITCHES gets the nr of suppressed glitches of the
+ *                  current channel (pulses shorter than the debounce time).
+ *                  M31_BLK_GLITCHES gets the counters of all channels.
+ *
+ *                M31_QUAD_POS, M31_QUAD_DIR and M31_QUAD_ERRORS get the
+ *                  position, last direction (1 = A leads B, -1 = B leads A,
+ *                  0 = no step yet) and nr of illegal transitions of the
+ *                  pair of the current channel. M31_BLK_QUAD gets all
+ *                  eight pairs at once (see M31_QUAD in m31_drv.h).
+ *
+ *                M31_STROBE_COUNT gets the number of words pending in the
+ *                  word FIFO, M31_STROBE_LOST the number of words lost
+ *                  because the FIFO was full.
+ *
+ *                M31_FIELD_VALUE gets the settled value of the field which
+ *                  contains the current channel. Fails with ERR_LL_ILL_PARAM
+ *                  if the channel is in no field or the field has no valid
+ *                  value yet. M31_BLK_FIELD_DEF gets the definitions and
+ *                  M31_BLK_FIELD_STAT the values and counters of all eight
+ *                  fields (see M31_FIELD_STAT in m31_drv.h).
+ *
+ *                M31_BLK_LAST_CHANGE gets the timestamp and the new level
+ *                  of the last transition of each channel (raw input, seen
+ *                  by the ISR). valid is 0 if the channel did not change
+ *                  since init. M31_EVF_LOST_EDGE is set in flags if a
+ *                  possible lost edge (double toggle) was attributed to the
+ *                  channel after this transition.
+ *
+ *                M31_BLK_COUNTERS gets the activity counters of the device
+ *                  in one call (see M31_COUNTERS in m31_drv.h), e.g. for
+ *                  monitoring. changes[n] counts the level changes of
+ *                  channel n (the edges behind M31_CHANGE_FLAGS); unlike
+ *                  M31_CHANGE_FLAGS, reading does not clear anything.
+ *                  irqs, eventLost and strobeLost follow their set/getstat
+ *                  codes, the other counters are never reset.
+ *
+ *                M31_BLK_LOCK_STAT gets the device lock statistics, one
+ *                  M31_LOCK_STAT per entry point (index M31_LOCK_xxx, see
+ *                  m31_drv.h). Times are given in timestamp counts (see
+ *                  M31_TS_FREQ); hold times include the statistics update.
+ *                  Only in M31_OWN_LOCK builds (driver variant m31_ownlock),
+ *                  else ERR_LL_UNK_CODE.
+ *
+ *                M31_BLK_RULES gets the loaded rule table (disabled rules
+ *                  are empty), M31_BLK_RULE_STAT the current step and the
+ *                  completion and violation counters of all rules.
+ *
+ *                M31_AGGR_MEMBERS gets a bit mask of the modules which are
+ *                  registered in the aggregate group of the device (bit n =
+ *                  module index n). 0 if the device is no group member.
+ *
+ *                M31_READY_MASK gets and clears the ready mask of the ready
+ *                  group of the device (bit n = device with READY_INDEX n
+ *                  had a reportable change since the last call). Any
+ *                  member can be asked. Fails with ERR_LL_ILL_PARAM if the
+ *                  device is no ready group member.
+ *
+ *                M31_BLK_AGGR_CHANGE gets the change flags (see
+ *                  M31_CHANGE_FLAGS) of all modules of an aggregate device
+ *                  (master only), one u_int16 per module, and clears them.
+ *                  Modules without enabled interrupt yield 0.
+ *
  *---------------------------------------------------------------------------
  *  Input......:  llHdl             low-level handle
  *                code              status code
@@ -630,10 +2094,11 @@ static int32 M31_GetStat(
 
 	int32 error = ERR_SUCCESS;
     int32 dummy;
-	int16 data;
     
-	DBGWRT_1((DBH, "LL - M31_GetStat: ch=%d code=0x%04x\n",
-			  ch,code));
+	TRACE(M31_TR_GETSTAT, ch, code);
+
+	if ((error = ChCodeCheck(code, ch)))
+		return(error);
 
     switch(code)
     {
@@ -648,7 +2113,8 @@ static int32 M31_GetStat(
         |  nr of channels           |
         +--------------------------*/
         case M_LL_CH_NUMBER:
-            *valueP = CH_NUMBER;
+            *valueP = llHdl->aggrCount ? CH_NUMBER * llHdl->aggrCount
+									   : CH_NUMBER;
             break;
         /*--------------------------+
         |  channel direction        |
@@ -697,8 +2163,11 @@ static int32 M31_GetStat(
 			if (blk->size < MOD_ID_SIZE)		/* check buf size */
 				return(ERR_LL_USERBUF);
 
-			for (n=0; n<MOD_ID_SIZE/2; n++)		/* read MOD_ID_SIZE/2 words */
-				*dataP++ = (u_int16)m_read((U_INT32_OR_64)llHdl->ma, n);
+			/* served from cache, also if the id check failed */
+			IdPromGet(llHdl, TRUE);
+
+			for (n=0; n<MOD_ID_SIZE/2; n++)		/* copy MOD_ID_SIZE/2 words */
+				*dataP++ = llHdl->idProm[n];
 
 			break;
 		}
@@ -725,6 +2194,9 @@ static int32 M31_GetStat(
         |  change flags             |
         +--------------------------*/
         case M31_CHANGE_FLAGS:
+			if (AGGR_MEMBER(llHdl))
+				return(ERR_LL_DEV_BUSY);	/* consumed by the master */
+
 			if(llHdl->irqEnable){
 				*valueP = (int32)llHdl->changeFlags;
 				llHdl->changeFlags = 0x00;
@@ -738,307 +2210,3654 @@ static int32 M31_GetStat(
         +--------------------------*/
         case M31_HYS_MODE:
 			/* M82 only */
-			if( llHdl->modId == MOD_ID_M82 ){
-				/* get hysteresis mode for current channel */
-				data = MREAD_D16(llHdl->ma, MODE_REG);
-				*valueP = (int32)( (data >> ch) & 0x01 );
-			}
-			else {
-	          error = ERR_LL_UNK_CODE;
-			}
+			if ((error = HysShadowGet(llHdl)))
+				break;
+
+			/* get hysteresis mode for current channel */
+			*valueP = (int32)( (llHdl->hysMask >> ch) & 0x01 );
 			break;
-       /*--------------------------+
-        |  (unknown)                |
+        case M31_HYS_MASK:
+			/* M82 only */
+			if ((error = HysShadowGet(llHdl)))
+				break;
+
+			/* get hysteresis mode for all channels */
+			*valueP = (int32)llHdl->hysMask;
+			break;
+        /*--------------------------+
+        |  timestamp frequency      |
         +--------------------------*/
-        default:
-            error = ERR_LL_UNK_CODE;
-    }
+        case M31_TS_FREQ:
+			*valueP = (int32)TsFreqGet(llHdl);
+			break;
+        /*--------------------------+
+        |  ISR timing statistics    |
+        +--------------------------*/
+        case M31_BLK_ISR_STAT:
+		{
+			M31_ISR_STAT *statP = (M31_ISR_STAT*)blk->data;
+			OSS_IRQ_STATE irqState;
+			u_int32 n;
 
-	return(error);
-}
+			if (blk->size < (int32)sizeof(M31_ISR_STAT))	/* check buf size */
+				return(ERR_LL_USERBUF);
 
-/******************************* M31_BlockRead *******************************
- *
- *  Description:  Read the state of all 16 channels
- *
- *                Bits 15..0 of the first two bytes of the data buffer (buf)
- *                correspond to channels 15..0.
- *
- *---------------------------------------------------------------------------
- *  Input......:  llHdl        low-level handle
- *                ch           current channel
- *                buf          data buffer
- *                size         data buffer size (minimum: two bytes)
- *
- *  Output.....:  nbrRdBytesP  number of read bytes
- *                return       success (0) or error code
- *
- *  Globals....:  -
- ****************************************************************************/
-static int32 M31_BlockRead(
-     LL_HANDLE	*llHdl,
-     int32		ch,
-     void		*buf,
-     int32		size,
-     int32		*nbrRdBytesP
-)
-{
-	DBGWRT_1((DBH, "LL - M31_BlockRead: ch=%d, size=%d\n",ch,size));
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			statP->count     = llHdl->isrCount;
+			statP->max       = llHdl->isrMax;
+			statP->maxTsHigh = (u_int32)(llHdl->isrMaxTs >> 32);
+			statP->maxTsLow  = (u_int32)llHdl->isrMaxTs;
+			for (n=0; n<HIST_BUCKETS; n++)
+				statP->hist[n] = llHdl->isrHist[n];
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
 
-	/* return nr of read bytes */
-	*nbrRdBytesP = 0;
+			blk->size = sizeof(M31_ISR_STAT);
+			break;
+		}
+        /*--------------------------+
+        |  binary trace             |
+        +--------------------------*/
+        case M31_TRACE_ENABLE:
+			*valueP = (int32)llHdl->trcEnable;
+			break;
 
-	if (size < 2)
-		return ERR_LL_USERBUF;
+        case M31_BLK_TRACE:
+		{
+			M31_TRACE_REC *recP = (M31_TRACE_REC*)blk->data;
+			M31_TRACE_REC *trcBuf = (M31_TRACE_REC*)llHdl->trcBuf;
+			u_int32 max = blk->size / sizeof(M31_TRACE_REC);
+			u_int32 n = 0, lost;
+			OSS_IRQ_STATE irqState;
 
-	*((u_int16*)buf) = MREAD_D16(llHdl->ma, DATA_REG);
+			if (max < 2)						/* check buf size */
+				return(ERR_LL_USERBUF);
 
-	*nbrRdBytesP = 2;
+			if (llHdl->trcSize) {
+				irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
 
-	return(ERR_SUCCESS);
-}
+				/* oldest records overwritten? */
+				lost = llHdl->trcPut - llHdl->trcGet;
+				if (lost > llHdl->trcSize) {
+					lost -= llHdl->trcSize;
+					llHdl->trcGet += lost;
 
-/****************************** M31_BlockWrite *******************************
- *
- *  Description:  Write data block to device (unused)
- *
- *---------------------------------------------------------------------------
- *  Input......:  llHdl        low-level handle
- *                ch           current channel
- *                buf          data buffer
- *                size         data buffer size
- *
- *  Output.....:  nbrWrBytesP  number of written bytes
- *                return       ERR_LL_ILL_FUNC
- *
- *  Globals....:  -
- ****************************************************************************/
-static int32 M31_BlockWrite(
-     LL_HANDLE	*llHdl,
-     int32		ch,
-     void		*buf,
-     int32		size,
-     int32		*nbrWrBytesP
-)
-{
-    DBGWRT_1((DBH, "LL - M31_BlockWrite: ch=%d, size=%d\n",ch,size));
+					recP->code   = M31_TR_LOST;
+					recP->ch     = 0;
+					recP->value  = lost;
+					recP->tsHigh = 0;
+					recP->tsLow  = 0;
+					n++;
+				}
 
-	/* return nr of written bytes */
-	*nbrWrBytesP = 0;
+				for (; n < max && llHdl->trcGet != llHdl->trcPut; n++)
+					recP[n] = trcBuf[llHdl->trcGet++ & (llHdl->trcSize-1)];
 
-	return(ERR_LL_ILL_FUNC);
-}
+				OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+			}
 
+			blk->size = n * sizeof(M31_TRACE_REC);
+			break;
+		}
+        /*--------------------------+
+        |  block read mode          |
+        +--------------------------*/
+        case M31_BLK_MODE:
+			*valueP = (int32)llHdl->blkMode;
+			break;
+        /*--------------------------+
+        |  event fifo               |
+        +--------------------------*/
+        case M31_EVENT_COUNT:
+			*valueP = (int32)(llHdl->evPut - llHdl->evGet);
+			break;
 
-/****************************** M31_Irq *************************************
- *
- *  Description:  Interrupt service routine
- *
- *                The interrupt is triggered when any input level changes.
- *                For each channel a level change will be stored in a flag.
- *                If a user signal is installed, the signal will be sent.
- *
- *                If the driver can detect the interrupt cause it returns
- *                LL_IRQ_DEVICE or LL_IRQ_DEV_NOT, otherwise LL_IRQ_UNKNOWN.
- *
- *---------------------------------------------------------------------------
- *  Input......:  llHdl    low-level handle
- *
- *  Output.....:  return   LL_IRQ_UNKNOWN
- *
- *  Globals....:  -
- ****************************************************************************/
-static int32 M31_Irq(
-   LL_HANDLE *llHdl
-)
-{
-	u_int16 currState;
-    IDBGWRT_1((DBH, "LL - M31_Irq:\n"));
+        case M31_EVENT_LOST:
+			*valueP = (int32)llHdl->evLost;
+			break;
+        /*--------------------------+
+        |  lost edge counters       |
+        +--------------------------*/
+        case M31_LOST_EDGES:
+			*valueP = (int32)llHdl->lostEdges[ch];
+			break;
 
-	/* get current states */	
-	currState = MREAD_D16(llHdl->ma, DATA_REG);
+        case M31_BLK_LOST_EDGES:
+		{
+			M31_LOST_STAT *lostP = (M31_LOST_STAT*)blk->data;
+			OSS_IRQ_STATE irqState;
+			u_int32 n;
 
-	/* save level changes */
-	llHdl->changeFlags |= llHdl->lastState ^ currState;
-	llHdl->lastState = currState;
+			if (blk->size < (int32)sizeof(M31_LOST_STAT))	/* check buf size */
+				return(ERR_LL_USERBUF);
 
-	/* signal installed? */
-	if(llHdl->sigHdl){
-		/* send signal */
-		OSS_SigSend(llHdl->osHdl, llHdl->sigHdl);
-	}
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			lostP->irqs         = llHdl->lostIrqs;
+			lostP->unattributed = llHdl->lostUnattr;
+			for (n=0; n<CH_NUMBER; n++)
+				lostP->ch[n] = llHdl->lostEdges[n];
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
 
-	/* clear interrupt */
-	MREAD_D16(llHdl->ma, IRQCRL_REG);
+			blk->size = sizeof(M31_LOST_STAT);
+			break;
+		}
+        /*--------------------------+
+        |  capture                  |
+        +--------------------------*/
+        case M31_CAP_PERIOD:
+			*valueP = (int32)llHdl->capPeriod;
+			break;
 
-	/* not my interrupt */
-	return LL_IRQ_UNKNOWN;
-}
+        case M31_CAP_TRIG_MASK:
+			*valueP = (int32)llHdl->capTrigMask;
+			break;
 
-/****************************** M31_Info ************************************
- *
- *  Description:  Get driver info
- *
- *                The following info codes are supported:
- *
- *                Code                      Description
- *                ------------------------  -----------------------------
- *                LL_INFO_HW_CHARACTER      hardware characteristics
- *                LL_INFO_ADDRSPACE_COUNT   nr of required address spaces
- *                LL_INFO_ADDRSPACE         address space type
- *                LL_INFO_IRQ               interrupt required
- *                LL_INFO_LOCKMODE 			process locking required (LL_LOCK_xxx).
- *
- *
- *---------------------------------------------------------------------------
- *  Input......:  infoType	   info code
- *                ...          argument(s)
- *
- *  Output.....:  return       success (0) or error code
- *
- *  Globals....:  -
- ****************************************************************************/
+        case M31_CAP_TRIG_VALUE:
+			*valueP = (int32)llHdl->capTrigValue;
+			break;
+
+        case M31_CAP_PRETRIG:
+			*valueP = (int32)llHdl->capPreTrig;
+			break;
+
+        case M31_CAP_CTRL:
+			*valueP = (int32)llHdl->capState;
+			break;
+
+        case M31_CAP_FORMAT:
+			*valueP = (int32)llHdl->capFormat;
+			break;
+        /*--------------------------+
+        |  notification             |
+        +--------------------------*/
+        case M31_SIG_MASK:
+			*valueP = (int32)llHdl->sigMask;
+			break;
+
+        case M31_EDGE_RISE:
+			*valueP = (int32)llHdl->edgeRise;
+			break;
+
+        case M31_EDGE_FALL:
+			*valueP = (int32)llHdl->edgeFall;
+			break;
+
+        case M31_SIG_COALESCE:
+			*valueP = (int32)llHdl->sigCoalesce;
+			break;
+        /*--------------------------+
+        |  debounce                 |
+        +--------------------------*/
+        case M31_DEBOUNCE:
+			*valueP = (int32)llHdl->dbTime[ch];
+			break;
+
+        case M31_GLITCHES:
+			*valueP = (int32)llHdl->glitches[ch];
+			break;
+
+        /*--------------------------+
+        |  strobed words            |
+        +--------------------------*/
+        case M31_STROBE_CH:
+			*valueP = (int32)Log2Bucket(llHdl->stbBit);
+			break;
+
+        case M31_STROBE_EDGE:
+			*valueP = (int32)llHdl->stbEdge;
+			break;
+
+        case M31_STROBE_COUNT:
+			*valueP = (int32)(llHdl->stbPut - llHdl->stbGet);
+			break;
+
+        case M31_STROBE_LOST:
+			*valueP = (int32)llHdl->stbLost;
+			break;
+        /*--------------------------+
+        |  channel fields           |
+        +--------------------------*/
+        case M31_FIELD_VALUE:
+		{
+			int32 fld = FieldOfCh(llHdl, ch);
+
+			if (fld < 0 || !(llHdl->fldValid & (1 << fld)))
+				return(ERR_LL_ILL_PARAM);
+			*valueP = (int32)llHdl->fldValue[fld];
+			break;
+		}
+
+        case M31_BLK_FIELD_DEF:
+		{
+			M31_FIELD_DEF *defP = (M31_FIELD_DEF*)blk->data;
+			u_int32 n;
+
+			if (blk->size < (int32)(FLD_NUMBER * sizeof(M31_FIELD_DEF)))
+				return(ERR_LL_USERBUF);
+
+			for (n=0; n<FLD_NUMBER; n++) {
+				OSS_MemCopy(llHdl->osHdl, FLD_NAME_LEN, llHdl->fldName[n],
+							defP[n].name);
+				defP[n].field  = (u_int8)n;
+				defP[n].first  = llHdl->fldFirst[n];
+				defP[n].width  = (u_int8)Log2Bucket(
+					(llHdl->fldMask[n] >> llHdl->fldFirst[n]) + 1);
+				defP[n].code   = llHdl->fldCode[n];
+				defP[n].settle = llHdl->fldSettle[n];
+			}
+
+			blk->size = FLD_NUMBER * sizeof(M31_FIELD_DEF);
+			break;
+		}
+
+        case M31_BLK_LAST_CHANGE:
+		{
+			M31_LAST_CHANGE *lcP = (M31_LAST_CHANGE*)blk->data;
+			OSS_IRQ_STATE irqState;
+			u_int32 n;
+
+			if (blk->size < (int32)(CH_NUMBER * sizeof(M31_LAST_CHANGE)))
+				return(ERR_LL_USERBUF);
+
+			/* consistent snapshot of all channels */
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			for (n=0; n<CH_NUMBER; n++) {
+				lcP[n].tsHigh = (u_int32)(llHdl->lcTs[n] >> 32);
+				lcP[n].tsLow  = (u_int32)llHdl->lcTs[n];
+				lcP[n].level  = (llHdl->lastState >> n) & 1;
+				lcP[n].valid  = (llHdl->lcValid >> n) & 1;
+				lcP[n].flags  = ((llHdl->lcLost >> n) & 1) ?
+					M31_EVF_LOST_EDGE : 0;
+				lcP[n].res    = 0;
+			}
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+			blk->size = CH_NUMBER * sizeof(M31_LAST_CHANGE);
+			break;
+		}
+
+        case M31_BLK_RULES:
+		{
+			M31_RULE *ruleP = (M31_RULE*)blk->data;
+			u_int32 r, n;
+
+			if (blk->size < (int32)(RULE_NUMBER * sizeof(M31_RULE)))
+				return(ERR_LL_USERBUF);
+
+			for (r=0; r<RULE_NUMBER; r++) {
+				for (n=0; n<RULE_STEPS; n++) {
+					ruleP[r].step[n].op   = llHdl->ruleOp[r][n];
+					ruleP[r].step[n].ch   = llHdl->ruleCh[r][n];
+					ruleP[r].step[n].res  = 0;
+					ruleP[r].step[n].time = llHdl->ruleTime[r][n];
+				}
+			}
+
+			blk->size = RULE_NUMBER * sizeof(M31_RULE);
+			break;
+		}
+
+        case M31_BLK_RULE_STAT:
+		{
+			M31_RULE_STAT *statP = (M31_RULE_STAT*)blk->data;
+			OSS_IRQ_STATE irqState;
+			u_int32 r;
+
+			if (blk->size < (int32)(RULE_NUMBER * sizeof(M31_RULE_STAT)))
+				return(ERR_LL_USERBUF);
+
+			/* consistent snapshot of all rules */
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			for (r=0; r<RULE_NUMBER; r++) {
+				statP[r].done     = llHdl->ruleDone[r];
+				statP[r].violated = llHdl->ruleViol[r];
+				statP[r].step     = llHdl->ruleStep[r];
+				statP[r].active   = (llHdl->ruleMask >> r) & 1;
+				statP[r].res      = 0;
+			}
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+			blk->size = RULE_NUMBER * sizeof(M31_RULE_STAT);
+			break;
+		}
+
+        case M31_BLK_FIELD_STAT:
+		{
+			M31_FIELD_STAT *statP = (M31_FIELD_STAT*)blk->data;
+			OSS_IRQ_STATE irqState;
+			u_int32 n;
+
+			if (blk->size < (int32)(FLD_NUMBER * sizeof(M31_FIELD_STAT)))
+				return(ERR_LL_USERBUF);
+
+			/* consistent snapshot of all fields */
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			for (n=0; n<FLD_NUMBER; n++) {
+				statP[n].value   = llHdl->fldValue[n];
+				statP[n].valid   = (llHdl->fldValid >> n) & 1;
+				statP[n].pending = (llHdl->fldPend >> n) & 1;
+				statP[n].res     = 0;
+				statP[n].changes = llHdl->fldChanges[n];
+				statP[n].invalid = llHdl->fldInvalid[n];
+			}
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+			blk->size = FLD_NUMBER * sizeof(M31_FIELD_STAT);
+			break;
+		}
+        /*--------------------------+
+        |  quadrature decoder       |
+        +--------------------------*/
+        case M31_QUAD_MASK:
+			*valueP = (int32)llHdl->quadMask;
+			break;
+
+        case M31_QUAD_POS:
+			*valueP = llHdl->quadPos[ch/2];
+			break;
+
+        case M31_QUAD_DIR:
+			*valueP = llHdl->quadDir[ch/2];
+			break;
+
+        case M31_QUAD_ERRORS:
+			*valueP = (int32)llHdl->quadErr[ch/2];
+			break;
+
+        case M31_BLK_QUAD:
+		{
+			M31_QUAD *quadP = (M31_QUAD*)blk->data;
+			OSS_IRQ_STATE irqState;
+			u_int32 n;
+
+			if (blk->size < (int32)(QUAD_PAIRS * sizeof(M31_QUAD)))
+				return(ERR_LL_USERBUF);
+
+			/* consistent snapshot of all pairs */
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			for (n=0; n<QUAD_PAIRS; n++) {
+				quadP[n].pos    = llHdl->quadPos[n];
+				quadP[n].dir    = llHdl->quadDir[n];
+				quadP[n].errors = llHdl->quadErr[n];
+			}
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+			blk->size = QUAD_PAIRS * sizeof(M31_QUAD);
+			break;
+		}
+
+        case M31_BLK_COUNTERS:
+		{
+			M31_COUNTERS *cntP = (M31_COUNTERS*)blk->data;
+			OSS_IRQ_STATE irqState;
+			u_int32 n;
+
+			if (blk->size < (int32)sizeof(M31_COUNTERS))	/* check buf size */
+				return(ERR_LL_USERBUF);
+
+			/* consistent snapshot, the counters are never cleared */
+			irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+			cntP->irqs         = llHdl->irqCount;
+			cntP->sigSent      = llHdl->sigSent;
+			cntP->sigDeferred  = llHdl->sigDeferred;
+			cntP->events       = llHdl->evPut;
+			cntP->eventPending = llHdl->evPut - llHdl->evGet;
+			cntP->eventLost    = llHdl->evLost;
+			cntP->lostIrqs     = llHdl->lostIrqs;
+			cntP->strobeLost   = llHdl->stbLost;
+			for (n=0; n<CH_NUMBER; n++)
+				cntP->changes[n] = llHdl->chChanges[n];
+			OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+			blk->size = sizeof(M31_COUNTERS);
+			break;
+		}
+
+#ifdef M31_OWN_LOCK
+        case M31_BLK_LOCK_STAT:
+		{
+			M31_LOCK_STAT *statP = (M31_LOCK_STAT*)blk->data;
+			u_int32 ep;
+
+			if (blk->size < (int32)(LOCK_EP_NUM * sizeof(M31_LOCK_STAT)))
+				return(ERR_LL_USERBUF);
+
+			/* called with the lock held: consistent */
+			for (ep=0; ep<LOCK_EP_NUM; ep++) {
+				statP[ep].count     = llHdl->lockCount[ep];
+				statP[ep].contended = llHdl->lockCont[ep];
+				statP[ep].waitMax   = llHdl->lockWaitMax[ep];
+				statP[ep].holdMax   = llHdl->lockHoldMax[ep];
+				OSS_MemCopy(llHdl->osHdl, sizeof(statP[ep].waitHist),
+							(char*)llHdl->lockWaitHist[ep],
+							(char*)statP[ep].waitHist);
+				OSS_MemCopy(llHdl->osHdl, sizeof(statP[ep].holdHist),
+							(char*)llHdl->lockHoldHist[ep],
+							(char*)statP[ep].holdHist);
+			}
+
+			blk->size = LOCK_EP_NUM * sizeof(M31_LOCK_STAT);
+			break;
+		}
+#endif
+
+        case M31_BLK_GLITCHES:
+		{
+			u_int32 *dataP = (u_int32*)blk->data;
+			u_int32 n;
+
+			if (blk->size < (int32)(CH_NUMBER * sizeof(u_int32)))
+				return(ERR_LL_USERBUF);
+
+			for (n=0; n<CH_NUMBER; n++)
+				dataP[n] = llHdl->glitches[n];
+
+			blk->size = CH_NUMBER * sizeof(u_int32);
+			break;
+		}
+
+        case M31_BLK_CAP_INFO:
+		{
+			M31_CAP_INFO *infoP = (M31_CAP_INFO*)blk->data;
+
+			if (blk->size < (int32)sizeof(M31_CAP_INFO))	/* check buf size */
+				return(ERR_LL_USERBUF);
+
+			if (llHdl->capSize == 0)
+				return(ERR_LL_ILL_PARAM);
+
+			OSS_SpinLockAcquire(llHdl->osHdl, llHdl->capLock);
+			infoP->state      = llHdl->capState;
+			infoP->period     = llHdl->capRealPeriod;
+			infoP->preTrig    = llHdl->capPreTrigCnt;
+			infoP->count      = (llHdl->capPut - llHdl->capGet) /
+				(llHdl->capFormat == M31_CAPFMT_RLE ? 2 : 1);
+			infoP->lost       = llHdl->capLost;
+			infoP->gaps       = llHdl->capGaps;
+			infoP->trigTsHigh = (u_int32)(llHdl->capTrigTs >> 32);
+			infoP->trigTsLow  = (u_int32)llHdl->capTrigTs;
+			OSS_SpinLockRelease(llHdl->osHdl, llHdl->capLock);
+
+			blk->size = sizeof(M31_CAP_INFO);
+			break;
+		}
+        /*--------------------------+
+        |  aggregate device         |
+        +--------------------------*/
+        case M31_AGGR_MEMBERS:
+			*valueP = (int32)AggrMembers(llHdl);
+			break;
+        /*--------------------------+
+        |  ready group              |
+        +--------------------------*/
+        case M31_READY_MASK:
+			if (llHdl->readyGroup == 0)
+				return(ERR_LL_ILL_PARAM);
+			*valueP = (int32)ReadyGet(llHdl);
+			break;
+
+        case M31_BLK_AGGR_CHANGE:
+			if (llHdl->aggrCount == 0)
+				return(ERR_LL_ILL_PARAM);
+
+			if (blk->size < (int32)(llHdl->aggrCount * sizeof(u_int16)))
+				return(ERR_LL_USERBUF);
+
+			if ((error = AggrChangeGet(llHdl, (u_int16*)blk->data)))
+				break;
+
+			blk->size = llHdl->aggrCount * sizeof(u_int16);
+			break;
+       /*--------------------------+
+        |  (unknown)                |
+        +--------------------------*/
+        default:
+            error = ERR_LL_UNK_CODE;
+    }
+
+	return(error);
+}
+
+/******************************* M31_BlockRead *******************************
+ *
+ *  Description:  Read the state of all 16 channels or pending events
+ *
+ *                Block read mode M31_BLKMODE_STATE (default):
+ *                Bits 15..0 of the first two bytes of the data buffer (buf)
+ *                correspond to channels 15..0. On the master of an
+ *                aggregate device, one u_int16 per module is returned
+ *                (word n holds channels 16n+15..16n), read back to back.
+ *
+ *                Block read mode M31_BLKMODE_EVENT:
+ *                The pending event records (M31_EVENT) are copied into the
+ *                buffer, oldest first, as many as fit. The function does not
+ *                wait for events, nbrRdBytesP is 0 if none are pending.
+ *                On the master of an aggregate device, the records of all
+ *                modules are merged in timestamp order. The members
+ *                (AGGR_INDEX > 0) with AGGR_EXCLUSIVE=1 return
+ *                ERR_LL_DEV_BUSY in this mode, their records belong to
+ *                the master.
+ *
+ *                Block read mode M31_BLKMODE_CAPTURE:
+ *                The captured samples (u_int16, bits 15..0 correspond to
+ *                channels 15..0) are copied into the buffer, oldest first.
+ *                In format M31_CAPFMT_RLE whole runs (M31_RLE_REC) are
+ *                copied instead. No data is returned until the capture has
+ *                triggered.
+ *
+ *                Block read mode M31_BLKMODE_STROBE:
+ *                The pending strobed words (M31_STROBE_REC) are copied into
+ *                the buffer, oldest first, as many as fit.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl        low-level handle
+ *                ch           current channel
+ *                buf          data buffer
+ *                size         data buffer size (minimum: two bytes or
+ *                             one event record)
+ *
+ *  Output.....:  nbrRdBytesP  number of read bytes
+ *                return       success (0) or error code
+ *
+ *  Globals....:  -
+ ****************************************************************************/
+static int32 M31_BlockRead(
+     LL_HANDLE	*llHdl,
+     int32		ch,
+     void		*buf,
+     int32		size,
+     int32		*nbrRdBytesP
+)
+{
+	TRACE(M31_TR_BLOCKREAD, ch, size);
+
+	/* return nr of read bytes */
+	*nbrRdBytesP = 0;
+
+	switch (llHdl->blkMode) {
+	case M31_BLKMODE_EVENT:
+		if (AGGR_MEMBER(llHdl))
+			return ERR_LL_DEV_BUSY;		/* consumed by the master */
+
+		if (llHdl->evSize == 0 && llHdl->aggrCount == 0)
+			return ERR_LL_ILL_PARAM;	/* EVENT_BUF_SIZE=0 */
+
+		if (size < (int32)sizeof(M31_EVENT))
+			return ERR_LL_USERBUF;
+
+		if (llHdl->aggrCount)
+			*nbrRdBytesP = AggrEventGet(llHdl, (M31_EVENT*)buf,
+										size / sizeof(M31_EVENT)) *
+				sizeof(M31_EVENT);
+		else
+			*nbrRdBytesP = EventGet(llHdl, buf, size / sizeof(M31_EVENT)) *
+				sizeof(M31_EVENT);
+		break;
+
+	case M31_BLKMODE_STROBE:
+		if (llHdl->stbSize == 0)
+			return ERR_LL_ILL_PARAM;
+
+		if (size < (int32)sizeof(M31_STROBE_REC))
+			return ERR_LL_USERBUF;
+
+		*nbrRdBytesP = StrobeGet(llHdl, (M31_STROBE_REC*)buf,
+								 size / sizeof(M31_STROBE_REC)) *
+			sizeof(M31_STROBE_REC);
+		break;
+
+	case M31_BLKMODE_CAPTURE:
+		if (llHdl->capSize == 0)
+			return ERR_LL_ILL_PARAM;
+
+		if (llHdl->capFormat == M31_CAPFMT_RLE) {
+			if (size < (int32)sizeof(M31_RLE_REC))
+				return ERR_LL_USERBUF;
+			size -= size % sizeof(M31_RLE_REC);		/* whole runs */
+		}
+		else if (size < 2)
+			return ERR_LL_USERBUF;
+
+		*nbrRdBytesP = CapGet(llHdl, (u_int16*)buf, size / 2) * 2;
+		break;
+
+	default:
+		if (llHdl->aggrCount) {
+			if (size < (int32)(llHdl->aggrCount * sizeof(u_int16)))
+				return ERR_LL_USERBUF;
+
+			return( AggrStateGet(llHdl, (u_int16*)buf, nbrRdBytesP) );
+		}
+
+		if (size < 2)
+			return ERR_LL_USERBUF;
+
+		*((u_int16*)buf) = MREAD_D16(llHdl->ma, DATA_REG);
+
+		*nbrRdBytesP = 2;
+	}
+
+	return(ERR_SUCCESS);
+}
+
+/****************************** M31_BlockWrite *******************************
+ *
+ *  Description:  Write data block to device (unused)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl        low-level handle
+ *                ch           current channel
+ *                buf          data buffer
+ *                size         data buffer size
+ *
+ *  Output.....:  nbrWrBytesP  number of written bytes
+ *                return       ERR_LL_ILL_FUNC
+ *
+ *  Globals....:  -
+ ****************************************************************************/
+static int32 M31_BlockWrite(
+     LL_HANDLE	*llHdl,
+     int32		ch,
+     void		*buf,
+     int32		size,
+     int32		*nbrWrBytesP
+)
+{
+    DBGWRT_1((DBH, "LL - M31_BlockWrite: ch=%d, size=%d\n",ch,size));
+
+	/* return nr of written bytes */
+	*nbrWrBytesP = 0;
+
+	return(ERR_LL_ILL_FUNC);
+}
+
+
+/****************************** M31_Irq *************************************
+ *
+ *  Description:  Interrupt service routine
+ *
+ *                The interrupt is triggered when any input level changes.
+ *                For each channel a level change will be stored in a flag.
+ *                If the interrupt is enabled, an event record is stored.
+ *                If a user signal is installed, the signal will be sent.
+ *
+ *                An interrupt without visible state change is counted as
+ *                possible lost edge (see M31_BLK_LOST_EDGES). It changes
+ *                no state: only an attributed lost edge of a reported
+ *                channel is stored as event with M31_EVF_LOST_EDGE.
+ *                Interrupts of other devices on a shared line are counted
+ *                as well, since the M31 has no interrupt pending bit.
+ *
+ *                If the driver can detect the interrupt cause it returns
+ *                LL_IRQ_DEVICE or LL_IRQ_DEV_NOT, otherwise LL_IRQ_UNKNOWN.
+ *
+ *                The execution time from entry until the interrupt is
+ *                cleared is added to the ISR timing statistics.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  llHdl    low-level handle
+ *
+ *  Output.....:  return   LL_IRQ_UNKNOWN
+ *
+ *  Globals....:  -
+ ****************************************************************************/
+static int32 M31_Irq(
+   LL_HANDLE *llHdl
+)
+{
+	u_int64 tsEnter = TsGet(llHdl);
+#ifdef TS_CYCLE_COUNTER
+	u_int32 time;
+#endif
+	u_int16 currState, change, lost = 0;
+
+	llHdl->irqCount++;
+
+	/* get current states */	
+	currState = MREAD_D16(llHdl->ma, DATA_REG);
+
+	ITRACE(M31_TR_IRQ, 0, ((u_int32)currState << 16) |
+		   (u_int16)(llHdl->lastState ^ currState));
+
+	change = llHdl->lastState ^ currState;
+
+	if (change) {
+		u_int16 bits;
+
+		/* remember last change per channel */
+		llHdl->lastChange = change;
+		for (bits = change; bits; bits &= bits - 1)
+			llHdl->lcTs[Log2Bucket(bits & (~bits + 1))] = tsEnter;
+		llHdl->lcValid |= change;
+		llHdl->lcLost  &= ~change;
+	}
+	else {
+		/* channel toggled twice (or foreign irq): only count and flag,
+		   attribute if unambiguous */
+		llHdl->lostIrqs++;
+		if (llHdl->lastChange &&
+			(llHdl->lastChange & (llHdl->lastChange - 1)) == 0) {
+			lost = llHdl->lastChange;
+			llHdl->lostEdges[Log2Bucket(lost)]++;
+			llHdl->lcLost |= lost;
+			if (lost & llHdl->stbBit)
+				llHdl->stbLostEdge = TRUE;
+		}
+		else
+			llHdl->lostUnattr++;
+	}
+
+	/* sequence rules: timeouts up to now, then this edge */
+	if (llHdl->ruleMask) {
+		if (llHdl->ruleDl)
+			RuleCheck(llHdl, tsEnter, llHdl->lastState);
+
+		if (change)
+			RuleEdge(llHdl, tsEnter, currState, change);
+	}
+
+	/* latch strobed word */
+	if (llHdl->stbEdge && change)
+		StrobeLatch(llHdl, tsEnter, currState, change);
+
+	/* quadrature pairs: decode, don't report */
+	if (llHdl->quadChMask) {
+		if (change & llHdl->quadChMask)
+			QuadDecode(llHdl, llHdl->lastState, currState);
+
+		change &= ~llHdl->quadChMask;
+		lost   &= ~llHdl->quadChMask;
+	}
+
+	/* field channels: report settled values, restart settle windows */
+	if (llHdl->fldChMask) {
+		if (llHdl->fldPend)
+			FieldCheck(llHdl, tsEnter, llHdl->lastState);
+
+		if (change & llHdl->fldChMask)
+			FieldEdge(llHdl, tsEnter, currState, change & llHdl->fldChMask);
+
+		change &= ~llHdl->fldChMask;
+		lost   &= ~llHdl->fldChMask;
+	}
+
+	/* debounced channels: report settled changes (levels within the
+	   windows are the levels before this irq) and filter the edges */
+	if (llHdl->dbMask) {
+		DbCheck(llHdl, tsEnter, llHdl->lastState);
+
+		if (change & llHdl->dbMask)
+			DbEdge(llHdl, tsEnter, currState, change & llHdl->dbMask);
+
+		change &= ~llHdl->dbMask;
+		lost   &= ~llHdl->dbMask;
+	}
+	llHdl->lastState = currState;
+
+	if (change)
+		ProcessChange(llHdl, tsEnter, DbState(llHdl, currState), change, 0);
+	else if (lost)
+		ProcessChange(llHdl, tsEnter, DbState(llHdl, currState), lost,
+					  M31_EVF_LOST_EDGE);
+
+	/* time out windows/deadlines if no further irq comes */
+	DbTimerArm(llHdl);
+
+	/* clear interrupt */
+	MREAD_D16(llHdl->ma, IRQCRL_REG);
+
+#ifdef TS_CYCLE_COUNTER
+	/* update timing statistics (OSS ticks are too coarse) */
+	time = (u_int32)(TsGet(llHdl) - tsEnter);
+	llHdl->isrCount++;
+	llHdl->isrHist[Log2Bucket(time)]++;
+	if (time > llHdl->isrMax) {
+		llHdl->isrMax   = time;
+		llHdl->isrMaxTs = tsEnter;
+	}
+#endif
+
+	/* not my interrupt */
+	return LL_IRQ_UNKNOWN;
+}
+
+/****************************** M31_Info ************************************
+ *
+ *  Description:  Get driver info
+ *
+ *                The following info codes are supported:
+ *
+ *                Code                      Description
+ *                ------------------------  -----------------------------
+ *                LL_INFO_HW_CHARACTER      hardware characteristics
+ *                LL_INFO_ADDRSPACE_COUNT   nr of required address spaces
+ *                LL_INFO_ADDRSPACE         address space type
+ *                LL_INFO_IRQ               interrupt required
+ *                LL_INFO_LOCKMODE 			process locking required (LL_LOCK_xxx).
+ *
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  infoType	   info code
+ *                ...          argument(s)
+ *
+ *  Output.....:  return       success (0) or error code
+ *
+ *  Globals....:  -
+ ****************************************************************************/
 static int32 M31_Info(
    int32  infoType,
    ...
 )
 {
-    int32   error = ERR_SUCCESS;
-    va_list argptr;
+    int32   error = ERR_SUCCESS;
+    va_list argptr;
+
+    va_start(argptr, infoType );
+
+    switch(infoType) {
+		/*-------------------------------+
+        |  hardware characteristics      |
+        +-------------------------------*/
+        case LL_INFO_HW_CHARACTER:
+		{
+			u_int32 *addrModeP = va_arg(argptr, u_int32*);
+			u_int32 *dataModeP = va_arg(argptr, u_int32*);
+
+			*addrModeP = MDIS_MA08;
+			*dataModeP = MDIS_MD16;
+			break;
+	    }
+		/*-------------------------------+
+        |  nr of required address spaces |
+        +-------------------------------*/
+        case LL_INFO_ADDRSPACE_COUNT:
+		{
+			u_int32 *nbrOfAddrSpaceP = va_arg(argptr, u_int32*);
+
+			*nbrOfAddrSpaceP = ADDRSPACE_COUNT;
+			break;
+	    }
+		/*-------------------------------+
+        |   address space type           |
+        +-------------------------------*/
+        case LL_INFO_ADDRSPACE:
+		{
+			u_int32 addrSpaceIndex = va_arg(argptr, u_int32);
+			u_int32 *addrModeP = va_arg(argptr, u_int32*);
+			u_int32 *dataModeP = va_arg(argptr, u_int32*);
+			u_int32 *addrSizeP = va_arg(argptr, u_int32*);
+
+			if (addrSpaceIndex >= ADDRSPACE_COUNT)
+				error = ERR_LL_ILL_PARAM;
+			else {
+				*addrModeP = MDIS_MA08;
+				*dataModeP = MDIS_MD16;
+				*addrSizeP = 0x100;
+			}
+
+			break;
+	    }
+		/*-------------------------------+
+        |   interrupt required           |
+        +-------------------------------*/
+        case LL_INFO_IRQ:
+		{
+			u_int32 *useIrqP = va_arg(argptr, u_int32*);
+
+			*useIrqP = TRUE;
+			break;
+	    }
+        /*-------------------------------+
+        |   process lock mode            |
+        +-------------------------------*/
+        case LL_INFO_LOCKMODE:
+        {
+            u_int32 *lockModeP = va_arg(argptr, u_int32*);
+
+#ifdef M31_OWN_LOCK
+            *lockModeP = LL_LOCK_NONE;	/* see LockEnter() */
+#else
+            *lockModeP = LL_LOCK_CALL;
+#endif
+            break;
+        }
+		/*-------------------------------+
+        |   (unknown)                    |
+        +-------------------------------*/
+        default:
+          error = ERR_LL_ILL_PARAM;
+    }
+
+    va_end(argptr);
+    return(error);
+}
+
+/*******************************  Ident  ************************************
+ *
+ *  Description:  Return ident string
+ *
+ *---------------------------------------------------------------------------
+ *  Input......:  -
+ *
+ *  Output.....:  return  pointer to ident string
+ *
+ *  Globals....:  -
+ ****************************************************************************/
+static char* Ident( void )	/* nodoc */
+{
+    return( (char*)IdentString );
+}
+
+/********************************* Cleanup **********************************
+ *
+ *  Description: Close all handles, free memory and return error code
+ *
+ *		         NOTE: The low-level handle is invalid after calling this
+ *                     function.
+ *			   
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               retCode    return value
+ *
+ *  Output.....: return	    retCode
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 Cleanup(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   int32        retCode
+)
+{
+    /*------------------------------+
+    |  close handles                |
+    +------------------------------*/
+	/* clean up desc */
+	if (llHdl->descHdl)
+		DESC_Exit(&llHdl->descHdl);
+
+	/* clean up debug */
+	DBGEXIT((&DBH));
+
+    /*------------------------------+
+    |  free memory                  |
+    +------------------------------*/
+#ifdef M31_OWN_LOCK
+	/* remove device lock */
+	if (llHdl->lockSem)
+		OSS_SemRemove(llHdl->osHdl, &llHdl->lockSem);
+#endif
+
+	/* remove debounce timer */
+	if (llHdl->dbTimer)
+		OSS_TimerRemove(llHdl->osHdl, &llHdl->dbTimer);
+
+	/* remove signal coalescing timer */
+	if (llHdl->sigTimer)
+		OSS_TimerRemove(llHdl->osHdl, &llHdl->sigTimer);
+
+	/* remove capture timer/lock, free buffer */
+	if (llHdl->capTimer)
+		OSS_TimerRemove(llHdl->osHdl, &llHdl->capTimer);
+
+	if (llHdl->capLock)
+		OSS_SpinLockRemove(llHdl->osHdl, &llHdl->capLock);
+
+	if (llHdl->capBuf)
+		OSS_MemFree(llHdl->osHdl, (int8*)llHdl->capBuf, llHdl->capAlloc);
+
+	/* free strobed word fifo */
+	if (llHdl->stbBuf)
+		OSS_MemFree(llHdl->osHdl, (int8*)llHdl->stbBuf, llHdl->stbAlloc);
+
+	/* free event fifo */
+	if (llHdl->evBuf)
+		OSS_MemFree(llHdl->osHdl, (int8*)llHdl->evBuf, llHdl->evAlloc);
+
+	/* free trace ring */
+	if (llHdl->trcBuf)
+		OSS_MemFree(llHdl->osHdl, (int8*)llHdl->trcBuf, llHdl->trcAlloc);
+
+    /* free my handle */
+    OSS_MemFree(llHdl->osHdl, (int8*)llHdl, llHdl->memAlloc);
+
+    /*------------------------------+
+    |  return error code            |
+    +------------------------------*/
+	return(retCode);
+}
+
+/********************************* TsGet ************************************
+ *
+ *  Description: Read the free running timestamp counter
+ *
+ *               Uses the time stamp counter (x86), time base (PowerPC) or
+ *               virtual counter (ARM64). On other CPUs or if the switch
+ *               M31_NO_CYCLE_COUNTER is set, the OSS tick is used.
+ *
+ *               Can be called from interrupt context.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: return	    counter value
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static u_int64 TsGet(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+#if defined(TS_CYCLE_COUNTER) && (defined(__i386__) || defined(__x86_64__))
+	u_int32 lo, hi;
+
+	__asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+	return( ((u_int64)hi << 32) | lo );
+#elif defined(TS_CYCLE_COUNTER) && defined(__aarch64__)
+	u_int64 cnt;
+
+	__asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(cnt));
+	return( cnt );
+#elif defined(TS_CYCLE_COUNTER)
+	u_int32 lo, hi, hi2;
+
+	/* re-read if the upper half wrapped between the reads */
+	do {
+		__asm__ __volatile__("mftbu %0" : "=r"(hi));
+		__asm__ __volatile__("mftb %0"  : "=r"(lo));
+		__asm__ __volatile__("mftbu %0" : "=r"(hi2));
+	} while (hi != hi2);
+	return( ((u_int64)hi << 32) | lo );
+#else
+	return( (u_int64)OSS_TickGet(llHdl->osHdl) );
+#endif
+}
+
+/******************************* TsFreqGet **********************************
+ *
+ *  Description: Get the frequency of the timestamp counter
+ *
+ *               The CPU counter is calibrated once against the OSS tick
+ *               (busy waits about 20ms). Called by M31_Init without any
+ *               lock held, afterwards it only returns the shared result.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: return	    frequency [Hz]
+ *
+ *  Globals....: G_tsFreq
+ ****************************************************************************/
+static u_int32 TsFreqGet(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+#ifdef TS_CYCLE_COUNTER
+	u_int32 rate, tick0, tick1;
+	u_int64 ts0, ts1;
+#endif
+
+	if (G_tsFreq)
+		return( G_tsFreq );
+
+#if defined(TS_CYCLE_COUNTER) && defined(__aarch64__)
+	{
+		u_int64 freq;
+
+		__asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(freq));
+		G_tsFreq = (u_int32)freq;
+	}
+#elif defined(TS_CYCLE_COUNTER)
+	rate = (u_int32)OSS_TickRateGet(llHdl->osHdl);
+
+	/* measure counts between two tick edges */
+	tick0 = OSS_TickGet(llHdl->osHdl);
+	while ((tick1 = OSS_TickGet(llHdl->osHdl)) == tick0)
+		;
+	ts0 = TsGet(llHdl);
+
+	OSS_Delay(llHdl->osHdl, TS_CALIB_MSEC);
+
+	tick0 = OSS_TickGet(llHdl->osHdl);
+	while (OSS_TickGet(llHdl->osHdl) == tick0)
+		;
+	ts1 = TsGet(llHdl);
+
+	G_tsFreq = (u_int32)(ts1 - ts0) / (tick0 + 1 - tick1) * rate;
+#else
+	G_tsFreq = (u_int32)OSS_TickRateGet(llHdl->osHdl);
+#endif
+
+	/* counts per us in 16.16 fixed point, without 64-bit division */
+	G_tsPerUsQ16 = (G_tsFreq / 62500) * 4096 +
+		((G_tsFreq % 62500) * 4096) / 62500;
+
+	DBGWRT_2((DBH, " timestamp frequency=%dHz\n", G_tsFreq));
+	return( G_tsFreq );
+}
+
+/******************************* Log2Bucket *********************************
+ *
+ *  Description: Get log2 histogram bucket of a value
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: val		value
+ *
+ *  Output.....: return	    bucket 0..31 (index of highest bit set, 0 for 0)
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static u_int32 Log2Bucket(	/* nodoc */
+   u_int32 val
+)
+{
+	u_int32 n = 0;
+
+	if (val & 0xffff0000) { n += 16; val >>= 16; }
+	if (val & 0x0000ff00) { n +=  8; val >>=  8; }
+	if (val & 0x000000f0) { n +=  4; val >>=  4; }
+	if (val & 0x0000000c) { n +=  2; val >>=  2; }
+	if (val & 0x00000002) { n +=  1; }
+
+	return( n );
+}
+
+/******************************* Pow2Floor **********************************
+ *
+ *  Description: Round down to a power of 2
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: val		value
+ *
+ *  Output.....: return	    largest power of 2 <= val (0 for 0)
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static u_int32 Pow2Floor(	/* nodoc */
+   u_int32 val
+)
+{
+	return( val ? (u_int32)1 << Log2Bucket(val) : 0 );
+}
+
+/******************************* TraceWrite *********************************
+ *
+ *  Description: Write a record into the binary trace ring
+ *
+ *               The oldest record is overwritten if the ring is full.
+ *               Outside interrupt context the device interrupt is masked
+ *               while writing.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               code		M31_TR_xxx
+ *               ch			current channel
+ *               value		code specific value
+ *               inIrq		called from interrupt context
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void TraceWrite(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int16      code,
+   int32        ch,
+   u_int32      value,
+   int32        inIrq
+)
+{
+	M31_TRACE_REC *recP;
+	OSS_IRQ_STATE irqState = 0;
+	u_int64 ts = TsGet(llHdl);
+
+	if (!inIrq)
+		irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+
+	recP = (M31_TRACE_REC*)llHdl->trcBuf +
+		(llHdl->trcPut++ & (llHdl->trcSize-1));
+	recP->code   = code;
+	recP->ch     = (u_int16)ch;
+	recP->value  = value;
+	recP->tsHigh = (u_int32)(ts >> 32);
+	recP->tsLow  = (u_int32)ts;
+
+	if (!inIrq)
+		OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+}
+
+/******************************* EventPut ***********************************
+ *
+ *  Description: Store an event record in the event FIFO
+ *
+ *               If the FIFO is full, the record is lost and the next stored
+ *               record gets the flag M31_EVF_OVERRUN. The sequence number
+ *               is incremented for lost records as well.
+ *
+ *               Must be called from interrupt context or with the device
+ *               interrupt masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               ts			timestamp
+ *               state		channel states
+ *               change		changed channels
+ *               flags		M31_EVF_xxx
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void EventPut(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int64      ts,
+   u_int16      state,
+   u_int16      change,
+   u_int8       flags
+)
+{
+	M31_EVENT *evP;
+	u_int16 seq;
+
+	/* event records disabled: nothing is lost */
+	if (llHdl->evSize == 0)
+		return;
+
+	seq = llHdl->evSeq++;
+
+	if (llHdl->evPut - llHdl->evGet >= llHdl->evSize) {
+		llHdl->evLost++;
+		llHdl->evOverrun = TRUE;
+		return;
+	}
+
+	if (llHdl->evOverrun) {
+		flags |= M31_EVF_OVERRUN;
+		llHdl->evOverrun = FALSE;
+	}
+
+	evP = (M31_EVENT*)llHdl->evBuf + (llHdl->evPut & (llHdl->evSize-1));
+	evP->tsHigh = (u_int32)(ts >> 32);
+	evP->tsLow  = (u_int32)ts;
+	evP->state  = state;
+	evP->change = change;
+	evP->flags  = flags;
+	evP->dev    = 0;
+	evP->seq    = seq;
+
+	llHdl->evPut++;
+}
+
+/******************************* EventGet ***********************************
+ *
+ *  Description: Get pending records from the event FIFO
+ *
+ *               The records are copied in chunks with the device interrupt
+ *               masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               buf		destination buffer (M31_EVENT)
+ *               max		max nr of records
+ *
+ *  Output.....: return	    nr of records copied
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static u_int32 EventGet(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   void         *buf,
+   u_int32      max
+)
+{
+	M31_EVENT *dstP = (M31_EVENT*)buf;
+	M31_EVENT *evBuf = (M31_EVENT*)llHdl->evBuf;
+	OSS_IRQ_STATE irqState;
+	u_int32 n = 0, chunk;
+
+	while (n < max) {
+		irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+
+		for (chunk = 0; chunk < EVENT_COPY_CHUNK && n < max &&
+				 llHdl->evGet != llHdl->evPut; chunk++)
+			dstP[n++] = evBuf[llHdl->evGet++ & (llHdl->evSize-1)];
+
+		OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+		if (chunk < EVENT_COPY_CHUNK)	/* fifo empty or buffer full */
+			break;
+	}
+
+	return( n );
+}
+
+/********************************* UsToTs ***********************************
+ *
+ *  Description: Convert microseconds to timestamp counts
+ *
+ *               The timestamp counter was calibrated in M31_Init, so
+ *               this may be called with the irq masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               us			time [us]
+ *
+ *  Output.....: return	    time [ts counts]
+ *
+ *  Globals....: G_tsPerUsQ16
+ ****************************************************************************/
+static u_int64 UsToTs(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int32      us
+)
+{
+	return( ((u_int64)us * G_tsPerUsQ16) >> 16 );
+}
+
+/******************************** CapStart **********************************
+ *
+ *  Description: Start sampling and arm the capture trigger
+ *
+ *               The timer period is the sample period rounded up to the
+ *               OSS tick, one sample is taken per timer call.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: return	    success (0) or error code
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 CapStart(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	u_int32 tickMsec, msec, realMsec = 0;
+	int32 error;
+
+	if (llHdl->capState == M31_CAPST_ARMED ||
+		llHdl->capState == M31_CAPST_TRIGGERED)
+		return( ERR_LL_DEV_BUSY );
+
+	if (llHdl->capPreTrig >= llHdl->capSize ||
+		(llHdl->capFormat == M31_CAPFMT_RLE && llHdl->capSize < 2))
+		return( ERR_LL_ILL_PARAM );
+
+	/* timer period: sample period rounded up to the OSS tick */
+	tickMsec = CapMinPeriod(llHdl) / 1000;
+	msec = (llHdl->capPeriod + 999) / 1000;
+	msec = ((msec + tickMsec - 1) / tickMsec) * tickMsec;
+
+	OSS_SpinLockAcquire(llHdl->osHdl, llHdl->capLock);
+	llHdl->capPut        = 0;
+	llHdl->capGet        = 0;
+	llHdl->capLost       = 0;
+	llHdl->capGaps       = 0;
+	llHdl->capPreTrigCnt = 0;
+	llHdl->capHeld       = 0;
+	llHdl->capRunCnt     = 0;
+	llHdl->capTrigTs     = 0;
+	llHdl->capNextTs     = 0;		/* first sample at first timer call */
+	llHdl->capRealPeriod = msec * 1000;
+	llHdl->capPeriodTs   = UsToTs(llHdl, msec * 1000);
+	llHdl->capState      = M31_CAPST_ARMED;
+	OSS_SpinLockRelease(llHdl->osHdl, llHdl->capLock);
+
+	if ((error = OSS_TimerStart(llHdl->osHdl, llHdl->capTimer, msec, TRUE,
+								&realMsec))) {
+		llHdl->capState = M31_CAPST_IDLE;
+		return( error );
+	}
+
+	/* timer period and period for gap detection: the rounded one */
+	if (realMsec && realMsec != msec) {
+		OSS_SpinLockAcquire(llHdl->osHdl, llHdl->capLock);
+		llHdl->capRealPeriod = realMsec * 1000;
+		llHdl->capPeriodTs   = UsToTs(llHdl, realMsec * 1000);
+		OSS_SpinLockRelease(llHdl->osHdl, llHdl->capLock);
+	}
+
+	DBGWRT_2((DBH, " capture started: period=%dus timer=%dms\n",
+			  llHdl->capPeriod, realMsec));
+	return( ERR_SUCCESS );
+}
+
+/******************************* CapMinPeriod *******************************
+ *
+ *  Description: Get the shortest capture sample period
+ *
+ *               One OSS tick, rounded up to whole milliseconds (the OSS
+ *               timer resolution).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: return	    period [us]
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static u_int32 CapMinPeriod(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	u_int32 rate = (u_int32)OSS_TickRateGet(llHdl->osHdl);
+	u_int32 msec = rate ? (1000 + rate - 1) / rate : 1;
+
+	return( msec * 1000 );
+}
+
+/********************************* CapStop **********************************
+ *
+ *  Description: Stop sampling
+ *
+ *               Samples taken after the trigger remain readable.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void CapStop(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	if (llHdl->capState != M31_CAPST_ARMED &&
+		llHdl->capState != M31_CAPST_TRIGGERED)
+		return;
+
+	OSS_TimerStop(llHdl->osHdl, llHdl->capTimer);
+
+	OSS_SpinLockAcquire(llHdl->osHdl, llHdl->capLock);
+	llHdl->capState = (llHdl->capState == M31_CAPST_TRIGGERED) ?
+		M31_CAPST_STOPPED : M31_CAPST_IDLE;
+	OSS_SpinLockRelease(llHdl->osHdl, llHdl->capLock);
+}
+
+/********************************* CapTimer *********************************
+ *
+ *  Description: Capture timer callback
+ *
+ *               Takes one sample. A call delayed by a sample period or
+ *               more is counted as gap (samples missing before this one).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg		low-level handle
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void CapTimer(	/* nodoc */
+   void *arg
+)
+{
+	LL_HANDLE *llHdl = (LL_HANDLE*)arg;
+	u_int64 now;
+
+	if (llHdl->capState != M31_CAPST_ARMED &&
+		llHdl->capState != M31_CAPST_TRIGGERED)
+		return;
+
+	now = TsGet(llHdl);
+
+	/* late by a period or more: samples missing */
+	if (llHdl->capNextTs &&
+		(int64)(now - llHdl->capNextTs) >= (int64)llHdl->capPeriodTs)
+		llHdl->capGaps++;
+	llHdl->capNextTs = now + llHdl->capPeriodTs;
+
+	CapSample(llHdl, MREAD_D16(llHdl->ma, DATA_REG), now);
+}
+
+/******************************** CapSample *********************************
+ *
+ *  Description: Store one capture sample
+ *
+ *               While armed, the trigger pattern is checked and only the
+ *               last pre-trigger samples are kept. After the trigger,
+ *               samples are lost if the buffer is full.
+ *
+ *               In format M31_CAPFMT_RLE, equal samples are counted in an
+ *               open run which is stored as M31_RLE_REC when the state
+ *               changes or the count saturates.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               sample		data register value
+ *               ts			timestamp of the sample
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void CapSample(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int16      sample,
+   u_int64      ts
+)
+{
+	u_int32 mask = llHdl->capSize - 1;
+	u_int16 *cntP;
+
+	OSS_SpinLockAcquire(llHdl->osHdl, llHdl->capLock);
+
+	if (llHdl->capState == M31_CAPST_ARMED &&
+		((sample ^ llHdl->capTrigValue) & llHdl->capTrigMask) == 0) {
+		llHdl->capState      = M31_CAPST_TRIGGERED;
+		llHdl->capPreTrigCnt = llHdl->capHeld;
+		llHdl->capTrigTs     = ts;
+	}
+
+	if (llHdl->capFormat == M31_CAPFMT_RLE) {
+		/*--- run length encoded ---*/
+		if (llHdl->capRunCnt &&
+			(sample != llHdl->capRunState || llHdl->capRunCnt == 0xffff))
+			CapRunStore(llHdl);
+
+		if (llHdl->capRunCnt == 0)
+			llHdl->capRunState = sample;
+		llHdl->capRunCnt++;
+
+		if (llHdl->capState == M31_CAPST_ARMED) {
+			/* keep only the last pre-trigger samples */
+			if (++llHdl->capHeld > llHdl->capPreTrig) {
+				if (llHdl->capGet != llHdl->capPut) {
+					cntP = &llHdl->capBuf[(llHdl->capGet + 1) & mask];
+					if (--(*cntP) == 0)
+						llHdl->capGet += 2;
+				}
+				else
+					llHdl->capRunCnt--;
+				llHdl->capHeld--;
+			}
+		}
+	}
+	else {
+		/*--- raw samples ---*/
+		if (llHdl->capState == M31_CAPST_ARMED) {
+			/* keep only the last pre-trigger samples */
+			if (llHdl->capHeld >= llHdl->capPreTrig) {
+				if (llHdl->capPreTrig == 0)
+					goto unlock;
+				llHdl->capGet++;
+				llHdl->capHeld--;
+			}
+			llHdl->capHeld++;
+		}
+		else if (llHdl->capPut - llHdl->capGet >= llHdl->capSize) {
+			llHdl->capLost++;
+			goto unlock;
+		}
+
+		llHdl->capBuf[llHdl->capPut++ & mask] = sample;
+	}
+
+unlock:
+	OSS_SpinLockRelease(llHdl->osHdl, llHdl->capLock);
+}
+
+/******************************* CapRunStore ********************************
+ *
+ *  Description: Store the open run (format M31_CAPFMT_RLE)
+ *
+ *               While armed, the oldest run is dropped if the buffer is
+ *               full. After the trigger, the samples of the run are lost.
+ *
+ *               Must be called with the capture lock held.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void CapRunStore(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	u_int32 mask = llHdl->capSize - 1;
+
+	if (llHdl->capPut - llHdl->capGet > llHdl->capSize - 2) {
+		if (llHdl->capState == M31_CAPST_ARMED) {
+			llHdl->capHeld -= llHdl->capBuf[(llHdl->capGet + 1) & mask];
+			llHdl->capGet  += 2;
+		}
+		else {
+			llHdl->capLost  += llHdl->capRunCnt;
+			llHdl->capRunCnt = 0;
+			return;
+		}
+	}
+
+	llHdl->capBuf[llHdl->capPut++ & mask] = llHdl->capRunState;
+	llHdl->capBuf[llHdl->capPut++ & mask] = (u_int16)llHdl->capRunCnt;
+	llHdl->capRunCnt = 0;
+}
+
+/********************************* CapGet ***********************************
+ *
+ *  Description: Get captured samples or runs
+ *
+ *               Returns nothing until the capture has triggered. The
+ *               samples are copied in chunks with the capture lock held.
+ *               In format M31_CAPFMT_RLE the open run is stored first, so
+ *               the reader gets all samples taken so far.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               buf		destination buffer
+ *               max		max nr of words (even for M31_CAPFMT_RLE)
+ *
+ *  Output.....: return	    nr of words copied
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static u_int32 CapGet(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int16      *buf,
+   u_int32      max
+)
+{
+	u_int32 n = 0, chunk;
+
+	while (n < max) {
+		OSS_SpinLockAcquire(llHdl->osHdl, llHdl->capLock);
+
+		if (llHdl->capState != M31_CAPST_TRIGGERED &&
+			llHdl->capState != M31_CAPST_STOPPED) {
+			OSS_SpinLockRelease(llHdl->osHdl, llHdl->capLock);
+			break;
+		}
+
+		if (llHdl->capRunCnt &&
+			llHdl->capPut - llHdl->capGet <= llHdl->capSize - 2)
+			CapRunStore(llHdl);
+
+		for (chunk = 0; chunk < CAP_COPY_CHUNK && n < max &&
+				 llHdl->capGet != llHdl->capPut; chunk++)
+			buf[n++] = llHdl->capBuf[llHdl->capGet++ & (llHdl->capSize-1)];
+
+		OSS_SpinLockRelease(llHdl->osHdl, llHdl->capLock);
+
+		if (chunk < CAP_COPY_CHUNK)		/* buffer empty or full */
+			break;
+	}
+
+	return( n );
+}
+
+/******************************** IdPromGet *********************************
+ *
+ *  Description: Get ID PROM contents into the cache and check the ID
+ *
+ *               The magic word and the module ID are read once, the other
+ *               words only if requested (full) and not cached yet. The
+ *               check result is stored and returned on subsequent calls.
+ *               The check verifies the magic word and the module ID
+ *               (the ID PROM layout has no checksum). The module ID is
+ *               taken from the cache also if ID_CHECK is disabled.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               full		read all words (else magic word and ID only)
+ *
+ *  Output.....: return	    success (0) or error code
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 IdPromGet(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int32      full
+)
+{
+	u_int8 n;
+
+	if (full && !llHdl->idFull) {
+		for (n=2; n<MOD_ID_SIZE/2; n++)
+			llHdl->idProm[n] = (u_int16)m_read((U_INT32_OR_64)llHdl->ma, n);
+		llHdl->idFull = TRUE;
+	}
+
+	if (llHdl->idRead)
+		return( llHdl->idError );
+
+	for (n=0; n<2; n++)
+		llHdl->idProm[n] = (u_int16)m_read((U_INT32_OR_64)llHdl->ma, n);
+
+	llHdl->modId   = llHdl->idProm[1];
+	llHdl->idRead  = TRUE;
+	llHdl->idError = ERR_SUCCESS;
+
+	if (!llHdl->idCheck)
+		return( ERR_SUCCESS );
+
+	if (llHdl->idProm[0] != MOD_ID_MAGIC) {
+		DBGWRT_ERR((DBH,"*** LL - IdPromGet: illegal magic=0x%04x\n",
+					llHdl->idProm[0]));
+		llHdl->idError = ERR_LL_ILL_ID;
+	}
+	else if ( (llHdl->modId != MOD_ID_M31) &&
+			  (llHdl->modId != MOD_ID_M32) &&
+			  (llHdl->modId != MOD_ID_M82) ) {
+		DBGWRT_ERR((DBH,"*** LL - IdPromGet: illegal id=%d\n",
+					llHdl->modId));
+		llHdl->idError = ERR_LL_ILL_ID;
+	}
+	else {
+		DBGWRT_2((DBH," M%d module detected\n", llHdl->modId));
+	}
+
+	return( llHdl->idError );
+}
+
+/****************************** HysShadowGet ********************************
+ *
+ *  Description: Check for M82 and load the mode register shadow
+ *
+ *               MODE_REG is only read if the shadow is not valid.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: return	    success (0) or error code
+ *                          (ERR_LL_UNK_CODE if no M82)
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 HysShadowGet(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	int32 error;
+
+	if ((error = IdPromGet(llHdl, FALSE)))
+		return( error );
+
+	if (llHdl->modId != MOD_ID_M82)
+		return( ERR_LL_UNK_CODE );
+
+	if (!llHdl->hysValid) {
+		llHdl->hysMask  = MREAD_D16(llHdl->ma, MODE_REG);
+		llHdl->hysValid = TRUE;
+	}
+
+	return( ERR_SUCCESS );
+}
+
+/***************************** SigCoalesceSet *******************************
+ *
+ *  Description: Set the signal coalescing window
+ *
+ *               Creates the coalescing timer on first use. A signal deferred
+ *               in the old window is sent. The one-shot timer is started
+ *               by the first deferred edge (see ProcessChange).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               msec		window [ms] (0=off)
+ *
+ *  Output.....: return	    success (0) or error code
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 SigCoalesceSet(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int32      msec
+)
+{
+	OSS_IRQ_STATE irqState;
+	u_int64 winTs;
+	int32 error;
+
+	if (msec > 0xffffffff / 1000)
+		return( ERR_LL_ILL_PARAM );
+
+	/* deliver a deferred signal */
+	if (llHdl->sigTimer)
+		OSS_TimerStop(llHdl->osHdl, llHdl->sigTimer);
+	SigTimer((void*)llHdl);
+
+	if (msec == 0) {
+		llHdl->sigCoalesce = 0;
+		return( ERR_SUCCESS );
+	}
+
+	if (llHdl->sigTimer == NULL &&
+		(error = OSS_TimerCreate(llHdl->osHdl, SigTimer, (void*)llHdl,
+								 &llHdl->sigTimer)))
+		return( error );
+
+	winTs = UsToTs(llHdl, msec * 1000);
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	llHdl->sigWinTs    = winTs;
+	llHdl->sigCoalesce = msec;
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	return( ERR_SUCCESS );
+}
+
+/******************************** SigTimer **********************************
+ *
+ *  Description: Signal coalescing timer callback
+ *
+ *               Sends the signal if edges were deferred in the window.
+ *               The timer is one-shot, the next deferred edge restarts it.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg		low-level handle
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void SigTimer(	/* nodoc */
+   void *arg
+)
+{
+	LL_HANDLE *llHdl = (LL_HANDLE*)arg;
+	OSS_IRQ_STATE irqState;
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+
+	if (llHdl->sigPending) {
+		llHdl->sigPending = FALSE;
+		if (llHdl->sigHdl) {
+			OSS_SigSend(llHdl->osHdl, llHdl->sigHdl);
+			llHdl->sigLastTs = TsGet(llHdl);
+			llHdl->sigSent++;
+		}
+	}
+
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+}
+
+/****************************** AggrRegister ********************************
+ *
+ *  Description: Register the device in its aggregate group
+ *
+ *               Creates the registry lock for the first device. Relies on
+ *               M31_Init/M31_Exit being serialized by the MDIS kernel.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: return	    success (0) or error code
+ *
+ *  Globals....: G_aggr, G_aggrLock, G_aggrUsers
+ ****************************************************************************/
+static int32 AggrRegister(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	LL_HANDLE **slotP = &G_aggr[llHdl->aggrGroup-1][llHdl->aggrIndex];
+	int32 error;
+
+	if (G_aggrUsers == 0 &&
+		(error = OSS_SpinLockCreate(llHdl->osHdl, &G_aggrLock)))
+		return( error );
+
+	OSS_SpinLockAcquire(llHdl->osHdl, G_aggrLock);
+	if (*slotP == NULL)
+		*slotP = llHdl;
+	OSS_SpinLockRelease(llHdl->osHdl, G_aggrLock);
+
+	if (*slotP != llHdl) {
+		DBGWRT_ERR((DBH,"*** LL - AggrRegister: group %d index %d in use\n",
+					llHdl->aggrGroup, llHdl->aggrIndex));
+		if (G_aggrUsers == 0)
+			OSS_SpinLockRemove(llHdl->osHdl, &G_aggrLock);
+		llHdl->aggrGroup = 0;		/* don't unregister */
+		return( ERR_LL_ILL_PARAM );
+	}
+
+	G_aggrUsers++;
+	return( ERR_SUCCESS );
+}
+
+/***************************** AggrUnregister *******************************
+ *
+ *  Description: Remove the device from its aggregate group
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: -
+ *
+ *  Globals....: G_aggr, G_aggrLock, G_aggrUsers
+ ****************************************************************************/
+static void AggrUnregister(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	OSS_SpinLockAcquire(llHdl->osHdl, G_aggrLock);
+	G_aggr[llHdl->aggrGroup-1][llHdl->aggrIndex] = NULL;
+	OSS_SpinLockRelease(llHdl->osHdl, G_aggrLock);
+
+	llHdl->aggrGroup = 0;
+
+	if (--G_aggrUsers == 0)
+		OSS_SpinLockRemove(llHdl->osHdl, &G_aggrLock);
+}
+
+/******************************* AggrMembers ********************************
+ *
+ *  Description: Get the registered modules of the aggregate group
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: return	    bit mask (bit n = module index n)
+ *
+ *  Globals....: G_aggr, G_aggrLock
+ ****************************************************************************/
+static u_int32 AggrMembers(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	u_int32 n, mask = 0;
+
+	if (llHdl->aggrGroup == 0)
+		return( 0 );
+
+	OSS_SpinLockAcquire(llHdl->osHdl, G_aggrLock);
+	for (n=0; n<AGGR_MEMBERS; n++)
+		if (G_aggr[llHdl->aggrGroup-1][n])
+			mask |= 1 << n;
+	OSS_SpinLockRelease(llHdl->osHdl, G_aggrLock);
+
+	return( mask );
+}
+
+/****************************** ReadyRegister *******************************
+ *
+ *  Description: Register the device in its ready group
+ *
+ *               Creates the ready lock for the first device. Relies on
+ *               M31_Init/M31_Exit being serialized by the MDIS kernel.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: return	    success (0) or error code
+ *
+ *  Globals....: G_ready, G_readyUsed, G_readyLock, G_readyUsers
+ ****************************************************************************/
+static int32 ReadyRegister(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	u_int32 group = llHdl->readyGroup - 1, used;
+	int32 error;
+
+	if (G_readyUsers == 0 &&
+		(error = OSS_SpinLockCreate(llHdl->osHdl, &G_readyLock)))
+		return( error );
+
+	OSS_SpinLockAcquire(llHdl->osHdl, G_readyLock);
+	used = G_readyUsed[group] & llHdl->readyBit;
+	if (!used) {
+		G_readyUsed[group] |= llHdl->readyBit;
+		G_ready[group]     &= ~llHdl->readyBit;
+	}
+	OSS_SpinLockRelease(llHdl->osHdl, G_readyLock);
+
+	if (used) {
+		DBGWRT_ERR((DBH,"*** LL - ReadyRegister: group %d bit 0x%x in use\n",
+					llHdl->readyGroup, llHdl->readyBit));
+		if (G_readyUsers == 0)
+			OSS_SpinLockRemove(llHdl->osHdl, &G_readyLock);
+		llHdl->readyGroup = 0;		/* don't unregister */
+		return( ERR_LL_ILL_PARAM );
+	}
+
+	G_readyUsers++;
+	return( ERR_SUCCESS );
+}
+
+/***************************** ReadyUnregister ******************************
+ *
+ *  Description: Remove the device from its ready group
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: -
+ *
+ *  Globals....: G_ready, G_readyUsed, G_readyLock, G_readyUsers
+ ****************************************************************************/
+static void ReadyUnregister(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	u_int32 group = llHdl->readyGroup - 1;
+
+	OSS_SpinLockAcquire(llHdl->osHdl, G_readyLock);
+	G_readyUsed[group] &= ~llHdl->readyBit;
+	G_ready[group]     &= ~llHdl->readyBit;
+	OSS_SpinLockRelease(llHdl->osHdl, G_readyLock);
+
+	if (--G_readyUsers == 0)
+		OSS_SpinLockRemove(llHdl->osHdl, &G_readyLock);
+}
+
+/********************************* ReadySet *********************************
+ *
+ *  Description: Mark the device ready
+ *
+ *               Each newly ready device must wake the waiter: a device
+ *               which became ready before may not have sent a signal
+ *               (none installed, edge not in M31_SIG_MASK).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: return	    TRUE if the device bit was not set
+ *
+ *  Globals....: G_ready, G_readyLock
+ ****************************************************************************/
+static u_int32 ReadySet(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	u_int32 *readyP = &G_ready[llHdl->readyGroup - 1];
+	u_int32 newly;
+
+	OSS_SpinLockAcquire(llHdl->osHdl, G_readyLock);
+	newly = !(*readyP & llHdl->readyBit);
+	*readyP |= llHdl->readyBit;
+	OSS_SpinLockRelease(llHdl->osHdl, G_readyLock);
+
+	return( newly );
+}
+
+/********************************* ReadyGet *********************************
+ *
+ *  Description: Get and clear the ready mask of the group
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: return	    ready mask
+ *
+ *  Globals....: G_ready, G_readyLock
+ ****************************************************************************/
+static u_int32 ReadyGet(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	u_int32 *readyP = &G_ready[llHdl->readyGroup - 1];
+	u_int32 mask;
+
+	OSS_SpinLockAcquire(llHdl->osHdl, G_readyLock);
+	mask = *readyP;
+	*readyP = 0;
+	OSS_SpinLockRelease(llHdl->osHdl, G_readyLock);
+
+	return( mask );
+}
+
+/******************************** AggrRead **********************************
+ *
+ *  Description: Read a channel of another module of the aggregate device
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle (master)
+ *               ch			channel 16..16*N-1
+ *
+ *  Output.....: *valueP	channel state
+ *               return	    success (0) or error code
+ *
+ *  Globals....: G_aggr, G_aggrLock
+ ****************************************************************************/
+static int32 AggrRead(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   int32        ch,
+   int32        *valueP
+)
+{
+	LL_HANDLE *memHdl;
+	u_int32 idx = ch / CH_NUMBER;
+	int32 error = ERR_SUCCESS;
+
+	if (idx >= llHdl->aggrCount)
+		return( ERR_LL_ILL_CHAN );
+
+	OSS_SpinLockAcquire(llHdl->osHdl, G_aggrLock);
+	if ((memHdl = G_aggr[llHdl->aggrGroup-1][idx]) != NULL)
+		*valueP = (int32)((MREAD_D16(memHdl->ma, DATA_REG) >>
+						   (ch % CH_NUMBER)) & 0x01);
+	else
+		error = ERR_LL_DEV_NOTRDY;
+	OSS_SpinLockRelease(llHdl->osHdl, G_aggrLock);
+
+	return( error );
+}
+
+/****************************** AggrStateGet ********************************
+ *
+ *  Description: Read the states of all modules of the aggregate device
+ *
+ *               The data registers are read back to back with the
+ *               registry lock held.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle (master)
+ *               buf		destination (aggrCount words)
+ *
+ *  Output.....: *nbrRdBytesP	nr of bytes read
+ *               return	    success (0) or error code
+ *
+ *  Globals....: G_aggr, G_aggrLock
+ ****************************************************************************/
+static int32 AggrStateGet(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int16      *buf,
+   int32        *nbrRdBytesP
+)
+{
+	LL_HANDLE **grp = G_aggr[llHdl->aggrGroup-1];
+	u_int32 n;
+	int32 error = ERR_SUCCESS;
+
+	OSS_SpinLockAcquire(llHdl->osHdl, G_aggrLock);
+	for (n=0; n<llHdl->aggrCount; n++) {
+		if (grp[n] == NULL) {
+			error = ERR_LL_DEV_NOTRDY;
+			break;
+		}
+		buf[n] = MREAD_D16(grp[n]->ma, DATA_REG);
+	}
+	OSS_SpinLockRelease(llHdl->osHdl, G_aggrLock);
+
+	if (error == ERR_SUCCESS)
+		*nbrRdBytesP = llHdl->aggrCount * sizeof(u_int16);
+
+	return( error );
+}
+
+/****************************** AggrChangeGet *******************************
+ *
+ *  Description: Get and clear the change flags of all modules
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle (master)
+ *               buf		destination (aggrCount words)
+ *
+ *  Output.....: return	    success (0) or error code
+ *
+ *  Globals....: G_aggr, G_aggrLock
+ ****************************************************************************/
+static int32 AggrChangeGet(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int16      *buf
+)
+{
+	LL_HANDLE **grp = G_aggr[llHdl->aggrGroup-1];
+	LL_HANDLE *memHdl;
+	OSS_IRQ_STATE irqState;
+	u_int32 n;
+	int32 error = ERR_SUCCESS;
+
+	OSS_SpinLockAcquire(llHdl->osHdl, G_aggrLock);
+	for (n=0; n<llHdl->aggrCount; n++) {
+		if ((memHdl = grp[n]) == NULL) {
+			error = ERR_LL_DEV_NOTRDY;
+			break;
+		}
+		irqState = OSS_IrqMaskR(memHdl->osHdl, memHdl->irqHdl);
+		buf[n] = memHdl->irqEnable ? memHdl->changeFlags : 0;
+		memHdl->changeFlags = 0;
+		OSS_IrqRestore(memHdl->osHdl, memHdl->irqHdl, irqState);
+	}
+	OSS_SpinLockRelease(llHdl->osHdl, G_aggrLock);
+
+	return( error );
+}
+
+/****************************** AggrEventGet ********************************
+ *
+ *  Description: Get the event records of all modules in timestamp order
+ *
+ *               Each record is taken from the module with the oldest
+ *               pending record. M31_EVENT.dev is set to the module index.
+ *               The records are merged in chunks, each with the group
+ *               lock taken once and the interrupts of all modules masked
+ *               (in module order).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle (master)
+ *               buf		destination buffer
+ *               max		max nr of records
+ *
+ *  Output.....: return	    nr of records copied
+ *
+ *  Globals....: G_aggr, G_aggrLock
+ ****************************************************************************/
+static u_int32 AggrEventGet(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   M31_EVENT    *buf,
+   u_int32      max
+)
+{
+	LL_HANDLE **grp = G_aggr[llHdl->aggrGroup-1];
+	LL_HANDLE *memHdl;
+	OSS_IRQ_STATE irqState[AGGR_MEMBERS];
+	M31_EVENT *evP;
+	u_int64 ts, bestTs = 0;
+	u_int32 n = 0, i, best, chunk, masked;
+
+	while (n < max) {
+		OSS_SpinLockAcquire(llHdl->osHdl, G_aggrLock);
+
+		/* freeze all fifos */
+		for (i=0, masked=0; i<llHdl->aggrCount; i++) {
+			if ((memHdl = grp[i]) && memHdl->evSize) {
+				irqState[i] = OSS_IrqMaskR(memHdl->osHdl, memHdl->irqHdl);
+				masked |= 1 << i;
+			}
+		}
+
+		for (chunk = 0; chunk < EVENT_COPY_CHUNK && n < max; chunk++) {
+			best = AGGR_MEMBERS;
+			for (i=0; i<llHdl->aggrCount; i++) {
+				memHdl = grp[i];
+				if (!(masked & (1 << i)) || memHdl->evGet == memHdl->evPut)
+					continue;
+				evP = (M31_EVENT*)memHdl->evBuf +
+					(memHdl->evGet & (memHdl->evSize-1));
+				ts = ((u_int64)evP->tsHigh << 32) | evP->tsLow;
+				if (best == AGGR_MEMBERS || (int64)(ts - bestTs) < 0) {
+					best   = i;
+					bestTs = ts;
+				}
+			}
+			if (best == AGGR_MEMBERS)
+				break;
+
+			memHdl = grp[best];
+			buf[n] = ((M31_EVENT*)memHdl->evBuf)
+				[memHdl->evGet++ & (memHdl->evSize-1)];
+			buf[n++].dev = (u_int8)best;
+		}
+
+		for (i=llHdl->aggrCount; i-- > 0; ) {
+			if (masked & (1 << i))
+				OSS_IrqRestore(grp[i]->osHdl, grp[i]->irqHdl, irqState[i]);
+		}
+
+		OSS_SpinLockRelease(llHdl->osHdl, G_aggrLock);
+
+		if (chunk < EVENT_COPY_CHUNK)	/* fifos empty or buffer full */
+			break;
+	}
+
+	return( n );
+}
+
+/****************************** ProcessChange *******************************
+ *
+ *  Description: Report a level change
+ *
+ *               Updates the change flags, stores the event record, marks
+ *               the device ready and sends the signal, each filtered by
+ *               the notification settings. Called with the device
+ *               interrupt masked (from the ISR or a timer).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               ts			timestamp of the change
+ *               state		reported states of all channels
+ *               change		changed channels (M31_EVF_RULE: rule bit,
+ *                          M31_EVF_LOST_EDGE: attributed channel)
+ *               flags		M31_EVF_xxx
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void ProcessChange(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int64      ts,
+   u_int16      state,
+   u_int16      change,
+   u_int8       flags
+)
+{
+	u_int16 notify, bits;
+	u_int32 wake = TRUE, n;
+
+	/* save and count level changes */
+	if (!(flags & (M31_EVF_LOST_EDGE | M31_EVF_RULE))) {
+		llHdl->changeFlags |= change;
+		for (bits=change, n=0; bits; bits >>= 1, n++)
+			if (bits & 1)
+				llHdl->chChanges[n]++;
+	}
+
+	/* edges to report (rules and new field values always, a lost edge
+	   contains both edges) */
+	if (flags & M31_EVF_RULE)
+		notify = 0xffff;
+	else if (flags & M31_EVF_FIELD)
+		notify = change;
+	else if (flags & M31_EVF_LOST_EDGE)
+		notify = change & (llHdl->edgeRise | llHdl->edgeFall);
+	else
+		notify = change & ((state & llHdl->edgeRise) |
+						   (~state & llHdl->edgeFall));
+
+	/* store event */
+	if (llHdl->irqEnable && notify)
+		EventPut(llHdl, ts, state, change, flags);
+
+	/* mark device ready, a device already marked doesn't wake again */
+	if (llHdl->readyGroup && notify)
+		wake = ReadySet(llHdl);
+
+	/* signal installed? */
+	if(llHdl->sigHdl && (notify & llHdl->sigMask) && wake){
+		/* send signal or defer to end of coalescing window */
+		if (llHdl->sigCoalesce == 0 ||
+			ts - llHdl->sigLastTs >= llHdl->sigWinTs) {
+			OSS_SigSend(llHdl->osHdl, llHdl->sigHdl);
+			llHdl->sigLastTs = ts;
+			llHdl->sigSent++;
+		}
+		else {
+			/* first deferred edge starts the one-shot timer */
+			if (!llHdl->sigPending) {
+				u_int32 realMsec;
+
+				OSS_TimerStart(llHdl->osHdl, llHdl->sigTimer,
+							   llHdl->sigCoalesce, FALSE, &realMsec);
+			}
+			llHdl->sigPending = TRUE;
+			llHdl->sigDeferred++;
+		}
+	}
+}
+
+/********************************* DbState **********************************
+ *
+ *  Description: Get the reported states of all channels
+ *
+ *               Debounced channels report their settled state, field
+ *               channels the state of the settled field value, all other
+ *               channels the current input level.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               raw		data register value
+ *
+ *  Output.....: return	    reported states
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static u_int16 DbState(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int16      raw
+)
+{
+	u_int16 state;
+
+	state = (raw & ~llHdl->dbMask) | (llHdl->dbState & llHdl->dbMask);
+
+	return( (state & ~llHdl->fldChMask) |
+			(llHdl->fldState & llHdl->fldChMask) );
+}
+
+/********************************* DbEdge ***********************************
+ *
+ *  Description: Handle edges of debounced channels
+ *
+ *               An input level different from the settled state (re)starts
+ *               the debounce window. A return to the settled state within
+ *               the window (or a double toggle) is counted as glitch.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               ts			timestamp of the edge
+ *               raw		data register value
+ *               change		changed debounced channels
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void DbEdge(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int64      ts,
+   u_int16      raw,
+   u_int16      change
+)
+{
+	u_int16 bit;
+	u_int32 ch;
+
+	while (change) {
+		bit = change & (~change + 1);		/* lowest changed channel */
+		change &= ~bit;
+		ch = Log2Bucket(bit);
+
+		if ((raw ^ llHdl->dbState) & bit) {
+			llHdl->dbPend |= bit;
+			llHdl->dbDeadline[ch] = ts + llHdl->dbTs[ch];
+		}
+		else {
+			llHdl->dbPend &= ~bit;
+			llHdl->glitches[ch]++;
+		}
+	}
+}
+
+/********************************* DbCheck **********************************
+ *
+ *  Description: Report debounced channels which are stable long enough
+ *
+ *               Settled changes are reported in deadline order with the
+ *               deadline as timestamp (last edge + debounce time), so the
+ *               event records stay in time order.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               now		current timestamp
+ *               raw		input levels since the last edges
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void DbCheck(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int64      now,
+   u_int16      raw
+)
+{
+	u_int16 pend, bit, due;
+	u_int32 ch;
+
+	for (;;) {
+		/* find oldest due channel */
+		due = 0;
+		for (pend = llHdl->dbPend; pend; pend &= ~bit) {
+			bit = pend & (~pend + 1);
+			ch  = Log2Bucket(bit);
+			if ((int64)(now - llHdl->dbDeadline[ch]) >= 0 &&
+				(due == 0 || (int64)(llHdl->dbDeadline[ch] -
+					llHdl->dbDeadline[Log2Bucket(due)]) < 0))
+				due = bit;
+		}
+
+		if (due == 0)
+			break;
+
+		llHdl->dbPend &= ~due;
+		ch = Log2Bucket(due);
+
+		if ((raw ^ llHdl->dbState) & due) {
+			llHdl->dbState ^= due;
+			ProcessChange(llHdl, llHdl->dbDeadline[ch], DbState(llHdl, raw),
+						  due, 0);
+		}
+		else
+			llHdl->glitches[ch]++;	/* returned without visible edge */
+	}
+}
+
+/********************************* DbTimer **********************************
+ *
+ *  Description: Debounce timer callback
+ *
+ *               Reports settled changes of debounced channels and fields
+ *               and rule timeouts if no interrupt occurs. The timer is
+ *               one-shot and re-armed while windows/deadlines are left.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg		low-level handle
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void DbTimer(	/* nodoc */
+   void *arg
+)
+{
+	LL_HANDLE *llHdl = (LL_HANDLE*)arg;
+	OSS_IRQ_STATE irqState;
+
+	u_int64 now;
+
+	/* pending level changes are left to the interrupt */
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	llHdl->dbTimerRun = FALSE;
+	now = TsGet(llHdl);
+	if (llHdl->dbPend)
+		DbCheck(llHdl, now, llHdl->lastState);
+	if (llHdl->fldPend)
+		FieldCheck(llHdl, now, llHdl->lastState);
+	if (llHdl->ruleDl)
+		RuleCheck(llHdl, now, llHdl->lastState);
+	DbTimerArm(llHdl);
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+}
+
+/********************************** DbSet ***********************************
+ *
+ *  Description: Set the debounce time of a channel
+ *
+ *               The settled state starts with the current input level.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               ch			channel
+ *               us			debounce time [us] (0=off)
+ *
+ *  Output.....: return	    success (0) or error code
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 DbSet(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   int32        ch,
+   u_int32      us
+)
+{
+	OSS_IRQ_STATE irqState;
+	u_int16 bit = (u_int16)(1 << ch);
+	u_int64 ts = us ? UsToTs(llHdl, us) : 0;
+	int32 error;
+
+	if (us && (error = DbTimerCreate(llHdl)))
+		return( error );
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	llHdl->dbTime[ch] = us;
+	llHdl->dbTs[ch]   = ts;
+	llHdl->dbPend    &= ~bit;
+	llHdl->dbState    = (llHdl->dbState & ~bit) | (llHdl->lastState & bit);
+	if (us)
+		llHdl->dbMask |= bit;
+	else
+		llHdl->dbMask &= ~bit;
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	return( ERR_SUCCESS );
+}
+
+/****************************** DbTimerCreate *******************************
+ *
+ *  Description: Create the debounce timer on first use
+ *
+ *               Needed once any channel is debounced, any field has a
+ *               settle time or any rule has a step time. The timer is
+ *               armed by DbTimerArm.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: return	    success (0) or error code
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 DbTimerCreate(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	if (llHdl->dbTimer)
+		return( ERR_SUCCESS );
+
+	return( OSS_TimerCreate(llHdl->osHdl, DbTimer, (void*)llHdl,
+							&llHdl->dbTimer) );
+}
+
+/******************************** DbTimerArm ********************************
+ *
+ *  Description: Arm the debounce timer if windows/deadlines are running
+ *
+ *               Starts the one-shot timer if a debounce window, a field
+ *               settle window or a rule deadline is pending and the timer
+ *               is not armed yet. A failed start is retried by the next
+ *               interrupt. Called with the device interrupt masked (ISR or
+ *               timer).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void DbTimerArm(	/* nodoc */
+   LL_HANDLE    *llHdl
+)
+{
+	u_int32 realMsec;
+
+	if (llHdl->dbTimerRun || llHdl->dbTimer == NULL ||
+		(llHdl->dbPend == 0 && llHdl->fldPend == 0 && llHdl->ruleDl == 0))
+		return;
+
+	if (OSS_TimerStart(llHdl->osHdl, llHdl->dbTimer, DB_TIMER_MSEC, FALSE,
+					   &realMsec) == ERR_SUCCESS)
+		llHdl->dbTimerRun = TRUE;
+}
+
+/********************************* QuadSet **********************************
+ *
+ *  Description: Set the quadrature decoded channel pairs
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               mask		pairs (bit n = channels 2n, 2n+1)
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void QuadSet(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int32      mask
+)
+{
+	OSS_IRQ_STATE irqState;
+	u_int16 chMask = 0;
+	u_int32 n;
+
+	for (n=0; n<QUAD_PAIRS; n++)
+		if (mask & (1 << n))
+			chMask |= 3 << (2*n);
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	llHdl->quadMask   = (u_int8)mask;
+	llHdl->quadChMask = chMask;
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+}
+
+/******************************** QuadDecode ********************************
+ *
+ *  Description: Decode the quadrature steps of all decoded pairs
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               prev		previous states
+ *               curr		current states
+ *
+ *  Output.....: -
+ *
+ *  Globals....: G_quadTab
+ ****************************************************************************/
+static void QuadDecode(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int16      prev,
+   u_int16      curr
+)
+{
+	u_int16 diff = (prev ^ curr) & llHdl->quadChMask;
+	u_int32 n;
+	int32 step;
+
+	for (n=0; diff; n++, prev >>= 2, curr >>= 2, diff >>= 2) {
+		if ((diff & 3) == 0)
+			continue;
+
+		step = G_quadTab[((prev & 3) << 2) | (curr & 3)];
+		if (step == QUAD_ERR)
+			llHdl->quadErr[n]++;
+		else {
+			llHdl->quadPos[n] += step;
+			llHdl->quadDir[n]  = step;
+		}
+	}
+}
+
+/******************************* StrobeLatch ********************************
+ *
+ *  Description: Latch the data word on the selected strobe edge
+ *
+ *               If a lost edge was attributed to the strobe channel
+ *               since the last word, the word gets flag M31_EVF_LOST_EDGE.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               ts			timestamp
+ *               state		data register value
+ *               change		changed channels
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void StrobeLatch(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int64      ts,
+   u_int16      state,
+   u_int16      change
+)
+{
+	M31_STROBE_REC *recP;
+	u_int8 edge;
+
+	if (!(change & llHdl->stbBit))
+		return;
+
+	edge = (state & llHdl->stbBit) ? M31_STROBE_RISE : M31_STROBE_FALL;
+
+	if (!(edge & llHdl->stbEdge))
+		return;
+
+	if (llHdl->stbPut - llHdl->stbGet >= llHdl->stbSize) {
+		llHdl->stbLost++;
+		llHdl->stbSeq++;
+		return;
+	}
+
+	recP = (M31_STROBE_REC*)llHdl->stbBuf +
+		(llHdl->stbPut & (llHdl->stbSize-1));
+	recP->tsHigh = (u_int32)(ts >> 32);
+	recP->tsLow  = (u_int32)ts;
+	recP->data   = state & ~llHdl->stbBit;
+	recP->flags  = llHdl->stbLostEdge ? M31_EVF_LOST_EDGE : 0;
+	recP->res    = 0;
+	recP->seq    = llHdl->stbSeq++;
+
+	llHdl->stbLostEdge = FALSE;
+	llHdl->stbPut++;
+}
+
+/******************************** StrobeGet *********************************
+ *
+ *  Description: Get pending records from the word FIFO
+ *
+ *               The records are copied in chunks with the device interrupt
+ *               masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               buf		destination buffer
+ *               max		max nr of records
+ *
+ *  Output.....: return	    nr of records copied
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static u_int32 StrobeGet(	/* nodoc */
+   LL_HANDLE      *llHdl,
+   M31_STROBE_REC *buf,
+   u_int32        max
+)
+{
+	M31_STROBE_REC *stbBuf = (M31_STROBE_REC*)llHdl->stbBuf;
+	OSS_IRQ_STATE irqState;
+	u_int32 n = 0, chunk;
+
+	while (n < max) {
+		irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+
+		for (chunk = 0; chunk < STROBE_COPY_CHUNK && n < max &&
+				 llHdl->stbGet != llHdl->stbPut; chunk++)
+			buf[n++] = stbBuf[llHdl->stbGet++ & (llHdl->stbSize-1)];
+
+		OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+		if (chunk < STROBE_COPY_CHUNK)	/* fifo empty or buffer full */
+			break;
+	}
+
+	return( n );
+}
+
+/******************************** FieldSet **********************************
+ *
+ *  Description: Define a channel field
+ *
+ *               The settled value starts with the current input levels.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               def		field definition (width 0 = delete)
+ *
+ *  Output.....: return	    success (0) or error code
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 FieldSet(	/* nodoc */
+   LL_HANDLE           *llHdl,
+   const M31_FIELD_DEF *def
+)
+{
+	OSS_IRQ_STATE irqState;
+	u_int32 fld = def->field, n;
+	u_int16 mask = 0x0000;
+	u_int32 settle;
+	u_int64 settleTs;
+	int32 error;
+
+	if (fld >= FLD_NUMBER || def->code > M31_FLDCODE_BCD)
+		return( ERR_LL_ILL_PARAM );
+
+	if (def->width) {
+		if (def->width > CH_NUMBER || def->first >= CH_NUMBER ||
+			def->first + def->width > CH_NUMBER)
+			return( ERR_LL_ILL_PARAM );
+
+		mask = (u_int16)(((1 << def->width) - 1) << def->first);
+
+		for (n=0; n<FLD_NUMBER; n++)
+			if (n != fld && (llHdl->fldMask[n] & mask))
+				return( ERR_LL_ILL_PARAM );		/* overlap */
+
+		if (def->settle && (error = DbTimerCreate(llHdl)))
+			return( error );
+	}
+
+	settle   = mask ? def->settle : 0;
+	settleTs = settle ? UsToTs(llHdl, settle) : 0;
+
+	OSS_MemCopy(llHdl->osHdl, FLD_NAME_LEN - 1, (char*)def->name,
+				llHdl->fldName[fld]);
+	llHdl->fldName[fld][FLD_NAME_LEN - 1] = '\0';
+
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	llHdl->fldChMask  &= ~llHdl->fldMask[fld];
+	llHdl->fldMask[fld]  = mask;
+	llHdl->fldFirst[fld] = mask ? def->first : 0;
+	llHdl->fldCode[fld]  = def->code;
+	llHdl->fldSettle[fld]   = settle;
+	llHdl->fldSettleTs[fld] = settleTs;
+	llHdl->fldChanges[fld] = 0;
+	llHdl->fldInvalid[fld] = 0;
+	llHdl->fldChMask |= mask;
+	FieldReset(llHdl, fld);
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	return( ERR_SUCCESS );
+}
+
+/******************************* FieldReset *********************************
+ *
+ *  Description: Restart a channel field with the current input levels
+ *
+ *               Called with the device interrupt masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               fld		field index
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void FieldReset(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int32      fld
+)
+{
+	u_int16 mask = llHdl->fldMask[fld];
+	u_int8  bit = (u_int8)(1 << fld);
+	u_int32 width = Log2Bucket((mask >> llHdl->fldFirst[fld]) + 1);
+
+	llHdl->fldPend  &= ~bit;
+	llHdl->fldState  = (llHdl->fldState & ~mask) | (llHdl->lastState & mask);
+
+	if (mask && FieldDecode(llHdl->fldCode[fld],
+							(llHdl->lastState & mask) >> llHdl->fldFirst[fld],
+							width, &llHdl->fldValue[fld]))
+		llHdl->fldValid |= bit;
+	else {
+		llHdl->fldValid &= ~bit;
+		llHdl->fldValue[fld] = 0;
+	}
+}
+
+/******************************* FieldDecode ********************************
+ *
+ *  Description: Decode the channel states of a field
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: code		M31_FLDCODE_xxx
+ *               bits		channel states (first channel = bit 0)
+ *               width		nr of channels
+ *               valueP		pointer to variable where value is stored
+ *
+ *  Output.....: return	    TRUE if valid code
+ *               *valueP	decoded value
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 FieldDecode(	/* nodoc */
+   u_int32      code,
+   u_int32      bits,
+   u_int32      width,
+   u_int32      *valueP
+)
+{
+	u_int32 value = 0, scale = 1, digit, n;
+
+	switch (code) {
+	case M31_FLDCODE_GRAY:
+		for (value = bits, n = 1; n < width; n <<= 1)
+			value ^= value >> n;
+		break;
+
+	case M31_FLDCODE_BCD:
+		for (n = 0; n < width; n += 4, scale *= 10) {
+			digit = (bits >> n) & 0xf;
+			if (digit > 9)
+				return( FALSE );
+			value += digit * scale;
+		}
+		break;
+
+	default:
+		value = bits;
+		break;
+	}
+
+	*valueP = value;
+	return( TRUE );
+}
+
+/******************************** FieldEdge *********************************
+ *
+ *  Description: Handle edges of field channels
+ *
+ *               An edge (re)starts the settle window of the field. Fields
+ *               without settle time are evaluated immediately.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               ts			timestamp of the edge
+ *               raw		data register value
+ *               change		changed field channels
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void FieldEdge(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int64      ts,
+   u_int16      raw,
+   u_int16      change
+)
+{
+	u_int32 fld;
+
+	for (fld=0; fld<FLD_NUMBER; fld++) {
+		if (!(change & llHdl->fldMask[fld]))
+			continue;
+
+		if (llHdl->fldSettleTs[fld]) {
+			llHdl->fldPend |= (u_int8)(1 << fld);
+			llHdl->fldDeadline[fld] = ts + llHdl->fldSettleTs[fld];
+		}
+		else
+			FieldCommit(llHdl, fld, ts, raw);
+	}
+}
+
+/******************************** FieldCheck ********************************
+ *
+ *  Description: Report fields which are stable long enough
+ *
+ *               Like DbCheck(), settled fields are reported in deadline
+ *               order with the deadline as timestamp.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               now		current timestamp
+ *               raw		input levels since the last edges
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void FieldCheck(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int64      now,
+   u_int16      raw
+)
+{
+	u_int32 fld, due;
+
+	while (llHdl->fldPend) {
+		/* find oldest due field */
+		due = FLD_NUMBER;
+		for (fld=0; fld<FLD_NUMBER; fld++) {
+			if ((llHdl->fldPend & (1 << fld)) &&
+				(int64)(now - llHdl->fldDeadline[fld]) >= 0 &&
+				(due == FLD_NUMBER || (int64)(llHdl->fldDeadline[fld] -
+					llHdl->fldDeadline[due]) < 0))
+				due = fld;
+		}
+
+		if (due == FLD_NUMBER)
+			break;
+
+		llHdl->fldPend &= (u_int8)~(1 << due);
+		FieldCommit(llHdl, due, llHdl->fldDeadline[due], raw);
+	}
+}
+
+/******************************* FieldCommit ********************************
+ *
+ *  Description: Settle a field and report a new value
+ *
+ *               Invalid codes (BCD digit > 9) are counted and keep the
+ *               previous value.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               fld		field index
+ *               ts			timestamp of the settled value
+ *               raw		input levels
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void FieldCommit(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int32      fld,
+   u_int64      ts,
+   u_int16      raw
+)
+{
+	u_int16 mask = llHdl->fldMask[fld];
+	u_int8  bit = (u_int8)(1 << fld);
+	u_int32 value;
+
+	if (!FieldDecode(llHdl->fldCode[fld], (raw & mask) >> llHdl->fldFirst[fld],
+					 Log2Bucket((mask >> llHdl->fldFirst[fld]) + 1), &value)) {
+		llHdl->fldInvalid[fld]++;
+		return;
+	}
+
+	if ((llHdl->fldValid & bit) && value == llHdl->fldValue[fld])
+		return;									/* back to old value */
+
+	llHdl->fldValue[fld] = value;
+	llHdl->fldValid |= bit;
+	llHdl->fldState  = (llHdl->fldState & ~mask) | (raw & mask);
+	llHdl->fldChanges[fld]++;
+
+	ProcessChange(llHdl, ts, DbState(llHdl, raw), mask, M31_EVF_FIELD);
+}
+
+/******************************** FieldOfCh *********************************
+ *
+ *  Description: Get the field which contains a channel
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               ch			channel
+ *
+ *  Output.....: return	    field index or -1
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 FieldOfCh(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   int32        ch
+)
+{
+	int32 fld;
+
+	for (fld=0; fld<FLD_NUMBER; fld++)
+		if (llHdl->fldMask[fld] & (1 << ch))
+			return( fld );
+
+	return( -1 );
+}
+
+/******************************* ChCodeCheck ********************************
+ *
+ *  Description: Check the current channel of a per-channel status code
+ *
+ *               On an aggregate master, the MDIS kernel accepts channels
+ *               of all modules (16*N). Per-channel codes only apply to the
+ *               channels of the own module.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: code		status code
+ *               ch			current channel
+ *
+ *  Output.....: return	    success (0) or ERR_LL_ILL_CHAN
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 ChCodeCheck(	/* nodoc */
+   int32        code,
+   int32        ch
+)
+{
+	switch (code) {
+	case M31_HYS_MODE:
+	case M31_DEBOUNCE:
+	case M31_GLITCHES:
+	case M31_LOST_EDGES:
+	case M31_FIELD_VALUE:
+	case M31_QUAD_POS:
+	case M31_QUAD_DIR:
+	case M31_QUAD_ERRORS:
+		if (ch < 0 || ch >= CH_NUMBER)
+			return( ERR_LL_ILL_CHAN );
+	}
+
+	return( ERR_SUCCESS );
+}
+
+/********************************* RuleLoad *********************************
+ *
+ *  Description: Load and compile the rule table
+ *
+ *               Step times are converted to timestamp counts, so the ISR
+ *               only compares timestamps. The conversion is a multiply and
+ *               done with the interrupt masked. All rules restart at step 0.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               rules		rule table
+ *               num		nr of rules (0..RULE_NUMBER)
+ *
+ *  Output.....: return	    success (0) or error code
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 RuleLoad(	/* nodoc */
+   LL_HANDLE      *llHdl,
+   const M31_RULE *rules,
+   u_int32        num
+)
+{
+	OSS_IRQ_STATE irqState;
+	const M31_RULE_STEP *stepP;
+	u_int8 mask = 0x00, timed = 0x00;
+	u_int32 r, n;
+	int32 error;
+
+	/* check */
+	for (r=0; r<num; r++) {
+		for (n=0; n<RULE_STEPS; n++) {
+			stepP = &rules[r].step[n];
+			if (stepP->op > M31_ROP_LOW || stepP->ch >= CH_NUMBER ||
+				stepP->time > RULE_TIME_MAX)
+				return( ERR_LL_ILL_PARAM );
+
+			if (stepP->op != M31_ROP_END && stepP->time)
+				timed |= (u_int8)(1 << r);
+		}
+		if (rules[r].step[0].op != M31_ROP_END)
+			mask |= (u_int8)(1 << r);
+	}
+
+	if (timed && (error = DbTimerCreate(llHdl)))
+		return( error );
+
+	/* copy and convert times (UsToTs is a plain multiply) */
+	irqState = OSS_IrqMaskR(llHdl->osHdl, llHdl->irqHdl);
+	for (r=0; r<RULE_NUMBER; r++) {
+		for (n=0; n<RULE_STEPS; n++) {
+			if (r < num && (mask & (1 << r))) {
+				stepP = &rules[r].step[n];
+				llHdl->ruleOp[r][n]   = stepP->op;
+				llHdl->ruleCh[r][n]   = stepP->ch;
+				llHdl->ruleTime[r][n] = stepP->time;
+				llHdl->ruleTs[r][n]   = stepP->time ?
+					UsToTs(llHdl, stepP->time * 1000) : 0;
+			}
+			else {
+				llHdl->ruleOp[r][n]   = 0;
+				llHdl->ruleCh[r][n]   = 0;
+				llHdl->ruleTime[r][n] = 0;
+				llHdl->ruleTs[r][n]   = 0;
+			}
+		}
+		llHdl->ruleStep[r] = 0;
+		llHdl->ruleDone[r] = 0;
+		llHdl->ruleViol[r] = 0;
+	}
+	llHdl->ruleMask  = mask;
+	llHdl->ruleDl    = 0x00;
+	OSS_IrqRestore(llHdl->osHdl, llHdl->irqHdl, irqState);
+
+	return( ERR_SUCCESS );
+}
+
+/******************************** RuleEnter *********************************
+ *
+ *  Description: Enter a rule step
+ *
+ *               Passing the last step completes the rule. Step 0 waits
+ *               for its edge. Level steps check the level on entry and
+ *               start the hold time, edge steps start their window.
+ *               Called with the device interrupt masked.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               rule		rule index
+ *               step		step to enter
+ *               ts			timestamp of entry
+ *               state		input levels
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void RuleEnter(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int32      rule,
+   u_int32      step,
+   u_int64      ts,
+   u_int16      state
+)
+{
+	u_int8 bit = (u_int8)(1 << rule);
+	u_int8 op;
+	u_int32 high;
 
-    va_start(argptr, infoType );
+	for (;;) {
+		llHdl->ruleDl &= ~bit;
 
-    switch(infoType) {
-		/*-------------------------------+
-        |  hardware characteristics      |
-        +-------------------------------*/
-        case LL_INFO_HW_CHARACTER:
-		{
-			u_int32 *addrModeP = va_arg(argptr, u_int32*);
-			u_int32 *dataModeP = va_arg(argptr, u_int32*);
+		if (step >= RULE_STEPS || llHdl->ruleOp[rule][step] == M31_ROP_END) {
+			RuleReport(llHdl, rule, ts, state, FALSE);
+			step = 0;
+		}
 
-			*addrModeP = MDIS_MA08;
-			*dataModeP = MDIS_MD16;
-			break;
-	    }
-		/*-------------------------------+
-        |  nr of required address spaces |
-        +-------------------------------*/
-        case LL_INFO_ADDRSPACE_COUNT:
-		{
-			u_int32 *nbrOfAddrSpaceP = va_arg(argptr, u_int32*);
+		llHdl->ruleStep[rule] = (u_int8)step;
+		if (step == 0)
+			return;							/* wait for trigger edge */
 
-			*nbrOfAddrSpaceP = ADDRSPACE_COUNT;
+		op   = llHdl->ruleOp[rule][step];
+		high = (state >> llHdl->ruleCh[rule][step]) & 1;
+
+		if (op == M31_ROP_RISE || op == M31_ROP_FALL) {
+			if (llHdl->ruleTs[rule][step]) {
+				llHdl->ruleDeadline[rule] = ts + llHdl->ruleTs[rule][step];
+				llHdl->ruleDl |= bit;
+			}
+			return;
+		}
+
+		/* level step */
+		if (high != (op == M31_ROP_HIGH)) {
+			RuleReport(llHdl, rule, ts, state, TRUE);
+			step = 0;
+		}
+		else if (llHdl->ruleTs[rule][step]) {
+			llHdl->ruleDeadline[rule] = ts + llHdl->ruleTs[rule][step];
+			llHdl->ruleDl |= bit;
+			return;
+		}
+		else
+			step++;							/* level condition met */
+	}
+}
+
+/********************************* RuleEdge *********************************
+ *
+ *  Description: Evaluate the rules for an edge
+ *
+ *               Lost edges (interrupts without visible change) are not
+ *               evaluated.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               ts			timestamp of the edge
+ *               state		input levels after the edge
+ *               change		changed channels
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void RuleEdge(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int64      ts,
+   u_int16      state,
+   u_int16      change
+)
+{
+	u_int32 rule, step, high;
+	u_int8 bit, op, ch;
+
+	for (rule=0; rule<RULE_NUMBER; rule++) {
+		bit  = (u_int8)(1 << rule);
+		step = llHdl->ruleStep[rule];
+		op   = llHdl->ruleOp[rule][step];
+		ch   = llHdl->ruleCh[rule][step];
+
+		if (!(llHdl->ruleMask & bit) || !(change & (1 << ch)))
+			continue;
+
+		high = (state >> ch) & 1;
+
+		switch (op) {
+		case M31_ROP_RISE:
+		case M31_ROP_FALL:
+			if (high == (op == M31_ROP_RISE))
+				RuleEnter(llHdl, rule, step + 1, ts, state);
 			break;
-	    }
-		/*-------------------------------+
-        |   address space type           |
-        +-------------------------------*/
-        case LL_INFO_ADDRSPACE:
-		{
-			u_int32 addrSpaceIndex = va_arg(argptr, u_int32);
-			u_int32 *addrModeP = va_arg(argptr, u_int32*);
-			u_int32 *dataModeP = va_arg(argptr, u_int32*);
-			u_int32 *addrSizeP = va_arg(argptr, u_int32*);
 
-			if (addrSpaceIndex >= ADDRSPACE_COUNT)
-				error = ERR_LL_ILL_PARAM;
+		case M31_ROP_HIGH:
+		case M31_ROP_LOW:
+			if (high == (op == M31_ROP_HIGH)) {
+				/* first step: edge to the level starts the hold time */
+				if (step == 0 && llHdl->ruleTs[rule][0]) {
+					llHdl->ruleDeadline[rule] = ts + llHdl->ruleTs[rule][0];
+					llHdl->ruleDl |= bit;
+				}
+				else if (step == 0)
+					RuleEnter(llHdl, rule, 1, ts, state);
+			}
+			else if (step == 0)
+				llHdl->ruleDl &= ~bit;		/* left the level: wait again */
 			else {
-				*addrModeP = MDIS_MA08;
-				*dataModeP = MDIS_MD16;
-				*addrSizeP = 0x100;
+				RuleReport(llHdl, rule, ts, state, TRUE);
+				RuleEnter(llHdl, rule, 0, ts, state);
 			}
-
 			break;
-	    }
-		/*-------------------------------+
-        |   interrupt required           |
-        +-------------------------------*/
-        case LL_INFO_IRQ:
-		{
-			u_int32 *useIrqP = va_arg(argptr, u_int32*);
+		}
+	}
+}
 
-			*useIrqP = TRUE;
+/******************************** RuleCheck *********************************
+ *
+ *  Description: Evaluate expired rule deadlines
+ *
+ *               An expired hold time passes a level step, an expired
+ *               window violates an edge step. Rules are handled in
+ *               deadline order with the deadline as timestamp.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               now		current timestamp
+ *               state		input levels since the last edges
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void RuleCheck(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int64      now,
+   u_int16      state
+)
+{
+	u_int32 rule, due, step;
+	u_int64 ts;
+	u_int8 op;
+
+	while (llHdl->ruleDl) {
+		/* find oldest expired deadline */
+		due = RULE_NUMBER;
+		for (rule=0; rule<RULE_NUMBER; rule++) {
+			if ((llHdl->ruleDl & (1 << rule)) &&
+				(int64)(now - llHdl->ruleDeadline[rule]) >= 0 &&
+				(due == RULE_NUMBER || (int64)(llHdl->ruleDeadline[rule] -
+					llHdl->ruleDeadline[due]) < 0))
+				due = rule;
+		}
+
+		if (due == RULE_NUMBER)
 			break;
-	    }
-        /*-------------------------------+
-        |   process lock mode            |
-        +-------------------------------*/
-        case LL_INFO_LOCKMODE:
-        {
-            u_int32 *lockModeP = va_arg(argptr, u_int32*);
 
-            *lockModeP = LL_LOCK_CALL;
-            break;
-        }
-		/*-------------------------------+
-        |   (unknown)                    |
-        +-------------------------------*/
-        default:
-          error = ERR_LL_ILL_PARAM;
-    }
+		llHdl->ruleDl &= (u_int8)~(1 << due);
+		step = llHdl->ruleStep[due];
+		op   = llHdl->ruleOp[due][step];
+		ts   = llHdl->ruleDeadline[due];
 
-    va_end(argptr);
-    return(error);
+		if (op == M31_ROP_HIGH || op == M31_ROP_LOW)
+			RuleEnter(llHdl, due, step + 1, ts, state);
+		else {
+			RuleReport(llHdl, due, ts, state, TRUE);
+			RuleEnter(llHdl, due, 0, ts, state);
+		}
+	}
 }
 
-/*******************************  Ident  ************************************
+/******************************** RuleReport ********************************
  *
- *  Description:  Return ident string
+ *  Description: Report a completed or violated rule
  *
  *---------------------------------------------------------------------------
- *  Input......:  -
+ *  Input......: llHdl		low-level handle
+ *               rule		rule index
+ *               ts			timestamp
+ *               state		input levels
+ *               violated	rule violated
  *
- *  Output.....:  return  pointer to ident string
+ *  Output.....: -
  *
- *  Globals....:  -
+ *  Globals....: -
  ****************************************************************************/
-static char* Ident( void )	/* nodoc */
+static void RuleReport(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int32      rule,
+   u_int64      ts,
+   u_int16      state,
+   u_int32      violated
+)
 {
-    return( (char*)IdentString );
+	if (violated)
+		llHdl->ruleViol[rule]++;
+	else
+		llHdl->ruleDone[rule]++;
+
+	ProcessChange(llHdl, ts, DbState(llHdl, state), (u_int16)(1 << rule),
+				  M31_EVF_RULE | (violated ? M31_EVF_VIOLATED : 0));
 }
 
-/********************************* Cleanup **********************************
+#ifdef M31_OWN_LOCK
+/******************************** LockEnter *********************************
  *
- *  Description: Close all handles, free memory and return error code
+ *  Description: Take the device lock for an entry point
+ *
+ *               Replaces the LL_LOCK_CALL locking of the MDIS kernel. A
+ *               non-blocking attempt first tells whether the lock was
+ *               taken (contended); the wait time is recorded with the
+ *               lock held.
  *
- *		         NOTE: The low-level handle is invalid after calling this
- *                     function.
- *			   
  *---------------------------------------------------------------------------
  *  Input......: llHdl		low-level handle
- *               retCode    return value
+ *               ep			entry point (M31_LOCK_xxx)
  *
- *  Output.....: return	    retCode
+ *  Output.....: return	    success (0) or error code (lock not taken)
  *
  *  Globals....: -
  ****************************************************************************/
-static int32 Cleanup(	/* nodoc */
+static int32 LockEnter(	/* nodoc */
    LL_HANDLE    *llHdl,
-   int32        retCode
+   u_int32      ep
 )
 {
-    /*------------------------------+
-    |  close handles                |
-    +------------------------------*/
-	/* clean up desc */
-	if (llHdl->descHdl)
-		DESC_Exit(&llHdl->descHdl);
+	u_int64 tsWait = TsGet(llHdl);
+	int32 contended = FALSE, error;
 
-	/* clean up debug */
-	DBGEXIT((&DBH));
+	if (OSS_SemWait(llHdl->osHdl, llHdl->lockSem, OSS_SEM_NOWAIT)) {
+		/* e.g. interrupted by a signal */
+		if ((error = OSS_SemWait(llHdl->osHdl, llHdl->lockSem,
+								 OSS_SEM_WAITINF)))
+			return(error);
+		contended = TRUE;
+	}
 
-    /*------------------------------+
-    |  free memory                  |
-    +------------------------------*/
-    /* free my handle */
-    OSS_MemFree(llHdl->osHdl, (int8*)llHdl, llHdl->memAlloc);
+	llHdl->lockTs = TsGet(llHdl);
 
-    /*------------------------------+
-    |  return error code            |
-    +------------------------------*/
-	return(retCode);
+	llHdl->lockCount[ep]++;
+	if (contended)
+		llHdl->lockCont[ep]++;
+	LockTime(llHdl->lockWaitHist[ep], &llHdl->lockWaitMax[ep],
+			 llHdl->lockTs - tsWait);
+
+	return(ERR_SUCCESS);
+}
+
+/******************************** LockLeave *********************************
+ *
+ *  Description: Record the hold time and release the device lock
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: llHdl		low-level handle
+ *               ep			entry point (M31_LOCK_xxx)
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void LockLeave(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   u_int32      ep
+)
+{
+	LockTime(llHdl->lockHoldHist[ep], &llHdl->lockHoldMax[ep],
+			 TsGet(llHdl) - llHdl->lockTs);
+
+	OSS_SemSignal(llHdl->osHdl, llHdl->lockSem);
+}
+
+/********************************* LockTime *********************************
+ *
+ *  Description: Add a time to a log2 histogram and its maximum
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: hist		histogram (HIST_BUCKETS)
+ *               maxP		maximum
+ *               time		time [ts counts], saturated to 32 bit
+ *
+ *  Output.....: -
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static void LockTime(	/* nodoc */
+   u_int32      *hist,
+   u_int32      *maxP,
+   u_int64      time
+)
+{
+	u_int32 t = (time >> 32) ? 0xffffffff : (u_int32)time;
+
+	hist[Log2Bucket(t)]++;
+	if (t > *maxP)
+		*maxP = t;
+}
+
+/***************************** M31_xxxLocked ********************************
+ *
+ *  Description: Entry points with device locking and lock statistics
+ *
+ *               Call the entry point with the device lock held, like
+ *               the MDIS kernel does for LL_LOCK_CALL drivers.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: see entry points
+ *
+ *  Output.....: return	    see entry points
+ *
+ *  Globals....: -
+ ****************************************************************************/
+static int32 M31_ReadLocked(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   int32        ch,
+   int32        *valueP
+)
+{
+	int32 error;
+
+	if ((error = LockEnter(llHdl, M31_LOCK_READ)))
+		return(error);
+	error = M31_Read(llHdl, ch, valueP);
+	LockLeave(llHdl, M31_LOCK_READ);
+
+	return(error);
+}
+
+static int32 M31_WriteLocked(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   int32        ch,
+   int32        value
+)
+{
+	int32 error;
+
+	if ((error = LockEnter(llHdl, M31_LOCK_WRITE)))
+		return(error);
+	error = M31_Write(llHdl, ch, value);
+	LockLeave(llHdl, M31_LOCK_WRITE);
+
+	return(error);
+}
+
+static int32 M31_SetStatLocked(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   int32        code,
+   int32        ch,
+   INT32_OR_64  value32_or_64
+)
+{
+	int32 error;
+
+	if ((error = LockEnter(llHdl, M31_LOCK_SETSTAT)))
+		return(error);
+	error = M31_SetStat(llHdl, code, ch, value32_or_64);
+	LockLeave(llHdl, M31_LOCK_SETSTAT);
+
+	return(error);
+}
+
+static int32 M31_GetStatLocked(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   int32        code,
+   int32        ch,
+   INT32_OR_64  *value32_or_64P
+)
+{
+	int32 error;
+
+	if ((error = LockEnter(llHdl, M31_LOCK_GETSTAT)))
+		return(error);
+	error = M31_GetStat(llHdl, code, ch, value32_or_64P);
+	LockLeave(llHdl, M31_LOCK_GETSTAT);
+
+	return(error);
+}
+
+static int32 M31_BlockReadLocked(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   int32        ch,
+   void         *buf,
+   int32        size,
+   int32        *nbrRdBytesP
+)
+{
+	int32 error;
+
+	if ((error = LockEnter(llHdl, M31_LOCK_BLOCKREAD)))
+		return(error);
+	error = M31_BlockRead(llHdl, ch, buf, size, nbrRdBytesP);
+	LockLeave(llHdl, M31_LOCK_BLOCKREAD);
+
+	return(error);
 }
 
+static int32 M31_BlockWriteLocked(	/* nodoc */
+   LL_HANDLE    *llHdl,
+   int32        ch,
+   void         *buf,
+   int32        size,
+   int32        *nbrWrBytesP
+)
+{
+	int32 error;
 
+	if ((error = LockEnter(llHdl, M31_LOCK_BLOCKWRITE)))
+		return(error);
+	error = M31_BlockWrite(llHdl, ch, buf, size, nbrWrBytesP);
+	LockLeave(llHdl, M31_LOCK_BLOCKWRITE);
 
+	return(error);
+}
+#endif /* M31_OWN_LOCK */
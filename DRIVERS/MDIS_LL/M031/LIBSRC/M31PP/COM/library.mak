@@ -0,0 +1,47 @@
+#**************************  M a k e f i l e ********************************
+#  
+#         Author: ds
+#  
+#    Description: Makefile definitions for the m31pp C++ client library
+#
+#                 m31pp.cpp is C++ (C++11, C++20 for coroutines). The MDIS
+#                 make rules compile C inputs only, so this library is not
+#                 part of the MDIS package build (no swmodule in the package
+#                 description). Build it with the application, e.g.
+#                   g++ -std=c++20 -I<MDIS>/INCLUDE/COM \
+#                       -I<MDIS>/INCLUDE/NATIVE -c m31pp.cpp
+#                 and link it with mdis_api, usr_oss and -lpthread. This
+#                 file lists the inputs for rule sets with a C++ rule.
+#                      
+#-----------------------------------------------------------------------------
+#   Copyright 2026, MEN Mikro Elektronik GmbH
+#*****************************************************************************
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+MAK_NAME=m31pp
+# the next line is updated during the MDIS installation
+STAMPED_REVISION="13M031-06_02_04-1-g9a830e5-dirty_2019-05-10"
+
+DEF_REVISION=MAK_REVISION=$(STAMPED_REVISION)
+MAK_SWITCH=$(SW_PREFIX)$(DEF_REVISION)
+
+MAK_INCL=$(MEN_INC_DIR)/m31_drv.h \
+	 $(MEN_INC_DIR)/m31pp.h \
+	 $(MEN_INC_DIR)/mdis_api.h \
+	 $(MEN_INC_DIR)/usr_oss.h \
+	 $(MEN_INC_DIR)/men_typs.h
+
+MAK_INP1=m31pp$(INP_SUFFIX)
+
+MAK_INP=$(MAK_INP1)
@@ -0,0 +1,785 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************
+ *
+ *         Name: m31pp.cpp
+ *
+ *       Author: ds
+ *
+ *  Description: C++ client library for the M31 driver (see m31pp.h)
+ *
+ *               Signal path: each device with subscriptions gets its own
+ *               signal (SigCode), the UOS signal handler (SigHandler) posts
+ *               the semaphore of the device owning the signal (sem_post is
+ *               async-signal-safe), and the event thread of the device
+ *               drains the event FIFO.
+ *               Further signals raised while the thread drains are merged
+ *               into one wakeup, so a burst costs one M_getblock per
+ *               M31PP_BATCH events.
+ *
+ *     Required: C++11, POSIX threads and semaphores
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/mdis_err.h>
+#include <MEN/usr_oss.h>
+#include <MEN/m31_drv.h>
+#include <MEN/m31pp.h>
+
+namespace m31pp {
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+/* semaphores of devices with subscriptions (read by the signal handler) */
+static std::atomic<sem_t*> G_sem[M31PP_DEV_MAX];
+static u_int32 G_sigCode[M31PP_DEV_MAX];	/* signal of slot (set before G_sem) */
+static std::mutex G_sigLock;			/* protects G_sigUsers, UOS_Sig* */
+static int G_sigUsers;					/* nr of registered devices */
+static thread_local Device *G_evDev;	/* device of this event thread */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void __MAPILIB SigHandler(u_int32 sigCode);
+static u_int32 SigCode(int slot);
+static int SigRegister(sem_t *sem);
+static void SigUnregister(int slot);
+
+/********************************* Error ************************************
+ *
+ *  Description: MDIS error exception
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: what		failed operation
+ *               code		MDIS error code
+ ****************************************************************************/
+Error::Error(const std::string &what, int32 code)
+	: std::runtime_error("can't " + what + ": " + M_errstring(code)),
+	  code_(code)
+{
+}
+
+/******************************** Device ************************************
+ *
+ *  Description: Open the device
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: name		device name
+ *  Output.....: -			throws Error
+ ****************************************************************************/
+Device::Device(const std::string &name)
+	: mode_(-1), nextId_(1), run_(false), slot_(-1)
+{
+	if ((path_ = M_open(name.c_str())) < 0)
+		throw Error("open " + name, (int32)UOS_ErrnoGet());
+
+	if (sem_init(&sem_, 0, 0) < 0) {
+		int32 error = (int32)errno;
+
+		M_close(path_);
+		throw Error("init semaphore", error);
+	}
+}
+
+/******************************** ~Device ***********************************
+ *
+ *  Description: Stop the event thread and close the device
+ ****************************************************************************/
+Device::~Device()
+{
+	try {
+		stop();
+	}
+	catch (const Error&) {
+		/* device already unusable, close anyway */
+	}
+
+	M_close(path_);
+	sem_destroy(&sem_);
+}
+
+/********************************* check ************************************
+ *
+ *  Description: Throw Error if an MDIS call failed
+ ****************************************************************************/
+void Device::check(int32 ret, const char *what)
+{
+	if (ret < 0)
+		throw Error(what, (int32)UOS_ErrnoGet());
+}
+
+/******************************** getStat ***********************************
+ *
+ *  Description: Get/set status (device or current channel)
+ ****************************************************************************/
+int32 Device::getStat(int32 code)
+{
+	int32 value;
+
+	check(M_getstat(path_, code, &value), "M_getstat");
+	return value;
+}
+
+void Device::setStat(int32 code, INT32_OR_64 value)
+{
+	if (code == M31_BLK_MODE) {
+		std::lock_guard<std::mutex> lock(ioLock_);
+		mode_ = -1;						/* don't trust the cache */
+		check(M_setstat(path_, code, value), "M_setstat");
+		return;
+	}
+
+	check(M_setstat(path_, code, value), "M_setstat");
+}
+
+int32 Device::getStat(int32 ch, int32 code)
+{
+	std::lock_guard<std::mutex> lock(ioLock_);
+	int32 value;
+
+	check(M_setstat(path_, M_MK_CH_CURRENT, ch), "M_setstat M_MK_CH_CURRENT");
+	check(M_getstat(path_, code, &value), "M_getstat");
+	return value;
+}
+
+void Device::setStat(int32 ch, int32 code, INT32_OR_64 value)
+{
+	std::lock_guard<std::mutex> lock(ioLock_);
+
+	check(M_setstat(path_, M_MK_CH_CURRENT, ch), "M_setstat M_MK_CH_CURRENT");
+	check(M_setstat(path_, code, value), "M_setstat");
+}
+
+/******************************** getBlock **********************************
+ *
+ *  Description: Get/set block status
+ *
+ *---------------------------------------------------------------------------
+ *  Output.....: return	    nr of bytes returned (getBlock)
+ ****************************************************************************/
+int32 Device::getBlock(int32 code, void *buf, int32 size)
+{
+	M_SG_BLOCK blk;
+
+	blk.size = size;
+	blk.data = buf;
+	check(M_getstat(path_, code, (int32*)&blk), "M_getstat (block)");
+	return blk.size;
+}
+
+void Device::setBlock(int32 code, const void *buf, int32 size)
+{
+	M_SG_BLOCK blk;
+
+	blk.size = size;
+	blk.data = (void*)buf;
+	check(M_setstat(path_, code, (INT32_OR_64)&blk), "M_setstat (block)");
+}
+
+/******************************** blkMode ***********************************
+ *
+ *  Description: Switch the block read mode if necessary (ioLock_ held)
+ ****************************************************************************/
+void Device::blkMode(int32 mode)
+{
+	if (mode_ != mode) {
+		mode_ = -1;
+		check(M_setstat(path_, M31_BLK_MODE, mode), "M_setstat M31_BLK_MODE");
+		mode_ = mode;
+	}
+}
+
+/******************************* readBlock **********************************
+ *
+ *  Description: M_getblock in the given block read mode
+ *
+ *---------------------------------------------------------------------------
+ *  Output.....: return	    nr of bytes read
+ ****************************************************************************/
+int32 Device::readBlock(int32 mode, void *buf, int32 size)
+{
+	std::lock_guard<std::mutex> lock(ioLock_);
+	int32 n;
+
+	blkMode(mode);
+	check(n = M_getblock(path_, (u_int8*)buf, size), "M_getblock");
+	return n;
+}
+
+/********************************* state ************************************
+ *
+ *  Description: Get the states of all channels / of one channel
+ ****************************************************************************/
+u_int16 Device::state()
+{
+	u_int16 st;
+
+	readBlock(M31_BLKMODE_STATE, &st, sizeof(st));
+	return st;
+}
+
+bool Device::state(int32 ch)
+{
+	std::lock_guard<std::mutex> lock(ioLock_);
+	int32 value;
+
+	check(M_setstat(path_, M_MK_CH_CURRENT, ch), "M_setstat M_MK_CH_CURRENT");
+	check(M_read(path_, &value), "M_read");
+	return value != 0;
+}
+
+/************************** block status getters ****************************
+ *
+ *  Description: Typed wrappers of the M31_BLK_xxx codes
+ ****************************************************************************/
+M31_ISR_STAT Device::isrStat()
+{
+	M31_ISR_STAT st;
+
+	getBlock(M31_BLK_ISR_STAT, &st, sizeof(st));
+	return st;
+}
+
+std::vector<M31_TRACE_REC> Device::trace(u_int32 max)
+{
+	std::vector<M31_TRACE_REC> v(max);
+
+	v.resize(getBlock(M31_BLK_TRACE, v.data(),
+					  (int32)(max * sizeof(M31_TRACE_REC))) /
+			 sizeof(M31_TRACE_REC));
+	return v;
+}
+
+M31_LOST_STAT Device::lostStat()
+{
+	M31_LOST_STAT st;
+
+	getBlock(M31_BLK_LOST_EDGES, &st, sizeof(st));
+	return st;
+}
+
+M31_COUNTERS Device::counters()
+{
+	M31_COUNTERS st;
+
+	getBlock(M31_BLK_COUNTERS, &st, sizeof(st));
+	return st;
+}
+
+std::vector<M31_LAST_CHANGE> Device::lastChange()
+{
+	std::vector<M31_LAST_CHANGE> v(16);
+
+	getBlock(M31_BLK_LAST_CHANGE, v.data(),
+			 (int32)(v.size() * sizeof(M31_LAST_CHANGE)));
+	return v;
+}
+
+M31_CAP_INFO Device::capInfo()
+{
+	M31_CAP_INFO info;
+
+	getBlock(M31_BLK_CAP_INFO, &info, sizeof(info));
+	return info;
+}
+
+std::vector<u_int16> Device::aggrChange()
+{
+	std::vector<u_int16> v(M31_AGGR_MAX);
+
+	v.resize(getBlock(M31_BLK_AGGR_CHANGE, v.data(),
+					  (int32)(v.size() * sizeof(u_int16))) /
+			 sizeof(u_int16));
+	return v;
+}
+
+std::vector<u_int32> Device::glitches()
+{
+	std::vector<u_int32> v(16);
+
+	getBlock(M31_BLK_GLITCHES, v.data(), (int32)(v.size() * sizeof(u_int32)));
+	return v;
+}
+
+std::vector<M31_QUAD> Device::quad()
+{
+	std::vector<M31_QUAD> v(8);
+
+	getBlock(M31_BLK_QUAD, v.data(), (int32)(v.size() * sizeof(M31_QUAD)));
+	return v;
+}
+
+std::vector<M31_FIELD_DEF> Device::fields()
+{
+	std::vector<M31_FIELD_DEF> v(M31_FIELD_MAX);
+
+	getBlock(M31_BLK_FIELD_DEF, v.data(),
+			 (int32)(v.size() * sizeof(M31_FIELD_DEF)));
+	return v;
+}
+
+std::vector<M31_FIELD_STAT> Device::fieldStat()
+{
+	std::vector<M31_FIELD_STAT> v(M31_FIELD_MAX);
+
+	getBlock(M31_BLK_FIELD_STAT, v.data(),
+			 (int32)(v.size() * sizeof(M31_FIELD_STAT)));
+	return v;
+}
+
+void Device::field(const M31_FIELD_DEF &def)
+{
+	setBlock(M31_BLK_FIELD_DEF, &def, sizeof(def));
+}
+
+void Device::rules(const std::vector<M31_RULE> &rules)
+{
+	setBlock(M31_BLK_RULES, rules.data(),
+			 (int32)(rules.size() * sizeof(M31_RULE)));
+}
+
+std::vector<M31_RULE> Device::rules()
+{
+	std::vector<M31_RULE> v(M31_RULE_MAX);
+
+	getBlock(M31_BLK_RULES, v.data(), (int32)(v.size() * sizeof(M31_RULE)));
+	return v;
+}
+
+std::vector<M31_RULE_STAT> Device::ruleStat()
+{
+	std::vector<M31_RULE_STAT> v(M31_RULE_MAX);
+
+	getBlock(M31_BLK_RULE_STAT, v.data(),
+			 (int32)(v.size() * sizeof(M31_RULE_STAT)));
+	return v;
+}
+
+/****************************** block reads *********************************
+ *
+ *  Description: Read capture samples/runs and strobed words
+ ****************************************************************************/
+std::vector<u_int16> Device::capture(u_int32 max)
+{
+	std::vector<u_int16> v(max);
+
+	v.resize(readBlock(M31_BLKMODE_CAPTURE, v.data(),
+					   (int32)(max * sizeof(u_int16))) / sizeof(u_int16));
+	return v;
+}
+
+std::vector<M31_RLE_REC> Device::captureRle(u_int32 max)
+{
+	std::vector<M31_RLE_REC> v(max);
+
+	v.resize(readBlock(M31_BLKMODE_CAPTURE, v.data(),
+					   (int32)(max * sizeof(M31_RLE_REC))) /
+			 sizeof(M31_RLE_REC));
+	return v;
+}
+
+std::vector<M31_STROBE_REC> Device::strobe(u_int32 max)
+{
+	std::vector<M31_STROBE_REC> v(max);
+
+	v.resize(readBlock(M31_BLKMODE_STROBE, v.data(),
+					   (int32)(max * sizeof(M31_STROBE_REC))) /
+			 sizeof(M31_STROBE_REC));
+	return v;
+}
+
+/******************************* onEvents ***********************************
+ *
+ *  Description: Register/remove an event callback
+ *
+ *               Callbacks are called in the event thread with each batch
+ *               of events. The first registration starts the thread.
+ *
+ *---------------------------------------------------------------------------
+ *  Output.....: return	    callback id (onEvents)
+ ****************************************************************************/
+int Device::onEvents(const EventCallback &cb)
+{
+	int id;
+
+	{
+		std::lock_guard<std::mutex> lock(evLock_);
+		id = nextId_++;
+		callbacks_.push_back(std::make_pair(id, cb));
+	}
+
+	start();
+	return id;
+}
+
+void Device::removeCallback(int id)
+{
+	std::lock_guard<std::mutex> lock(evLock_);
+	size_t n;
+
+	for (n = 0; n < callbacks_.size(); n++) {
+		if (callbacks_[n].first == id) {
+			callbacks_.erase(callbacks_.begin() + n);
+			break;
+		}
+	}
+}
+
+/********************************* start ************************************
+ *
+ *  Description: Start event delivery
+ *
+ *               Installs the signal, switches to event mode, enables the
+ *               interrupt and starts the event thread. No-op if running.
+ *               Serialized with stop(); a coroutine resumed in the event
+ *               thread while stop() waits for it returns at once.
+ ****************************************************************************/
+void Device::start()
+{
+	if (run_ || G_evDev == this)
+		return;
+
+	std::lock_guard<std::mutex> lock(runLock_);
+
+	if (run_)
+		return;
+
+	if ((slot_ = SigRegister(&sem_)) < 0)
+		throw Error("install signal", slot_ == -1 ?
+					ERR_LL_ILL_PARAM : (int32)UOS_ErrnoGet());
+
+	try {
+		check(M_setstat(path_, M31_SIGSET, SigCode(slot_)),
+			  "M_setstat M31_SIGSET");
+		{
+			std::lock_guard<std::mutex> lock(ioLock_);
+			blkMode(M31_BLKMODE_EVENT);
+		}
+		check(M_setstat(path_, M_MK_IRQ_ENABLE, 1),
+			  "M_setstat M_MK_IRQ_ENABLE");
+	}
+	catch (const Error&) {
+		M_setstat(path_, M31_SIGCLR, 0);
+		SigUnregister(slot_);
+		slot_ = -1;
+		throw;
+	}
+
+	run_ = true;
+	sem_post(&sem_);					/* drain events recorded before */
+	thread_ = std::thread(&Device::eventThread, this);
+}
+
+/********************************** stop ************************************
+ *
+ *  Description: Stop event delivery (the interrupt stays enabled)
+ *
+ *               Must not be called from a callback. Suspended coroutines
+ *               are not resumed anymore.
+ ****************************************************************************/
+void Device::stop()
+{
+	std::lock_guard<std::mutex> lock(runLock_);
+
+	if (!run_)
+		return;
+
+	run_ = false;
+	sem_post(&sem_);
+	thread_.join();
+
+	SigUnregister(slot_);
+	slot_ = -1;
+	check(M_setstat(path_, M31_SIGCLR, 0), "M_setstat M31_SIGCLR");
+}
+
+/******************************** onError ***********************************
+ *
+ *  Description: Set the handler of errors in the event thread
+ *
+ *               Exceptions thrown by callbacks or resumed coroutines and
+ *               failed event reads are passed to the handler. Without a
+ *               handler they are printed to stderr. The event thread
+ *               continues in any case.
+ ****************************************************************************/
+void Device::onError(const ErrorCallback &cb)
+{
+	std::lock_guard<std::mutex> lock(evLock_);
+
+	errorCb_ = cb;
+}
+
+/********************************* report ***********************************
+ *
+ *  Description: Report an exception caught in the event thread
+ ****************************************************************************/
+void Device::report(std::exception_ptr e)
+{
+	ErrorCallback cb;
+
+	{
+		std::lock_guard<std::mutex> lock(evLock_);
+		cb = errorCb_;
+	}
+
+	try {
+		if (cb) {
+			cb(e);
+			return;
+		}
+		std::rethrow_exception(e);
+	}
+	catch (const std::exception &ex) {
+		fprintf(stderr, "*** m31pp: event thread: %s\n", ex.what());
+	}
+	catch (...) {
+		fprintf(stderr, "*** m31pp: event thread: unknown exception\n");
+	}
+}
+
+/****************************** eventThread *********************************
+ *
+ *  Description: Wait for signals, drain the event FIFO, dispatch batches
+ ****************************************************************************/
+void Device::eventThread()
+{
+	M31_EVENT buf[M31PP_BATCH];
+	EventBatch batch;
+	int32 n;
+
+	G_evDev = this;
+
+	while (run_) {
+		while (sem_wait(&sem_) < 0 && errno == EINTR)
+			;
+		/* merge signals raised meanwhile into this wakeup */
+		while (sem_trywait(&sem_) == 0)
+			;
+
+		if (!run_)
+			break;
+
+		try {
+			do {
+				n = readBlock(M31_BLKMODE_EVENT, buf, sizeof(buf)) /
+					sizeof(M31_EVENT);
+				batch.insert(batch.end(), buf, buf + n);
+			} while (n == M31PP_BATCH);
+		}
+		catch (const Error&) {
+			/* keep events read so far, retry on next signal */
+			report(std::current_exception());
+		}
+
+		if (!batch.empty())
+			dispatch(batch);
+	}
+}
+
+/******************************** dispatch **********************************
+ *
+ *  Description: Pass a batch to callbacks and waiting coroutines
+ *
+ *               Without any consumer the batch is queued for the next
+ *               co_await. Consumers run without evLock_ held, so they may
+ *               (un)register callbacks.
+ ****************************************************************************/
+void Device::dispatch(EventBatch &batch)
+{
+	std::vector<std::pair<int, EventCallback> > cbs;
+#ifdef M31PP_COROUTINES
+	std::vector<EventAwaiter*> waiters;
+#endif
+	size_t n;
+
+	{
+		std::lock_guard<std::mutex> lock(evLock_);
+		cbs = callbacks_;
+#ifdef M31PP_COROUTINES
+		waiters.swap(waiters_);
+		if (cbs.empty() && waiters.empty()) {
+#else
+		if (cbs.empty()) {
+#endif
+			queue_.insert(queue_.end(), batch.begin(), batch.end());
+			if (queue_.size() > M31PP_QUEUE_MAX)
+				queue_.erase(queue_.begin(),
+							 queue_.end() - M31PP_QUEUE_MAX);
+			batch.clear();
+			return;
+		}
+	}
+
+	/* a throwing consumer doesn't stop the others (nor the thread) */
+	for (n = 0; n < cbs.size(); n++) {
+		try {
+			cbs[n].second(batch);
+		}
+		catch (...) {
+			report(std::current_exception());
+		}
+	}
+
+#ifdef M31PP_COROUTINES
+	for (n = 0; n < waiters.size(); n++) {
+		waiters[n]->batch_ = batch;
+		try {
+			waiters[n]->handle_.resume();
+		}
+		catch (...) {
+			report(std::current_exception());
+		}
+	}
+#endif
+	batch.clear();
+}
+
+#ifdef M31PP_COROUTINES
+/****************************** EventAwaiter ********************************
+ *
+ *  Description: co_await support
+ *
+ *               Queued events complete the await immediately, otherwise
+ *               the coroutine is resumed in the event thread.
+ ****************************************************************************/
+bool EventAwaiter::await_ready()
+{
+	dev_.start();
+	return false;
+}
+
+bool EventAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+	std::lock_guard<std::mutex> lock(dev_.evLock_);
+
+	if (!dev_.queue_.empty()) {
+		batch_.swap(dev_.queue_);
+		return false;						/* don't suspend */
+	}
+
+	handle_ = h;
+	dev_.waiters_.push_back(this);
+	return true;
+}
+#endif
+
+/******************************** SigHandler ********************************
+ *
+ *  Description: UOS signal handler: wake the event thread of the device
+ *               owning the signal
+ *
+ *               Only async-signal-safe calls (sem_post) are used.
+ ****************************************************************************/
+static void __MAPILIB SigHandler(u_int32 sigCode)
+{
+	sem_t *sem;
+	int n;
+
+	for (n = 0; n < M31PP_DEV_MAX; n++) {
+		if ((sem = G_sem[n].load()) != NULL && G_sigCode[n] == sigCode) {
+			sem_post(sem);
+			break;
+		}
+	}
+}
+
+/********************************* SigCode **********************************
+ *
+ *  Description: Signal of a slot
+ *
+ *               Slot 0 and 1 use UOS_SIG_USR1/2, further slots real-time
+ *               signals (SIGRTMIN+n) where available.
+ *
+ *---------------------------------------------------------------------------
+ *  Output.....: return	    signal code, 0 if the slot has no signal
+ ****************************************************************************/
+static u_int32 SigCode(int slot)
+{
+	if (slot == 0)
+		return UOS_SIG_USR1;
+	if (slot == 1)
+		return UOS_SIG_USR2;
+#ifdef SIGRTMIN
+	if (SIGRTMIN + slot - 2 <= SIGRTMAX)
+		return (u_int32)(SIGRTMIN + slot - 2);
+#endif
+	return 0;
+}
+
+/******************************* SigRegister ********************************
+ *
+ *  Description: Register a semaphore for the signal handler
+ *
+ *               The first registration installs the UOS signal handler,
+ *               each registration the signal of its slot.
+ *
+ *---------------------------------------------------------------------------
+ *  Output.....: return	    slot, -1 (no free slot) or -2 (UOS error)
+ ****************************************************************************/
+static int SigRegister(sem_t *sem)
+{
+	std::lock_guard<std::mutex> lock(G_sigLock);
+	int n;
+
+	for (n = 0; n < M31PP_DEV_MAX; n++)
+		if (G_sem[n].load() == NULL)
+			break;
+
+	if (n == M31PP_DEV_MAX || SigCode(n) == 0)
+		return -1;
+
+	if (G_sigUsers == 0 && UOS_SigInit(SigHandler))
+		return -2;
+
+	if (UOS_SigInstall(SigCode(n))) {
+		if (G_sigUsers == 0)
+			UOS_SigExit();
+		return -2;
+	}
+
+	G_sigUsers++;
+	G_sigCode[n] = SigCode(n);
+	G_sem[n].store(sem);
+	return n;
+}
+
+/****************************** SigUnregister *******************************
+ *
+ *  Description: Remove a semaphore, remove the signal handler if unused
+ ****************************************************************************/
+static void SigUnregister(int slot)
+{
+	std::lock_guard<std::mutex> lock(G_sigLock);
+
+	if (slot < 0)
+		return;
+
+	G_sem[slot].store(NULL);
+	UOS_SigRemove(G_sigCode[slot]);
+
+	if (--G_sigUsers == 0)
+		UOS_SigExit();
+}
+
+} /* namespace m31pp */
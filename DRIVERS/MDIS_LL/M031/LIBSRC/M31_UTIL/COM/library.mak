@@ -0,0 +1,48 @@
+#**************************  M a k e f i l e ********************************
+#  
+#         Author: ds
+#  
+#    Description: Makefile definitions for the m31_util user library
+#                      
+#-----------------------------------------------------------------------------
+#   Copyright 2026, MEN Mikro Elektronik GmbH
+#*****************************************************************************
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+MAK_NAME=m31_util
+# the next line is updated during the MDIS installation
+STAMPED_REVISION="13M031-06_02_04-1-g9a830e5-dirty_2019-05-10"
+
+DEF_REVISION=MAK_REVISION=$(STAMPED_REVISION)
+MAK_SWITCH=$(SW_PREFIX)$(DEF_REVISION)
+
+MAK_INCL=$(MEN_INC_DIR)/m31_drv.h \
+	 $(MEN_INC_DIR)/m31_rle.h \
+	 $(MEN_INC_DIR)/m31_log.h \
+	 $(MEN_INC_DIR)/m31_shm.h \
+	 $(MEN_INC_DIR)/m31_bits.h \
+	 $(MEN_INC_DIR)/m31_merge.h \
+	 $(MEN_INC_DIR)/men_typs.h
+
+MAK_INP1=m31_rle$(INP_SUFFIX)
+MAK_INP2=m31_log$(INP_SUFFIX)
+MAK_INP3=m31_shm$(INP_SUFFIX)
+MAK_INP4=m31_bits$(INP_SUFFIX)
+MAK_INP5=m31_merge$(INP_SUFFIX)
+
+MAK_INP=$(MAK_INP1) \
+        $(MAK_INP2) \
+        $(MAK_INP3) \
+        $(MAK_INP4) \
+        $(MAK_INP5)
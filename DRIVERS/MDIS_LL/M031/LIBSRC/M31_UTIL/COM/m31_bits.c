@@ -0,0 +1,584 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************
+ *
+ *         Name: m31_bits.c
+ *
+ *       Author: ds
+ *
+ *  Description: Decoder of M31 state word arrays (scalar, SSE2, AVX2)
+ *
+ *               Each function exists as a scalar loop and, on x86 with
+ *               GCC/clang, as SSE2 (8 words per step) and AVX2 (16 words
+ *               per step) version. The vector versions get the delta of
+ *               a block from two overlapping loads (in[i], in[i-1]) and
+ *               turn bit <ch> of all words into a bit mask with one shift
+ *               and movemask: shifting by 7-ch moves bit ch into bit 7
+ *               and bit ch+8 into bit 15 of each word, so the even mask
+ *               bits belong to channel ch and the odd ones to ch+8.
+ *               Edge lists are then read by bit scanning, tallies by
+ *               popcount. Blocks without any change are skipped.
+ *
+ *               Sample 0 and the remainder of a buffer are done by the
+ *               scalar loops. The implementation is selected once by CPU
+ *               feature (M31_BitsSelect() may override it).
+ *
+ *     Required: -
+ *     Switches: M31_BITS_NO_SIMD	scalar implementation only
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <MEN/men_typs.h>
+#include <MEN/m31_bits.h>
+
+#if !defined(M31_BITS_NO_SIMD) && defined(__GNUC__) && \
+	(defined(__x86_64__) || defined(__i386__))
+# define BITS_X86
+# include <immintrin.h>
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define CH_NBR		16
+
+#ifdef BITS_X86
+# define SSE2		__attribute__((target("sse2")))
+# define AVX2		__attribute__((target("avx2,popcnt")))
+#endif
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/* implementation; the kernels process samples i..n-1, prev = in[i-1] */
+typedef struct {
+	int32		id;						/* M31_BITS_xxx */
+	const char	*name;
+	void		(*delta)(const u_int16 *in, u_int32 i, u_int32 n,
+					   u_int16 prev, u_int16 *out);
+	u_int32		(*edges)(const u_int16 *in, u_int32 i, u_int32 n,
+						 u_int16 prev, u_int32 ch, u_int32 *idx,
+						 u_int32 max);
+	void		(*planes)(const u_int16 *in, u_int32 i, u_int32 n,
+						  u_int16 chMask, u_int8 **plane);
+	u_int32		(*tally)(const u_int16 *in, u_int32 i, u_int32 n,
+						 u_int16 prev, u_int32 *rise, u_int32 *fall);
+} BITS_IMPL;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static const BITS_IMPL *Impl(void);
+
+/*==========================================================================*
+ *  scalar                                                                  *
+ *==========================================================================*/
+static void XorScalar(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 prev, u_int16 *out)
+{
+	for (; i<n; i++) {
+		out[i] = in[i] ^ prev;
+		prev = in[i];
+	}
+}
+
+static u_int32 EdgesScalar(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 prev, u_int32 ch,
+	u_int32 *idx, u_int32 max)
+{
+	u_int32 cnt = 0;
+
+	for (; i<n && cnt<max; i++) {
+		if ((in[i] ^ prev) & (1 << ch))
+			idx[cnt++] = i;
+		prev = in[i];
+	}
+	return(cnt);
+}
+
+static void PlanesScalar(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 chMask, u_int8 **plane)
+{
+	u_int32 ch, k;
+
+	for (ch=0; ch<CH_NBR; ch++)
+		if (chMask & (1 << ch))
+			for (k=i; k<n; k++)
+				plane[ch][k] = (u_int8)((in[k] >> ch) & 1);
+}
+
+static u_int32 TallyScalar(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 prev, u_int32 *rise,
+	u_int32 *fall)
+{
+	u_int32 d, r, f, ch, cnt = 0;
+
+	for (; i<n; i++) {
+		if ((d = in[i] ^ prev) != 0) {
+			r = d & in[i];
+			f = d & prev;
+			for (ch=0; r | f; ch++, r >>= 1, f >>= 1) {
+				rise[ch] += r & 1;
+				fall[ch] += f & 1;
+				cnt += (r & 1) + (f & 1);
+			}
+		}
+		prev = in[i];
+	}
+	return(cnt);
+}
+
+static const BITS_IMPL G_scalar = {
+	M31_BITS_SCALAR, "scalar",
+	XorScalar, EdgesScalar, PlanesScalar, TallyScalar
+};
+
+#ifdef BITS_X86
+/* sum of all edge counters */
+static u_int32 Sum(const u_int32 *rise, const u_int32 *fall)	/* nodoc */
+{
+	u_int32 ch, sum = 0;
+
+	for (ch=0; ch<CH_NBR; ch++)
+		sum += rise[ch] + fall[ch];
+	return(sum);
+}
+
+/* popcount without POPCNT instruction (SSE2 CPUs may lack it) */
+static u_int32 Pop16(u_int32 x)	/* nodoc */
+{
+	x = x - ((x >> 1) & 0x5555);
+	x = (x & 0x3333) + ((x >> 2) & 0x3333);
+	x = (x + (x >> 4)) & 0x0f0f;
+	return((x + (x >> 8)) & 0x1f);
+}
+#endif
+
+#ifdef BITS_X86
+/*==========================================================================*
+ *  SSE2: 8 words per step                                                  *
+ *==========================================================================*/
+static SSE2 void XorSse2(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 prev, u_int16 *out)
+{
+	__m128i cur, prv;
+
+	if (i == 0 && n)
+		XorScalar(in, i++, 1, prev, out);
+
+	for (; i + 8 <= n; i += 8) {
+		cur = _mm_loadu_si128((const __m128i*)(in + i));
+		prv = _mm_loadu_si128((const __m128i*)(in + i - 1));
+		_mm_storeu_si128((__m128i*)(out + i), _mm_xor_si128(cur, prv));
+	}
+
+	if (i < n)
+		XorScalar(in, i, n, in[i-1], out);
+}
+
+static SSE2 u_int32 EdgesSse2(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 prev, u_int32 ch,
+	u_int32 *idx, u_int32 max)
+{
+	__m128i d;
+	u_int32 m, cnt = 0;
+
+	if (i == 0 && n && max)
+		cnt = EdgesScalar(in, i++, 1, prev, ch, idx, max);
+
+	for (; i + 8 <= n; i += 8) {
+		d = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(in + i)),
+						  _mm_loadu_si128((const __m128i*)(in + i - 1)));
+		d = _mm_sll_epi16(d, _mm_cvtsi32_si128(15 - ch));
+		m = (u_int32)_mm_movemask_epi8(d) & 0xaaaa;
+
+		for (; m; m &= m - 1) {
+			if (cnt == max)
+				return(cnt);
+			idx[cnt++] = i + (__builtin_ctz(m) >> 1);
+		}
+	}
+
+	if (i < n && cnt < max)
+		cnt += EdgesScalar(in, i, n, in[i-1], ch, idx + cnt, max - cnt);
+	return(cnt);
+}
+
+static SSE2 void PlanesSse2(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 chMask, u_int8 **plane)
+{
+	__m128i a, b, bit, one = _mm_set1_epi8(1);
+	u_int32 ch;
+
+	for (; i + 16 <= n; i += 16) {
+		a = _mm_loadu_si128((const __m128i*)(in + i));
+		b = _mm_loadu_si128((const __m128i*)(in + i + 8));
+
+		for (ch=0; ch<CH_NBR; ch++) {
+			if (!(chMask & (1 << ch)))
+				continue;
+			bit = _mm_set1_epi16((short)(1 << ch));
+			_mm_storeu_si128((__m128i*)(plane[ch] + i),
+				_mm_and_si128(one, _mm_packs_epi16(
+					_mm_cmpeq_epi16(_mm_and_si128(a, bit), bit),
+					_mm_cmpeq_epi16(_mm_and_si128(b, bit), bit))));
+		}
+	}
+
+	if (i < n)
+		PlanesScalar(in, i, n, chMask, plane);
+}
+
+static SSE2 u_int32 TallySse2(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 prev, u_int32 *rise,
+	u_int32 *fall)
+{
+	__m128i cur, d, r, f, zero = _mm_setzero_si128();
+	u_int32 mr, mf, ch, cnt = Sum(rise, fall);
+
+	if (i == 0 && n)
+		TallyScalar(in, i++, 1, prev, rise, fall);
+
+	for (; i + 8 <= n; i += 8) {
+		cur = _mm_loadu_si128((const __m128i*)(in + i));
+		d   = _mm_xor_si128(cur,
+							_mm_loadu_si128((const __m128i*)(in + i - 1)));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(d, zero)) == 0xffff)
+			continue;
+
+		r = _mm_and_si128(d, cur);
+		f = _mm_andnot_si128(cur, d);
+
+		for (ch=0; ch<8; ch++) {
+			mr = (u_int32)_mm_movemask_epi8(
+				_mm_sll_epi16(r, _mm_cvtsi32_si128(7 - ch)));
+			mf = (u_int32)_mm_movemask_epi8(
+				_mm_sll_epi16(f, _mm_cvtsi32_si128(7 - ch)));
+			rise[ch]     += Pop16(mr & 0x5555);
+			rise[ch + 8] += Pop16(mr & 0xaaaa);
+			fall[ch]     += Pop16(mf & 0x5555);
+			fall[ch + 8] += Pop16(mf & 0xaaaa);
+		}
+	}
+
+	if (i < n)
+		TallyScalar(in, i, n, in[i-1], rise, fall);
+
+	return(Sum(rise, fall) - cnt);
+}
+
+static const BITS_IMPL G_sse2 = {
+	M31_BITS_SSE2, "sse2",
+	XorSse2, EdgesSse2, PlanesSse2, TallySse2
+};
+
+/*==========================================================================*
+ *  AVX2: 16 words per step                                                 *
+ *==========================================================================*/
+static AVX2 void XorAvx2(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 prev, u_int16 *out)
+{
+	__m256i cur, prv;
+
+	if (i == 0 && n)
+		XorScalar(in, i++, 1, prev, out);
+
+	for (; i + 16 <= n; i += 16) {
+		cur = _mm256_loadu_si256((const __m256i*)(in + i));
+		prv = _mm256_loadu_si256((const __m256i*)(in + i - 1));
+		_mm256_storeu_si256((__m256i*)(out + i),
+							_mm256_xor_si256(cur, prv));
+	}
+
+	if (i < n)
+		XorScalar(in, i, n, in[i-1], out);
+}
+
+static AVX2 u_int32 EdgesAvx2(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 prev, u_int32 ch,
+	u_int32 *idx, u_int32 max)
+{
+	__m256i d;
+	u_int32 m, cnt = 0;
+
+	if (i == 0 && n && max)
+		cnt = EdgesScalar(in, i++, 1, prev, ch, idx, max);
+
+	for (; i + 16 <= n; i += 16) {
+		d = _mm256_xor_si256(
+			_mm256_loadu_si256((const __m256i*)(in + i)),
+			_mm256_loadu_si256((const __m256i*)(in + i - 1)));
+		d = _mm256_sll_epi16(d, _mm_cvtsi32_si128(15 - ch));
+		m = (u_int32)_mm256_movemask_epi8(d) & 0xaaaaaaaa;
+
+		for (; m; m &= m - 1) {
+			if (cnt == max)
+				return(cnt);
+			idx[cnt++] = i + (__builtin_ctz(m) >> 1);
+		}
+	}
+
+	if (i < n && cnt < max)
+		cnt += EdgesScalar(in, i, n, in[i-1], ch, idx + cnt, max - cnt);
+	return(cnt);
+}
+
+static AVX2 void PlanesAvx2(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 chMask, u_int8 **plane)
+{
+	__m256i a, b, bit, p, one = _mm256_set1_epi8(1);
+	u_int32 ch;
+
+	for (; i + 32 <= n; i += 32) {
+		a = _mm256_loadu_si256((const __m256i*)(in + i));
+		b = _mm256_loadu_si256((const __m256i*)(in + i + 16));
+
+		for (ch=0; ch<CH_NBR; ch++) {
+			if (!(chMask & (1 << ch)))
+				continue;
+			bit = _mm256_set1_epi16((short)(1 << ch));
+			/* packs works per 128 bit lane: a0 b0 a1 b1 -> a0 a1 b0 b1 */
+			p = _mm256_packs_epi16(
+				_mm256_cmpeq_epi16(_mm256_and_si256(a, bit), bit),
+				_mm256_cmpeq_epi16(_mm256_and_si256(b, bit), bit));
+			p = _mm256_permute4x64_epi64(p, 0xd8);
+			_mm256_storeu_si256((__m256i*)(plane[ch] + i),
+								_mm256_and_si256(one, p));
+		}
+	}
+
+	if (i < n)
+		PlanesScalar(in, i, n, chMask, plane);
+}
+
+static AVX2 u_int32 TallyAvx2(	/* nodoc */
+	const u_int16 *in, u_int32 i, u_int32 n, u_int16 prev, u_int32 *rise,
+	u_int32 *fall)
+{
+	__m256i cur, d, r, f;
+	__m128i sh;
+	u_int32 mr, mf, ch, cnt = Sum(rise, fall);
+
+	if (i == 0 && n)
+		TallyScalar(in, i++, 1, prev, rise, fall);
+
+	for (; i + 16 <= n; i += 16) {
+		cur = _mm256_loadu_si256((const __m256i*)(in + i));
+		d   = _mm256_xor_si256(cur,
+				_mm256_loadu_si256((const __m256i*)(in + i - 1)));
+		if (_mm256_testz_si256(d, d))
+			continue;
+
+		r = _mm256_and_si256(d, cur);
+		f = _mm256_andnot_si256(cur, d);
+
+		for (ch=0; ch<8; ch++) {
+			sh = _mm_cvtsi32_si128(7 - ch);
+			mr = (u_int32)_mm256_movemask_epi8(_mm256_sll_epi16(r, sh));
+			mf = (u_int32)_mm256_movemask_epi8(_mm256_sll_epi16(f, sh));
+			rise[ch]     += _mm_popcnt_u32(mr & 0x55555555);
+			rise[ch + 8] += _mm_popcnt_u32(mr & 0xaaaaaaaa);
+			fall[ch]     += _mm_popcnt_u32(mf & 0x55555555);
+			fall[ch + 8] += _mm_popcnt_u32(mf & 0xaaaaaaaa);
+		}
+	}
+
+	if (i < n)
+		TallyScalar(in, i, n, in[i-1], rise, fall);
+
+	return(Sum(rise, fall) - cnt);
+}
+
+static const BITS_IMPL G_avx2 = {
+	M31_BITS_AVX2, "avx2",
+	XorAvx2, EdgesAvx2, PlanesAvx2, TallyAvx2
+};
+#endif /* BITS_X86 */
+
+static const BITS_IMPL *G_impl;		/* selected implementation */
+
+/******************************** M31_BitsXor *******************************
+ *
+ *  Description: XOR delta of state words
+ *
+ *               out[i] = in[i] ^ in[i-1], out[0] = in[0] ^ prev
+ *               (set bits are the channels that changed). <out> may not
+ *               overlap <in>.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: in			state words
+ *               n			nr of words
+ *               prev		word before in[0]
+ *  Output.....: out		delta words (n)
+ *  Globals....: -
+ ****************************************************************************/
+void M31_BitsXor(
+	const u_int16 *in,
+	u_int32 n,
+	u_int16 prev,
+	u_int16 *out)
+{
+	Impl()->delta(in, 0, n, prev, out);
+}
+
+/******************************* M31_BitsEdges ******************************
+ *
+ *  Description: Get the edge positions of one channel
+ *
+ *               Stores the indices of the words where bit <ch> differs
+ *               from the previous word. If there are more than <max>
+ *               edges, continue at idx[max-1]+1 with prev = in[idx[max-1]].
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: in			state words
+ *               n			nr of words
+ *               prev		word before in[0]
+ *               ch			channel 0..15
+ *               max		size of idx[]
+ *  Output.....: idx		edge indices, ascending
+ *               return		nr of edges stored
+ *  Globals....: -
+ ****************************************************************************/
+u_int32 M31_BitsEdges(
+	const u_int16 *in,
+	u_int32 n,
+	u_int16 prev,
+	u_int32 ch,
+	u_int32 *idx,
+	u_int32 max)
+{
+	if (ch >= CH_NBR)
+		return(0);
+
+	return(Impl()->edges(in, 0, n, prev, ch, idx, max));
+}
+
+/****************************** M31_BitsPlanes ******************************
+ *
+ *  Description: Split state words into byte planes
+ *
+ *               plane[ch][i] = bit ch of in[i] (0 or 1) for each channel
+ *               in <chMask>; the other planes are not accessed (may be
+ *               NULL).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: in			state words
+ *               n			nr of words
+ *               chMask		channels
+ *  Output.....: plane		byte planes (n bytes each)
+ *  Globals....: -
+ ****************************************************************************/
+void M31_BitsPlanes(
+	const u_int16 *in,
+	u_int32 n,
+	u_int16 chMask,
+	u_int8 *plane[16])
+{
+	Impl()->planes(in, 0, n, chMask, plane);
+}
+
+/******************************* M31_BitsTally ******************************
+ *
+ *  Description: Count rising and falling edges per channel
+ *
+ *               The counts are added to rise[] and fall[], so the caller
+ *               clears them once and accumulates over several buffers.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: in			state words
+ *               n			nr of words
+ *               prev		word before in[0]
+ *               rise		rising edge counters (16)
+ *               fall		falling edge counters (16)
+ *  Output.....: rise, fall	updated counters
+ *               return		nr of edges in this buffer
+ *  Globals....: -
+ ****************************************************************************/
+u_int32 M31_BitsTally(
+	const u_int16 *in,
+	u_int32 n,
+	u_int16 prev,
+	u_int32 rise[16],
+	u_int32 fall[16])
+{
+	return(Impl()->tally(in, 0, n, prev, rise, fall));
+}
+
+/****************************** M31_BitsSelect ******************************
+ *
+ *  Description: Select the implementation
+ *
+ *               An implementation not supported by the CPU (or not built)
+ *               falls back to the next lower one.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: impl		M31_BITS_xxx
+ *  Output.....: return		selected M31_BITS_xxx
+ *  Globals....: G_impl
+ ****************************************************************************/
+int32 M31_BitsSelect(int32 impl)
+{
+	const BITS_IMPL *sel = &G_scalar;
+
+#ifdef BITS_X86
+	__builtin_cpu_init();
+
+	if (impl == M31_BITS_AUTO)
+		impl = M31_BITS_AVX2;
+
+	if (impl >= M31_BITS_AVX2 && __builtin_cpu_supports("avx2") &&
+		__builtin_cpu_supports("popcnt"))
+		sel = &G_avx2;
+	else if (impl >= M31_BITS_SSE2 && __builtin_cpu_supports("sse2"))
+		sel = &G_sse2;
+#else
+	(void)impl;
+#endif
+
+	G_impl = sel;
+	return(sel->id);
+}
+
+/******************************* M31_BitsName *******************************
+ *
+ *  Description: Get the name of the selected implementation
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		"scalar", "sse2" or "avx2"
+ *  Globals....: -
+ ****************************************************************************/
+const char *M31_BitsName(void)
+{
+	return(Impl()->name);
+}
+
+/*********************************** Impl ***********************************
+ *
+ *  Description: Get the selected implementation, select it on first use
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		implementation
+ *  Globals....: G_impl
+ ****************************************************************************/
+static const BITS_IMPL *Impl(void)	/* nodoc */
+{
+	if (G_impl == NULL)
+		M31_BitsSelect(M31_BITS_AUTO);
+	return(G_impl);
+}
@@ -0,0 +1,623 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************
+ *
+ *         Name: m31_log.c
+ *
+ *       Author: ds
+ *
+ *  Description: Writer and reader of the M31 binary event log
+ *
+ *               The writer appends M31_EVENT records to fixed size
+ *               segments (see m31_log.h) and maintains the time and
+ *               channel index in each segment header. The reader maps
+ *               the whole file and returns the records matching a time
+ *               range, device and channel mask, skipping all segments
+ *               excluded by their index.
+ *
+ *               Functions return 0 on success or -1 with errno set
+ *               (EINVAL: no M31 log or incompatible header).
+ *
+ *     Required: POSIX file io and mmap
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _FILE_OFFSET_BITS 64
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <MEN/men_typs.h>
+#include <MEN/m31_drv.h>
+#include <MEN/m31_log.h>
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define WR_CHUNK	256			/* records copied per write */
+
+/* file offset of segment <idx> */
+#define SEG_OFFS(log,idx) \
+	((off_t)(log)->hdr.hdrSize + (off_t)(idx) * (log)->hdr.segSize)
+
+/* mapped segment header of segment <idx> */
+#define SEG_MAP(log,idx) \
+	((const M31_LOG_SEG*)((log)->map + SEG_OFFS(log,idx)))
+
+#define TS(high,low)	(((u_int64)(high) << 32) | (low))
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static int32 SegStart(M31_LOG *log, u_int32 idx, u_int32 seq);
+static int32 Append(M31_LOG *log);
+static int32 HdrCheck(const M31_LOG_HDR *hdr, u_int64 size);
+
+/****************************** M31_LogCreate *******************************
+ *
+ *  Description: Create a log file for writing
+ *
+ *               The caller fills segSize (rounded up to M31_LOG_ALIGN),
+ *               maxSegs, tsFreq, nrDev and dev[] of <hdr>; all other
+ *               fields are set here.
+ *
+ *               With <append> set an existing log is continued in a new
+ *               segment after the newest one. Its device table must be
+ *               the same, otherwise the call fails with EINVAL. A missing
+ *               file is created.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: log		log handle
+ *               file		file name
+ *               hdr		file header
+ *               append		continue existing file (0/1)
+ *  Output.....: return		0 | -1 (errno)
+ *  Globals....: -
+ ****************************************************************************/
+int32 M31_LogCreate(
+	M31_LOG *log,
+	const char *file,
+	const M31_LOG_HDR *hdr,
+	int append)
+{
+	M31_LOG_HDR newHdr;
+	u_int32 segSize;
+
+	memset(log, 0, sizeof(*log));
+	log->fd = -1;
+
+	segSize = hdr->segSize;
+	if (segSize < sizeof(M31_LOG_SEG) + sizeof(M31_EVENT))
+		segSize = sizeof(M31_LOG_SEG) + sizeof(M31_EVENT);
+	segSize = (segSize + M31_LOG_ALIGN - 1) & ~(M31_LOG_ALIGN - 1);
+
+	if (hdr->nrDev == 0 || hdr->nrDev > M31_LOG_DEV_MAX) {
+		errno = EINVAL;
+		return(-1);
+	}
+
+	newHdr         = *hdr;
+	newHdr.magic   = M31_LOG_MAGIC;
+	newHdr.version = M31_LOG_VERSION;
+	newHdr.hdrSize = M31_LOG_ALIGN;
+	newHdr.segSize = segSize;
+	newHdr.segRecs = M31_LOG_SEG_RECS(segSize);
+	log->hdr       = newHdr;
+
+	if ((log->fd = open(file, O_RDWR | O_CREAT | (append ? 0 : O_TRUNC),
+						0644)) < 0)
+		return(-1);
+
+	/*--------------------------+
+	|  continue existing file   |
+	+--------------------------*/
+	if (append) {
+		switch (Append(log)) {
+		case 0:								/* continued */
+			return(0);
+		case 1:								/* empty file */
+			break;
+		default:
+			M31_LogClose(log);
+			return(-1);
+		}
+	}
+
+	/*--------------------------+
+	|  new file                 |
+	+--------------------------*/
+	if (ftruncate(log->fd, log->hdr.hdrSize) < 0 ||
+		/* write the local copy: GCC 12 mistakes &log->hdr for &hdr.magic */
+		pwrite(log->fd, &newHdr, sizeof(newHdr), 0) !=
+		(ssize_t)sizeof(newHdr) ||
+		SegStart(log, 0, 1) < 0) {
+		M31_LogClose(log);
+		return(-1);
+	}
+
+	return(0);
+}
+
+/****************************** M31_LogWrite ********************************
+ *
+ *  Description: Append event records of one device
+ *
+ *               M31_EVENT.dev of the logged records is set to <dev>.
+ *               A full segment is closed and the next one started. The
+ *               header of the open segment is only written when the
+ *               segment is full or on M31_LogFlush().
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: log		log handle
+ *               dev		device index (M31_LOG_HDR.dev[])
+ *               ev			event records
+ *               nr			nr of records
+ *  Output.....: return		0 | -1 (errno)
+ *  Globals....: -
+ ****************************************************************************/
+int32 M31_LogWrite(
+	M31_LOG *log,
+	u_int8 dev,
+	const M31_EVENT *ev,
+	u_int32 nr)
+{
+	M31_LOG_SEG *seg = &log->seg;
+	M31_EVENT	buf[WR_CHUNK];
+	u_int64		ts, first, last;
+	u_int32		n, i, idx;
+	ssize_t		size;
+
+	if (log->rdOnly || dev >= log->hdr.nrDev) {
+		errno = EINVAL;
+		return(-1);
+	}
+
+	while (nr) {
+		/*--------------------------+
+		|  segment full: next one   |
+		+--------------------------*/
+		if (seg->nrRecs == log->hdr.segRecs) {
+			if (M31_LogFlush(log) < 0)
+				return(-1);
+
+			idx = log->segIdx + 1;
+			if (log->hdr.maxSegs && idx >= log->hdr.maxSegs)
+				idx = 0;
+			if (SegStart(log, idx, seg->seq + 1) < 0)
+				return(-1);
+		}
+
+		n = log->hdr.segRecs - seg->nrRecs;
+		if (n > nr)
+			n = nr;
+		if (n > WR_CHUNK)
+			n = WR_CHUNK;
+
+		/*--------------------------+
+		|  copy, update index       |
+		+--------------------------*/
+		first = TS(seg->tsFirstHigh, seg->tsFirstLow);
+		last  = TS(seg->tsLastHigh, seg->tsLastLow);
+
+		for (i=0; i<n; i++) {
+			buf[i] = ev[i];
+			buf[i].dev = dev;
+
+			ts = TS(ev[i].tsHigh, ev[i].tsLow);
+			if ((seg->nrRecs == 0 && i == 0) || ts < first)
+				first = ts;
+			if ((seg->nrRecs == 0 && i == 0) || ts > last)
+				last = ts;
+
+			/* rule events carry no channel mask */
+			if (!(ev[i].flags & M31_EVF_RULE))
+				seg->chMask[dev] |= ev[i].change;
+		}
+
+		size = (ssize_t)(n * sizeof(M31_EVENT));
+		if (pwrite(log->fd, buf, size, SEG_OFFS(log, log->segIdx) +
+				   sizeof(M31_LOG_SEG) +
+				   (off_t)seg->nrRecs * sizeof(M31_EVENT)) != size)
+			return(-1);
+
+		seg->tsFirstHigh = (u_int32)(first >> 32);
+		seg->tsFirstLow  = (u_int32)first;
+		seg->tsLastHigh  = (u_int32)(last >> 32);
+		seg->tsLastLow   = (u_int32)last;
+		seg->devMask    |= 1 << dev;
+		seg->nrRecs     += n;
+
+		ev += n;
+		nr -= n;
+	}
+
+	return(0);
+}
+
+/****************************** M31_LogFlush ********************************
+ *
+ *  Description: Write header of the open segment
+ *
+ *               Makes all records written so far visible to readers.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: log		log handle
+ *  Output.....: return		0 | -1 (errno)
+ *  Globals....: -
+ ****************************************************************************/
+int32 M31_LogFlush(M31_LOG *log)
+{
+	if (log->rdOnly)
+		return(0);
+
+	if (pwrite(log->fd, &log->seg, sizeof(log->seg),
+			   SEG_OFFS(log, log->segIdx)) != (ssize_t)sizeof(log->seg))
+		return(-1);
+
+	return(0);
+}
+
+/****************************** M31_LogOpen *********************************
+ *
+ *  Description: Open a log file for queries
+ *
+ *               Maps the file and orders the valid segments by their
+ *               sequence number. Records written after the call are not
+ *               visible; reopen the file to see them.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: log		log handle
+ *               file		file name
+ *  Output.....: return		0 | -1 (errno)
+ *  Globals....: -
+ ****************************************************************************/
+int32 M31_LogOpen(M31_LOG *log, const char *file)
+{
+	const M31_LOG_SEG *seg;
+	struct stat st;
+	u_int32 nrSegs, idx, n, first, minSeq = 0;
+
+	memset(log, 0, sizeof(*log));
+	log->rdOnly = 1;
+
+	if ((log->fd = open(file, O_RDONLY)) < 0)
+		return(-1);
+
+	if (fstat(log->fd, &st) < 0 ||
+		pread(log->fd, &log->hdr, sizeof(log->hdr), 0) !=
+		(ssize_t)sizeof(log->hdr))
+		goto error;
+
+	if (HdrCheck(&log->hdr, (u_int64)st.st_size) < 0 ||
+		(u_int64)(size_t)st.st_size != (u_int64)st.st_size) {
+		errno = EINVAL;
+		goto error;
+	}
+
+	nrSegs = (u_int32)((st.st_size - log->hdr.hdrSize) / log->hdr.segSize);
+	log->mapSize = (u_int64)st.st_size;
+
+	if ((log->map = mmap(NULL, (size_t)log->mapSize, PROT_READ, MAP_SHARED,
+						 log->fd, 0)) == MAP_FAILED) {
+		log->map = NULL;
+		goto error;
+	}
+
+	if (nrSegs && (log->order = malloc(nrSegs * sizeof(u_int32))) == NULL)
+		goto error;
+
+	/*--------------------------+
+	|  find oldest segment      |
+	+--------------------------*/
+	for (first=0, idx=0; idx<nrSegs; idx++) {
+		seg = SEG_MAP(log, idx);
+		if (seg->magic != M31_LOG_SEG_MAGIC || seg->seq == 0)
+			continue;
+		if (minSeq == 0 || seg->seq < minSeq) {
+			minSeq = seg->seq;
+			first  = idx;
+		}
+	}
+
+	/* segments are written in ring order starting at the oldest one */
+	for (n=0; n<nrSegs; n++) {
+		idx = (first + n) % nrSegs;
+		seg = SEG_MAP(log, idx);
+		if (seg->magic == M31_LOG_SEG_MAGIC && seg->seq != 0)
+			log->order[log->nrOrder++] = idx;
+	}
+
+	return(0);
+
+ error:
+	M31_LogClose(log);
+	return(-1);
+}
+
+/****************************** M31_LogClose ********************************
+ *
+ *  Description: Close log file
+ *
+ *               The writer flushes the open segment.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: log		log handle
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void M31_LogClose(M31_LOG *log)
+{
+	if (log->fd >= 0 && !log->rdOnly && log->seg.magic)
+		M31_LogFlush(log);
+
+	if (log->map)
+		munmap(log->map, (size_t)log->mapSize);
+	if (log->order)
+		free(log->order);
+	if (log->fd >= 0)
+		close(log->fd);
+
+	log->map   = NULL;
+	log->order = NULL;
+	log->fd    = -1;
+}
+
+/****************************** M31_LogQueryInit ****************************
+ *
+ *  Description: Initialize a query
+ *
+ *               A record matches if its timestamp is within tsFrom..tsTo,
+ *               its device is in <devMask> and its change mask shares a
+ *               channel with <chMask>. Rule events (M31_EVF_RULE) only
+ *               match if <chMask> is 0xffff.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: q			query state
+ *               tsFrom		first timestamp
+ *               tsTo		last timestamp
+ *               devMask	devices (bit n = M31_LOG_HDR.dev[n])
+ *               chMask		channels
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void M31_LogQueryInit(
+	M31_LOG_QUERY *q,
+	u_int64 tsFrom,
+	u_int64 tsTo,
+	u_int32 devMask,
+	u_int16 chMask)
+{
+	memset(q, 0, sizeof(*q));
+	q->tsFrom  = tsFrom;
+	q->tsTo    = tsTo;
+	q->devMask = devMask;
+	q->chMask  = chMask;
+}
+
+/****************************** M31_LogNext *********************************
+ *
+ *  Description: Get next record matching the query
+ *
+ *               Records are returned in segment order. Segments whose
+ *               time range, device mask or channel masks exclude the
+ *               query are skipped without touching their records.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: log		log handle (M31_LogOpen)
+ *               q			query state
+ *  Output.....: return		record (in the mapping) | NULL (no more)
+ *  Globals....: -
+ ****************************************************************************/
+const M31_EVENT *M31_LogNext(M31_LOG *log, M31_LOG_QUERY *q)
+{
+	const M31_LOG_SEG *seg;
+	const M31_EVENT *ev;
+	u_int64 ts;
+	u_int32 nrRecs, dev;
+	u_int16 chMask;
+
+	for (; q->pos < log->nrOrder; q->pos++, q->rec = 0) {
+		seg = SEG_MAP(log, log->order[q->pos]);
+		nrRecs = seg->nrRecs;
+		if (nrRecs > log->hdr.segRecs)
+			nrRecs = log->hdr.segRecs;
+
+		/*--------------------------+
+		|  check segment index      |
+		+--------------------------*/
+		if (q->rec == 0) {
+			for (chMask=0, dev=0; dev<log->hdr.nrDev; dev++)
+				if (q->devMask & seg->devMask & (1 << dev))
+					chMask |= seg->chMask[dev];
+
+			if (nrRecs == 0 ||
+				!(q->devMask & seg->devMask) ||
+				(q->chMask != 0xffff && !(q->chMask & chMask)) ||
+				TS(seg->tsLastHigh, seg->tsLastLow) < q->tsFrom ||
+				TS(seg->tsFirstHigh, seg->tsFirstLow) > q->tsTo) {
+				q->segsSkipped++;
+				continue;
+			}
+			q->segsRead++;
+		}
+
+		/*--------------------------+
+		|  search records           |
+		+--------------------------*/
+		while (q->rec < nrRecs) {
+			ev = (const M31_EVENT*)(seg + 1) + q->rec++;
+
+			if (!(q->devMask & (1 << ev->dev)))
+				continue;
+			if (q->chMask != 0xffff &&
+				((ev->flags & M31_EVF_RULE) || !(q->chMask & ev->change)))
+				continue;
+
+			ts = TS(ev->tsHigh, ev->tsLow);
+			if (ts < q->tsFrom || ts > q->tsTo)
+				continue;
+
+			return(ev);
+		}
+	}
+
+	return(NULL);
+}
+
+/****************************** M31_LogSeg **********************************
+ *
+ *  Description: Get segment header
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: log		log handle (M31_LogOpen)
+ *               idx		index in segment order (0=oldest)
+ *  Output.....: return		segment header | NULL (idx out of range)
+ *  Globals....: -
+ ****************************************************************************/
+const M31_LOG_SEG *M31_LogSeg(M31_LOG *log, u_int32 idx)
+{
+	if (idx >= log->nrOrder)
+		return(NULL);
+
+	return(SEG_MAP(log, log->order[idx]));
+}
+
+/******************************** SegStart **********************************
+ *
+ *  Description: Start new segment
+ *
+ *               Extends the file by one segment if necessary and writes
+ *               the empty segment header, which invalidates old records
+ *               of a reused ring segment.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: log		log handle
+ *               idx		segment index
+ *               seq		sequence number
+ *  Output.....: return		0 | -1 (errno)
+ *  Globals....: -
+ ****************************************************************************/
+static int32 SegStart(M31_LOG *log, u_int32 idx, u_int32 seq)/* nodoc */
+{
+	struct timeval tv;
+
+	if (idx >= log->nrSegs) {
+		if (ftruncate(log->fd, SEG_OFFS(log, idx + 1)) < 0)
+			return(-1);
+		log->nrSegs = idx + 1;
+	}
+
+	gettimeofday(&tv, NULL);
+
+	memset(&log->seg, 0, sizeof(log->seg));
+	log->seg.magic    = M31_LOG_SEG_MAGIC;
+	log->seg.seq      = seq;
+	log->seg.wallSec  = (u_int32)tv.tv_sec;
+	log->seg.wallUsec = (u_int32)tv.tv_usec;
+	log->segIdx       = idx;
+
+	return(M31_LogFlush(log));
+}
+
+/********************************* Append ***********************************
+ *
+ *  Description: Continue existing log file
+ *
+ *               Checks the header against the new one and starts a new
+ *               segment after the newest one.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: log		log handle (hdr = new header)
+ *  Output.....: return		0 | 1 (empty file) | -1 (errno)
+ *  Globals....: -
+ ****************************************************************************/
+static int32 Append(M31_LOG *log)/* nodoc */
+{
+	M31_LOG_HDR hdr;
+	M31_LOG_SEG seg;
+	struct stat st;
+	u_int32 idx, newest = 0, maxSeq = 0;
+
+	if (fstat(log->fd, &st) < 0)
+		return(-1);
+	if (st.st_size == 0)
+		return(1);
+
+	if (pread(log->fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr))
+		return(-1);
+
+	if (HdrCheck(&hdr, (u_int64)st.st_size) < 0 ||
+		hdr.segSize != log->hdr.segSize ||
+		hdr.maxSegs != log->hdr.maxSegs ||
+		hdr.tsFreq  != log->hdr.tsFreq ||
+		hdr.nrDev   != log->hdr.nrDev ||
+		memcmp(hdr.dev, log->hdr.dev, hdr.nrDev * sizeof(M31_LOG_DEV))) {
+		errno = EINVAL;
+		return(-1);
+	}
+
+	log->nrSegs = (u_int32)((st.st_size - hdr.hdrSize) / hdr.segSize);
+
+	for (idx=0; idx<log->nrSegs; idx++) {
+		if (pread(log->fd, &seg, sizeof(seg), SEG_OFFS(log, idx)) !=
+			(ssize_t)sizeof(seg))
+			return(-1);
+		if (seg.magic == M31_LOG_SEG_MAGIC && seg.seq > maxSeq) {
+			maxSeq = seg.seq;
+			newest = idx;
+		}
+	}
+
+	if (maxSeq == 0)
+		return(SegStart(log, 0, 1));
+
+	idx = newest + 1;
+	if (log->hdr.maxSegs && idx >= log->hdr.maxSegs)
+		idx = 0;
+
+	return(SegStart(log, idx, maxSeq + 1));
+}
+
+/******************************** HdrCheck **********************************
+ *
+ *  Description: Check file header
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: hdr		file header
+ *               size		file size [bytes]
+ *  Output.....: return		0 | -1 (invalid)
+ *  Globals....: -
+ ****************************************************************************/
+static int32 HdrCheck(const M31_LOG_HDR *hdr, u_int64 size)/* nodoc */
+{
+	if (hdr->magic != M31_LOG_MAGIC ||
+		hdr->version != M31_LOG_VERSION ||
+		hdr->hdrSize < sizeof(M31_LOG_HDR) ||
+		hdr->segSize < sizeof(M31_LOG_SEG) + sizeof(M31_EVENT) ||
+		hdr->segRecs != M31_LOG_SEG_RECS(hdr->segSize) ||
+		hdr->nrDev == 0 || hdr->nrDev > M31_LOG_DEV_MAX ||
+		size < hdr->hdrSize)
+		return(-1);
+
+	return(0);
+}
@@ -0,0 +1,461 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************
+ *
+ *         Name: m31_merge.c
+ *
+ *       Author: ds
+ *
+ *  Description: Time-ordered merge of the event streams of several M31
+ *
+ *               k-way merge of per-device queues (see m31_merge.h). The
+ *               heap holds the devices with queued events, keyed by the
+ *               timestamp of their oldest event. Before the heap top is
+ *               released, the release bound is computed once: the lowest
+ *               watermark of all other devices with an empty queue, or
+ *               the newest timestamp minus the slack if that is later.
+ *               Events of the top device are then released one by one
+ *               while they are within the bound and not newer than the
+ *               oldest event of any other device (gallop); only then is
+ *               the heap fixed.
+ *
+ *               The functions are not thread safe; one thread puts and
+ *               gets (e.g. the reader loop of m31_merge).
+ *
+ *     Required: -
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <MEN/men_typs.h>
+#include <MEN/m31_drv.h>
+#include <MEN/m31_merge.h>
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define QSIZE_MIN	16			/* min queue size */
+#define QSIZE_MAX	0x100000	/* max queue size (1M events) */
+
+#define TS_MAX		(~(u_int64)0)
+#define NO_CH_BIT	0x10000		/* pendMask: event without channel */
+
+#define TS(e)		(((u_int64)(e)->tsHigh << 32) | (e)->tsLow)
+#define USED(q)		((q)->put - (q)->get)
+#define HEAD(m,q)	(&(q)->ev[(q)->get & ((m)->size - 1)])
+#define KEY(m,i)	TS(HEAD((m), &(m)->dev[(m)->heap[i]]))
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static void HeapUp(M31_MERGE *m, u_int32 i);
+static void HeapDown(M31_MERGE *m, u_int32 i);
+static u_int64 Bound(M31_MERGE *m, u_int8 d);
+static void Emit(M31_MERGE *m, M31_MERGE_REC *rec);
+
+/****************************** M31_MergeInit *******************************
+ *
+ *  Description: Initialize the merge state
+ *
+ *               Allocates one queue of <size> events (rounded up to a
+ *               power of 2) per device. A larger <slack> tolerates later
+ *               delivery of slow devices at the cost of latency; a device
+ *               with a full queue forces the release of the oldest event.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: m			merge state
+ *               nrDev		nr of devices (1..M31_MERGE_DEV_MAX)
+ *               size		queue size per device [events]
+ *               slack		max wait for slow devices [timestamp ticks]
+ *  Output.....: return		0 | -1 (errno: EINVAL, ENOMEM)
+ *  Globals....: -
+ ****************************************************************************/
+int32 M31_MergeInit(
+	M31_MERGE *m,
+	u_int32 nrDev,
+	u_int32 size,
+	u_int64 slack)
+{
+	u_int32 d;
+
+	memset(m, 0, sizeof(*m));
+
+	if (nrDev == 0 || nrDev > M31_MERGE_DEV_MAX) {
+		errno = EINVAL;
+		return(-1);
+	}
+
+	for (m->size = QSIZE_MIN; m->size < size && m->size < QSIZE_MAX; )
+		m->size <<= 1;
+
+	m->nrDev = nrDev;
+	m->slack = slack;
+
+	for (d=0; d<nrDev; d++) {
+		if (!(m->dev[d].ev = malloc(m->size * sizeof(M31_EVENT)))) {
+			M31_MergeExit(m);
+			errno = ENOMEM;
+			return(-1);
+		}
+	}
+	return(0);
+}
+
+/****************************** M31_MergeExit *******************************
+ *
+ *  Description: Free the queues; pending events are discarded
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: m			merge state
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void M31_MergeExit(M31_MERGE *m)
+{
+	u_int32 d;
+
+	for (d=0; d<M31_MERGE_DEV_MAX; d++) {
+		free(m->dev[d].ev);
+		m->dev[d].ev = NULL;
+	}
+	m->nrDev = m->nrHeap = m->nrFull = m->pendMask = 0;
+}
+
+/****************************** M31_MergeFree *******************************
+ *
+ *  Description: Get the free space of a device queue
+ *
+ *               Readers should not read more events from a device than
+ *               fit (e.g. limit the M_getblock size), so that no events
+ *               must be held back outside the merge.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: m			merge state
+ *               dev		device index
+ *  Output.....: return		free queue entries [events]
+ *  Globals....: -
+ ****************************************************************************/
+u_int32 M31_MergeFree(M31_MERGE *m, u_int8 dev)
+{
+	return(m->size - USED(&m->dev[dev]));
+}
+
+/****************************** M31_MergePut ********************************
+ *
+ *  Description: Queue events of one device
+ *
+ *               The events of one device must be in timestamp order (as
+ *               read from the driver FIFO). Sets ev.dev to <dev>; each
+ *               event also advances the watermark of the device.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: m			merge state
+ *               dev		device index
+ *               ev			events
+ *               nr			nr of events
+ *  Output.....: return		nr of events queued (less than <nr> if the
+ *							queue got full)
+ *  Globals....: -
+ ****************************************************************************/
+u_int32 M31_MergePut(
+	M31_MERGE *m,
+	u_int8 dev,
+	const M31_EVENT *ev,
+	u_int32 nr)
+{
+	M31_MERGE_DEV	*q = &m->dev[dev];
+	M31_EVENT		*e;
+	u_int64			ts;
+	u_int32			n, wasEmpty = (USED(q) == 0);
+
+	if (nr > m->size - USED(q))
+		nr = m->size - USED(q);
+
+	for (n=0; n<nr; n++) {
+		e = &q->ev[q->put++ & (m->size - 1)];
+		*e = ev[n];
+		e->dev = dev;
+
+		ts = TS(e);
+		if (ts > m->newest)
+			m->newest = ts;
+		if (ts > q->mark)
+			q->mark = ts;
+		if (ts < m->released)
+			m->late++;
+	}
+
+	if (!nr)
+		return(0);
+
+	if (USED(q) > q->maxUsed)
+		q->maxUsed = USED(q);
+	if (USED(q) == m->size)
+		m->nrFull++;
+
+	if (wasEmpty) {
+		m->heap[m->nrHeap] = dev;
+		HeapUp(m, m->nrHeap++);
+	}
+	return(nr);
+}
+
+/****************************** M31_MergeMark *******************************
+ *
+ *  Description: Set the watermark of a device
+ *
+ *               Declares that no events older than <ts> will follow from
+ *               <dev>, e.g. after an empty read at a known time. Idle
+ *               devices without watermarks delay the output up to the
+ *               slack.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: m			merge state
+ *               dev		device index
+ *               ts			watermark [timestamp ticks]
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void M31_MergeMark(M31_MERGE *m, u_int8 dev, u_int64 ts)
+{
+	if (ts > m->dev[dev].mark)
+		m->dev[dev].mark = ts;
+	if (ts > m->newest)
+		m->newest = ts;
+}
+
+/****************************** M31_MergeGet ********************************
+ *
+ *  Description: Get merged records in timestamp order
+ *
+ *               Returns the records of all events that can be released
+ *               (see m31_merge.h), one per channel in event.change, lowest
+ *               channel first. An event without channel bits yields one
+ *               record with ch=M31_MERGE_NO_CH. M31_EVF_OVERRUN is only
+ *               set in the first record of an event. An event split over
+ *               two calls is continued in the next call.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: m			merge state
+ *               rec		buffer for records
+ *               max		size of <rec> [records]
+ *               flush		release all queued events (e.g. all devices
+ *							idle or at exit)
+ *  Output.....: return		nr of records
+ *  Globals....: -
+ ****************************************************************************/
+u_int32 M31_MergeGet(
+	M31_MERGE *m,
+	M31_MERGE_REC *rec,
+	u_int32 max,
+	int flush)
+{
+	M31_MERGE_DEV	*q;
+	M31_EVENT		*e;
+	u_int64			bound, limit, ts;
+	u_int32			n = 0, rel;
+	u_int8			d;
+
+	for (;;) {
+		/* rest of a split event */
+		while (m->pendMask && n < max)
+			Emit(m, &rec[n++]);
+
+		if (m->pendMask || n == max || !m->nrHeap)
+			break;
+
+		d     = m->heap[0];
+		q     = &m->dev[d];
+		bound = flush ? TS_MAX : Bound(m, d);
+
+		/* oldest event of the other devices */
+		limit = TS_MAX;
+		if (m->nrHeap > 1)
+			limit = KEY(m, 1);
+		if (m->nrHeap > 2 && KEY(m, 2) < limit)
+			limit = KEY(m, 2);
+
+		/* release events of <d> up to the next device (gallop) */
+		for (rel=0; USED(q) && n < max; ) {
+			e  = HEAD(m, q);
+			ts = TS(e);
+
+			if (rel && ts > limit)
+				break;
+			if (ts > bound && !m->nrFull)
+				break;
+
+			if (USED(q) == m->size)
+				m->nrFull--;
+			q->get++;
+			rel++;
+
+			if (ts > m->released)
+				m->released = ts;
+
+			m->pend     = *e;
+			m->pendMask = e->change ? e->change : NO_CH_BIT;
+
+			while (m->pendMask && n < max)
+				Emit(m, &rec[n++]);
+			if (m->pendMask)
+				break;
+		}
+
+		/* fix the heap */
+		if (rel) {
+			if (!USED(q))
+				m->heap[0] = m->heap[--m->nrHeap];
+			HeapDown(m, 0);
+		}
+		else
+			break;
+	}
+	return(n);
+}
+
+/********************************* HeapUp ***********************************
+ *
+ *  Description: Move a heap entry up to its place
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: m			merge state
+ *               i			heap index
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void HeapUp(M31_MERGE *m, u_int32 i)	/* nodoc */
+{
+	u_int8  d = m->heap[i];
+	u_int64 key = TS(HEAD(m, &m->dev[d]));
+	u_int32 p;
+
+	while (i) {
+		p = (i - 1) / 2;
+		if (KEY(m, p) <= key)
+			break;
+		m->heap[i] = m->heap[p];
+		i = p;
+	}
+	m->heap[i] = d;
+}
+
+/******************************** HeapDown **********************************
+ *
+ *  Description: Move a heap entry down to its place
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: m			merge state
+ *               i			heap index
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void HeapDown(M31_MERGE *m, u_int32 i)	/* nodoc */
+{
+	u_int8  d;
+	u_int64 key;
+	u_int32 c;
+
+	if (i >= m->nrHeap)
+		return;
+
+	d   = m->heap[i];
+	key = TS(HEAD(m, &m->dev[d]));
+
+	while ((c = 2 * i + 1) < m->nrHeap) {
+		if (c + 1 < m->nrHeap && KEY(m, c + 1) < KEY(m, c))
+			c++;
+		if (key <= KEY(m, c))
+			break;
+		m->heap[i] = m->heap[c];
+		i = c;
+	}
+	m->heap[i] = d;
+}
+
+/********************************* Bound ************************************
+ *
+ *  Description: Get the release bound for events of a device
+ *
+ *               Events up to the bound can be released: all other idle
+ *               devices have watermarks at or after it, or it is at
+ *               least <slack> older than the newest timestamp.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: m			merge state
+ *               d			device at the heap top
+ *  Output.....: return		bound [timestamp ticks]
+ *  Globals....: -
+ ****************************************************************************/
+static u_int64 Bound(M31_MERGE *m, u_int8 d)	/* nodoc */
+{
+	u_int64 bound = TS_MAX;
+	u_int32 i;
+
+	for (i=0; i<m->nrDev; i++)
+		if (i != d && !USED(&m->dev[i]) && m->dev[i].mark < bound)
+			bound = m->dev[i].mark;
+
+	if (m->newest >= m->slack && m->newest - m->slack > bound)
+		bound = m->newest - m->slack;
+
+	return(bound);
+}
+
+/********************************** Emit ************************************
+ *
+ *  Description: Return the record of the next channel of the pending event
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: m			merge state (pendMask != 0)
+ *               rec		record
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void Emit(M31_MERGE *m, M31_MERGE_REC *rec)	/* nodoc */
+{
+	const M31_EVENT *e = &m->pend;
+	u_int32 ch;
+
+	for (ch=0; !(m->pendMask & (1 << ch)); ch++)
+		;
+	m->pendMask &= ~(1 << ch);
+
+	rec->tsHigh = e->tsHigh;
+	rec->tsLow  = e->tsLow;
+	rec->state  = e->state;
+	rec->dev    = e->dev;
+	rec->ch     = (ch < 16) ? (u_int8)ch : M31_MERGE_NO_CH;
+	rec->flags  = e->flags;
+	rec->seq    = e->seq;
+
+	if (e->flags & M31_EVF_RULE)
+		rec->edge = M31_MERGE_RULE;
+	else if (e->flags & M31_EVF_LOST_EDGE)
+		rec->edge = M31_MERGE_LOST;
+	else if (e->flags & M31_EVF_FIELD)
+		rec->edge = M31_MERGE_FIELD;
+	else
+		rec->edge = (ch < 16 && (e->state & (1 << ch))) ?
+			M31_MERGE_RISE : M31_MERGE_FALL;
+
+	/* report a driver overrun once per event */
+	m->pend.flags &= ~M31_EVF_OVERRUN;
+}
@@ -0,0 +1,232 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************
+ *
+ *         Name: m31_rle.c
+ *
+ *       Author: ds
+ *
+ *  Description: Run length decoder/encoder for M31 capture streams
+ *
+ *               Decodes the capture format M31_CAPFMT_RLE (see m31_rle.h)
+ *               either into single samples or into a list of transitions
+ *               (new state, delta time in sample periods). The encoder
+ *               converts raw samples (M31_CAPFMT_RAW) into the same
+ *               format, e.g. for files written by m31_cap.
+ *
+ *               All functions keep their state in the caller's context
+ *               structure, so streams can be processed in pieces of any
+ *               size.
+ *
+ *     Required: -
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <MEN/men_typs.h>
+#include <MEN/m31_drv.h>
+#include <MEN/m31_rle.h>
+
+/****************************** M31_RleDecInit ******************************
+ *
+ *  Description: Initialize decoder for a new stream
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: dec		decoder state
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void M31_RleDecInit(M31_RLE_DEC *dec)
+{
+	dec->sample    = 0;
+	dec->lastTrans = 0;
+	dec->left      = 0;
+	dec->state     = 0;
+	dec->valid     = 0;
+}
+
+/****************************** M31_RleExpand *******************************
+ *
+ *  Description: Expand records into single samples
+ *
+ *               Stops when <max> samples are written. A partly expanded
+ *               record is not counted in *usedP; the next call must pass
+ *               it again and continues where the previous call stopped.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: dec		decoder state
+ *               rec		records
+ *               nrRec		nr of records
+ *               buf		sample buffer
+ *               max		size of sample buffer
+ *  Output.....: *usedP		nr of records completely expanded
+ *               return		nr of samples written
+ *  Globals....: -
+ ****************************************************************************/
+u_int32 M31_RleExpand(
+	M31_RLE_DEC *dec,
+	const M31_RLE_REC *rec,
+	u_int32 nrRec,
+	u_int32 *usedP,
+	u_int16 *buf,
+	u_int32 max)
+{
+	u_int32 r, n = 0;
+
+	for (r = 0; r < nrRec && n < max; r++) {
+		if (dec->left == 0)
+			dec->left = rec[r].count;
+
+		while (dec->left && n < max) {
+			buf[n++] = rec[r].state;
+			dec->left--;
+		}
+
+		if (dec->left)
+			break;				/* record not finished */
+	}
+
+	dec->sample += n;
+	*usedP = r;
+	return( n );
+}
+
+/****************************** M31_RleToTrans ******************************
+ *
+ *  Description: Convert records into transitions
+ *
+ *               Records with the same state as their predecessor are
+ *               merged. The first record of a stream yields a transition
+ *               with change=0 and delta=0 (initial state).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: dec		decoder state
+ *               rec		records
+ *               nrRec		nr of records
+ *               trans		transition buffer (nrRec entries)
+ *  Output.....: return		nr of transitions written
+ *  Globals....: -
+ ****************************************************************************/
+u_int32 M31_RleToTrans(
+	M31_RLE_DEC *dec,
+	const M31_RLE_REC *rec,
+	u_int32 nrRec,
+	M31_RLE_TRANS *trans)
+{
+	u_int32 r, n = 0;
+
+	for (r = 0; r < nrRec; r++) {
+		if (!dec->valid || rec[r].state != dec->state) {
+			trans[n].sample = dec->sample;
+			trans[n].delta  = dec->sample - dec->lastTrans;
+			trans[n].state  = rec[r].state;
+			trans[n].change = dec->valid ? (u_int16)(rec[r].state ^ dec->state)
+										 : 0;
+			n++;
+
+			dec->lastTrans = dec->sample;
+			dec->state     = rec[r].state;
+			dec->valid     = 1;
+		}
+		dec->sample += rec[r].count;
+	}
+
+	return( n );
+}
+
+/****************************** M31_RleEncInit ******************************
+ *
+ *  Description: Initialize encoder for a new stream
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: enc		encoder state
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void M31_RleEncInit(M31_RLE_ENC *enc)
+{
+	enc->count = 0;
+	enc->state = 0;
+}
+
+/****************************** M31_RleEncode *******************************
+ *
+ *  Description: Encode raw samples into records
+ *
+ *               The last run stays open until a different sample follows
+ *               or M31_RleEncFlush() is called. Stops when <max> records
+ *               are written.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: enc		encoder state
+ *               buf		samples
+ *               nrSamples	nr of samples
+ *               rec		record buffer
+ *               max		size of record buffer
+ *  Output.....: *usedP		nr of samples consumed
+ *               return		nr of records written
+ *  Globals....: -
+ ****************************************************************************/
+u_int32 M31_RleEncode(
+	M31_RLE_ENC *enc,
+	const u_int16 *buf,
+	u_int32 nrSamples,
+	u_int32 *usedP,
+	M31_RLE_REC *rec,
+	u_int32 max)
+{
+	u_int32 i, n = 0;
+
+	for (i = 0; i < nrSamples; i++) {
+		if (enc->count &&
+			(buf[i] != enc->state || enc->count == 0xffff)) {
+			if (n == max)
+				break;
+			rec[n].state = enc->state;
+			rec[n].count = (u_int16)enc->count;
+			n++;
+			enc->count = 0;
+		}
+
+		enc->state = buf[i];
+		enc->count++;
+	}
+
+	*usedP = i;
+	return( n );
+}
+
+/****************************** M31_RleEncFlush *****************************
+ *
+ *  Description: Close the open run of the encoder
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: enc		encoder state
+ *               rec		record buffer (1 entry)
+ *  Output.....: return		nr of records written (0 or 1)
+ *  Globals....: -
+ ****************************************************************************/
+u_int32 M31_RleEncFlush(M31_RLE_ENC *enc, M31_RLE_REC *rec)
+{
+	if (enc->count == 0)
+		return( 0 );
+
+	rec->state = enc->state;
+	rec->count = (u_int16)enc->count;
+	enc->count = 0;
+	return( 1 );
+}
@@ -0,0 +1,514 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************
+ *
+ *         Name: m31_shm.c
+ *
+ *       Author: ds
+ *
+ *  Description: Shared memory event ring of the M31 publisher service
+ *
+ *               Single writer, any nr of readers, no locks (see
+ *               m31_shm.h). The publisher invalidates a ring record
+ *               (seq=0), writes the event, sets the record seq and then
+ *               advances the head, each step ordered by release
+ *               semantics. A subscriber copies the record and accepts it
+ *               only if the record seq matches its cursor before and
+ *               after the copy; otherwise the publisher lapped it.
+ *
+ *               Functions return 0 on success or -1 with errno set
+ *               (EINVAL: no M31 ring or incompatible header, EBUSY:
+ *               the object is owned by a running publisher).
+ *
+ *     Required: POSIX shared memory, GCC atomic builtins
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <MEN/men_typs.h>
+#include <MEN/m31_drv.h>
+#include <MEN/m31_shm.h>
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define HDR_ALIGN	4096		/* header size (page) */
+#define RECS_MIN	64			/* min ring size */
+#define RECS_MAX	0x1000000	/* max ring size (16M records) */
+
+/* shared variables: atomic access with ordering */
+#define LOAD_ACQ(p)		__atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define LOAD_RLX(p)		__atomic_load_n((p), __ATOMIC_RELAXED)
+#define STORE_REL(p,v)	__atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define STORE_RLX(p,v)	__atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define FENCE_ACQ()		__atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define FENCE_REL()		__atomic_thread_fence(__ATOMIC_RELEASE)
+
+#define HEAD(shm)		(&(shm)->hdr->head[0])
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static int32 Map(M31_SHM *shm, int prot);
+static void StateUpdate(M31_SHM_STATE *st, u_int32 state, u_int32 tsHigh,
+						u_int32 tsLow, u_int32 events, u_int32 lost);
+
+/****************************** M31_ShmCreate *******************************
+ *
+ *  Description: Create the shared memory ring (publisher)
+ *
+ *               The caller fills nrRecs (rounded up to a power of 2),
+ *               tsFreq, nrDev and dev[] of <hdr>; all other fields are
+ *               set here. A stale object of a terminated publisher is
+ *               replaced; subscribers still mapping it see it closed.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle
+ *               name		object name (e.g. M31_SHM_NAME)
+ *               hdr		header
+ *  Output.....: return		0 | -1 (errno)
+ *  Globals....: -
+ ****************************************************************************/
+int32 M31_ShmCreate(
+	M31_SHM *shm,
+	const char *name,
+	const M31_SHM_HDR *hdr)
+{
+	M31_SHM old;
+	u_int32 nrRecs;
+
+	memset(shm, 0, sizeof(*shm));
+	shm->fd = -1;
+
+	if (hdr->nrDev == 0 || hdr->nrDev > M31_SHM_DEV_MAX ||
+		strlen(name) >= sizeof(shm->name)) {
+		errno = EINVAL;
+		return(-1);
+	}
+
+	for (nrRecs = RECS_MIN; nrRecs < hdr->nrRecs && nrRecs < RECS_MAX; )
+		nrRecs <<= 1;
+
+	/* refuse to replace the ring of a running publisher */
+	if (M31_ShmAttach(&old, name) == 0) {
+		if (M31_ShmAlive(&old)) {
+			M31_ShmClose(&old);
+			errno = EBUSY;
+			return(-1);
+		}
+		M31_ShmClose(&old);
+	}
+	shm_unlink(name);
+
+	strcpy(shm->name, name);
+	shm->pub  = 1;
+	shm->size = HDR_ALIGN + (u_int64)nrRecs * sizeof(M31_SHM_REC);
+
+	if ((shm->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644)) < 0)
+		return(-1);
+
+	if (ftruncate(shm->fd, (off_t)shm->size) < 0 ||
+		Map(shm, PROT_READ | PROT_WRITE) < 0) {
+		M31_ShmClose(shm);
+		return(-1);
+	}
+
+	/* new object is zeroed: all records invalid, head 0 */
+	shm->hdr->version = M31_SHM_VERSION;
+	shm->hdr->hdrSize = HDR_ALIGN;
+	shm->hdr->nrRecs  = nrRecs;
+	shm->hdr->tsFreq  = hdr->tsFreq;
+	shm->hdr->nrDev   = hdr->nrDev;
+	shm->hdr->pid     = (u_int32)getpid();
+	memcpy(shm->hdr->dev, hdr->dev, sizeof(hdr->dev));
+	shm->mask = nrRecs - 1;
+
+	STORE_REL(&shm->hdr->magic, M31_SHM_MAGIC);
+	return(0);
+}
+
+/****************************** M31_ShmPublish ******************************
+ *
+ *  Description: Publish events of one device
+ *
+ *               Sets ev.dev to <dev> and updates the device state from
+ *               the last event.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle (publisher)
+ *               dev		device index
+ *               ev			events
+ *               nr			nr of events
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void M31_ShmPublish(
+	M31_SHM *shm,
+	u_int8 dev,
+	const M31_EVENT *ev,
+	u_int32 nr)
+{
+	M31_SHM_STATE	*st = &shm->hdr->state[dev];
+	M31_SHM_REC		*rec;
+	u_int32			seq, n;
+
+	if (!nr)
+		return;
+
+	seq = LOAD_RLX(HEAD(shm));
+
+	for (n=0; n<nr; n++, seq++) {
+		rec = &shm->rec[seq & shm->mask];
+
+		STORE_RLX(&rec->seq, 0);
+		FENCE_REL();
+		rec->ev     = ev[n];
+		rec->ev.dev = dev;
+		STORE_REL(&rec->seq, seq + 1);
+		STORE_REL(HEAD(shm), seq + 1);
+	}
+
+	ev += nr - 1;
+	StateUpdate(st, ev->state, ev->tsHigh, ev->tsLow, st->events + nr,
+				st->lost);
+}
+
+/***************************** M31_ShmStateSet ******************************
+ *
+ *  Description: Set the state of a device (publisher)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle (publisher)
+ *               dev		device index
+ *               state		channel states
+ *               ts			timestamp of state
+ *               lost		events lost in the driver
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void M31_ShmStateSet(
+	M31_SHM *shm,
+	u_int8 dev,
+	u_int32 state,
+	u_int64 ts,
+	u_int32 lost)
+{
+	M31_SHM_STATE *st = &shm->hdr->state[dev];
+
+	StateUpdate(st, state, (u_int32)(ts >> 32), (u_int32)ts, st->events,
+				lost);
+}
+
+/******************************* M31_ShmBeat ********************************
+ *
+ *  Description: Increment the publisher heartbeat
+ *
+ *               Subscribers may watch M31_SHM_HDR.beat to detect a hung
+ *               publisher.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle (publisher)
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void M31_ShmBeat(M31_SHM *shm)
+{
+	STORE_REL(&shm->hdr->beat, shm->hdr->beat + 1);
+}
+
+/****************************** M31_ShmAttach *******************************
+ *
+ *  Description: Map an existing ring read-only (subscriber)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle
+ *               name		object name
+ *  Output.....: return		0 | -1 (errno)
+ *  Globals....: -
+ ****************************************************************************/
+int32 M31_ShmAttach(
+	M31_SHM *shm,
+	const char *name)
+{
+	struct stat			st;
+	const M31_SHM_HDR	*hdr;
+
+	memset(shm, 0, sizeof(*shm));
+	shm->fd = -1;
+
+	if (strlen(name) >= sizeof(shm->name)) {
+		errno = EINVAL;
+		return(-1);
+	}
+	strcpy(shm->name, name);
+
+	if ((shm->fd = shm_open(name, O_RDONLY, 0)) < 0)
+		return(-1);
+
+	if (fstat(shm->fd, &st) < 0)
+		goto error;
+
+	shm->size = (u_int64)st.st_size;
+	if (shm->size < HDR_ALIGN) {
+		errno = EINVAL;
+		goto error;
+	}
+
+	if (Map(shm, PROT_READ) < 0)
+		goto error;
+
+	hdr = shm->hdr;
+	if (LOAD_ACQ(&hdr->magic) != M31_SHM_MAGIC ||
+		hdr->version != M31_SHM_VERSION ||
+		hdr->hdrSize != HDR_ALIGN ||
+		hdr->nrRecs < RECS_MIN || (hdr->nrRecs & (hdr->nrRecs - 1)) ||
+		hdr->nrDev == 0 || hdr->nrDev > M31_SHM_DEV_MAX ||
+		shm->size < HDR_ALIGN + (u_int64)hdr->nrRecs * sizeof(M31_SHM_REC)) {
+		errno = EINVAL;
+		goto error;
+	}
+	shm->mask = hdr->nrRecs - 1;
+
+	return(0);
+
+ error:
+	M31_ShmClose(shm);
+	return(-1);
+}
+
+/****************************** M31_ShmSubInit ******************************
+ *
+ *  Description: Init a subscriber cursor
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle
+ *               sub		subscriber cursor
+ *               oldest		start at oldest record in ring (1) or at
+ *							the next published record (0)
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void M31_ShmSubInit(
+	M31_SHM *shm,
+	M31_SHM_SUB *sub,
+	int oldest)
+{
+	u_int32 head = LOAD_ACQ(HEAD(shm));
+
+	memset(sub, 0, sizeof(*sub));
+	sub->cursor = head;
+
+	if (oldest)
+		sub->cursor = (head > shm->mask) ? head - shm->mask : 0;
+}
+
+/******************************* M31_ShmRead ********************************
+ *
+ *  Description: Read events (subscriber)
+ *
+ *               Never blocks. If the publisher lapped the cursor, the
+ *               overwritten records are added to sub->lost and reading
+ *               continues at the oldest valid record.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle
+ *               sub		subscriber cursor
+ *               ev			event buffer
+ *               max		max nr of events
+ *  Output.....: return		nr of events read
+ *  Globals....: -
+ ****************************************************************************/
+u_int32 M31_ShmRead(
+	M31_SHM *shm,
+	M31_SHM_SUB *sub,
+	M31_EVENT *ev,
+	u_int32 max)
+{
+	const M31_SHM_REC	*rec;
+	u_int32				head, seq, n = 0;
+
+	head = LOAD_ACQ(HEAD(shm));
+
+	while (n < max && sub->cursor != head) {
+		/* lapped by the publisher ? */
+		if (head - sub->cursor > shm->mask) {
+			sub->lost += head - shm->mask - sub->cursor;
+			sub->overruns++;
+			sub->cursor = head - shm->mask;
+		}
+
+		rec = &shm->rec[sub->cursor & shm->mask];
+		seq = LOAD_ACQ(&rec->seq);
+		ev[n] = rec->ev;
+		FENCE_ACQ();
+
+		if (seq != sub->cursor + 1 || LOAD_RLX(&rec->seq) != seq) {
+			/* overwritten during copy, resync with the new head */
+			head = LOAD_ACQ(HEAD(shm));
+			if (head - sub->cursor <= shm->mask)
+				head = sub->cursor + shm->mask + 1;
+			continue;
+		}
+
+		sub->cursor++;
+		n++;
+	}
+
+	sub->read += n;
+	return(n);
+}
+
+/***************************** M31_ShmStateGet ******************************
+ *
+ *  Description: Get the current state of a device (subscriber)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle
+ *               dev		device index
+ *  Output.....: st			consistent copy of the state
+ *  Globals....: -
+ ****************************************************************************/
+void M31_ShmStateGet(
+	M31_SHM *shm,
+	u_int8 dev,
+	M31_SHM_STATE *st)
+{
+	const M31_SHM_STATE	*src = &shm->hdr->state[dev];
+	u_int32				seq;
+
+	do {
+		while ((seq = LOAD_ACQ(&src->seq)) & 1)
+			;
+		*st = *src;
+		FENCE_ACQ();
+	} while (LOAD_RLX(&src->seq) != seq);
+
+	st->seq = seq;
+}
+
+/******************************* M31_ShmAlive *******************************
+ *
+ *  Description: Check if the publisher of the ring is running
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle
+ *  Output.....: return		1: running, 0: closed or terminated
+ *  Globals....: -
+ ****************************************************************************/
+int M31_ShmAlive(M31_SHM *shm)
+{
+	pid_t pid = (pid_t)LOAD_ACQ(&shm->hdr->pid);
+
+	if (pid == 0)
+		return(0);
+
+	/* EPERM: running under another user */
+	return(kill(pid, 0) == 0 || errno == EPERM);
+}
+
+/******************************* M31_ShmClose *******************************
+ *
+ *  Description: Unmap the ring
+ *
+ *               The publisher marks the ring closed and removes the
+ *               object name; mapped subscribers keep their view.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void M31_ShmClose(M31_SHM *shm)
+{
+	if (shm->hdr) {
+		if (shm->pub) {
+			STORE_REL(&shm->hdr->pid, 0);
+			shm_unlink(shm->name);
+		}
+		munmap((void*)shm->hdr, (size_t)shm->size);
+	}
+	else if (shm->pub)
+		shm_unlink(shm->name);
+
+	if (shm->fd >= 0)
+		close(shm->fd);
+
+	shm->hdr = NULL;
+	shm->rec = NULL;
+	shm->fd  = -1;
+	shm->pub = 0;
+}
+
+/*********************************** Map ************************************
+ *
+ *  Description: Map the object
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle (fd, size set)
+ *               prot		mmap protection
+ *  Output.....: return		0 | -1 (errno)
+ *  Globals....: -
+ ****************************************************************************/
+static int32 Map(M31_SHM *shm, int prot)	/* nodoc */
+{
+	void *map;
+
+	if ((map = mmap(NULL, (size_t)shm->size, prot, MAP_SHARED, shm->fd, 0))
+		== MAP_FAILED)
+		return(-1);
+
+	shm->hdr = (M31_SHM_HDR*)map;
+	shm->rec = (M31_SHM_REC*)((u_int8*)map + HDR_ALIGN);
+	return(0);
+}
+
+/******************************* StateUpdate ********************************
+ *
+ *  Description: Write a device state under its sequence lock
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: st			device state
+ *               state..lost	new values
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void StateUpdate(	/* nodoc */
+	M31_SHM_STATE *st,
+	u_int32 state,
+	u_int32 tsHigh,
+	u_int32 tsLow,
+	u_int32 events,
+	u_int32 lost)
+{
+	u_int32 seq = st->seq;
+
+	STORE_RLX(&st->seq, seq + 1);
+	FENCE_REL();
+	st->state  = state;
+	st->tsHigh = tsHigh;
+	st->tsLow  = tsLow;
+	st->events = events;
+	st->lost   = lost;
+	STORE_REL(&st->seq, seq + 2);
+}
@@ -0,0 +1,295 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    M31_CAP                         ************
+ ************                                                    ************
+ ****************************************************************************
+ *  
+ *       Author: ds
+ *
+ *  Description: Capture input waveforms with the M31 driver capture mode
+ *
+ *               Configures period, trigger and pre-trigger depth, starts
+ *               the capture and drains the samples in large blocks. The
+ *               samples are printed or written to a binary file, either
+ *               raw or run length encoded (see m31_rle.h). With -e the
+ *               rising and falling edges per channel are counted
+ *               (m31_bits.h).
+ *                      
+ *     Required: libraries: mdis_api, usr_oss, usr_utl, m31_util
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/m31_drv.h>
+#include <MEN/m31_bits.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define BLK_SAMPLES		4096	/* nr of samples per M_getblock call */
+#define POLL_MSEC		20		/* delay if no samples pending */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void PrintMdisError(char *info);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *			   
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m31_cap [<opts>] <device> [<opts>]\n");
+	printf("Function: Capture input waveforms (descriptor CAP_BUF_SIZE > 0)\n");
+	printf("Options:\n");
+	printf("    device       device name\n");
+	printf("    -p=<us>      sample period [us], >= OSS tick   [driver]\n");
+	printf("    -m=<hex>     trigger mask                      [0]\n");
+	printf("    -v=<hex>     trigger value                     [0]\n");
+	printf("    -t=<n>       pre-trigger samples               [0]\n");
+	printf("    -n=<n>       nr of samples to capture          [1000]\n");
+	printf("    -r           run length encoded format (M31_CAPFMT_RLE)\n");
+	printf("    -o=<file>    write samples (u_int16) or runs (M31_RLE_REC)\n");
+	printf("                 to binary file\n");
+	printf("    -e           print rising/falling edges per channel\n");
+	printf("\n");
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *			   
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	MDIS_PATH		path = -1;
+	M_SG_BLOCK		blk;
+	M31_CAP_INFO	info;
+	u_int16			buf[BLK_SAMPLES], states[BLK_SAMPLES], prev = 0;
+	u_int32			rise[16], fall[16];
+	M31_RLE_REC		*rec = (M31_RLE_REC*)buf;
+	char			*device, *str, *errstr, *outFile, errbuf[40];
+	int32			n, i, nbr, total = 0, ret = 1;
+	int32			period, preTrig, rle, size, edges;
+	u_int32			trigMask, trigValue;
+	FILE			*fp = NULL;
+
+	/*--------------------+
+	|  check arguments    |
+	+--------------------*/
+	if ((errstr = UTL_ILLIOPT("p=m=v=t=n=o=re?", errbuf))) {
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {
+		usage();
+		return(1);
+	}
+
+	for (device=NULL, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+
+	if (!device) {
+		usage();
+		return(1);
+	}
+
+	period    = ((str = UTL_TSTOPT("p=")) ? atoi(str) : 0);
+	trigMask  = ((str = UTL_TSTOPT("m=")) ? strtoul(str, NULL, 16) : 0);
+	trigValue = ((str = UTL_TSTOPT("v=")) ? strtoul(str, NULL, 16) : 0);
+	preTrig   = ((str = UTL_TSTOPT("t=")) ? atoi(str) : 0);
+	nbr       = ((str = UTL_TSTOPT("n=")) ? atoi(str) : 1000);
+	outFile   = UTL_TSTOPT("o=");
+	rle       = (UTL_TSTOPT("r") ? 1 : 0);
+	edges     = (UTL_TSTOPT("e") ? 1 : 0);
+
+	memset(rise, 0, sizeof(rise));
+	memset(fall, 0, sizeof(fall));
+
+	if (outFile && (fp = fopen(outFile, "wb")) == NULL) {
+		printf("*** can't open %s\n", outFile);
+		return(1);
+	}
+
+	/*--------------------+
+	|  open path          |
+	+--------------------*/
+	if ((path = M_open(device)) < 0) {
+		PrintMdisError("open");
+		goto cleanup;
+	}
+
+	/*--------------------+
+	|  configure, start   |
+	+--------------------*/
+	if ((period && M_setstat(path, M31_CAP_PERIOD, period) < 0) ||
+		(M_setstat(path, M31_CAP_TRIG_MASK, trigMask)) < 0 ||
+		(M_setstat(path, M31_CAP_TRIG_VALUE, trigValue)) < 0 ||
+		(M_setstat(path, M31_CAP_PRETRIG, preTrig)) < 0 ||
+		(M_setstat(path, M31_CAP_FORMAT,
+				   rle ? M31_CAPFMT_RLE : M31_CAPFMT_RAW)) < 0) {
+		PrintMdisError("setstat M31_CAP_xxx");
+		goto cleanup;
+	}
+
+	if ((M_setstat(path, M31_BLK_MODE, M31_BLKMODE_CAPTURE)) < 0) {
+		PrintMdisError("setstat M31_BLK_MODE");
+		goto cleanup;
+	}
+
+	if ((M_setstat(path, M31_CAP_CTRL, M31_CAP_START)) < 0) {
+		PrintMdisError("setstat M31_CAP_CTRL");
+		goto cleanup;
+	}
+
+	printf("Capturing %d samples... (Press Key to abort)\n", (int)nbr);
+
+	/*--------------------+
+	|  drain samples      |
+	+--------------------*/
+	while (total < nbr) {
+		/* a run may hold more samples than requested */
+		n = (nbr - total) < BLK_SAMPLES ? (nbr - total) : BLK_SAMPLES;
+		size = rle ? (int32)sizeof(buf) : n * 2;
+
+		if ((n = M_getblock(path, (u_int8*)buf, size)) < 0) {
+			PrintMdisError("getblock");
+			break;
+		}
+		n /= (rle ? sizeof(M31_RLE_REC) : 2);
+
+		if (n == 0) {
+			if (UOS_KeyPressed() >= 0)
+				break;
+			UOS_Delay(POLL_MSEC);
+			continue;
+		}
+
+		/* no edge before the first sample */
+		if (edges && total == 0)
+			prev = rle ? rec[0].state : buf[0];
+
+		if (rle) {
+			for (i=0; i<n; i++) {
+				if (!fp)
+					printf("%8d: 0x%04x x %u\n", (int)total, rec[i].state,
+						   (unsigned)rec[i].count);
+				total += rec[i].count;
+				states[i] = rec[i].state;
+			}
+			if (fp)
+				fwrite(rec, sizeof(M31_RLE_REC), n, fp);
+
+			/* each run is one state, edges are between runs */
+			if (edges) {
+				M31_BitsTally(states, n, prev, rise, fall);
+				prev = states[n-1];
+			}
+			continue;
+		}
+
+		if (edges) {
+			M31_BitsTally(buf, n, prev, rise, fall);
+			prev = buf[n-1];
+		}
+
+		if (fp)
+			fwrite(buf, sizeof(u_int16), n, fp);
+		else
+			for (i=0; i<n; i++)
+				printf("%8d: 0x%04x\n", (int)(total + i), buf[i]);
+
+		total += n;
+	}
+
+	M_setstat(path, M31_CAP_CTRL, M31_CAP_STOP);
+
+	/*--------------------+
+	|  print info         |
+	+--------------------*/
+	blk.size = sizeof(info);
+	blk.data = (void*)&info;
+	if (M_getstat(path, M31_BLK_CAP_INFO, (int32*)&blk) < 0) {
+		PrintMdisError("getstat M31_BLK_CAP_INFO");
+		goto cleanup;
+	}
+
+	printf("samples read    : %d\n", (int)total);
+	printf("sample period   : %u us\n", (unsigned)info.period);
+	printf("pre-trigger     : %u\n", (unsigned)info.preTrig);
+	printf("samples lost    : %u\n", (unsigned)info.lost);
+	printf("sampling gaps   : %u\n", (unsigned)info.gaps);
+
+	if (edges) {
+		printf("edges (%s):\n", M31_BitsName());
+		for (i=0; i<16; i++)
+			printf("  ch %2d: %8u rising, %8u falling\n", (int)i,
+				   (unsigned)rise[i], (unsigned)fall[i]);
+	}
+
+	ret = 0;
+
+	/*--------------------+
+	|  cleanup            |
+	+--------------------*/
+	cleanup:
+	if (fp)
+		fclose(fp);
+
+	if (path >= 0 && M_close(path) < 0)
+		PrintMdisError("close");
+
+	return(ret);
+}
+
+/********************************* PrintMdisError ***************************
+ *
+ *  Description: Print MDIS error message
+ *			   
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintMdisError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
@@ -0,0 +1,380 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    M31_MERGE                       ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Print the edges of several M31 devices in global time order
+ *
+ *               Opens the devices in block mode M31_BLKMODE_EVENT, drains
+ *               the event FIFOs on each driver signal and merges the
+ *               events online (see m31_merge.h) into one stream of edges
+ *               in timestamp order, tagged with device and channel.
+ *
+ *               Latency is bounded by -l: an event is printed at the
+ *               latest when an event <latency> newer was read from any
+ *               device. Devices whose FIFO was drained get the newest
+ *               timestamp read before as watermark, so idle devices
+ *               normally hold back nothing; if all devices are idle
+ *               longer than <latency>, the queues are flushed. Memory is
+ *               bounded by the queue size (-s) per device; the reader
+ *               reads at most the free queue space of a device.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl, m31_util
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/m31_drv.h>
+#include <MEN/m31_merge.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define BLK_EVENTS		1024	/* max nr of events per M_getblock call */
+#define GET_RECS		1024	/* nr of records per M31_MergeGet call */
+#define POLL_MSEC		1		/* delay if no signal pending */
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static volatile u_int32 G_SigCount;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void __MAPILIB SigHandler(u_int32 sigCode);
+static void PrintMdisError(char *info);
+static u_int32 Output(M31_MERGE *m, int flush, int quiet, char **name,
+					  u_int32 freq);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m31_merge [<opts>] <device> [<device>...]\n");
+	printf("Function: Print the edges of M31 devices in time order\n");
+	printf("Options:\n");
+	printf("    device       device name (max. %d)\n", M31_MERGE_DEV_MAX);
+	printf("    -l=<ms>      max latency [ms]         [10]\n");
+	printf("    -s=<n>       queue size [events/dev]  [4096]\n");
+	printf("    -q           quiet, print record rate per second only\n");
+	printf("\n");
+	printf("Times are seconds of the driver timestamp (M31_TS_FREQ).\n");
+	printf("\n");
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_SigCount
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	MDIS_PATH	path[M31_MERGE_DEV_MAX];
+	char		*name[M31_MERGE_DEV_MAX];
+	u_int32		events[M31_MERGE_DEV_MAX];
+	M31_MERGE	m;
+	M31_EVENT	buf[BLK_EVENTS];
+	u_int64		newest;
+	u_int32		latMs, qSize, tsFreq = 0, lastPoll, lastEv,
+				lastSec, cnt = 0, nr, n;
+	char		*str, *errstr, errbuf[40];
+	int32		nrDev = 0, dev, len, freq;
+	int			i, quiet, mergeInit = 0, ret = 1;
+
+	if ((errstr = UTL_ILLIOPT("l=s=q?", errbuf))) {
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	latMs = ((str = UTL_TSTOPT("l=")) ? atoi(str) : 10);
+	qSize = ((str = UTL_TSTOPT("s=")) ? atoi(str) : 4096);
+	quiet = (UTL_TSTOPT("q") ? 1 : 0);
+
+	for (i=1; i<argc; i++) {
+		if (*argv[i] == '-')
+			continue;
+		if (nrDev == M31_MERGE_DEV_MAX) {
+			printf("*** max. %d devices\n", M31_MERGE_DEV_MAX);
+			return(1);
+		}
+		name[nrDev++] = argv[i];
+	}
+
+	if (UTL_TSTOPT("?") || !nrDev) {
+		usage();
+		return(1);
+	}
+
+	for (dev=0; dev<nrDev; dev++) {
+		path[dev]   = -1;
+		events[dev] = 0;
+	}
+
+	/*--------------------+
+	|  install signal     |
+	+--------------------*/
+	if (UOS_SigInit(SigHandler) || UOS_SigInstall(UOS_SIG_USR1)) {
+		printf("*** can't install signal: %s\n",
+			   UOS_ErrString(UOS_ErrnoGet()));
+		UOS_SigExit();
+		return(1);
+	}
+
+	/*--------------------+
+	|  open devices       |
+	+--------------------*/
+	for (dev=0; dev<nrDev; dev++) {
+		if ((path[dev] = M_open(name[dev])) < 0) {
+			PrintMdisError("open");
+			goto cleanup;
+		}
+
+		/* one time base for all devices */
+		if (M_getstat(path[dev], M31_TS_FREQ, &freq) < 0) {
+			PrintMdisError("getstat M31_TS_FREQ");
+			goto cleanup;
+		}
+		if (dev && (u_int32)freq != tsFreq) {
+			printf("*** %s: different timestamp frequency\n", name[dev]);
+			goto cleanup;
+		}
+		tsFreq = freq;
+	}
+
+	if (M31_MergeInit(&m, nrDev, qSize,
+					  (u_int64)tsFreq * latMs / 1000) < 0) {
+		printf("*** can't init merge: %s\n", strerror(errno));
+		goto cleanup;
+	}
+	mergeInit = 1;
+
+	for (dev=0; dev<nrDev; dev++) {
+		if (M_setstat(path[dev], M31_BLK_MODE, M31_BLKMODE_EVENT) < 0 ||
+			M_setstat(path[dev], M31_SIGSET, UOS_SIG_USR1) < 0 ||
+			M_setstat(path[dev], M_MK_IRQ_ENABLE, 1) < 0) {
+			PrintMdisError("setstat");
+			goto cleanup;
+		}
+	}
+
+	printf("Merging %d device(s), queue %u events/dev, latency %u ms... "
+		   "(Press Key to abort)\n", (int)nrDev, (unsigned)m.size,
+		   (unsigned)latMs);
+
+	/*--------------------+
+	|  read and merge     |
+	+--------------------*/
+	lastPoll = lastEv = lastSec = UOS_MsecTimerGet();
+
+	while (UOS_KeyPressed() < 0) {
+		if (!G_SigCount &&
+			UOS_MsecTimerGet() - lastPoll < latMs) {
+			UOS_Delay(POLL_MSEC);
+			continue;
+		}
+		G_SigCount = 0;
+		lastPoll   = UOS_MsecTimerGet();
+
+		/*
+		 * Events older than a timestamp already read are in the FIFO
+		 * of their device by now (except an ISR running on another
+		 * CPU; the slack covers this): a drained device is marked.
+		 */
+		newest = m.newest;
+
+		for (dev=0; dev<nrDev; dev++) {
+			do {
+				nr = M31_MergeFree(&m, (u_int8)dev);
+				if (nr > BLK_EVENTS)
+					nr = BLK_EVENTS;
+				if (!nr)
+					break;
+
+				if ((len = M_getblock(path[dev], (u_int8*)buf,
+									  nr * sizeof(M31_EVENT))) < 0) {
+					PrintMdisError("getblock");
+					goto cleanup;
+				}
+				n = len / sizeof(M31_EVENT);
+				M31_MergePut(&m, (u_int8)dev, buf, n);
+				events[dev] += n;
+
+				if (n)
+					lastEv = UOS_MsecTimerGet();
+				if (n < nr)
+					M31_MergeMark(&m, (u_int8)dev, newest);
+
+				/* block full: release what is possible to make room */
+				if (n == nr)
+					cnt += Output(&m, 0, quiet, name, tsFreq);
+			} while (n == nr);
+		}
+
+		/* all devices idle for <latency>: nothing older can follow */
+		cnt += Output(&m, UOS_MsecTimerGet() - lastEv >= latMs, quiet,
+					  name, tsFreq);
+
+		if (quiet && UOS_MsecTimerGet() - lastSec >= 1000) {
+			printf("%u records/s, %u late\n", (unsigned)cnt,
+				   (unsigned)m.late);
+			cnt = 0;
+			lastSec = UOS_MsecTimerGet();
+		}
+	}
+
+	/*--------------------+
+	|  print statistics   |
+	+--------------------*/
+	Output(&m, 1, quiet, name, tsFreq);
+
+	for (dev=0; dev<nrDev; dev++)
+		printf("%-16s: %u events, max queue fill %u\n", name[dev],
+			   (unsigned)events[dev], (unsigned)m.dev[dev].maxUsed);
+	printf("%u late event(s) (increase -l)\n", (unsigned)m.late);
+
+	ret = 0;
+
+	/*--------------------+
+	|  cleanup            |
+	+--------------------*/
+	cleanup:
+	for (dev=0; dev<nrDev; dev++) {
+		if (path[dev] < 0)
+			continue;
+		M_setstat(path[dev], M_MK_IRQ_ENABLE, 0);
+		M_setstat(path[dev], M31_SIGCLR, 0);
+		if (M_close(path[dev]) < 0)
+			PrintMdisError("close");
+	}
+
+	if (mergeInit)
+		M31_MergeExit(&m);
+
+	UOS_SigExit();
+
+	return(ret);
+}
+
+/********************************* Output ***********************************
+ *
+ *  Description: Print the merged records that can be released
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: m			merge state
+ *               flush		release all queued events
+ *               quiet		count only
+ *               name		device names
+ *               freq		timestamp frequency [Hz]
+ *  Output.....: return		nr of records
+ *  Globals....: -
+ ****************************************************************************/
+static u_int32 Output(
+	M31_MERGE *m,
+	int flush,
+	int quiet,
+	char **name,
+	u_int32 freq)
+{
+	static M31_MERGE_REC	rec[GET_RECS];
+	static const char		*edge[] = { "fall", "rise", "lost edge?",
+										"rule", "field" };
+	const M31_MERGE_REC		*r;
+	u_int32					n, i, cnt = 0;
+	double					s;
+
+	while ((n = M31_MergeGet(m, rec, GET_RECS, flush)) != 0) {
+		cnt += n;
+		if (quiet)
+			continue;
+
+		for (i=0; i<n; i++) {
+			r = &rec[i];
+			s = (double)(((u_int64)r->tsHigh << 32) | r->tsLow) / freq;
+
+			if (r->flags & M31_EVF_OVERRUN)
+				printf("*** %s: events lost in driver before seq %u\n",
+					   name[r->dev], (unsigned)r->seq);
+
+			if (r->ch == M31_MERGE_NO_CH)
+				printf("%14.6f s  %-16s        %s\n", s, name[r->dev],
+					   edge[r->edge]);
+			else if (r->edge == M31_MERGE_RULE)
+				printf("%14.6f s  %-16s rule %d %s\n", s, name[r->dev],
+					   (int)r->ch, (r->flags & M31_EVF_VIOLATED) ?
+					   "violated" : "done");
+			else
+				printf("%14.6f s  %-16s ch %2d  %s\n", s, name[r->dev],
+					   (int)r->ch, edge[r->edge]);
+		}
+	}
+	return(cnt);
+}
+
+/******************************* SigHandler *********************************
+ *
+ *  Description: Signal handler (counts UOS_SIG_USR1)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: sigCode	signal code received
+ *  Output.....: -
+ *  Globals....: G_SigCount
+ ****************************************************************************/
+static void __MAPILIB SigHandler(u_int32 sigCode)
+{
+	if (sigCode == UOS_SIG_USR1)
+		G_SigCount++;
+}
+
+/********************************* PrintMdisError ***************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintMdisError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
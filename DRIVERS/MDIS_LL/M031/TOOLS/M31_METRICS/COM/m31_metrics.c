@@ -0,0 +1,564 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    M31_METRICS                     ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Serve the counters of M31 devices as text metrics
+ *
+ *               Polls the counters of one or more devices once per
+ *               interval and serves them on a local Unix socket in the
+ *               Prometheus text format. Per device and poll, four block
+ *               getstats are made (M31_BLK_COUNTERS, M31_BLK_ISR_STAT,
+ *               M31_BLK_LOST_EDGES, M31_BLK_GLITCHES); none of them
+ *               clears driver state, so applications using the devices
+ *               are not affected. A fifth, M31_BLK_LOCK_STAT, adds the
+ *               device lock statistics with the driver variant
+ *               m31_ownlock. Clients get the text of the last poll and
+ *               cause no driver calls:
+ *
+ *                 curl --unix-socket /var/run/m31_metrics.sock http://x/
+ *                 socat - UNIX-CONNECT:/var/run/m31_metrics.sock
+ *
+ *               A request starting with "GET" is answered with an HTTP
+ *               header, any other client gets the plain text.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/m31_drv.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define SOCK_PATH		"/var/run/m31_metrics.sock"
+#define DEV_MAX			16		/* max nr of devices */
+#define TEXT_SIZE		0x100000	/* metrics text buffer */
+#define LABEL_LEN		80		/* max metric labels length */
+#define REQ_MSEC		100		/* wait for a client request */
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/* counters of one device (last poll) */
+typedef struct {
+	char			*name;			/* device name */
+	MDIS_PATH		path;			/* MDIS path */
+	u_int32			freq;			/* timestamp frequency [Hz] */
+	int				up;				/* last poll succeeded */
+	M31_COUNTERS	cnt;			/* activity counters */
+	M31_ISR_STAT	isr;			/* ISR timing */
+	M31_LOST_STAT	lost;			/* lost edges */
+	u_int32			glitches[16];	/* suppressed glitches */
+	int				lockUp;			/* lock statistics available */
+	M31_LOCK_STAT	lock[M31_LOCK_EP_NUM];	/* lock statistics */
+} DEV;
+
+/* counter of M31_COUNTERS */
+typedef struct {
+	const char	*name;
+	const char	*help;
+	const char	*type;
+	u_int32		offs;				/* offset in M31_COUNTERS */
+} METRIC;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static const METRIC G_metric[] = {
+	{ "m31_irqs_total", "Interrupts", "counter",
+	  offsetof(M31_COUNTERS, irqs) },
+	{ "m31_signals_sent_total", "Signals sent", "counter",
+	  offsetof(M31_COUNTERS, sigSent) },
+	{ "m31_signals_deferred_total", "Signals deferred by coalescing",
+	  "counter", offsetof(M31_COUNTERS, sigDeferred) },
+	{ "m31_events_total", "Event records stored", "counter",
+	  offsetof(M31_COUNTERS, events) },
+	{ "m31_events_pending", "Event records pending", "gauge",
+	  offsetof(M31_COUNTERS, eventPending) },
+	{ "m31_events_lost_total", "Event records lost (FIFO full)",
+	  "counter", offsetof(M31_COUNTERS, eventLost) },
+	{ "m31_lost_irqs_total", "Interrupts without visible change",
+	  "counter", offsetof(M31_COUNTERS, lostIrqs) },
+	{ "m31_strobe_lost_total", "Strobed words lost (FIFO full)",
+	  "counter", offsetof(M31_COUNTERS, strobeLost) },
+};
+
+static const char *G_lockEp[M31_LOCK_EP_NUM] = {
+	"read", "write", "setstat", "getstat", "blockread", "blockwrite"
+};
+
+static char		G_text[TEXT_SIZE];	/* metrics text of last poll */
+static u_int32	G_len;				/* length of text */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void PrintMdisError(char *info);
+static void Poll(DEV *dev);
+static void Render(DEV *dev, int32 nrDev);
+static void Out(const char *fmt, ...);
+static void OutHist(const char *name, const char *labels, u_int32 *hist,
+					u_int32 count, u_int32 freq);
+static void Serve(int fd);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m31_metrics [<opts>] <device> [<device>...]\n");
+	printf("Function: Serve M31 counters as text metrics on a Unix socket\n");
+	printf("Options:\n");
+	printf("    device       device name (max. %d)\n", DEV_MAX);
+	printf("    -s=<path>    socket path     [%s]\n", SOCK_PATH);
+	printf("    -t=<ms>      poll interval   [1000]\n");
+	printf("\n");
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	DEV					dev[DEV_MAX];
+	struct sockaddr_un	addr;
+	struct timeval		tv;
+	fd_set				rd;
+	u_int32				pollMs, lastPoll, wait;
+	char				*str, *errstr, *sock, errbuf[40];
+	int32				nrDev = 0, d, freq;
+	int					i, fd = -1, cfd, ret = 1;
+
+	if ((errstr = UTL_ILLIOPT("s=t=?", errbuf))) {
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	sock   = ((str = UTL_TSTOPT("s=")) ? str : SOCK_PATH);
+	pollMs = ((str = UTL_TSTOPT("t=")) ? atoi(str) : 1000);
+
+	memset(dev, 0, sizeof(dev));
+	for (i=1; i<argc; i++) {
+		if (*argv[i] == '-')
+			continue;
+		if (nrDev == DEV_MAX) {
+			printf("*** max. %d devices\n", DEV_MAX);
+			return(1);
+		}
+		dev[nrDev++].name = argv[i];
+	}
+
+	if (UTL_TSTOPT("?") || !nrDev || !pollMs ||
+		strlen(sock) >= sizeof(addr.sun_path)) {
+		usage();
+		return(1);
+	}
+
+	for (d=0; d<nrDev; d++)
+		dev[d].path = -1;
+
+	/*--------------------+
+	|  open devices       |
+	+--------------------*/
+	for (d=0; d<nrDev; d++) {
+		if ((dev[d].path = M_open(dev[d].name)) < 0) {
+			PrintMdisError("open");
+			goto cleanup;
+		}
+		if (M_getstat(dev[d].path, M31_TS_FREQ, &freq) < 0) {
+			PrintMdisError("getstat M31_TS_FREQ");
+			goto cleanup;
+		}
+		dev[d].freq = freq;
+	}
+
+	/*--------------------+
+	|  create socket      |
+	+--------------------*/
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, sock);
+	unlink(sock);
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0 ||
+		bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+		listen(fd, 8) < 0) {
+		printf("*** can't create socket %s: %s\n", sock, strerror(errno));
+		goto cleanup;
+	}
+
+	printf("Serving %d device(s) on %s, poll interval %u ms... "
+		   "(Press Key to abort)\n", (int)nrDev, sock, (unsigned)pollMs);
+
+	/*--------------------+
+	|  poll and serve     |
+	+--------------------*/
+	lastPoll = UOS_MsecTimerGet() - pollMs;
+
+	while (UOS_KeyPressed() < 0) {
+		if (UOS_MsecTimerGet() - lastPoll >= pollMs) {
+			lastPoll = UOS_MsecTimerGet();
+			for (d=0; d<nrDev; d++)
+				Poll(&dev[d]);
+			Render(dev, nrDev);
+		}
+
+		/* wait for clients until the next poll (at most 100 ms to
+		   check the keyboard) */
+		wait = pollMs - (UOS_MsecTimerGet() - lastPoll);
+		if (wait > pollMs)
+			wait = 0;
+		if (wait > 100)
+			wait = 100;
+
+		FD_ZERO(&rd);
+		FD_SET(fd, &rd);
+		tv.tv_sec  = 0;
+		tv.tv_usec = wait * 1000;
+
+		if (select(fd + 1, &rd, NULL, NULL, &tv) > 0 &&
+			(cfd = accept(fd, NULL, NULL)) >= 0) {
+			Serve(cfd);
+			close(cfd);
+		}
+	}
+
+	ret = 0;
+
+	/*--------------------+
+	|  cleanup            |
+	+--------------------*/
+	cleanup:
+	if (fd >= 0) {
+		close(fd);
+		unlink(sock);
+	}
+
+	for (d=0; d<nrDev; d++) {
+		if (dev[d].path >= 0 && M_close(dev[d].path) < 0)
+			PrintMdisError("close");
+	}
+
+	return(ret);
+}
+
+/********************************** Poll ************************************
+ *
+ *  Description: Read the counters of a device
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: dev		device
+ *  Output.....: dev		counters, up
+ *  Globals....: -
+ ****************************************************************************/
+static void Poll(DEV *dev)
+{
+	M_SG_BLOCK blk;
+
+	dev->up = 0;
+
+	blk.size = sizeof(dev->cnt);
+	blk.data = (void*)&dev->cnt;
+	if (M_getstat(dev->path, M31_BLK_COUNTERS, (int32*)&blk) < 0)
+		return;
+
+	blk.size = sizeof(dev->isr);
+	blk.data = (void*)&dev->isr;
+	if (M_getstat(dev->path, M31_BLK_ISR_STAT, (int32*)&blk) < 0)
+		return;
+
+	blk.size = sizeof(dev->lost);
+	blk.data = (void*)&dev->lost;
+	if (M_getstat(dev->path, M31_BLK_LOST_EDGES, (int32*)&blk) < 0)
+		return;
+
+	blk.size = sizeof(dev->glitches);
+	blk.data = (void*)dev->glitches;
+	if (M_getstat(dev->path, M31_BLK_GLITCHES, (int32*)&blk) < 0)
+		return;
+
+	/* optional (M31_OWN_LOCK) */
+	blk.size = sizeof(dev->lock);
+	blk.data = (void*)dev->lock;
+	dev->lockUp = (M_getstat(dev->path, M31_BLK_LOCK_STAT,
+							 (int32*)&blk) >= 0);
+
+	dev->up = 1;
+}
+
+/********************************* Render ***********************************
+ *
+ *  Description: Format the counters of all devices as metrics text
+ *
+ *               Samples of one metric are grouped, as required by the
+ *               format. Devices whose last poll failed only report
+ *               m31_up 0. The ISR time and the lock wait/hold times are
+ *               histograms in seconds with the log2 buckets of the
+ *               driver, all buckets always (no _sum, the driver keeps no
+ *               total time).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: dev		devices
+ *               nrDev		nr of devices
+ *  Output.....: -
+ *  Globals....: G_text, G_len
+ ****************************************************************************/
+static void Render(DEV *dev, int32 nrDev)
+{
+	const METRIC	*m;
+	char			labels[LABEL_LEN];
+	u_int32			i, n;
+	int32			d;
+
+	G_len = 0;
+
+	Out("# HELP m31_up Last poll of the device succeeded\n"
+		"# TYPE m31_up gauge\n");
+	for (d=0; d<nrDev; d++)
+		Out("m31_up{dev=\"%s\"} %d\n", dev[d].name, dev[d].up);
+
+	/* scalar counters */
+	for (i=0; i<sizeof(G_metric)/sizeof(G_metric[0]); i++) {
+		m = &G_metric[i];
+		Out("# HELP %s %s\n# TYPE %s %s\n", m->name, m->help, m->name,
+			m->type);
+		for (d=0; d<nrDev; d++)
+			if (dev[d].up)
+				Out("%s{dev=\"%s\"} %u\n", m->name, dev[d].name,
+					(unsigned)*(u_int32*)((u_int8*)&dev[d].cnt + m->offs));
+	}
+
+	/* per channel counters */
+	Out("# HELP m31_changes_total Level changes per channel\n"
+		"# TYPE m31_changes_total counter\n");
+	for (d=0; d<nrDev; d++)
+		for (n=0; dev[d].up && n<16; n++)
+			Out("m31_changes_total{dev=\"%s\",ch=\"%u\"} %u\n",
+				dev[d].name, (unsigned)n, (unsigned)dev[d].cnt.changes[n]);
+
+	Out("# HELP m31_lost_edges_total Possible lost edges per channel\n"
+		"# TYPE m31_lost_edges_total counter\n");
+	for (d=0; d<nrDev; d++)
+		for (n=0; dev[d].up && n<16; n++)
+			Out("m31_lost_edges_total{dev=\"%s\",ch=\"%u\"} %u\n",
+				dev[d].name, (unsigned)n, (unsigned)dev[d].lost.ch[n]);
+
+	Out("# HELP m31_glitches_total Suppressed glitches per channel\n"
+		"# TYPE m31_glitches_total counter\n");
+	for (d=0; d<nrDev; d++)
+		for (n=0; dev[d].up && n<16; n++)
+			Out("m31_glitches_total{dev=\"%s\",ch=\"%u\"} %u\n",
+				dev[d].name, (unsigned)n, (unsigned)dev[d].glitches[n]);
+
+	/* ISR execution time */
+	Out("# HELP m31_isr_seconds_max Max ISR execution time\n"
+		"# TYPE m31_isr_seconds_max gauge\n");
+	for (d=0; d<nrDev; d++)
+		if (dev[d].up)
+			Out("m31_isr_seconds_max{dev=\"%s\"} %.9f\n", dev[d].name,
+				(double)dev[d].isr.max / dev[d].freq);
+
+	Out("# HELP m31_isr_seconds ISR execution time\n"
+		"# TYPE m31_isr_seconds histogram\n");
+	for (d=0; d<nrDev; d++) {
+		if (!dev[d].up)
+			continue;
+		snprintf(labels, sizeof(labels), "dev=\"%s\"", dev[d].name);
+		OutHist("m31_isr_seconds", labels, dev[d].isr.hist,
+				dev[d].isr.count, dev[d].freq);
+	}
+
+	/* device lock (M31_OWN_LOCK) */
+	Out("# HELP m31_lock_calls_total Entry point calls with device lock\n"
+		"# TYPE m31_lock_calls_total counter\n");
+	for (d=0; d<nrDev; d++)
+		for (n=0; dev[d].up && dev[d].lockUp && n<M31_LOCK_EP_NUM; n++)
+			Out("m31_lock_calls_total{dev=\"%s\",ep=\"%s\"} %u\n",
+				dev[d].name, G_lockEp[n], (unsigned)dev[d].lock[n].count);
+
+	Out("# HELP m31_lock_contended_total Calls which found the device "
+		"lock taken\n"
+		"# TYPE m31_lock_contended_total counter\n");
+	for (d=0; d<nrDev; d++)
+		for (n=0; dev[d].up && dev[d].lockUp && n<M31_LOCK_EP_NUM; n++)
+			Out("m31_lock_contended_total{dev=\"%s\",ep=\"%s\"} %u\n",
+				dev[d].name, G_lockEp[n],
+				(unsigned)dev[d].lock[n].contended);
+
+	Out("# HELP m31_lock_wait_seconds Wait time for the device lock\n"
+		"# TYPE m31_lock_wait_seconds histogram\n");
+	for (d=0; d<nrDev; d++)
+		for (n=0; dev[d].up && dev[d].lockUp && n<M31_LOCK_EP_NUM; n++) {
+			snprintf(labels, sizeof(labels), "dev=\"%s\",ep=\"%s\"",
+					 dev[d].name, G_lockEp[n]);
+			OutHist("m31_lock_wait_seconds", labels,
+					dev[d].lock[n].waitHist, dev[d].lock[n].count,
+					dev[d].freq);
+		}
+
+	Out("# HELP m31_lock_hold_seconds Hold time of the device lock\n"
+		"# TYPE m31_lock_hold_seconds histogram\n");
+	for (d=0; d<nrDev; d++)
+		for (n=0; dev[d].up && dev[d].lockUp && n<M31_LOCK_EP_NUM; n++) {
+			snprintf(labels, sizeof(labels), "dev=\"%s\",ep=\"%s\"",
+					 dev[d].name, G_lockEp[n]);
+			OutHist("m31_lock_hold_seconds", labels,
+					dev[d].lock[n].holdHist, dev[d].lock[n].count,
+					dev[d].freq);
+		}
+}
+
+/********************************* OutHist **********************************
+ *
+ *  Description: Append the samples of a log2 histogram
+ *
+ *               Bucket n of the driver counts times below 2^(n+1)
+ *               timestamp counts; the buckets are made cumulative.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: name		metric name
+ *               labels		labels without le
+ *               hist		histogram (M31_HIST_BUCKETS)
+ *               count		nr of samples
+ *               freq		timestamp frequency [Hz]
+ *  Output.....: -
+ *  Globals....: G_text, G_len
+ ****************************************************************************/
+static void OutHist(const char *name, const char *labels, u_int32 *hist,
+					u_int32 count, u_int32 freq)
+{
+	u_int32 n, sum;
+
+	for (n=0, sum=0; n<M31_HIST_BUCKETS; n++) {
+		sum += hist[n];
+		Out("%s_bucket{%s,le=\"%.9f\"} %u\n", name, labels,
+			(double)((u_int64)2 << n) / freq, (unsigned)sum);
+	}
+	Out("%s_bucket{%s,le=\"+Inf\"} %u\n", name, labels, (unsigned)count);
+	Out("%s_count{%s} %u\n", name, labels, (unsigned)count);
+}
+
+/*********************************** Out ************************************
+ *
+ *  Description: Append to the metrics text (truncated if full)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: fmt		printf format
+ *  Output.....: -
+ *  Globals....: G_text, G_len
+ ****************************************************************************/
+static void Out(const char *fmt, ...)
+{
+	va_list	ap;
+	int		n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(G_text + G_len, TEXT_SIZE - G_len, fmt, ap);
+	va_end(ap);
+
+	if (n > 0)
+		G_len = (G_len + n < TEXT_SIZE) ? G_len + n : TEXT_SIZE - 1;
+}
+
+/********************************** Serve ***********************************
+ *
+ *  Description: Send the metrics text to a client
+ *
+ *               Waits up to REQ_MSEC for a request; a client which sends
+ *               nothing gets the plain text.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: fd			client socket
+ *  Output.....: -
+ *  Globals....: G_text, G_len
+ ****************************************************************************/
+static void Serve(int fd)
+{
+	struct timeval	tv;
+	char			req[512], hdr[128];
+	ssize_t			n;
+	u_int32			off;
+	int				len;
+
+	tv.tv_sec  = 0;
+	tv.tv_usec = REQ_MSEC * 1000;
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	n = recv(fd, req, sizeof(req), 0);
+
+	if (n >= 3 && !strncmp(req, "GET", 3)) {
+		len = snprintf(hdr, sizeof(hdr), "HTTP/1.0 200 OK\r\n"
+					   "Content-Type: text/plain; version=0.0.4\r\n"
+					   "Content-Length: %u\r\n\r\n", (unsigned)G_len);
+		if (send(fd, hdr, len, MSG_NOSIGNAL) != len)
+			return;
+	}
+
+	for (off=0; off<G_len; off+=n)
+		if ((n = send(fd, G_text + off, G_len - off, MSG_NOSIGNAL)) <= 0)
+			return;
+}
+
+/********************************* PrintMdisError ***************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintMdisError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
@@ -0,0 +1,493 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    M31_MON                         ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Log the change events of M31 devices to a binary log
+ *
+ *               Logging: opens one or more devices in block mode
+ *               M31_BLKMODE_EVENT and waits for the driver signal. On each
+ *               signal (and at least once per flush interval) the event
+ *               FIFOs are drained in large blocks and appended to the log
+ *               file (see m31_log.h). The segment headers are flushed
+ *               periodically, so a crash loses at most one interval.
+ *
+ *               Query (-q): maps the log file and prints the edges in a
+ *               time range, optionally of one device and channel. Segments
+ *               are selected by their index (time range, changed channels)
+ *               without reading their records.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl, m31_util
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/m31_drv.h>
+#include <MEN/m31_log.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define BLK_EVENTS		1024	/* nr of events per M_getblock call */
+#define POLL_MSEC		10		/* delay if no signal pending */
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static volatile u_int32 G_SigCount;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static int Monitor(int argc, char *argv[], char *file);
+static int Query(char *file, int32 dev, int32 ch, double from, double to,
+				 int index);
+static void PrintEvent(const M31_EVENT *ev, u_int16 chMask, u_int32 freq);
+static void __MAPILIB SigHandler(u_int32 sigCode);
+static void PrintMdisError(char *info);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m31_mon [<opts>] <device> [<device>...]\n");
+	printf("       m31_mon -q [<opts>]\n");
+	printf("Function: Log M31 change events to an indexed binary log\n");
+	printf("          or query the log\n");
+	printf("Options:\n");
+	printf("    device       device name (max. %d)\n", M31_LOG_DEV_MAX);
+	printf("    -f=<file>    log file                          [m31_mon.log]\n");
+	printf("  logging:\n");
+	printf("    -a           append to existing log\n");
+	printf("    -s=<kB>      segment size [kB]                 [64]\n");
+	printf("    -n=<n>       nr of segments, log is a ring     [0=unlimited]\n");
+	printf("    -t=<ms>      flush interval [ms]               [1000]\n");
+	printf("  query:\n");
+	printf("    -q           query mode\n");
+	printf("    -i           print segment index only\n");
+	printf("    -d=<n>       device index                      [all]\n");
+	printf("    -c=<ch>      channel                           [all]\n");
+	printf("    -b=<s>       begin time [s]                    [0]\n");
+	printf("    -e=<s>       end time [s]                      [end]\n");
+	printf("\n");
+	printf("Times are seconds of the driver timestamp (M31_TS_FREQ).\n");
+	printf("\n");
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	char	*str, *errstr, *file, errbuf[40];
+	int32	dev, ch;
+	double	from, to;
+
+	if ((errstr = UTL_ILLIOPT("f=as=n=t=qid=c=b=e=?", errbuf))) {
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {
+		usage();
+		return(1);
+	}
+
+	file = ((str = UTL_TSTOPT("f=")) ? str : "m31_mon.log");
+
+	if (UTL_TSTOPT("q")) {
+		dev  = ((str = UTL_TSTOPT("d=")) ? atoi(str) : -1);
+		ch   = ((str = UTL_TSTOPT("c=")) ? atoi(str) : -1);
+		from = ((str = UTL_TSTOPT("b=")) ? atof(str) : 0.0);
+		to   = ((str = UTL_TSTOPT("e=")) ? atof(str) : -1.0);
+
+		if (dev >= M31_LOG_DEV_MAX || ch > 15) {
+			usage();
+			return(1);
+		}
+		return(Query(file, dev, ch, from, to, UTL_TSTOPT("i") ? 1 : 0));
+	}
+
+	return(Monitor(argc, argv, file));
+}
+
+/********************************* Monitor **********************************
+ *
+ *  Description: Log events of all devices until a key is pressed
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *               file		log file
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_SigCount
+ ****************************************************************************/
+static int Monitor(int argc, char *argv[], char *file)
+{
+	MDIS_PATH	path[M31_LOG_DEV_MAX];
+	M31_LOG		log;
+	M31_LOG_HDR	hdr;
+	M_SG_BLOCK	blk;
+	M31_EVENT	buf[BLK_EVENTS];
+	u_int16		idProm[64];
+	u_int32		total[M31_LOG_DEV_MAX], lost, lastFlush, flushMs, n;
+	char		*str;
+	int32		nrDev = 0, dev, len, freq, chNbr;
+	int			i, logOpen = 0, ret = 1;
+
+	memset(&hdr, 0, sizeof(hdr));
+	memset(total, 0, sizeof(total));
+
+	hdr.segSize = ((str = UTL_TSTOPT("s=")) ? atoi(str) : 64) * 1024;
+	hdr.maxSegs = ((str = UTL_TSTOPT("n=")) ? atoi(str) : 0);
+	flushMs     = ((str = UTL_TSTOPT("t=")) ? atoi(str) : 1000);
+
+	for (i=1; i<argc; i++) {
+		if (*argv[i] == '-')
+			continue;
+		if (nrDev == M31_LOG_DEV_MAX) {
+			printf("*** max. %d devices\n", M31_LOG_DEV_MAX);
+			return(1);
+		}
+		strncpy(hdr.dev[nrDev++].name, argv[i], M31_LOG_NAME_LEN - 1);
+	}
+
+	if (!nrDev) {
+		usage();
+		return(1);
+	}
+
+	for (dev=0; dev<nrDev; dev++)
+		path[dev] = -1;
+
+	/*--------------------+
+	|  install signal     |
+	+--------------------*/
+	if (UOS_SigInit(SigHandler) || UOS_SigInstall(UOS_SIG_USR1)) {
+		printf("*** can't install signal: %s\n",
+			   UOS_ErrString(UOS_ErrnoGet()));
+		UOS_SigExit();
+		return(1);
+	}
+
+	/*--------------------+
+	|  open devices       |
+	+--------------------*/
+	for (dev=0; dev<nrDev; dev++) {
+		if ((path[dev] = M_open(hdr.dev[dev].name)) < 0) {
+			PrintMdisError("open");
+			goto cleanup;
+		}
+
+		if (M_getstat(path[dev], M31_TS_FREQ, &freq) < 0 ||
+			M_getstat(path[dev], M_LL_CH_NUMBER, &chNbr) < 0) {
+			PrintMdisError("getstat M31_TS_FREQ/M_LL_CH_NUMBER");
+			goto cleanup;
+		}
+		if (dev && (u_int32)freq != hdr.tsFreq) {
+			printf("*** %s: different timestamp frequency\n",
+				   hdr.dev[dev].name);
+			goto cleanup;
+		}
+		hdr.tsFreq = freq;
+		hdr.dev[dev].chNbr = (u_int16)chNbr;
+
+		/* module id is optional (ID PROM may be missing) */
+		blk.size = sizeof(idProm);
+		blk.data = (void*)idProm;
+		if (M_getstat(path[dev], M_LL_BLK_ID_DATA, (int32*)&blk) >= 0)
+			hdr.dev[dev].modId = idProm[1];
+	}
+	hdr.nrDev = nrDev;
+
+	if (M31_LogCreate(&log, file, &hdr,
+					  UTL_TSTOPT("a") ? 1 : 0) < 0) {
+		printf("*** can't create %s: %s\n", file, strerror(errno));
+		goto cleanup;
+	}
+	logOpen = 1;
+
+	/*--------------------+
+	|  start events       |
+	+--------------------*/
+	for (dev=0; dev<nrDev; dev++) {
+		if (M_setstat(path[dev], M31_BLK_MODE, M31_BLKMODE_EVENT) < 0 ||
+			M_setstat(path[dev], M31_SIGSET, UOS_SIG_USR1) < 0 ||
+			M_setstat(path[dev], M_MK_IRQ_ENABLE, 1) < 0) {
+			PrintMdisError("setstat");
+			goto cleanup;
+		}
+	}
+
+	printf("Logging %d device(s) to %s, segment %u kB... "
+		   "(Press Key to abort)\n", (int)nrDev, file,
+		   (unsigned)(log.hdr.segSize / 1024));
+
+	/*--------------------+
+	|  drain events       |
+	+--------------------*/
+	lastFlush = UOS_MsecTimerGet();
+
+	while (UOS_KeyPressed() < 0) {
+		if (!G_SigCount &&
+			UOS_MsecTimerGet() - lastFlush < flushMs) {
+			UOS_Delay(POLL_MSEC);
+			continue;
+		}
+		G_SigCount = 0;
+
+		for (dev=0; dev<nrDev; dev++) {
+			do {
+				if ((len = M_getblock(path[dev], (u_int8*)buf,
+									  sizeof(buf))) < 0) {
+					PrintMdisError("getblock");
+					goto cleanup;
+				}
+				n = len / sizeof(M31_EVENT);
+
+				if (n && M31_LogWrite(&log, (u_int8)dev, buf, n) < 0) {
+					printf("*** can't write %s: %s\n", file,
+						   strerror(errno));
+					goto cleanup;
+				}
+				total[dev] += n;
+			} while (n == BLK_EVENTS);
+		}
+
+		if (UOS_MsecTimerGet() - lastFlush >= flushMs) {
+			if (M31_LogFlush(&log) < 0) {
+				printf("*** can't write %s: %s\n", file, strerror(errno));
+				goto cleanup;
+			}
+			lastFlush = UOS_MsecTimerGet();
+		}
+	}
+
+	/*--------------------+
+	|  print statistics   |
+	+--------------------*/
+	for (dev=0; dev<nrDev; dev++) {
+		if (M_getstat(path[dev], M31_EVENT_LOST, (int32*)&lost) < 0)
+			lost = 0;
+		printf("%-16s: %u events logged, %u lost\n", hdr.dev[dev].name,
+			   (unsigned)total[dev], (unsigned)lost);
+	}
+
+	ret = 0;
+
+	/*--------------------+
+	|  cleanup            |
+	+--------------------*/
+	cleanup:
+	for (dev=0; dev<nrDev; dev++) {
+		if (path[dev] < 0)
+			continue;
+		M_setstat(path[dev], M_MK_IRQ_ENABLE, 0);
+		M_setstat(path[dev], M31_SIGCLR, 0);
+		if (M_close(path[dev]) < 0)
+			PrintMdisError("close");
+	}
+
+	if (logOpen)
+		M31_LogClose(&log);
+
+	UOS_SigExit();
+
+	return(ret);
+}
+
+/********************************** Query ***********************************
+ *
+ *  Description: Print the edges of a log file matching the query
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: file		log file
+ *               dev		device index (-1=all)
+ *               ch			channel (-1=all)
+ *               from		begin time [s]
+ *               to			end time [s] (<0: end of log)
+ *               index		print segment index only
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+static int Query(char *file, int32 dev, int32 ch, double from, double to,
+				 int index)
+{
+	M31_LOG				log;
+	M31_LOG_QUERY		q;
+	const M31_LOG_SEG	*seg;
+	const M31_EVENT		*ev;
+	u_int32				freq, n, d, cnt = 0;
+	u_int16				chMask;
+	time_t				wall;
+	char				tstr[32];
+
+	if (M31_LogOpen(&log, file) < 0) {
+		printf("*** can't open %s: %s\n", file, strerror(errno));
+		return(1);
+	}
+
+	freq = log.hdr.tsFreq;
+
+	printf("log %s: %u segment(s) of %u records\n", file,
+		   (unsigned)log.nrOrder, (unsigned)log.hdr.segRecs);
+	for (n=0; n<log.hdr.nrDev; n++)
+		printf("  dev %u: %-16s M%02u, %u channels\n", (unsigned)n,
+			   log.hdr.dev[n].name, (unsigned)log.hdr.dev[n].modId,
+			   (unsigned)log.hdr.dev[n].chNbr);
+
+	/*--------------------+
+	|  segment index      |
+	+--------------------*/
+	if (index) {
+		for (n=0; (seg = M31_LogSeg(&log, n)) != NULL; n++) {
+			wall = (time_t)seg->wallSec;
+			strftime(tstr, sizeof(tstr), "%Y-%m-%d %H:%M:%S",
+					 localtime(&wall));
+			printf("seq %6u  %s  %14.6f .. %14.6f s  %5u recs  ch",
+				   (unsigned)seg->seq, tstr,
+				   (double)(((u_int64)seg->tsFirstHigh << 32) |
+							seg->tsFirstLow) / freq,
+				   (double)(((u_int64)seg->tsLastHigh << 32) |
+							seg->tsLastLow) / freq,
+				   (unsigned)seg->nrRecs);
+			for (d=0; d<log.hdr.nrDev; d++)
+				printf(" %04x", seg->chMask[d]);
+			printf("\n");
+		}
+		M31_LogClose(&log);
+		return(0);
+	}
+
+	/*--------------------+
+	|  query edges        |
+	+--------------------*/
+	chMask = (ch < 0 ? 0xffff : (u_int16)(1 << ch));
+
+	M31_LogQueryInit(&q, (u_int64)(from * freq),
+					 to < 0 ? ~(u_int64)0 : (u_int64)(to * freq),
+					 dev < 0 ? 0xffffffff : (u_int32)1 << dev, chMask);
+
+	while ((ev = M31_LogNext(&log, &q)) != NULL) {
+		PrintEvent(ev, chMask, freq);
+		cnt++;
+	}
+
+	printf("%u event(s), %u segment(s) searched, %u skipped by index\n",
+		   (unsigned)cnt, (unsigned)q.segsRead, (unsigned)q.segsSkipped);
+
+	M31_LogClose(&log);
+	return(0);
+}
+
+/******************************* PrintEvent *********************************
+ *
+ *  Description: Print the edges of one event
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: ev			event record
+ *               chMask		channels to print
+ *               freq		timestamp frequency [Hz]
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintEvent(const M31_EVENT *ev, u_int16 chMask, u_int32 freq)
+{
+	u_int64 ts = ((u_int64)ev->tsHigh << 32) | ev->tsLow;
+	double  s  = (double)ts / freq;
+	int32   ch;
+
+	if (ev->flags & M31_EVF_OVERRUN)
+		printf("*** events lost before seq %u\n", (unsigned)ev->seq);
+
+	if (ev->flags & M31_EVF_RULE) {
+		for (ch=0; ch<M31_RULE_MAX; ch++)
+			if (ev->change & (1 << ch))
+				printf("%14.6f s  dev %u  rule %d %s\n", s, ev->dev,
+					   (int)ch, (ev->flags & M31_EVF_VIOLATED) ?
+					   "violated" : "done");
+		return;
+	}
+
+	for (ch=0; ch<16; ch++) {
+		if (!(ev->change & chMask & (1 << ch)))
+			continue;
+
+		if (ev->flags & M31_EVF_LOST_EDGE)
+			printf("%14.6f s  dev %u  ch %2d  lost edge?\n", s, ev->dev,
+				   (int)ch);
+		else
+			printf("%14.6f s  dev %u  ch %2d  %s\n", s, ev->dev, (int)ch,
+				   (ev->state & (1 << ch)) ? "rise" : "fall");
+	}
+}
+
+/******************************* SigHandler *********************************
+ *
+ *  Description: Signal handler (counts UOS_SIG_USR1)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: sigCode	signal code received
+ *  Output.....: -
+ *  Globals....: G_SigCount
+ ****************************************************************************/
+static void __MAPILIB SigHandler(u_int32 sigCode)
+{
+	if (sigCode == UOS_SIG_USR1)
+		G_SigCount++;
+}
+
+/********************************* PrintMdisError ***************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintMdisError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
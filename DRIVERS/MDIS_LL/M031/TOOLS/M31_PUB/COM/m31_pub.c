@@ -0,0 +1,312 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    M31_PUB                         ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Publish the events of M31 devices in shared memory
+ *
+ *               Reader service for several consumer processes: opens one
+ *               or more devices in block mode M31_BLKMODE_EVENT, drains
+ *               each event FIFO once per driver signal (and at least once
+ *               per heartbeat interval) and publishes the events and the
+ *               current device states in a shared memory ring (see
+ *               m31_shm.h). Subscribers (e.g. m31_sub) read the ring at
+ *               their own pace without opening the devices.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl, m31_util
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/m31_drv.h>
+#include <MEN/m31_shm.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define BLK_EVENTS		1024	/* nr of events per M_getblock call */
+#define POLL_MSEC		1		/* delay if no signal pending */
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static volatile u_int32 G_SigCount;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void __MAPILIB SigHandler(u_int32 sigCode);
+static void PrintMdisError(char *info);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m31_pub [<opts>] <device> [<device>...]\n");
+	printf("Function: Publish M31 events in a shared memory ring\n");
+	printf("Options:\n");
+	printf("    device       device name (max. %d)\n", M31_SHM_DEV_MAX);
+	printf("    -n=<name>    shared memory object     [%s]\n", M31_SHM_NAME);
+	printf("    -r=<n>       ring size [records]      [65536]\n");
+	printf("    -t=<ms>      heartbeat interval [ms]  [100]\n");
+	printf("\n");
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_SigCount
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	MDIS_PATH		path[M31_SHM_DEV_MAX];
+	M31_SHM			shm;
+	M31_SHM_HDR		hdr;
+	M31_SHM_STATE	st;
+	M_SG_BLOCK		blk;
+	M31_EVENT		buf[BLK_EVENTS];
+	u_int16			idProm[64], state;
+	u_int32			lost, lastBeat, beatMs, n;
+	char			*str, *errstr, *name, errbuf[40];
+	int32			nrDev = 0, dev, len, freq, chNbr;
+	int				i, shmOpen = 0, ret = 1;
+
+	if ((errstr = UTL_ILLIOPT("n=r=t=?", errbuf))) {
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+
+	name       = ((str = UTL_TSTOPT("n=")) ? str : M31_SHM_NAME);
+	hdr.nrRecs = ((str = UTL_TSTOPT("r=")) ? atoi(str) : 65536);
+	beatMs     = ((str = UTL_TSTOPT("t=")) ? atoi(str) : 100);
+
+	for (i=1; i<argc; i++) {
+		if (*argv[i] == '-')
+			continue;
+		if (nrDev == M31_SHM_DEV_MAX) {
+			printf("*** max. %d devices\n", M31_SHM_DEV_MAX);
+			return(1);
+		}
+		strncpy(hdr.dev[nrDev++].name, argv[i], M31_SHM_NAME_LEN - 1);
+	}
+
+	if (UTL_TSTOPT("?") || !nrDev) {
+		usage();
+		return(1);
+	}
+
+	for (dev=0; dev<nrDev; dev++)
+		path[dev] = -1;
+
+	/*--------------------+
+	|  install signal     |
+	+--------------------*/
+	if (UOS_SigInit(SigHandler) || UOS_SigInstall(UOS_SIG_USR1)) {
+		printf("*** can't install signal: %s\n",
+			   UOS_ErrString(UOS_ErrnoGet()));
+		UOS_SigExit();
+		return(1);
+	}
+
+	/*--------------------+
+	|  open devices       |
+	+--------------------*/
+	for (dev=0; dev<nrDev; dev++) {
+		if ((path[dev] = M_open(hdr.dev[dev].name)) < 0) {
+			PrintMdisError("open");
+			goto cleanup;
+		}
+
+		if (M_getstat(path[dev], M31_TS_FREQ, &freq) < 0 ||
+			M_getstat(path[dev], M_LL_CH_NUMBER, &chNbr) < 0) {
+			PrintMdisError("getstat M31_TS_FREQ/M_LL_CH_NUMBER");
+			goto cleanup;
+		}
+		if (dev && (u_int32)freq != hdr.tsFreq) {
+			printf("*** %s: different timestamp frequency\n",
+				   hdr.dev[dev].name);
+			goto cleanup;
+		}
+		hdr.tsFreq = freq;
+		hdr.dev[dev].chNbr = (u_int16)chNbr;
+
+		/* module id is optional (ID PROM may be missing) */
+		blk.size = sizeof(idProm);
+		blk.data = (void*)idProm;
+		if (M_getstat(path[dev], M_LL_BLK_ID_DATA, (int32*)&blk) >= 0)
+			hdr.dev[dev].modId = idProm[1];
+	}
+	hdr.nrDev = nrDev;
+
+	if (M31_ShmCreate(&shm, name, &hdr) < 0) {
+		printf("*** can't create %s: %s\n", name, strerror(errno));
+		goto cleanup;
+	}
+	shmOpen = 1;
+
+	/*--------------------+
+	|  start events       |
+	+--------------------*/
+	for (dev=0; dev<nrDev; dev++) {
+		/* initial state (block mode M31_BLKMODE_STATE) */
+		if (M_setstat(path[dev], M31_BLK_MODE, M31_BLKMODE_STATE) < 0 ||
+			M_getblock(path[dev], (u_int8*)&state, sizeof(state)) < 0) {
+			PrintMdisError("get state");
+			goto cleanup;
+		}
+		M31_ShmStateSet(&shm, (u_int8)dev, state, 0, 0);
+
+		if (M_setstat(path[dev], M31_BLK_MODE, M31_BLKMODE_EVENT) < 0 ||
+			M_setstat(path[dev], M31_SIGSET, UOS_SIG_USR1) < 0 ||
+			M_setstat(path[dev], M_MK_IRQ_ENABLE, 1) < 0) {
+			PrintMdisError("setstat");
+			goto cleanup;
+		}
+	}
+
+	printf("Publishing %d device(s) in %s, %u records... "
+		   "(Press Key to abort)\n", (int)nrDev, name,
+		   (unsigned)shm.hdr->nrRecs);
+
+	/*--------------------+
+	|  drain events       |
+	+--------------------*/
+	lastBeat = UOS_MsecTimerGet();
+
+	while (UOS_KeyPressed() < 0) {
+		if (!G_SigCount &&
+			UOS_MsecTimerGet() - lastBeat < beatMs) {
+			UOS_Delay(POLL_MSEC);
+			continue;
+		}
+		G_SigCount = 0;
+
+		for (dev=0; dev<nrDev; dev++) {
+			do {
+				if ((len = M_getblock(path[dev], (u_int8*)buf,
+									  sizeof(buf))) < 0) {
+					PrintMdisError("getblock");
+					goto cleanup;
+				}
+				n = len / sizeof(M31_EVENT);
+				M31_ShmPublish(&shm, (u_int8)dev, buf, n);
+			} while (n == BLK_EVENTS);
+		}
+
+		/* heartbeat and driver lost counters */
+		if (UOS_MsecTimerGet() - lastBeat >= beatMs) {
+			for (dev=0; dev<nrDev; dev++) {
+				if (M_getstat(path[dev], M31_EVENT_LOST, (int32*)&lost) < 0)
+					continue;
+				M31_ShmStateGet(&shm, (u_int8)dev, &st);
+				if (lost != st.lost)
+					M31_ShmStateSet(&shm, (u_int8)dev, st.state,
+									((u_int64)st.tsHigh << 32) | st.tsLow,
+									lost);
+			}
+			M31_ShmBeat(&shm);
+			lastBeat = UOS_MsecTimerGet();
+		}
+	}
+
+	/*--------------------+
+	|  print statistics   |
+	+--------------------*/
+	for (dev=0; dev<nrDev; dev++) {
+		M31_ShmStateGet(&shm, (u_int8)dev, &st);
+		printf("%-16s: %u events published, %u lost in driver\n",
+			   hdr.dev[dev].name, (unsigned)st.events, (unsigned)st.lost);
+	}
+
+	ret = 0;
+
+	/*--------------------+
+	|  cleanup            |
+	+--------------------*/
+	cleanup:
+	for (dev=0; dev<nrDev; dev++) {
+		if (path[dev] < 0)
+			continue;
+		M_setstat(path[dev], M_MK_IRQ_ENABLE, 0);
+		M_setstat(path[dev], M31_SIGCLR, 0);
+		if (M_close(path[dev]) < 0)
+			PrintMdisError("close");
+	}
+
+	if (shmOpen)
+		M31_ShmClose(&shm);
+
+	UOS_SigExit();
+
+	return(ret);
+}
+
+/******************************* SigHandler *********************************
+ *
+ *  Description: Signal handler (counts UOS_SIG_USR1)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: sigCode	signal code received
+ *  Output.....: -
+ *  Globals....: G_SigCount
+ ****************************************************************************/
+static void __MAPILIB SigHandler(u_int32 sigCode)
+{
+	if (sigCode == UOS_SIG_USR1)
+		G_SigCount++;
+}
+
+/********************************* PrintMdisError ***************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintMdisError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
@@ -0,0 +1,1682 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    M31_CHECK                       ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Behaviour checks of the M31 driver with an emulated module
+ *
+ *               The low-level driver source is compiled into this program
+ *               against the user space emulation (switch M31_EMU, see
+ *               m31_emu.h), like m31_replay. Each scenario opens one or
+ *               more emulated devices with its own descriptor keys, drives
+ *               the data register and the real M31_Irq and compares the
+ *               results of the driver entry points with the expected ones.
+ *               Times are real: scenarios with time windows wait for them
+ *               with some margin.
+ *
+ *               Without -s, all scenarios are run. The program prints one
+ *               line per failed check and per scenario and returns 1 if
+ *               any check failed.
+ *
+ *     Required: m31_emu.c (see program_check.mak), libraries: usr_utl;
+ *               POSIX threads
+ *     Switches: M31_EMU (set here)
+ *               M31_OWN_LOCK  driver with own locking (see m31_drv.c)
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef M31_EMU
+#define M31_EMU
+#endif
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the real driver, built against m31_emu.h */
+#include "../../../DRIVER/COM/m31_drv.c"
+
+#include <MEN/usr_utl.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define DEV_MAX			4		/* max devices per scenario */
+#define DESC_MAX		32		/* max descriptor keys per device */
+#define EV_MAX			64		/* max events per read */
+
+/* check an expression, report the failed one */
+#define CHECK(expr)		Check((expr) ? 1 : 0, #expr, __LINE__)
+
+/* device locking: by the driver (M31_OWN_LOCK) or as the MDIS kernel */
+#ifdef M31_OWN_LOCK
+# define DEV_SETSTAT	M31_SetStatLocked
+# define DEV_GETSTAT	M31_GetStatLocked
+# define DEV_BLOCKREAD	M31_BlockReadLocked
+#else
+# define DEV_SETSTAT	M31_SetStat
+# define DEV_GETSTAT	M31_GetStat
+# define DEV_BLOCKREAD	M31_BlockRead
+#endif
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/* emulated device */
+typedef struct {
+	EMU_DEV			dev;		/* registers, ID PROM */
+	MACCESS			ma;
+	LL_HANDLE		*llHdl;
+	const char		*desc[DESC_MAX + 1];
+} DEV;
+
+/* scenario */
+typedef struct {
+	const char		*name;
+	const char		*descr;
+	void			(*func)(void);
+} SCENARIO;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static DEV				G_dev[DEV_MAX];
+static OSS_SEM_HANDLE	*G_devSem;
+static volatile u_int32	G_sigCount;		/* signals sent by the driver */
+static u_int32			G_checks;		/* checks of the scenario */
+static u_int32			G_failed;		/* failed checks of the scenario */
+static int				G_verbose;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void Check(int ok, const char *expr, int line);
+static int32 DevOpen(int idx, u_int16 modId, const char **keys);
+static void DevClose(int idx);
+static void Edge(int idx, u_int16 state);
+static int32 SetStat(int idx, int32 code, int32 ch, int32 value);
+static int32 GetStat(int idx, int32 code, int32 ch, int32 *valueP);
+static int32 GetBlk(int idx, int32 code, void *buf, int32 size);
+static int32 SetBlk(int idx, int32 code, void *buf, int32 size);
+static int32 Read(int idx, void *buf, int32 size);
+static u_int32 Events(int idx, M31_EVENT *ev, u_int32 max);
+static void SigHook(void *arg, int32 sigNbr);
+static u_int32 DbArmed(int idx);
+static void Input(int idx, u_int16 state);
+
+/* scenarios */
+static void ScAggr(void);
+static void ScIsr(void);
+static void ScTrace(void);
+static void ScLost(void);
+static void ScCapture(void);
+static void ScRle(void);
+static void ScIdProm(void);
+static void ScHys(void);
+static void ScPreset(void);
+static void ScDebounce(void);
+static void ScQuad(void);
+static void ScStrobe(void);
+static void ScField(void);
+static void ScRule(void);
+static void ScLastChange(void);
+static void ScReady(void);
+#ifdef M31_OWN_LOCK
+static void *LockThread(void *arg);
+static void ScLockStat(void);
+#endif
+
+static const SCENARIO G_scenario[] = {
+	{ "aggr",	"aggregate device: merge order, exclusive members",	ScAggr },
+	{ "isr",	"ISR timing statistics",	ScIsr },
+	{ "trace",	"binary trace: records, overwrite, disable",	ScTrace },
+	{ "lost",	"lost edges: attributed, unattributed, events",	ScLost },
+	{ "capture",	"capture: period limit, trigger, pre-trigger",	ScCapture },
+	{ "rle",	"capture: run length encoded format",	ScRle },
+	{ "idprom",	"ID PROM: lazy read, cache, deferred check",	ScIdProm },
+	{ "hys",	"hysteresis (M82): shadow, bulk, descriptor",	ScHys },
+	{ "preset",	"preset notification, signal coalescing",	ScPreset },
+	{ "debounce",	"debounce: settle, glitch, timer arming",	ScDebounce },
+	{ "quad",	"quadrature decoder: position, direction, errors",	ScQuad },
+	{ "strobe",	"strobed words: edges, lost edge, full FIFO",	ScStrobe },
+	{ "field",	"channel fields: codes, settle, invalid",	ScField },
+	{ "rule",	"sequence rules: windows, hold times, levels",	ScRule },
+	{ "lastchange",	"last change: timestamp, level, lost edge",	ScLastChange },
+	{ "ready",	"ready group: mask, one signal per device",	ScReady },
+#ifdef M31_OWN_LOCK
+	{ "lockstat",	"device lock: counts, wait, hold, contention",
+	  ScLockStat },
+#endif
+	{ NULL, NULL, NULL }
+};
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	const SCENARIO *sc;
+
+	printf("Usage: m31_check [<opts>]\n");
+	printf("Function: Check the M31 driver behaviour with an emulated "
+		   "module\n");
+	printf("Options:\n");
+	printf("    -s=<name>    run only this scenario             [all]\n");
+	printf("    -v           verbose: print passed checks\n");
+	printf("Scenarios:\n");
+	for (sc = G_scenario; sc->name; sc++)
+		printf("    %-12s %s\n", sc->name, sc->descr);
+	printf("\n");
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_xxx
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	const SCENARIO	*sc;
+	char			*errstr, *name, errbuf[40];
+	u_int32			run = 0, failed = 0;
+
+	if ((errstr = UTL_ILLIOPT("s=v?", errbuf))) {
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {
+		usage();
+		return(1);
+	}
+
+	name      = UTL_TSTOPT("s=");
+	G_verbose = (UTL_TSTOPT("v") ? 1 : 0);
+
+	if (EMU_Init(SigHook, NULL) || (G_devSem = EMU_SemCreate()) == NULL) {
+		printf("*** can't init emulation\n");
+		return(1);
+	}
+
+	for (sc = G_scenario; sc->name; sc++) {
+		if (name && strcmp(name, sc->name))
+			continue;
+
+		G_checks = G_failed = 0;
+		G_sigCount = 0;
+		sc->func();
+		run++;
+
+		printf("%-12s %s (%u checks", sc->name,
+			   G_failed ? "FAILED" : "ok", (unsigned)G_checks);
+		if (G_failed)
+			printf(", %u failed", (unsigned)G_failed);
+		printf(")\n");
+		if (G_failed)
+			failed++;
+	}
+
+	EMU_SemRemove(G_devSem);
+
+	if (run == 0) {
+		printf("*** no scenario %s\n", name);
+		return(1);
+	}
+	printf("%u of %u scenarios passed\n", (unsigned)(run - failed),
+		   (unsigned)run);
+
+	return(failed ? 1 : 0);
+}
+
+/********************************** Check ***********************************
+ *
+ *  Description: Count a check, report it if failed
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: ok			check result
+ *               expr		checked expression
+ *               line		source line
+ *  Output.....: -
+ *  Globals....: G_checks, G_failed
+ ****************************************************************************/
+static void Check(int ok, const char *expr, int line)
+{
+	G_checks++;
+	if (!ok)
+		G_failed++;
+	if (!ok || G_verbose)
+		printf("  %s line %d: %s\n", ok ? "ok    " : "FAILED", line, expr);
+}
+
+/********************************* DevOpen **********************************
+ *
+ *  Description: Init an emulated device
+ *
+ *               The descriptor consists of the given keys, followed by
+ *               IRQ_ENABLE=1 (the first match wins).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: idx		device index
+ *               modId		module id in the ID PROM
+ *               keys		descriptor keys (KEY=value, NULL terminated)
+ *  Output.....: return		M31_Init result
+ *  Globals....: G_dev
+ ****************************************************************************/
+static int32 DevOpen(int idx, u_int16 modId, const char **keys)
+{
+	DEV		*d = &G_dev[idx];
+	int32	n = 0;
+
+	memset(&d->dev, 0, sizeof(d->dev));
+	d->dev.idProm[0] = MOD_ID_MAGIC;
+	d->dev.idProm[1] = modId;
+	d->ma = (MACCESS)&d->dev;
+
+	while (keys && *keys && n < DESC_MAX - 1)
+		d->desc[n++] = *keys++;
+	d->desc[n++] = "IRQ_ENABLE=1";
+	d->desc[n]   = NULL;
+
+	return( M31_Init((DESC_SPEC*)d->desc, EMU_Oss(), &d->ma, G_devSem,
+					 EMU_IrqHdl(), &d->llHdl) );
+}
+
+/********************************* DevClose *********************************
+ *
+ *  Description: Deinit an emulated device
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: idx		device index
+ *  Output.....: -
+ *  Globals....: G_dev
+ ****************************************************************************/
+static void DevClose(int idx)
+{
+	if (G_dev[idx].llHdl)
+		M31_Exit(&G_dev[idx].llHdl);
+	G_dev[idx].llHdl = NULL;
+}
+
+/*********************************** Edge ***********************************
+ *
+ *  Description: Set the inputs and raise the interrupt
+ *
+ *               An unchanged state emulates a double toggle.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: idx		device index
+ *               state		new input levels
+ *  Output.....: -
+ *  Globals....: G_dev
+ ****************************************************************************/
+static void Edge(int idx, u_int16 state)
+{
+	G_dev[idx].dev.regs[DATA_REG/2] = state;
+
+	EMU_IrqLock();
+	M31_Irq(G_dev[idx].llHdl);
+	EMU_IrqUnlock();
+}
+
+/********************************* SetStat **********************************
+ *
+ *  Description: M31_SetStat of a value with device semaphore
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: idx		device index
+ *               code		status code
+ *               ch			channel
+ *               value		value
+ *  Output.....: return		0 | error code
+ *  Globals....: G_dev, G_devSem
+ ****************************************************************************/
+static int32 SetStat(int idx, int32 code, int32 ch, int32 value)
+{
+	int32 error;
+
+#ifndef M31_OWN_LOCK
+	OSS_SemWait(NULL, G_devSem, OSS_SEM_WAITINF);
+#endif
+	error = DEV_SETSTAT(G_dev[idx].llHdl, code, ch, (INT32_OR_64)value);
+#ifndef M31_OWN_LOCK
+	OSS_SemSignal(NULL, G_devSem);
+#endif
+	return(error);
+}
+
+/********************************* GetStat **********************************
+ *
+ *  Description: M31_GetStat of a value with device semaphore
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: idx		device index
+ *               code		status code
+ *               ch			channel
+ *  Output.....: *valueP	value
+ *               return		0 | error code
+ *  Globals....: G_dev, G_devSem
+ ****************************************************************************/
+static int32 GetStat(int idx, int32 code, int32 ch, int32 *valueP)
+{
+	INT32_OR_64	value = 0;
+	int32		error;
+
+#ifndef M31_OWN_LOCK
+	OSS_SemWait(NULL, G_devSem, OSS_SEM_WAITINF);
+#endif
+	error = DEV_GETSTAT(G_dev[idx].llHdl, code, ch, &value);
+#ifndef M31_OWN_LOCK
+	OSS_SemSignal(NULL, G_devSem);
+#endif
+	*valueP = (int32)value;
+	return(error);
+}
+
+/********************************** GetBlk **********************************
+ *
+ *  Description: Block M31_GetStat with device semaphore
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: idx		device index
+ *               code		status code
+ *               buf		block buffer
+ *               size		block size
+ *  Output.....: return		0 | error code
+ *  Globals....: G_dev, G_devSem
+ ****************************************************************************/
+static int32 GetBlk(int idx, int32 code, void *buf, int32 size)
+{
+	M_SG_BLOCK	blk;
+	int32		error;
+
+	blk.size = size;
+	blk.data = buf;
+
+#ifndef M31_OWN_LOCK
+	OSS_SemWait(NULL, G_devSem, OSS_SEM_WAITINF);
+#endif
+	error = DEV_GETSTAT(G_dev[idx].llHdl, code, 0, (INT32_OR_64*)&blk);
+#ifndef M31_OWN_LOCK
+	OSS_SemSignal(NULL, G_devSem);
+#endif
+	return(error);
+}
+
+/********************************** SetBlk **********************************
+ *
+ *  Description: Block M31_SetStat with device semaphore
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: idx		device index
+ *               code		status code
+ *               buf		block buffer
+ *               size		block size
+ *  Output.....: return		0 | error code
+ *  Globals....: G_dev, G_devSem
+ ****************************************************************************/
+static int32 SetBlk(int idx, int32 code, void *buf, int32 size)
+{
+	M_SG_BLOCK	blk;
+	int32		error;
+
+	blk.size = size;
+	blk.data = buf;
+
+#ifndef M31_OWN_LOCK
+	OSS_SemWait(NULL, G_devSem, OSS_SEM_WAITINF);
+#endif
+	error = DEV_SETSTAT(G_dev[idx].llHdl, code, 0,
+						(INT32_OR_64)(U_INT32_OR_64)&blk);
+#ifndef M31_OWN_LOCK
+	OSS_SemSignal(NULL, G_devSem);
+#endif
+	return(error);
+}
+
+/*********************************** Read ***********************************
+ *
+ *  Description: M31_BlockRead in the current block read mode
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: idx		device index
+ *               buf		buffer
+ *               size		buffer size
+ *  Output.....: return		nr of bytes read | -error code
+ *  Globals....: G_dev, G_devSem
+ ****************************************************************************/
+static int32 Read(int idx, void *buf, int32 size)
+{
+	int32 error, nbr = 0;
+
+#ifndef M31_OWN_LOCK
+	OSS_SemWait(NULL, G_devSem, OSS_SEM_WAITINF);
+#endif
+	error = DEV_BLOCKREAD(G_dev[idx].llHdl, 0, buf, size, &nbr);
+#ifndef M31_OWN_LOCK
+	OSS_SemSignal(NULL, G_devSem);
+#endif
+	return(error ? -error : nbr);
+}
+
+/********************************** Events **********************************
+ *
+ *  Description: Read pending event records
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: idx		device index
+ *               ev			buffer
+ *               max		max nr of records
+ *  Output.....: return		nr of records (0 on error)
+ *  Globals....: -
+ ****************************************************************************/
+static u_int32 Events(int idx, M31_EVENT *ev, u_int32 max)
+{
+	int32 nbr;
+
+	if (SetStat(idx, M31_BLK_MODE, 0, M31_BLKMODE_EVENT) ||
+		(nbr = Read(idx, ev, max * sizeof(M31_EVENT))) < 0)
+		return(0);
+
+	return(nbr / sizeof(M31_EVENT));
+}
+
+/********************************* SigHook **********************************
+ *
+ *  Description: Driver signal (OSS_SigSend)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg		unused
+ *               sigNbr		signal number
+ *  Output.....: -
+ *  Globals....: G_sigCount
+ ****************************************************************************/
+static void SigHook(void *arg, int32 sigNbr)
+{
+	G_sigCount++;
+}
+
+/********************************** Input ***********************************
+ *
+ *  Description: Set the inputs without interrupt (sampled inputs)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: idx		device index
+ *               state		new input levels
+ *  Output.....: -
+ *  Globals....: G_dev
+ ****************************************************************************/
+static void Input(int idx, u_int16 state)
+{
+	EMU_IrqLock();
+	G_dev[idx].dev.regs[DATA_REG/2] = state;
+	EMU_IrqUnlock();
+}
+
+/********************************* DbArmed **********************************
+ *
+ *  Description: Check if the debounce timer of a device is armed
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: idx		device index
+ *  Output.....: return		armed (1) or idle (0)
+ *  Globals....: G_dev
+ ****************************************************************************/
+static u_int32 DbArmed(int idx)
+{
+	u_int32 armed;
+
+	EMU_IrqLock();
+	armed = G_dev[idx].llHdl->dbTimerRun;
+	EMU_IrqUnlock();
+
+	return(armed);
+}
+
+#ifdef M31_OWN_LOCK
+/******************************** LockThread ********************************
+ *
+ *  Description: Thread which calls a getstat of device 0
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg		unused
+ *  Output.....: return		NULL
+ *  Globals....: -
+ ****************************************************************************/
+static void *LockThread(void *arg)
+{
+	int32 value;
+
+	GetStat(0, M31_EVENT_COUNT, 0, &value);
+	return(NULL);
+}
+#endif
+
+/********************************** ScAggr **********************************
+ *
+ *  Description: Aggregate device
+ *
+ *               Events of two modules are merged in timestamp order with
+ *               the module index; an exclusive member is busy for events
+ *               and change flags, a shared one reads its own.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScAggr(void)
+{
+	static const char *master[] = { "AGGR_GROUP=1", "AGGR_INDEX=0",
+									"AGGR_COUNT=3", NULL };
+	static const char *member1[] = { "AGGR_GROUP=1", "AGGR_INDEX=1",
+									 "AGGR_EXCLUSIVE=1", NULL };
+	static const char *member2[] = { "AGGR_GROUP=1", "AGGR_INDEX=2", NULL };
+	M31_EVENT	ev[EV_MAX];
+	u_int16		state[3] = { 0, 0, 0 };
+	u_int16		flags[3];
+	int32		value;
+	u_int32		n, i, ordered = 1;
+
+	CHECK(DevOpen(0, MOD_ID_M31, master) == 0);
+	CHECK(DevOpen(1, MOD_ID_M31, member1) == 0);
+	CHECK(DevOpen(2, MOD_ID_M31, member2) == 0);
+	CHECK(GetStat(0, M31_AGGR_MEMBERS, 0, &value) == 0 && value == 0x7);
+
+	/* interleaved edges, more than one merge chunk (the first three in
+	   ticks of their own, for timestamps without cycle counter) */
+	for (i=0; i<EV_MAX; i++) {
+		if (i < 4)
+			OSS_Delay(NULL, 2);
+		Edge(i % 3, ++state[i % 3]);
+	}
+
+	n = Events(0, ev, EV_MAX);
+	CHECK(n == EV_MAX);
+	for (i=1; i<n; i++) {
+		if ((int64)((((u_int64)ev[i].tsHigh << 32) | ev[i].tsLow) -
+					(((u_int64)ev[i-1].tsHigh << 32) | ev[i-1].tsLow)) < 0)
+			ordered = 0;
+	}
+	CHECK(ordered);
+	CHECK(ev[0].dev == 0 && ev[1].dev == 1 && ev[2].dev == 2);
+	CHECK(Events(0, ev, EV_MAX) == 0);
+
+	/* exclusive member: reserved for the master */
+	Edge(1, state[1] ^ 0x8000);
+	CHECK(SetStat(1, M31_BLK_MODE, 0, M31_BLKMODE_EVENT) == 0);
+	CHECK(Read(1, ev, sizeof(ev)) == -ERR_LL_DEV_BUSY);
+	CHECK(GetStat(1, M31_CHANGE_FLAGS, 0, &value) == ERR_LL_DEV_BUSY);
+
+	/* shared member: first reader consumes */
+	CHECK(GetStat(2, M31_CHANGE_FLAGS, 0, &value) == 0);
+	Edge(2, state[2] ^ 0x8000);
+	CHECK(Events(2, ev, EV_MAX) == 1 && ev[0].change == 0x8000);
+	CHECK(GetStat(2, M31_CHANGE_FLAGS, 0, &value) == 0 && value == 0x8000);
+	n = Events(0, ev, EV_MAX);
+	CHECK(n == 1 && ev[0].dev == 1 && ev[0].change == 0x8000);
+
+	/* change flags of all modules (the shared member read its own) */
+	CHECK(GetBlk(0, M31_BLK_AGGR_CHANGE, flags, sizeof(flags)) == 0);
+	CHECK(flags[0] != 0 && (flags[1] & 0x8000) && flags[2] == 0);
+	CHECK(GetBlk(0, M31_BLK_AGGR_CHANGE, flags, sizeof(flags)) == 0);
+	CHECK(flags[0] == 0 && flags[1] == 0 && flags[2] == 0);
+
+	DevClose(2);
+	DevClose(1);
+	DevClose(0);
+}
+
+/********************************** ScIsr ***********************************
+ *
+ *  Description: ISR timing statistics
+ *
+ *               Every interrupt is measured (CPU counter only), the
+ *               histogram adds up to the count, M31_ISR_STAT_CLR clears.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScIsr(void)
+{
+	M31_ISR_STAT	st;
+	int32			value;
+	u_int32			n, sum;
+
+	CHECK(DevOpen(0, MOD_ID_M31, NULL) == 0);
+	CHECK(GetStat(0, M31_TS_FREQ, 0, &value) == 0 && value != 0);
+
+	for (n=0; n<10; n++)
+		Edge(0, (u_int16)((n + 1) & 1));
+
+	CHECK(GetBlk(0, M31_BLK_ISR_STAT, &st, sizeof(st)) == 0);
+#ifdef TS_CYCLE_COUNTER
+	CHECK(st.count == 10);
+	CHECK(st.max > 0 && (st.maxTsHigh || st.maxTsLow));
+#else
+	CHECK(st.count == 0);				/* ticks too coarse: not measured */
+#endif
+	for (sum=0, n=0; n<M31_HIST_BUCKETS; n++)
+		sum += st.hist[n];
+	CHECK(sum == st.count);
+
+	CHECK(SetStat(0, M31_ISR_STAT_CLR, 0, 0) == 0);
+	CHECK(GetBlk(0, M31_BLK_ISR_STAT, &st, sizeof(st)) == 0);
+	CHECK(st.count == 0 && st.max == 0);
+
+	DevClose(0);
+}
+
+/********************************* ScTrace **********************************
+ *
+ *  Description: Binary trace
+ *
+ *               Entry points and interrupts are recorded with code and
+ *               value, overwritten records are reported by M31_TR_LOST,
+ *               a disabled trace records nothing.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScTrace(void)
+{
+	static const char *keys[] = { "TRACE_SIZE=8", "TRACE_ENABLE=1", NULL };
+	M31_TRACE_REC	rec[16];
+	u_int32			n, cnt, setstat = 0, irq = 0;
+
+	CHECK(DevOpen(0, MOD_ID_M31, keys) == 0);
+	CHECK(GetBlk(0, M31_BLK_TRACE, rec, sizeof(rec)) == 0);
+
+	/* records of an entry point and an interrupt */
+	CHECK(SetStat(0, M31_SIG_MASK, 0, 0xffff) == 0);
+	Edge(0, 0x0003);
+	memset(rec, 0, sizeof(rec));
+	CHECK(GetBlk(0, M31_BLK_TRACE, rec, sizeof(rec)) == 0);
+	for (n=0; n<16 && rec[n].code; n++) {
+		if (rec[n].code == M31_TR_SETSTAT &&
+			rec[n].value == (u_int32)M31_SIG_MASK)
+			setstat++;
+		if (rec[n].code == M31_TR_IRQ && rec[n].value == 0x00030003)
+			irq++;
+	}
+	CHECK(setstat == 1 && irq == 1);
+
+	/* overwritten records */
+	for (n=0; n<20; n++)
+		Edge(0, (u_int16)(n & 1));
+	memset(rec, 0, sizeof(rec));
+	CHECK(GetBlk(0, M31_BLK_TRACE, rec, sizeof(rec)) == 0);
+	for (cnt=0; cnt<16 && rec[cnt].code; cnt++)
+		;
+	CHECK(rec[0].code == M31_TR_LOST && rec[0].value > 0);
+	CHECK(cnt <= 9);
+
+	/* disabled */
+	CHECK(SetStat(0, M31_TRACE_ENABLE, 0, 0) == 0);
+	CHECK(GetBlk(0, M31_BLK_TRACE, rec, sizeof(rec)) == 0);
+	Edge(0, 0x0000);
+	memset(rec, 0, sizeof(rec));
+	CHECK(GetBlk(0, M31_BLK_TRACE, rec, sizeof(rec)) == 0);
+	CHECK(rec[0].code == 0);
+
+	DevClose(0);
+}
+
+/********************************** ScLost **********************************
+ *
+ *  Description: Lost edge accounting
+ *
+ *               An interrupt without visible change after a single-channel
+ *               change is counted for that channel and reported as event
+ *               with M31_EVF_LOST_EDGE, after a multi-channel change it is
+ *               only counted as unattributed.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScLost(void)
+{
+	M31_EVENT		ev[EV_MAX];
+	M31_LOST_STAT	st;
+	M31_LAST_CHANGE	lc[16];
+	int32			value;
+
+	CHECK(DevOpen(0, MOD_ID_M31, NULL) == 0);
+
+	/* double toggle of channel 2 */
+	Edge(0, 0x0004);
+	Edge(0, 0x0004);
+	CHECK(Events(0, ev, EV_MAX) == 2 && ev[0].flags == 0 &&
+		  ev[1].change == 0x0004 && ev[1].flags == M31_EVF_LOST_EDGE);
+	CHECK(GetStat(0, M31_LOST_EDGES, 2, &value) == 0 && value == 1);
+	CHECK(GetBlk(0, M31_BLK_LAST_CHANGE, lc, sizeof(lc)) == 0);
+	CHECK(lc[2].valid && (lc[2].flags & M31_EVF_LOST_EDGE));
+
+	/* double toggle after a multi-channel change: not attributable */
+	Edge(0, 0x0003);
+	Edge(0, 0x0003);
+	CHECK(Events(0, ev, EV_MAX) == 1 && ev[0].change == 0x0007 &&
+		  ev[0].flags == 0);
+	CHECK(GetBlk(0, M31_BLK_LAST_CHANGE, lc, sizeof(lc)) == 0);
+	CHECK(lc[2].valid && !(lc[2].flags & M31_EVF_LOST_EDGE));
+
+	CHECK(GetBlk(0, M31_BLK_LOST_EDGES, &st, sizeof(st)) == 0);
+	CHECK(st.irqs == 2 && st.unattributed == 1 && st.ch[2] == 1 &&
+		  st.ch[0] == 0 && st.ch[1] == 0);
+
+	CHECK(SetStat(0, M31_LOST_EDGES, 2, 0) == 0);
+	CHECK(GetStat(0, M31_LOST_EDGES, 2, &value) == 0 && value == 0);
+
+	DevClose(0);
+}
+
+/******************************** ScCapture *********************************
+ *
+ *  Description: Sampling capture
+ *
+ *               Periods below the OSS tick are rejected, mask 0 triggers on
+ *               the first sample, a trigger pattern keeps the pre-trigger
+ *               samples, settings are locked while sampling.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScCapture(void)
+{
+	static const char *keys[] = { "CAP_BUF_SIZE=256", NULL };
+	M31_CAP_INFO	info;
+	u_int16			smp[256];
+	int32			value, nbr;
+	u_int32			n, bad;
+
+	CHECK(DevOpen(0, MOD_ID_M31, keys) == 0);
+	CHECK(GetStat(0, M31_CAP_PERIOD, 0, &value) == 0 && value == 1000);
+	CHECK(SetStat(0, M31_CAP_PERIOD, 0, 500) == ERR_LL_ILL_PARAM);
+	CHECK(SetStat(0, M31_CAP_PERIOD, 0, 2000) == 0);
+	CHECK(GetStat(0, M31_CAP_PERIOD, 0, &value) == 0 && value == 2000);
+
+	/* immediate trigger */
+	Input(0, 0x00aa);
+	CHECK(SetStat(0, M31_CAP_CTRL, 0, M31_CAP_START) == 0);
+	CHECK(SetStat(0, M31_CAP_PERIOD, 0, 1000) == ERR_LL_DEV_BUSY);
+	OSS_Delay(NULL, 50);
+	CHECK(GetStat(0, M31_CAP_CTRL, 0, &value) == 0 &&
+		  value == M31_CAPST_TRIGGERED);
+	CHECK(SetStat(0, M31_CAP_CTRL, 0, M31_CAP_STOP) == 0);
+	CHECK(GetBlk(0, M31_BLK_CAP_INFO, &info, sizeof(info)) == 0);
+	CHECK(info.state == M31_CAPST_STOPPED && info.period == 2000);
+	CHECK(info.count >= 5 && info.count <= 26 && info.lost == 0);
+
+	CHECK(SetStat(0, M31_BLK_MODE, 0, M31_BLKMODE_CAPTURE) == 0);
+	nbr = Read(0, smp, sizeof(smp));
+	CHECK(nbr == (int32)(info.count * sizeof(u_int16)));
+	for (bad=0, n=0; n<info.count; n++)
+		if (smp[n] != 0x00aa)
+			bad++;
+	CHECK(bad == 0);
+
+	/* trigger pattern with pre-trigger samples */
+	CHECK(SetStat(0, M31_CAP_PERIOD, 0, 1000) == 0);
+	CHECK(SetStat(0, M31_CAP_TRIG_MASK, 0, 0x0001) == 0);
+	CHECK(SetStat(0, M31_CAP_TRIG_VALUE, 0, 0x0001) == 0);
+	CHECK(SetStat(0, M31_CAP_PRETRIG, 0, 4) == 0);
+	Input(0, 0x0000);
+	CHECK(SetStat(0, M31_CAP_CTRL, 0, M31_CAP_START) == 0);
+	OSS_Delay(NULL, 20);
+	CHECK(GetStat(0, M31_CAP_CTRL, 0, &value) == 0 &&
+		  value == M31_CAPST_ARMED);
+	Input(0, 0x0001);
+	OSS_Delay(NULL, 20);
+	CHECK(SetStat(0, M31_CAP_CTRL, 0, M31_CAP_STOP) == 0);
+	CHECK(GetBlk(0, M31_BLK_CAP_INFO, &info, sizeof(info)) == 0);
+	CHECK(info.preTrig == 4 && info.count > 4);
+	CHECK(info.trigTsHigh || info.trigTsLow);
+
+	nbr = Read(0, smp, sizeof(smp));
+	CHECK(nbr == (int32)(info.count * sizeof(u_int16)));
+	CHECK(smp[0] == 0 && smp[3] == 0 && smp[4] == 1);
+
+	DevClose(0);
+}
+
+/********************************** ScRle ***********************************
+ *
+ *  Description: Run length encoded capture
+ *
+ *               Equal samples are merged into runs, the runs add up to the
+ *               number of samples taken.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScRle(void)
+{
+	static const char *keys[] = { "CAP_BUF_SIZE=64", NULL };
+	M31_CAP_INFO	info;
+	M31_RLE_REC		rec[64];
+	int32			value, nbr;
+	u_int32			n, runs, sum, order = 1;
+
+	CHECK(DevOpen(0, MOD_ID_M31, keys) == 0);
+	CHECK(SetStat(0, M31_CAP_FORMAT, 0, M31_CAPFMT_RLE) == 0);
+	CHECK(GetStat(0, M31_CAP_FORMAT, 0, &value) == 0 &&
+		  value == M31_CAPFMT_RLE);
+
+	Input(0, 0x0005);
+	CHECK(SetStat(0, M31_CAP_CTRL, 0, M31_CAP_START) == 0);
+	OSS_Delay(NULL, 30);
+	Input(0, 0x0006);
+	OSS_Delay(NULL, 30);
+	CHECK(SetStat(0, M31_CAP_CTRL, 0, M31_CAP_STOP) == 0);
+	CHECK(GetBlk(0, M31_BLK_CAP_INFO, &info, sizeof(info)) == 0);
+	CHECK(info.lost == 0);
+
+	CHECK(SetStat(0, M31_BLK_MODE, 0, M31_BLKMODE_CAPTURE) == 0);
+	nbr = Read(0, rec, sizeof(rec));
+	runs = nbr > 0 ? nbr / sizeof(M31_RLE_REC) : 0;
+	CHECK(runs >= 2 && runs < 8);		/* far fewer than samples */
+
+	/* runs of 5, then runs of 6 */
+	for (sum=0, n=0; n<runs; n++) {
+		sum += rec[n].count;
+		if (rec[n].count == 0 ||
+			(rec[n].state != 0x0005 && rec[n].state != 0x0006) ||
+			(n && rec[n-1].state == 0x0006 && rec[n].state == 0x0005))
+			order = 0;
+	}
+	CHECK(order);
+	CHECK(runs && rec[0].state == 0x0005 && rec[runs-1].state == 0x0006);
+	CHECK(sum >= 40 && sum <= 70);
+
+	DevClose(0);
+}
+
+/********************************* ScIdProm *********************************
+ *
+ *  Description: ID PROM cache and deferred ID check
+ *
+ *               Init reads only the magic word and the module ID, the
+ *               other words are read on the first M_LL_BLK_ID_DATA and
+ *               cached until M31_ID_REFRESH. A wrong ID fails the init,
+ *               with ID_DEFER=1 the first use of the ID.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: G_dev
+ ****************************************************************************/
+static void ScIdProm(void)
+{
+	static const char *defer[] = { "ID_DEFER=1", NULL };
+	u_int16		id[MOD_ID_SIZE/2];
+	u_int32		n;
+
+	CHECK(DevOpen(0, MOD_ID_M31, NULL) == 0);
+	CHECK(G_dev[0].llHdl->idRead && !G_dev[0].llHdl->idFull);
+
+	/* written after init: only visible if read on demand */
+	for (n=2; n<MOD_ID_SIZE/2; n++)
+		G_dev[0].dev.idProm[n] = (u_int16)(0x3100 + n);
+	CHECK(GetBlk(0, M_LL_BLK_ID_DATA, id, sizeof(id)) == 0);
+	CHECK(id[0] == MOD_ID_MAGIC && id[1] == MOD_ID_M31 &&
+		  id[2] == 0x3102 && id[63] == 0x313f);
+
+	/* cached until refreshed */
+	G_dev[0].dev.idProm[2] = 0x4242;
+	CHECK(GetBlk(0, M_LL_BLK_ID_DATA, id, sizeof(id)) == 0 &&
+		  id[2] == 0x3102);
+	CHECK(SetStat(0, M31_ID_REFRESH, 0, 0) == 0);
+	CHECK(GetBlk(0, M_LL_BLK_ID_DATA, id, sizeof(id)) == 0 &&
+		  id[2] == 0x4242);
+	DevClose(0);
+
+	/* wrong module */
+	CHECK(DevOpen(0, 0x0031, NULL) == ERR_LL_ILL_ID);
+	G_dev[0].llHdl = NULL;
+
+	/* deferred: init succeeds, the refresh reports the wrong ID */
+	CHECK(DevOpen(0, 0x0031, defer) == 0);
+	CHECK(!G_dev[0].llHdl->idRead);
+	CHECK(SetStat(0, M31_ID_REFRESH, 0, 0) == ERR_LL_ILL_ID);
+	DevClose(0);
+}
+
+/********************************** ScHys ***********************************
+ *
+ *  Description: Hysteresis configuration (M82)
+ *
+ *               MODE_REG is read once into the shadow, per-channel and
+ *               bulk changes are written from the shadow, HYS_MODE sets
+ *               all channels at init. M31 modules don't support it.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: G_dev
+ ****************************************************************************/
+static void ScHys(void)
+{
+	static const char *keys[] = { "HYS_MODE=771", NULL };
+	u_int16		*modeReg = &G_dev[0].dev.regs[MODE_REG/2];
+	int32		value;
+
+	CHECK(DevOpen(0, MOD_ID_M82, NULL) == 0);
+
+	/* shadow loaded on first use */
+	*modeReg = 0x00f0;
+	CHECK(GetStat(0, M31_HYS_MASK, 0, &value) == 0 && value == 0x00f0);
+	*modeReg = 0x1111;
+	CHECK(GetStat(0, M31_HYS_MASK, 0, &value) == 0 && value == 0x00f0);
+
+	CHECK(SetStat(0, M31_HYS_MODE, 0, 1) == 0);
+	CHECK(*modeReg == 0x00f1);
+	CHECK(SetStat(0, M31_HYS_MASK, 0, 0xa5a5) == 0);
+	CHECK(*modeReg == 0xa5a5);
+	CHECK(GetStat(0, M31_HYS_MODE, 0, &value) == 0 && value == 1);
+	CHECK(GetStat(0, M31_HYS_MODE, 1, &value) == 0 && value == 0);
+	DevClose(0);
+
+	/* descriptor */
+	CHECK(DevOpen(0, MOD_ID_M82, keys) == 0);
+	CHECK(*modeReg == 0x0303);
+	DevClose(0);
+
+	/* not supported */
+	CHECK(DevOpen(0, MOD_ID_M31, keys) == 0);
+	CHECK(*modeReg == 0);
+	CHECK(GetStat(0, M31_HYS_MASK, 0, &value) == ERR_LL_UNK_CODE);
+	CHECK(SetStat(0, M31_HYS_MODE, 0, 1) == ERR_LL_UNK_CODE);
+	DevClose(0);
+}
+
+/********************************* ScPreset *********************************
+ *
+ *  Description: Descriptor preset notification, signal coalescing
+ *
+ *               The descriptor keys select the reported edges, the
+ *               signalling channels, the coalescing window and the event
+ *               FIFO size (rounded down to a power of 2). Within the
+ *               window, the first edge signals at once and further edges
+ *               send one deferred signal; a window change sends a
+ *               deferred signal.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: G_sigCount
+ ****************************************************************************/
+static void ScPreset(void)
+{
+	static const char *keys[] = { "EVENT_BUF_SIZE=6", "EDGE_RISE=1",
+								  "EDGE_FALL=2", "SIG_MASK=2",
+								  "SIG_COALESCE=30", NULL };
+	M31_EVENT	ev[EV_MAX];
+	int32		value;
+	u_int32		i;
+
+	CHECK(DevOpen(0, MOD_ID_M31, keys) == 0);
+	CHECK(GetStat(0, M31_EDGE_RISE, 0, &value) == 0 && value == 0x0001);
+	CHECK(GetStat(0, M31_EDGE_FALL, 0, &value) == 0 && value == 0x0002);
+	CHECK(GetStat(0, M31_SIG_MASK, 0, &value) == 0 && value == 0x0002);
+	CHECK(GetStat(0, M31_SIG_COALESCE, 0, &value) == 0 && value == 30);
+	CHECK(SetStat(0, M31_SIGSET, 0, 10) == 0);
+
+	/* only selected edges are reported, only ch1 signals */
+	Edge(0, 0x0001);
+	CHECK(G_sigCount == 0);
+	Edge(0, 0x0000);
+	Edge(0, 0x0002);
+	Edge(0, 0x0000);
+	CHECK(G_sigCount == 1);
+	CHECK(GetStat(0, M31_EVENT_COUNT, 0, &value) == 0 && value == 2);
+	CHECK(Events(0, ev, EV_MAX) == 2 &&
+		  ev[0].change == 0x0001 && ev[0].state == 0x0001 &&
+		  ev[1].change == 0x0002 && ev[1].state == 0x0000);
+
+	/* FIFO of 4 records: the fifth is lost, the next one flagged */
+	for (i=0; i<5; i++) {
+		Edge(0, 0x0001);
+		Edge(0, 0x0000);
+	}
+	CHECK(GetStat(0, M31_EVENT_COUNT, 0, &value) == 0 && value == 4);
+	CHECK(GetStat(0, M31_EVENT_LOST, 0, &value) == 0 && value == 1);
+	CHECK(Events(0, ev, EV_MAX) == 4 &&
+		  !(ev[3].flags & M31_EVF_OVERRUN));
+	Edge(0, 0x0001);
+	CHECK(Events(0, ev, EV_MAX) == 1 && (ev[0].flags & M31_EVF_OVERRUN));
+	CHECK(SetStat(0, M31_EVENT_LOST, 0, 0) == 0);
+	CHECK(GetStat(0, M31_EVENT_LOST, 0, &value) == 0 && value == 0);
+
+	/* coalescing: one deferred signal for edges within the window */
+	OSS_Delay(NULL, 80);
+	G_sigCount = 0;
+	Edge(0, 0x0002);
+	Edge(0, 0x0000);
+	CHECK(G_sigCount == 1);
+	Edge(0, 0x0002);
+	Edge(0, 0x0000);
+	Edge(0, 0x0002);
+	Edge(0, 0x0000);
+	CHECK(G_sigCount == 1);
+	OSS_Delay(NULL, 80);
+	CHECK(G_sigCount == 2);
+
+	/* quiet: no further signal */
+	OSS_Delay(NULL, 80);
+	CHECK(G_sigCount == 2);
+
+	/* deferred signal sent by a window change */
+	Edge(0, 0x0002);
+	Edge(0, 0x0000);
+	CHECK(G_sigCount == 3);
+	Edge(0, 0x0002);
+	Edge(0, 0x0000);
+	CHECK(G_sigCount == 3);
+	CHECK(SetStat(0, M31_SIG_COALESCE, 0, 0) == 0);
+	CHECK(G_sigCount == 4);
+	Edge(0, 0x0002);
+	Edge(0, 0x0000);
+	CHECK(G_sigCount == 5);
+
+	CHECK(SetStat(0, M31_SIGCLR, 0, 0) == 0);
+	DevClose(0);
+}
+
+/******************************** ScDebounce ********************************
+ *
+ *  Description: Debounced channels
+ *
+ *               A level stable for the debounce time is reported once
+ *               with the deadline as timestamp, a shorter pulse counts as
+ *               glitch. The debounce timer is only armed while a window
+ *               is running.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScDebounce(void)
+{
+	static const char *keys[] = { "DEBOUNCE_3=5000", NULL };
+	M31_EVENT	ev[EV_MAX];
+	int32		value;
+
+	CHECK(DevOpen(0, MOD_ID_M31, keys) == 0);
+	CHECK(GetStat(0, M31_DEBOUNCE, 3, &value) == 0 && value == 5000);
+	CHECK(GetStat(0, M31_DEBOUNCE, 2, &value) == 0 && value == 0);
+	CHECK(DbArmed(0) == 0);
+
+	/* settled edge: reported by the timer */
+	Edge(0, 0x0008);
+	CHECK(DbArmed(0) == 1);
+	CHECK(Events(0, ev, EV_MAX) == 0);
+	OSS_Delay(NULL, 20);
+	CHECK(Events(0, ev, EV_MAX) == 1 && ev[0].change == 0x0008 &&
+		  ev[0].state == 0x0008);
+	CHECK(DbArmed(0) == 0);
+
+	/* glitch: back within the window */
+	Edge(0, 0x0000);
+	Edge(0, 0x0008);
+	OSS_Delay(NULL, 20);
+	CHECK(Events(0, ev, EV_MAX) == 0);
+	CHECK(GetStat(0, M31_GLITCHES, 3, &value) == 0 && value == 1);
+	CHECK(DbArmed(0) == 0);
+
+	/* undebounced channel: reported at the edge, timer stays idle */
+	Edge(0, 0x0009);
+	CHECK(Events(0, ev, EV_MAX) == 1 && ev[0].change == 0x0001);
+	CHECK(DbArmed(0) == 0);
+
+	/* debounce off: pending window dropped, edges reported at once */
+	Edge(0, 0x0001);
+	CHECK(SetStat(0, M31_DEBOUNCE, 3, 0) == 0);
+	OSS_Delay(NULL, 20);
+	CHECK(Events(0, ev, EV_MAX) == 0);
+	CHECK(DbArmed(0) == 0);
+	Edge(0, 0x0009);
+	CHECK(Events(0, ev, EV_MAX) == 1 && ev[0].change == 0x0008);
+
+	DevClose(0);
+}
+
+/********************************** ScQuad **********************************
+ *
+ *  Description: Quadrature decoder
+ *
+ *               Pair 1 (channels 2/3) is enabled by descriptor. Each legal
+ *               transition moves the position by one, a transition of both
+ *               channels counts as error; undecoded pairs stay at 0.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScQuad(void)
+{
+	static const char *keys[] = { "QUAD_MASK=2", NULL };
+	M31_QUAD	quad[8];
+	int32		value;
+
+	CHECK(DevOpen(0, MOD_ID_M31, keys) == 0);
+	CHECK(GetStat(0, M31_QUAD_MASK, 0, &value) == 0 && value == 0x02);
+
+	/* forward: A leads B */
+	Edge(0, 0x0004);
+	Edge(0, 0x000c);
+	Edge(0, 0x0008);
+	Edge(0, 0x0000);
+	CHECK(GetStat(0, M31_QUAD_POS, 2, &value) == 0 && value == 4);
+	CHECK(GetStat(0, M31_QUAD_DIR, 3, &value) == 0 && value == 1);
+
+	/* backward */
+	Edge(0, 0x0008);
+	Edge(0, 0x000c);
+	CHECK(GetStat(0, M31_QUAD_POS, 2, &value) == 0 && value == 2);
+	CHECK(GetStat(0, M31_QUAD_DIR, 2, &value) == 0 && value == -1);
+
+	/* both channels changed: error, position kept */
+	Edge(0, 0x0000);
+	CHECK(GetStat(0, M31_QUAD_POS, 2, &value) == 0 && value == 2);
+	CHECK(GetStat(0, M31_QUAD_ERRORS, 2, &value) == 0 && value == 1);
+
+	/* undecoded pair */
+	Edge(0, 0x0001);
+	Edge(0, 0x0003);
+	CHECK(GetStat(0, M31_QUAD_POS, 0, &value) == 0 && value == 0);
+
+	CHECK(GetBlk(0, M31_BLK_QUAD, quad, sizeof(quad)) == 0 &&
+		  quad[1].pos == 2 && quad[1].dir == -1 && quad[1].errors == 1 &&
+		  quad[0].pos == 0 && quad[0].errors == 0);
+
+	/* preset, limits */
+	CHECK(SetStat(0, M31_QUAD_POS, 3, -100) == 0);
+	CHECK(SetStat(0, M31_QUAD_ERRORS, 3, 0) == 0);
+	Edge(0, 0x0007);
+	CHECK(GetStat(0, M31_QUAD_POS, 2, &value) == 0 && value == -99);
+	CHECK(GetStat(0, M31_QUAD_ERRORS, 2, &value) == 0 && value == 0);
+	CHECK(SetStat(0, M31_QUAD_MASK, 0, 0x100) == ERR_LL_ILL_PARAM);
+
+	/* decoder off */
+	CHECK(SetStat(0, M31_QUAD_MASK, 0, 0) == 0);
+	Edge(0, 0x0003);
+	CHECK(GetStat(0, M31_QUAD_POS, 2, &value) == 0 && value == -99);
+
+	DevClose(0);
+}
+
+/********************************* ScStrobe *********************************
+ *
+ *  Description: Strobed word mode
+ *
+ *               The data word is latched on the selected strobe edge
+ *               without the strobe bit. A lost edge attributed to the
+ *               strobe channel flags the next word, a full FIFO counts
+ *               lost words. Without word FIFO the mode can't be set.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScStrobe(void)
+{
+	static const char *keys[] = { "STROBE_BUF_SIZE=4", NULL };
+	static const char *noFifo[] = { "STROBE_BUF_SIZE=0", NULL };
+	M31_STROBE_REC	rec[8];
+	int32			value, nbr;
+	u_int32			i;
+
+	CHECK(DevOpen(0, MOD_ID_M31, keys) == 0);
+	CHECK(SetStat(0, M31_STROBE_CH, 0, 15) == 0);
+	CHECK(SetStat(0, M31_STROBE_EDGE, 0, M31_STROBE_RISE) == 0);
+	CHECK(SetStat(0, M31_BLK_MODE, 0, M31_BLKMODE_STROBE) == 0);
+
+	/* rising edge only */
+	Edge(0, 0x00a5);
+	Edge(0, 0x80a5);
+	Edge(0, 0x005a);
+	Edge(0, 0x805a);
+	CHECK(GetStat(0, M31_STROBE_COUNT, 0, &value) == 0 && value == 2);
+	nbr = Read(0, rec, sizeof(rec));
+	CHECK(nbr == 2 * sizeof(M31_STROBE_REC) &&
+		  rec[0].data == 0x00a5 && rec[0].seq == 0 && rec[0].flags == 0 &&
+		  rec[1].data == 0x005a && rec[1].seq == 1);
+
+	/* both edges, lost strobe edge flags the next word */
+	CHECK(SetStat(0, M31_STROBE_EDGE, 0, M31_STROBE_BOTH) == 0);
+	Edge(0, 0x0011);
+	Edge(0, 0x8011);
+	Edge(0, 0x8011);
+	Edge(0, 0x0011);
+	nbr = Read(0, rec, sizeof(rec));
+	CHECK(nbr == 3 * sizeof(M31_STROBE_REC) &&
+		  rec[0].data == 0x0011 && rec[0].flags == 0 &&
+		  rec[1].data == 0x0011 && rec[1].flags == 0 &&
+		  rec[2].data == 0x0011 && rec[2].flags == M31_EVF_LOST_EDGE);
+
+	/* full FIFO */
+	for (i=0; i<3; i++) {
+		Edge(0, 0x8011);
+		Edge(0, 0x0011);
+	}
+	CHECK(GetStat(0, M31_STROBE_COUNT, 0, &value) == 0 && value == 4);
+	CHECK(GetStat(0, M31_STROBE_LOST, 0, &value) == 0 && value == 2);
+	nbr = Read(0, rec, sizeof(rec));
+	CHECK(nbr == 4 * sizeof(M31_STROBE_REC) && rec[0].seq == 5 &&
+		  rec[3].seq == 8);
+	Edge(0, 0x8011);
+	CHECK(Read(0, rec, sizeof(rec)) == sizeof(M31_STROBE_REC) &&
+		  rec[0].seq == 11);
+	CHECK(SetStat(0, M31_STROBE_LOST, 0, 0) == 0);
+
+	/* limits, mode off */
+	CHECK(SetStat(0, M31_STROBE_CH, 0, 16) == ERR_LL_ILL_PARAM);
+	CHECK(SetStat(0, M31_STROBE_EDGE, 0, 4) == ERR_LL_ILL_PARAM);
+	CHECK(SetStat(0, M31_STROBE_EDGE, 0, M31_STROBE_OFF) == 0);
+	Edge(0, 0x0011);
+	Edge(0, 0x8011);
+	CHECK(GetStat(0, M31_STROBE_COUNT, 0, &value) == 0 && value == 0);
+	DevClose(0);
+
+	/* no word FIFO */
+	CHECK(DevOpen(0, MOD_ID_M31, noFifo) == 0);
+	CHECK(SetStat(0, M31_STROBE_CH, 0, 15) == ERR_LL_ILL_PARAM);
+	CHECK(SetStat(0, M31_STROBE_EDGE, 0, M31_STROBE_RISE) ==
+		  ERR_LL_ILL_PARAM);
+	DevClose(0);
+}
+
+/********************************** ScField *********************************
+ *
+ *  Description: Channel fields
+ *
+ *               A Gray coded field without settle time reports each new
+ *               value at once, a BCD field with settle time the settled
+ *               value only. Invalid codes are counted, a return to the
+ *               old value isn't reported. Fields are defined by
+ *               descriptor or M31_BLK_FIELD_DEF and must not overlap.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScField(void)
+{
+	static const char *keys[] = { "FIELD_0_WIDTH=4", "FIELD_0_CH=0",
+								  "FIELD_0_CODE=1", "FIELD_0_NAME=pos",
+								  "FIELD_1_WIDTH=8", "FIELD_1_CH=8",
+								  "FIELD_1_CODE=2", "FIELD_1_SETTLE=5000",
+								  "FIELD_1_NAME=bcd", NULL };
+	M31_FIELD_DEF	def[M31_FIELD_MAX];
+	M31_FIELD_STAT	stat[M31_FIELD_MAX];
+	M31_EVENT		ev[EV_MAX];
+	int32			value;
+
+	CHECK(DevOpen(0, MOD_ID_M31, keys) == 0);
+	CHECK(GetBlk(0, M31_BLK_FIELD_DEF, def, sizeof(def)) == 0 &&
+		  !strcmp(def[0].name, "pos") && def[0].first == 0 &&
+		  def[0].width == 4 && def[0].code == M31_FLDCODE_GRAY &&
+		  !strcmp(def[1].name, "bcd") && def[1].first == 8 &&
+		  def[1].width == 8 && def[1].code == M31_FLDCODE_BCD &&
+		  def[1].settle == 5000 && def[2].width == 0);
+	CHECK(GetStat(0, M31_FIELD_VALUE, 0, &value) == 0 && value == 0);
+
+	/* Gray code: reported at once */
+	Edge(0, 0x0001);
+	Edge(0, 0x0003);
+	CHECK(GetStat(0, M31_FIELD_VALUE, 2, &value) == 0 && value == 2);
+	CHECK(Events(0, ev, EV_MAX) == 2 &&
+		  ev[0].flags == M31_EVF_FIELD && ev[0].change == 0x000f &&
+		  ev[1].flags == M31_EVF_FIELD && ev[1].state == 0x0003);
+
+	/* BCD: settled value only */
+	Edge(0, 0x0103);
+	Edge(0, 0x2303);
+	CHECK(Events(0, ev, EV_MAX) == 0);
+	OSS_Delay(NULL, 20);
+	CHECK(GetStat(0, M31_FIELD_VALUE, 8, &value) == 0 && value == 23);
+	CHECK(Events(0, ev, EV_MAX) == 1 &&
+		  ev[0].flags == M31_EVF_FIELD && ev[0].change == 0xff00 &&
+		  ev[0].state == 0x2303);
+
+	/* invalid code, back to the old value */
+	Edge(0, 0x0a03);
+	OSS_Delay(NULL, 20);
+	Edge(0, 0x2303);
+	OSS_Delay(NULL, 20);
+	CHECK(Events(0, ev, EV_MAX) == 0);
+	CHECK(GetBlk(0, M31_BLK_FIELD_STAT, stat, sizeof(stat)) == 0 &&
+		  stat[1].value == 23 && stat[1].valid && !stat[1].pending &&
+		  stat[1].changes == 1 && stat[1].invalid == 1 &&
+		  stat[0].value == 2 && stat[0].changes == 2);
+
+	/* overlap, no field */
+	memset(def, 0, sizeof(def));
+	def[0].field = 2;
+	def[0].first = 2;
+	def[0].width = 4;
+	CHECK(SetBlk(0, M31_BLK_FIELD_DEF, def, sizeof(def[0])) ==
+		  ERR_LL_ILL_PARAM);
+	CHECK(GetStat(0, M31_FIELD_VALUE, 4, &value) == ERR_LL_ILL_PARAM);
+
+	/* undefined field: plain edges */
+	def[0].field = 0;
+	def[0].width = 0;
+	CHECK(SetBlk(0, M31_BLK_FIELD_DEF, def, sizeof(def[0])) == 0);
+	Edge(0, 0x2302);
+	CHECK(Events(0, ev, EV_MAX) == 1 &&
+		  ev[0].flags == 0 && ev[0].change == 0x0001);
+
+	DevClose(0);
+}
+
+/********************************** ScRule **********************************
+ *
+ *  Description: Sequence rules
+ *
+ *               Rule 0: ch1 rises within 30ms after ch0 rose, rule 1: ch2
+ *               high for 20ms, rule 2: ch4 low when ch3 rises. Windows and
+ *               hold times run out in the timer. The channel edges aren't
+ *               reported, so the events are the rule results.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScRule(void)
+{
+	static const char *keys[] = { "EDGE_RISE=0", "EDGE_FALL=0", NULL };
+	M31_RULE		rule[M31_RULE_MAX];
+	M31_RULE_STAT	stat[M31_RULE_MAX];
+	M31_EVENT		ev[EV_MAX];
+
+	memset(rule, 0, sizeof(rule));
+	rule[0].step[0].op   = M31_ROP_RISE;
+	rule[0].step[0].ch   = 0;
+	rule[0].step[1].op   = M31_ROP_RISE;
+	rule[0].step[1].ch   = 1;
+	rule[0].step[1].time = 30;
+	rule[1].step[0].op   = M31_ROP_HIGH;
+	rule[1].step[0].ch   = 2;
+	rule[1].step[0].time = 20;
+	rule[2].step[0].op   = M31_ROP_RISE;
+	rule[2].step[0].ch   = 3;
+	rule[2].step[1].op   = M31_ROP_LOW;
+	rule[2].step[1].ch   = 4;
+
+	CHECK(DevOpen(0, MOD_ID_M31, keys) == 0);
+	CHECK(SetBlk(0, M31_BLK_RULES, rule, 3 * sizeof(M31_RULE)) == 0);
+	memset(rule, 0xff, sizeof(rule));
+	CHECK(GetBlk(0, M31_BLK_RULES, rule, sizeof(rule)) == 0 &&
+		  rule[0].step[1].op == M31_ROP_RISE &&
+		  rule[0].step[1].time == 30 && rule[1].step[0].ch == 2 &&
+		  rule[2].step[2].op == M31_ROP_END &&
+		  rule[3].step[0].op == M31_ROP_END);
+
+	/* edge within window: done, window expired: violated */
+	Edge(0, 0x0001);
+	Edge(0, 0x0003);
+	CHECK(Events(0, ev, EV_MAX) == 1 && ev[0].flags == M31_EVF_RULE &&
+		  ev[0].change == 0x0001);
+	Edge(0, 0x0000);
+	Edge(0, 0x0001);
+	OSS_Delay(NULL, 60);
+	CHECK(Events(0, ev, EV_MAX) == 1 &&
+		  ev[0].flags == (M31_EVF_RULE | M31_EVF_VIOLATED) &&
+		  ev[0].change == 0x0001);
+
+	/* hold time: passed, interrupted */
+	Edge(0, 0x0005);
+	OSS_Delay(NULL, 60);
+	CHECK(Events(0, ev, EV_MAX) == 1 && ev[0].flags == M31_EVF_RULE &&
+		  ev[0].change == 0x0002);
+	Edge(0, 0x0001);
+	Edge(0, 0x0005);
+	Edge(0, 0x0001);
+	OSS_Delay(NULL, 60);
+	CHECK(Events(0, ev, EV_MAX) == 0);
+
+	/* level on entry: met, not met */
+	Edge(0, 0x0009);
+	Edge(0, 0x0001);
+	Edge(0, 0x0011);
+	Edge(0, 0x0019);
+	CHECK(Events(0, ev, EV_MAX) == 2 &&
+		  ev[0].flags == M31_EVF_RULE && ev[0].change == 0x0004 &&
+		  ev[1].flags == (M31_EVF_RULE | M31_EVF_VIOLATED) &&
+		  ev[1].change == 0x0004);
+
+	CHECK(GetBlk(0, M31_BLK_RULE_STAT, stat, sizeof(stat)) == 0 &&
+		  stat[0].done == 1 && stat[0].violated == 1 &&
+		  stat[1].done == 1 && stat[1].violated == 0 &&
+		  stat[2].done == 1 && stat[2].violated == 1 &&
+		  stat[0].active && stat[2].active && !stat[3].active &&
+		  stat[0].step == 0);
+
+	/* illegal tables */
+	memset(rule, 0, sizeof(rule));
+	rule[0].step[0].op = M31_ROP_LOW + 1;
+	CHECK(SetBlk(0, M31_BLK_RULES, rule, sizeof(M31_RULE)) ==
+		  ERR_LL_ILL_PARAM);
+	rule[0].step[0].op = M31_ROP_RISE;
+	rule[0].step[0].ch = 16;
+	CHECK(SetBlk(0, M31_BLK_RULES, rule, sizeof(M31_RULE)) ==
+		  ERR_LL_ILL_PARAM);
+	CHECK(SetBlk(0, M31_BLK_RULES, rule, sizeof(M31_RULE) - 1) ==
+		  ERR_LL_ILL_PARAM);
+
+	/* unload */
+	CHECK(SetBlk(0, M31_BLK_RULES, rule, 0) == 0);
+	CHECK(GetBlk(0, M31_BLK_RULE_STAT, stat, sizeof(stat)) == 0 &&
+		  !stat[0].active && stat[0].done == 0);
+	Edge(0, 0x0000);
+	Edge(0, 0x0001);
+	CHECK(Events(0, ev, EV_MAX) == 0);
+
+	DevClose(0);
+}
+
+/******************************** ScLastChange ******************************
+ *
+ *  Description: Last change per channel
+ *
+ *               Each channel keeps the timestamp of its last change (the
+ *               event timestamp) and the new level. A lost edge attributed
+ *               to the channel is flagged until its next change.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void ScLastChange(void)
+{
+	M31_LAST_CHANGE	lc[16];
+	M31_EVENT		ev[EV_MAX];
+
+	CHECK(DevOpen(0, MOD_ID_M31, NULL) == 0);
+	CHECK(GetBlk(0, M31_BLK_LAST_CHANGE, lc, sizeof(lc)) == 0 &&
+		  !lc[0].valid && !lc[15].valid);
+
+	Edge(0, 0x0001);
+	OSS_Delay(NULL, 2);
+	Edge(0, 0x0003);
+	CHECK(Events(0, ev, EV_MAX) == 2);
+	CHECK(GetBlk(0, M31_BLK_LAST_CHANGE, lc, sizeof(lc)) == 0 &&
+		  lc[0].valid && lc[0].level == 1 && lc[0].flags == 0 &&
+		  lc[0].tsHigh == ev[0].tsHigh && lc[0].tsLow == ev[0].tsLow &&
+		  lc[1].valid && lc[1].level == 1 &&
+		  lc[1].tsHigh == ev[1].tsHigh && lc[1].tsLow == ev[1].tsLow &&
+		  !lc[2].valid);
+
+	/* lost edge of ch1, flag kept by a change of ch0 */
+	Edge(0, 0x0003);
+	Edge(0, 0x0002);
+	CHECK(GetBlk(0, M31_BLK_LAST_CHANGE, lc, sizeof(lc)) == 0 &&
+		  lc[1].flags == M31_EVF_LOST_EDGE && lc[1].level == 1 &&
+		  lc[0].flags == 0 && lc[0].level == 0);
+	Edge(0, 0x0000);
+	CHECK(GetBlk(0, M31_BLK_LAST_CHANGE, lc, sizeof(lc)) == 0 &&
+		  lc[1].flags == 0 && lc[1].level == 0);
+
+	CHECK(GetBlk(0, M31_BLK_LAST_CHANGE, lc, sizeof(lc) - 1) ==
+		  ERR_LL_USERBUF);
+	DevClose(0);
+}
+
+/********************************** ScReady *********************************
+ *
+ *  Description: Ready group
+ *
+ *               A reportable change sets the bit of the device in the
+ *               ready mask of its group; a member signals only if its bit
+ *               was clear. M31_READY_MASK gets and clears the mask. A
+ *               ready index can be used only once per group.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: G_sigCount
+ ****************************************************************************/
+static void ScReady(void)
+{
+	static const char *dev0[] = { "READY_GROUP=2", "READY_INDEX=0", NULL };
+	static const char *dev1[] = { "READY_GROUP=2", "READY_INDEX=5", NULL };
+	int32		value;
+
+	CHECK(DevOpen(0, MOD_ID_M31, dev0) == 0);
+	CHECK(DevOpen(1, MOD_ID_M31, dev1) == 0);
+	CHECK(DevOpen(2, MOD_ID_M31, dev1) == ERR_LL_ILL_PARAM);
+	CHECK(DevOpen(2, MOD_ID_M31, NULL) == 0);
+	CHECK(GetStat(2, M31_READY_MASK, 0, &value) == ERR_LL_ILL_PARAM);
+	CHECK(GetStat(0, M31_READY_MASK, 0, &value) == 0 && value == 0);
+	CHECK(SetStat(0, M31_SIGSET, 0, 10) == 0);
+	CHECK(SetStat(1, M31_SIGSET, 0, 10) == 0);
+
+	/* one signal per device until the mask is read */
+	Edge(1, 0x0001);
+	CHECK(G_sigCount == 1);
+	Edge(1, 0x0000);
+	CHECK(G_sigCount == 1);
+	Edge(0, 0x0001);
+	CHECK(G_sigCount == 2);
+	CHECK(GetStat(1, M31_READY_MASK, 0, &value) == 0 && value == 0x21);
+	CHECK(GetStat(0, M31_READY_MASK, 0, &value) == 0 && value == 0);
+	Edge(1, 0x0001);
+	CHECK(G_sigCount == 3);
+	CHECK(GetStat(0, M31_READY_MASK, 0, &value) == 0 && value == 0x20);
+
+	/* index free again after exit */
+	CHECK(SetStat(1, M31_SIGCLR, 0, 0) == 0);
+	DevClose(1);
+	DevClose(2);
+	CHECK(DevOpen(2, MOD_ID_M31, dev1) == 0);
+	Edge(2, 0x0001);
+	CHECK(GetStat(0, M31_READY_MASK, 0, &value) == 0 && value == 0x20);
+
+	CHECK(SetStat(0, M31_SIGCLR, 0, 0) == 0);
+	DevClose(2);
+	DevClose(0);
+}
+
+#ifdef M31_OWN_LOCK
+/******************************** ScLockStat ********************************
+ *
+ *  Description: Device lock statistics (M31_OWN_LOCK)
+ *
+ *               Each entry point counts its calls, wait and hold times.
+ *               A call which finds the lock taken counts as contended and
+ *               records the wait.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: G_dev
+ ****************************************************************************/
+static void ScLockStat(void)
+{
+	M31_LOCK_STAT	stat[M31_LOCK_EP_NUM];
+	M31_EVENT		ev[EV_MAX];
+	LL_HANDLE		*llHdl;
+	pthread_t		thread;
+	u_int32			n, wait, hold;
+	int32			value;
+
+	CHECK(DevOpen(0, MOD_ID_M31, NULL) == 0);
+	llHdl = G_dev[0].llHdl;
+	CHECK(SetStat(0, M31_LOCK_STAT_CLR, 0, 0) == 0);
+
+	/* uncontended: 3+1 getstats, setstat and blockread of Events */
+	for (n=0; n<3; n++)
+		GetStat(0, M31_EVENT_COUNT, 0, &value);
+	Events(0, ev, EV_MAX);
+	CHECK(GetBlk(0, M31_BLK_LOCK_STAT, stat, sizeof(stat)) == 0);
+	for (n=wait=hold=0; n<M31_HIST_BUCKETS; n++) {
+		wait += stat[M31_LOCK_GETSTAT].waitHist[n];
+		hold += stat[M31_LOCK_GETSTAT].holdHist[n];
+	}
+	CHECK(stat[M31_LOCK_GETSTAT].count == 4 &&
+		  stat[M31_LOCK_GETSTAT].contended == 0 && wait == 4 && hold == 3);
+	CHECK(stat[M31_LOCK_SETSTAT].count == 1 &&
+		  stat[M31_LOCK_BLOCKREAD].count == 1 &&
+		  stat[M31_LOCK_READ].count == 0);
+
+	/* contended: lock held for 20ms */
+	CHECK(SetStat(0, M31_LOCK_STAT_CLR, 0, 0) == 0);
+	OSS_SemWait(NULL, llHdl->lockSem, OSS_SEM_WAITINF);
+	CHECK(pthread_create(&thread, NULL, LockThread, NULL) == 0);
+	OSS_Delay(NULL, 20);
+	OSS_SemSignal(NULL, llHdl->lockSem);
+	pthread_join(thread, NULL);
+	CHECK(GetBlk(0, M31_BLK_LOCK_STAT, stat, sizeof(stat)) == 0 &&
+		  stat[M31_LOCK_GETSTAT].contended == 1 &&
+		  stat[M31_LOCK_GETSTAT].waitMax >= UsToTs(llHdl, 10000));
+
+	DevClose(0);
+}
+#endif
@@ -0,0 +1,623 @@
+/*********************  P r o g r a m  -  M o d u l e ***********************
+ *
+ *         Name: m31_emu.c
+ *
+ *       Author: ds
+ *
+ *  Description: User space emulation of OSS, DESC and ID PROM access
+ *
+ *               Implements the functions declared in m31_emu.h for the
+ *               driver compiled with switch M31_EMU (see m31_replay.c).
+ *               Interrupt masking and spin locks share one recursive
+ *               mutex, which also serializes the emulated interrupt and
+ *               the timer callbacks, so the driver sees the exclusion of
+ *               a single CPU system. Each OSS timer is a thread paced by
+ *               CLOCK_MONOTONIC.
+ *
+ *     Required: POSIX threads
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <MEN/men_typs.h>
+#include <MEN/m31_emu.h>
+#include <MEN/mdis_err.h>
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define KEY_LEN		64			/* max descriptor key length */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+struct EMU_OSS   { int dummy; };
+struct EMU_IRQ   { int dummy; };
+struct EMU_SPINL { int dummy; };
+
+struct EMU_SEM {
+	pthread_mutex_t lock;
+	pthread_cond_t  cond;
+	int32           count;
+};
+
+struct EMU_SIG {
+	int32   sigNbr;
+};
+
+struct EMU_TIMER {
+	pthread_t       thread;
+	pthread_mutex_t lock;				/* protects state below */
+	pthread_cond_t  cond;
+	void            (*func)(void *arg);
+	void            *arg;
+	u_int32         msec;				/* period */
+	int             cyclic;
+	int             run;				/* started */
+	int             quit;				/* thread shall exit */
+	u_int32         gen;				/* incremented by each start */
+};
+
+struct EMU_DESC {
+	DESC_SPEC *list;					/* "KEY=value" strings */
+};
+
+/*-----------------------------------------+
+|  GLOBALS                                 |
++-----------------------------------------*/
+static pthread_mutex_t	G_irqLock;		/* irq mask and spin locks */
+static struct EMU_OSS	G_oss;
+static struct EMU_IRQ	G_irq;
+static struct EMU_SPINL	G_spl;
+static EMU_SIG_HOOK		*G_sigHook;
+static void				*G_sigArg;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+static void *TimerThread(void *arg);
+static const char *DescFind(DESC_HANDLE *desc, char *keyFmt, va_list ap);
+
+/********************************* EMU_Init *********************************
+ *
+ *  Description: Initialize the emulation
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: hook		called by OSS_SigSend (NULL=none)
+ *               arg		hook argument
+ *  Output.....: return		0 | error code
+ *  Globals....: G_irqLock, G_sigHook, G_sigArg
+ ****************************************************************************/
+int32 EMU_Init(EMU_SIG_HOOK *hook, void *arg)
+{
+	pthread_mutexattr_t attr;
+
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	if (pthread_mutex_init(&G_irqLock, &attr))
+		return(ERR_OSS_MEM_ALLOC);
+	pthread_mutexattr_destroy(&attr);
+
+	G_sigHook = hook;
+	G_sigArg  = arg;
+
+	return(0);
+}
+
+/********************************* EMU_Oss **********************************
+ *
+ *  Description: Get OSS handle for M31_Init
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		OSS handle
+ *  Globals....: G_oss
+ ****************************************************************************/
+OSS_HANDLE *EMU_Oss(void)
+{
+	return(&G_oss);
+}
+
+/******************************** EMU_IrqHdl ********************************
+ *
+ *  Description: Get IRQ handle for M31_Init
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		IRQ handle
+ *  Globals....: G_irq
+ ****************************************************************************/
+OSS_IRQ_HANDLE *EMU_IrqHdl(void)
+{
+	return(&G_irq);
+}
+
+/******************************** EMU_IrqLock *******************************
+ *
+ *  Description: Enter emulated interrupt context
+ *
+ *               Called around M31_Irq; excludes all code that masks the
+ *               interrupt or holds a spin lock.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: G_irqLock
+ ****************************************************************************/
+void EMU_IrqLock(void)
+{
+	pthread_mutex_lock(&G_irqLock);
+}
+
+/******************************* EMU_IrqUnlock ******************************
+ *
+ *  Description: Leave emulated interrupt context
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: G_irqLock
+ ****************************************************************************/
+void EMU_IrqUnlock(void)
+{
+	pthread_mutex_unlock(&G_irqLock);
+}
+
+/******************************* EMU_SemCreate ******************************
+ *
+ *  Description: Create a semaphore (e.g. the MDIS device semaphore)
+ *
+ *               The semaphore is created free (count 1).
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		semaphore | NULL
+ *  Globals....: -
+ ****************************************************************************/
+OSS_SEM_HANDLE *EMU_SemCreate(void)
+{
+	OSS_SEM_HANDLE *sem;
+
+	if ((sem = calloc(1, sizeof(*sem))) == NULL)
+		return(NULL);
+
+	pthread_mutex_init(&sem->lock, NULL);
+	pthread_cond_init(&sem->cond, NULL);
+	sem->count = 1;
+
+	return(sem);
+}
+
+/******************************* EMU_SemRemove ******************************
+ *
+ *  Description: Remove a semaphore
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: sem		semaphore
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+void EMU_SemRemove(OSS_SEM_HANDLE *sem)
+{
+	pthread_cond_destroy(&sem->cond);
+	pthread_mutex_destroy(&sem->lock);
+	free(sem);
+}
+
+/*==========================================================================
+ *  oss.h
+ *=========================================================================*/
+
+void *OSS_MemGet(OSS_HANDLE *oss, u_int32 size, u_int32 *gotSizeP)
+{
+	void *p = malloc(size ? size : 1);
+
+	*gotSizeP = p ? size : 0;
+	return(p);
+}
+
+int32 OSS_MemFree(OSS_HANDLE *oss, void *addr, u_int32 size)
+{
+	free(addr);
+	return(0);
+}
+
+void OSS_MemFill(OSS_HANDLE *oss, u_int32 size, char *adr, int8 value)
+{
+	memset(adr, value, size);
+}
+
+void OSS_MemCopy(OSS_HANDLE *oss, u_int32 size, char *src, char *dst)
+{
+	memcpy(dst, src, size);
+}
+
+int32 OSS_SigCreate(OSS_HANDLE *oss, int32 value, OSS_SIG_HANDLE **sigP)
+{
+	if ((*sigP = calloc(1, sizeof(**sigP))) == NULL)
+		return(ERR_OSS_MEM_ALLOC);
+
+	(*sigP)->sigNbr = value;
+	return(0);
+}
+
+int32 OSS_SigSend(OSS_HANDLE *oss, OSS_SIG_HANDLE *sig)
+{
+	if (G_sigHook)
+		G_sigHook(G_sigArg, sig->sigNbr);
+	return(0);
+}
+
+int32 OSS_SigRemove(OSS_HANDLE *oss, OSS_SIG_HANDLE **sigP)
+{
+	free(*sigP);
+	*sigP = NULL;
+	return(0);
+}
+
+int32 OSS_SigInfo(OSS_HANDLE *oss, OSS_SIG_HANDLE *sig, int32 *sigNbrP,
+				  int32 *pidP)
+{
+	*sigNbrP = sig->sigNbr;
+	*pidP    = (int32)getpid();
+	return(0);
+}
+
+OSS_IRQ_STATE OSS_IrqMaskR(OSS_HANDLE *oss, OSS_IRQ_HANDLE *irq)
+{
+	pthread_mutex_lock(&G_irqLock);
+	return(0);
+}
+
+void OSS_IrqRestore(OSS_HANDLE *oss, OSS_IRQ_HANDLE *irq,
+					OSS_IRQ_STATE state)
+{
+	pthread_mutex_unlock(&G_irqLock);
+}
+
+u_int32 OSS_TickGet(OSS_HANDLE *oss)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return((u_int32)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000));
+}
+
+int32 OSS_TickRateGet(OSS_HANDLE *oss)
+{
+	return(1000);
+}
+
+int32 OSS_Delay(OSS_HANDLE *oss, int32 msec)
+{
+	usleep(msec * 1000);
+	return(msec);
+}
+
+int32 OSS_TimerCreate(OSS_HANDLE *oss, void (*func)(void *arg), void *arg,
+					  OSS_TIMER_HANDLE **timerP)
+{
+	OSS_TIMER_HANDLE *tmr;
+
+	if ((tmr = calloc(1, sizeof(*tmr))) == NULL)
+		return(ERR_OSS_MEM_ALLOC);
+
+	pthread_mutex_init(&tmr->lock, NULL);
+	pthread_cond_init(&tmr->cond, NULL);
+	tmr->func = func;
+	tmr->arg  = arg;
+
+	if (pthread_create(&tmr->thread, NULL, TimerThread, tmr)) {
+		free(tmr);
+		return(ERR_OSS_MEM_ALLOC);
+	}
+
+	*timerP = tmr;
+	return(0);
+}
+
+int32 OSS_TimerRemove(OSS_HANDLE *oss, OSS_TIMER_HANDLE **timerP)
+{
+	OSS_TIMER_HANDLE *tmr = *timerP;
+
+	pthread_mutex_lock(&tmr->lock);
+	tmr->quit = 1;
+	pthread_cond_signal(&tmr->cond);
+	pthread_mutex_unlock(&tmr->lock);
+
+	pthread_join(tmr->thread, NULL);
+	pthread_cond_destroy(&tmr->cond);
+	pthread_mutex_destroy(&tmr->lock);
+	free(tmr);
+
+	*timerP = NULL;
+	return(0);
+}
+
+int32 OSS_TimerStart(OSS_HANDLE *oss, OSS_TIMER_HANDLE *tmr, u_int32 msec,
+					 u_int32 cyclic, u_int32 *realMsecP)
+{
+	pthread_mutex_lock(&tmr->lock);
+	tmr->msec   = msec ? msec : 1;
+	tmr->cyclic = cyclic ? 1 : 0;
+	tmr->run    = 1;
+	tmr->gen++;
+	pthread_cond_signal(&tmr->cond);
+	pthread_mutex_unlock(&tmr->lock);
+
+	*realMsecP = tmr->msec;
+	return(0);
+}
+
+int32 OSS_TimerStop(OSS_HANDLE *oss, OSS_TIMER_HANDLE *tmr)
+{
+	pthread_mutex_lock(&tmr->lock);
+	tmr->run = 0;
+	pthread_mutex_unlock(&tmr->lock);
+	return(0);
+}
+
+int32 OSS_SemCreate(OSS_HANDLE *oss, int32 semType, int32 initVal,
+					OSS_SEM_HANDLE **semP)
+{
+	if ((*semP = EMU_SemCreate()) == NULL)
+		return(ERR_OSS_MEM_ALLOC);
+
+	(*semP)->count = initVal;
+	return(0);
+}
+
+int32 OSS_SemRemove(OSS_HANDLE *oss, OSS_SEM_HANDLE **semP)
+{
+	EMU_SemRemove(*semP);
+	*semP = NULL;
+	return(0);
+}
+
+int32 OSS_SemWait(OSS_HANDLE *oss, OSS_SEM_HANDLE *sem, int32 msec)
+{
+	pthread_mutex_lock(&sem->lock);
+	/* only OSS_SEM_NOWAIT and OSS_SEM_WAITINF are emulated */
+	if (sem->count == 0 && msec == OSS_SEM_NOWAIT) {
+		pthread_mutex_unlock(&sem->lock);
+		return(ERR_OSS_TIMEOUT);
+	}
+	while (sem->count == 0)
+		pthread_cond_wait(&sem->cond, &sem->lock);
+	sem->count--;
+	pthread_mutex_unlock(&sem->lock);
+	return(0);
+}
+
+int32 OSS_SemSignal(OSS_HANDLE *oss, OSS_SEM_HANDLE *sem)
+{
+	pthread_mutex_lock(&sem->lock);
+	sem->count++;
+	pthread_cond_signal(&sem->cond);
+	pthread_mutex_unlock(&sem->lock);
+	return(0);
+}
+
+int32 OSS_SpinLockCreate(OSS_HANDLE *oss, OSS_SPINL_HANDLE **splP)
+{
+	*splP = &G_spl;
+	return(0);
+}
+
+int32 OSS_SpinLockRemove(OSS_HANDLE *oss, OSS_SPINL_HANDLE **splP)
+{
+	*splP = NULL;
+	return(0);
+}
+
+int32 OSS_SpinLockAcquire(OSS_HANDLE *oss, OSS_SPINL_HANDLE *spl)
+{
+	pthread_mutex_lock(&G_irqLock);
+	return(0);
+}
+
+int32 OSS_SpinLockRelease(OSS_HANDLE *oss, OSS_SPINL_HANDLE *spl)
+{
+	pthread_mutex_unlock(&G_irqLock);
+	return(0);
+}
+
+char *OSS_Ident(void)
+{
+	return("OSS emulation (m31_emu)");
+}
+
+/*==========================================================================
+ *  desc.h
+ *=========================================================================*/
+
+int32 DESC_Init(DESC_SPEC *spec, OSS_HANDLE *oss, DESC_HANDLE **descP)
+{
+	if ((*descP = calloc(1, sizeof(**descP))) == NULL)
+		return(ERR_OSS_MEM_ALLOC);
+
+	(*descP)->list = spec;
+	return(0);
+}
+
+int32 DESC_GetUInt32(DESC_HANDLE *desc, u_int32 defVal, u_int32 *valueP,
+					 char *keyFmt, ...)
+{
+	const char *val;
+	va_list ap;
+
+	va_start(ap, keyFmt);
+	val = DescFind(desc, keyFmt, ap);
+	va_end(ap);
+
+	if (!val) {
+		*valueP = defVal;
+		return(ERR_DESC_KEY_NOTFOUND);
+	}
+
+	*valueP = (u_int32)strtoul(val, NULL, 0);
+	return(0);
+}
+
+int32 DESC_GetString(DESC_HANDLE *desc, char *defVal, char *buf,
+					 u_int32 *lenP, char *keyFmt, ...)
+{
+	const char *val;
+	va_list ap;
+	u_int32 len;
+
+	va_start(ap, keyFmt);
+	val = DescFind(desc, keyFmt, ap);
+	va_end(ap);
+
+	len = (u_int32)strlen(val ? val : defVal) + 1;
+	if (len > *lenP)
+		return(ERR_LL_USERBUF);
+
+	memcpy(buf, val ? val : defVal, len);
+	*lenP = len;
+
+	return(val ? 0 : ERR_DESC_KEY_NOTFOUND);
+}
+
+int32 DESC_Exit(DESC_HANDLE **descP)
+{
+	free(*descP);
+	*descP = NULL;
+	return(0);
+}
+
+int32 DESC_DbgLevelSet(DESC_HANDLE *desc, u_int32 level)
+{
+	return(0);
+}
+
+char *DESC_Ident(void)
+{
+	return("DESC emulation (m31_emu)");
+}
+
+/*==========================================================================
+ *  modcom.h
+ *=========================================================================*/
+
+int m_read(U_INT32_OR_64 base, u_int8 index)
+{
+	/* the register window is the start of EMU_DEV */
+	EMU_DEV *dev = (EMU_DEV*)base;
+
+	return(index < EMU_ID_SIZE ? dev->idProm[index] : 0xffff);
+}
+
+/******************************* TimerThread ********************************
+ *
+ *  Description: Timer thread, calls the timer function in irq context
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg		timer
+ *  Output.....: return		NULL
+ *  Globals....: G_irqLock
+ ****************************************************************************/
+static void *TimerThread(void *arg)/* nodoc */
+{
+	OSS_TIMER_HANDLE *tmr = (OSS_TIMER_HANDLE*)arg;
+	struct timespec next;
+	u_int32 gen;
+	int call;
+
+	pthread_mutex_lock(&tmr->lock);
+
+	while (!tmr->quit) {
+		if (!tmr->run) {
+			pthread_cond_wait(&tmr->cond, &tmr->lock);
+			continue;
+		}
+
+		/* (re)started: first expiry one period from now */
+		gen = tmr->gen;
+		clock_gettime(CLOCK_MONOTONIC, &next);
+
+		while (tmr->run && !tmr->quit && gen == tmr->gen) {
+			next.tv_nsec += (long)tmr->msec * 1000000;
+			while (next.tv_nsec >= 1000000000) {
+				next.tv_nsec -= 1000000000;
+				next.tv_sec++;
+			}
+
+			pthread_mutex_unlock(&tmr->lock);
+			while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next,
+								   NULL) == EINTR)
+				;
+
+			/* timer functions run in irq context */
+			pthread_mutex_lock(&G_irqLock);
+			pthread_mutex_lock(&tmr->lock);
+			call = tmr->run && !tmr->quit && gen == tmr->gen;
+			if (call && !tmr->cyclic)
+				tmr->run = 0;
+			pthread_mutex_unlock(&tmr->lock);
+
+			if (call)
+				tmr->func(tmr->arg);
+			pthread_mutex_unlock(&G_irqLock);
+
+			pthread_mutex_lock(&tmr->lock);
+		}
+	}
+
+	pthread_mutex_unlock(&tmr->lock);
+	return(NULL);
+}
+
+/********************************* DescFind *********************************
+ *
+ *  Description: Find descriptor key
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: desc		descriptor handle
+ *               keyFmt		key (printf format)
+ *               ap			format arguments
+ *  Output.....: return		value string | NULL (not found)
+ *  Globals....: -
+ ****************************************************************************/
+static const char *DescFind(DESC_HANDLE *desc, char *keyFmt, va_list ap)/* nodoc */
+{
+	char key[KEY_LEN];
+	size_t len;
+	DESC_SPEC *p;
+
+	vsnprintf(key, sizeof(key), keyFmt, ap);
+	len = strlen(key);
+
+	for (p = desc->list; p && *p; p++)
+		if (!strncmp(*p, key, len) && (*p)[len] == '=')
+			return(*p + len + 1);
+
+	return(NULL);
+}
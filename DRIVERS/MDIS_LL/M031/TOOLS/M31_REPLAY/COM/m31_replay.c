@@ -0,0 +1,722 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                   M31_REPLAY                       ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Replay recorded edges through the real M31 driver
+ *
+ *               The low-level driver source is compiled into this program
+ *               against the user space emulation (switch M31_EMU, see
+ *               m31_emu.h). A recorded edge log is written, record by
+ *               record, into the emulated data register followed by a
+ *               call of the real M31_Irq. Consumer threads read the event
+ *               records via M31_BlockRead like applications do (woken by
+ *               the driver signal or polling), serialized by a device
+ *               semaphore as the MDIS kernel does for LL_LOCK_CALL.
+ *               Built with M31_OWN_LOCK, the driver entry points with
+ *               own locking are called instead and the lock statistics
+ *               are printed at the end.
+ *
+ *               The replay runs at the original speed, scaled (-s=<f>)
+ *               or as fast as possible (-s=0). At the end, the tool
+ *               prints the replay lag, driver drops (event FIFO overruns,
+ *               interrupts without visible change), ISR time and the
+ *               latency from event timestamp to consumer.
+ *
+ *               Input formats:
+ *                 -l=<file>  m31_mon log, one device (-d=<n>); rule and
+ *                            field events are skipped, lost edge events
+ *                            are replayed as interrupts without change
+ *                 -t=<file>  text, one record per line:
+ *                            <time [us]> <state (hex)>
+ *                            the first line is the initial state
+ *
+ *     Required: libraries: usr_utl, m31_util; POSIX threads
+ *     Switches: M31_EMU (set here)
+ *               M31_OWN_LOCK  driver with own locking (see m31_drv.c)
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef M31_EMU
+#define M31_EMU
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* the real driver, built against m31_emu.h */
+#include "../../../DRIVER/COM/m31_drv.c"
+
+#include <MEN/usr_utl.h>
+#include <MEN/m31_log.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define DESC_MAX		128		/* max descriptor lines */
+#define LINE_LEN		128		/* max line length (text, descriptor) */
+#define CONS_MAX		16		/* max consumer threads */
+#define BATCH_MAX		1024	/* max events per M31_BlockRead */
+#define SPIN_NSEC		200000	/* busy wait below this [ns] */
+#define DRAIN_MSEC		1000	/* max wait for consumers at end */
+
+/* device locking: by the driver (M31_OWN_LOCK) or as the MDIS kernel */
+#ifdef M31_OWN_LOCK
+# define DEV_LOCK()
+# define DEV_UNLOCK()
+# define DEV_BLOCKREAD	M31_BlockReadLocked
+# define DEV_GETSTAT	M31_GetStatLocked
+#else
+# define DEV_LOCK()		OSS_SemWait(NULL, G_devSem, OSS_SEM_WAITINF)
+# define DEV_UNLOCK()	OSS_SemSignal(NULL, G_devSem)
+# define DEV_BLOCKREAD	M31_BlockRead
+# define DEV_GETSTAT	M31_GetStat
+#endif
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/* input file */
+typedef struct {
+	FILE			*fp;		/* text input */
+	M31_LOG			log;		/* m31_mon log input */
+	M31_LOG_QUERY	q;
+	int				isLog;
+	u_int32			freq;		/* log timestamp frequency */
+} INPUT;
+
+/* consumer thread */
+typedef struct {
+	pthread_t		thread;
+	u_int32			events;		/* events read */
+	u_int32			calls;		/* M31_BlockRead calls */
+	u_int32			hist[M31_HIST_BUCKETS];	/* latency [ts counts] */
+	u_int64			max;		/* max latency [ts counts] */
+} CONSUMER;
+
+/*--------------------------------------+
+|   GLOBALS                             |
++--------------------------------------*/
+static LL_HANDLE		*G_llHdl;
+static OSS_SEM_HANDLE	*G_devSem;	/* MDIS device semaphore (LL_LOCK_CALL) */
+static sem_t			G_sigSem;	/* posted by driver signal */
+static volatile u_int32	G_sigCount;
+static volatile int		G_done;		/* replay finished */
+static u_int32			G_batch;	/* events per M31_BlockRead */
+static u_int32			G_pollMs;	/* consumer poll timeout */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static int InputOpen(INPUT *in, char *logFile, char *txtFile, int32 dev,
+					 u_int16 *initP);
+static int InputNext(INPUT *in, u_int64 *nsP, u_int16 *stateP);
+static void InputClose(INPUT *in);
+static int DescLoad(char *file, char **desc, char *lines, int max);
+static void *ConsumerThread(void *arg);
+static void SigHook(void *arg, int32 sigNbr);
+static u_int64 NsGet(void);
+static void NsWait(u_int64 ns);
+static int32 DevGetStat(int32 code, void *buf, int32 size);
+static void PrintHist(u_int32 *hist, u_int64 max, u_int32 freq);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m31_replay [<opts>] -l=<file> | -t=<file>\n");
+	printf("Function: Replay a recorded edge log through the M31 driver\n");
+	printf("          with an emulated module\n");
+	printf("Options:\n");
+	printf("    -l=<file>    m31_mon log file\n");
+	printf("    -d=<n>       log file: device index             [0]\n");
+	printf("    -t=<file>    text file: <time [us]> <state (hex)>\n");
+	printf("    -s=<f>       speed factor, 0=as fast as possible [1]\n");
+	printf("    -c=<n>       nr of consumer threads (max %d)    [1]\n",
+		   CONS_MAX);
+	printf("    -b=<n>       events per M31_BlockRead           [64]\n");
+	printf("    -p=<ms>      consumer poll timeout              [10]\n");
+	printf("    -k=<file>    descriptor keys (KEY=value per line)\n");
+	printf("                 defaults: IRQ_ENABLE=1 EVENT_BUF_SIZE=1024\n");
+	printf("    -m=<id>      module id in emulated ID PROM      [31]\n");
+	printf("\n");
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: G_xxx
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	static EMU_DEV	dev;
+	static char		descLines[DESC_MAX][LINE_LEN];
+	char			*desc[DESC_MAX + 3];
+	CONSUMER		cons[CONS_MAX];
+	INPUT			in;
+	MACCESS			ma = (MACCESS)&dev;
+	M31_ISR_STAT	isr;
+	M31_LOST_STAT	lost;
+#ifdef M31_OWN_LOCK
+	M31_LOCK_STAT	lockStat[M31_LOCK_EP_NUM];
+#endif
+	u_int32			hist[M31_HIST_BUCKETS];
+	char			*str, *errstr, *logFile, *txtFile, *descFile, errbuf[40];
+	double			speed;
+	u_int64			ns, ns0 = 0, t0 = 0, target, lag, maxLag = 0, max = 0;
+	u_int32			nrCons, records = 0, events = 0, calls = 0, end, freq;
+	int32			evLost = 0, nrDesc = 0, devIdx, error, n, i;
+	u_int16			state, modId;
+	int				ret = 1;
+
+	/*--------------------+
+	|  check arguments    |
+	+--------------------*/
+	if ((errstr = UTL_ILLIOPT("l=d=t=s=c=b=p=k=m=?", errbuf))) {
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	logFile  = UTL_TSTOPT("l=");
+	txtFile  = UTL_TSTOPT("t=");
+	descFile = UTL_TSTOPT("k=");
+
+	if (UTL_TSTOPT("?") || (!logFile == !txtFile)) {
+		usage();
+		return(1);
+	}
+
+	devIdx   = ((str = UTL_TSTOPT("d=")) ? atoi(str) : 0);
+	speed    = ((str = UTL_TSTOPT("s=")) ? atof(str) : 1.0);
+	nrCons   = ((str = UTL_TSTOPT("c=")) ? atoi(str) : 1);
+	G_batch  = ((str = UTL_TSTOPT("b=")) ? atoi(str) : 64);
+	G_pollMs = ((str = UTL_TSTOPT("p=")) ? atoi(str) : 10);
+	modId    = ((str = UTL_TSTOPT("m=")) ? atoi(str) : MOD_ID_M31);
+
+	if (nrCons > CONS_MAX)
+		nrCons = CONS_MAX;
+	if (G_batch == 0 || G_batch > BATCH_MAX)
+		G_batch = BATCH_MAX;
+
+	/*--------------------+
+	|  descriptor         |
+	+--------------------*/
+	/* own keys first: the first match wins */
+	if (descFile &&
+		(nrDesc = DescLoad(descFile, desc, &descLines[0][0], DESC_MAX)) < 0)
+		return(1);
+	desc[nrDesc++] = "IRQ_ENABLE=1";
+	desc[nrDesc++] = "EVENT_BUF_SIZE=1024";
+	desc[nrDesc]   = NULL;
+
+	if (InputOpen(&in, logFile, txtFile, devIdx, &state))
+		return(1);
+
+	/*--------------------+
+	|  emulated module    |
+	+--------------------*/
+	memset(&dev, 0, sizeof(dev));
+	dev.idProm[0] = MOD_ID_MAGIC;
+	dev.idProm[1] = modId;
+	dev.regs[DATA_REG/2] = state;
+
+	sem_init(&G_sigSem, 0, 0);
+
+	if ((error = EMU_Init(SigHook, NULL)) ||
+		(G_devSem = EMU_SemCreate()) == NULL) {
+		printf("*** can't init emulation\n");
+		goto cleanup_in;
+	}
+
+	if ((error = M31_Init((DESC_SPEC*)desc, EMU_Oss(), &ma, G_devSem,
+						  EMU_IrqHdl(), &G_llHdl))) {
+		printf("*** M31_Init failed: 0x%04x\n", (unsigned)error);
+		goto cleanup_in;
+	}
+
+	if ((error = M31_SetStat(G_llHdl, M31_BLK_MODE, 0,
+							 M31_BLKMODE_EVENT)) ||
+		(error = M31_SetStat(G_llHdl, M31_SIGSET, 0, 1))) {
+		printf("*** M31_SetStat failed: 0x%04x\n", (unsigned)error);
+		goto cleanup;
+	}
+
+	freq = TsFreqGet(G_llHdl);
+
+	/*--------------------+
+	|  start consumers    |
+	+--------------------*/
+	memset(cons, 0, sizeof(cons));
+	for (i=0; i<(int)nrCons; i++)
+		pthread_create(&cons[i].thread, NULL, ConsumerThread, &cons[i]);
+
+	printf("Replaying %s at %s...\n", logFile ? logFile : txtFile,
+		   speed > 0 ? "scaled speed" : "max speed");
+
+	/*--------------------+
+	|  replay             |
+	+--------------------*/
+	while (InputNext(&in, &ns, &state) > 0) {
+		if (records == 0) {
+			ns0 = ns;
+			t0  = NsGet();
+		}
+
+		if (speed > 0) {
+			target = t0 + (u_int64)((double)(ns - ns0) / speed);
+			NsWait(target);
+			lag = NsGet() - target;
+			if (lag > maxLag)
+				maxLag = lag;
+		}
+
+		dev.regs[DATA_REG/2] = state;
+
+		EMU_IrqLock();
+		M31_Irq(G_llHdl);
+		EMU_IrqUnlock();
+
+		records++;
+	}
+	t0 = NsGet() - t0;
+
+	/* let the consumers drain the fifo */
+	for (end = OSS_TickGet(NULL) + DRAIN_MSEC;
+		 (int32)(end - OSS_TickGet(NULL)) > 0; ) {
+		if (DevGetStat(M31_EVENT_COUNT, &n, 0) || n == 0)
+			break;
+		OSS_Delay(NULL, 1);
+	}
+
+	G_done = 1;
+	for (i=0; i<(int)nrCons; i++) {
+		sem_post(&G_sigSem);
+	}
+	for (i=0; i<(int)nrCons; i++)
+		pthread_join(cons[i].thread, NULL);
+
+	/*--------------------+
+	|  results            |
+	+--------------------*/
+	memset(hist, 0, sizeof(hist));
+	for (i=0; i<(int)nrCons; i++) {
+		events += cons[i].events;
+		calls  += cons[i].calls;
+		if (cons[i].max > max)
+			max = cons[i].max;
+		for (n=0; n<M31_HIST_BUCKETS; n++)
+			hist[n] += cons[i].hist[n];
+	}
+
+	DevGetStat(M31_EVENT_LOST, &evLost, 0);
+	DevGetStat(M31_BLK_ISR_STAT, &isr, sizeof(isr));
+	DevGetStat(M31_BLK_LOST_EDGES, &lost, sizeof(lost));
+
+	printf("records replayed  : %u in %.3f s (%.0f/s)\n", (unsigned)records,
+		   t0 / 1e9, t0 ? records * 1e9 / t0 : 0.0);
+	if (speed > 0)
+		printf("max replay lag    : %.1f us\n", maxLag / 1e3);
+	printf("interrupts        : %u, max ISR time %.2f us\n",
+		   (unsigned)isr.count, isr.max * 1e6 / freq);
+	printf("lost edge irqs    : %u\n", (unsigned)lost.irqs);
+	printf("signals           : %u\n", (unsigned)G_sigCount);
+	printf("events read       : %u in %u M31_BlockRead calls\n",
+		   (unsigned)events, (unsigned)calls);
+	printf("events lost       : %u (event fifo overrun)\n",
+		   (unsigned)evLost);
+	printf("event latency (timestamp -> consumer):\n");
+	PrintHist(hist, max, freq);
+
+#ifdef M31_OWN_LOCK
+	if (DevGetStat(M31_BLK_LOCK_STAT, lockStat, sizeof(lockStat)) == 0) {
+		printf("lock BlockRead    : %u calls, %u contended, "
+			   "max hold %.2f us\n",
+			   (unsigned)lockStat[M31_LOCK_BLOCKREAD].count,
+			   (unsigned)lockStat[M31_LOCK_BLOCKREAD].contended,
+			   lockStat[M31_LOCK_BLOCKREAD].holdMax * 1e6 / freq);
+		printf("lock wait (BlockRead):\n");
+		PrintHist(lockStat[M31_LOCK_BLOCKREAD].waitHist,
+				  lockStat[M31_LOCK_BLOCKREAD].waitMax, freq);
+	}
+#endif
+
+	ret = 0;
+
+	cleanup:
+	M31_Exit(&G_llHdl);
+
+	cleanup_in:
+	InputClose(&in);
+	if (G_devSem)
+		EMU_SemRemove(G_devSem);
+	sem_destroy(&G_sigSem);
+
+	return(ret);
+}
+
+/****************************** ConsumerThread ******************************
+ *
+ *  Description: Read events like an application
+ *
+ *               Waits for the driver signal (or the poll timeout) and
+ *               reads the event FIFO until it is empty. Each call holds
+ *               the device semaphore.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg		consumer state
+ *  Output.....: return		NULL
+ *  Globals....: G_llHdl, G_devSem, G_sigSem, G_done
+ ****************************************************************************/
+static void *ConsumerThread(void *arg)
+{
+	CONSUMER		*cons = (CONSUMER*)arg;
+	M31_EVENT		buf[BATCH_MAX];
+	struct timespec	tmo;
+	u_int64			now, lat;
+	int32			nbr, n, i;
+
+	while (!G_done) {
+		clock_gettime(CLOCK_REALTIME, &tmo);
+		tmo.tv_nsec += (long)G_pollMs * 1000000;
+		tmo.tv_sec  += tmo.tv_nsec / 1000000000;
+		tmo.tv_nsec %= 1000000000;
+		sem_timedwait(&G_sigSem, &tmo);
+
+		do {
+			DEV_LOCK();
+			if (DEV_BLOCKREAD(G_llHdl, 0, buf, G_batch * sizeof(M31_EVENT),
+							  &nbr))
+				nbr = 0;
+			DEV_UNLOCK();
+
+			cons->calls++;
+			now = TsGet(G_llHdl);
+			n = nbr / sizeof(M31_EVENT);
+
+			for (i=0; i<n; i++) {
+				lat = now - (((u_int64)buf[i].tsHigh << 32) | buf[i].tsLow);
+				cons->hist[Log2Bucket((u_int32)(lat > 0xffffffff ?
+												0xffffffff : lat))]++;
+				if (lat > cons->max)
+					cons->max = lat;
+			}
+			cons->events += n;
+		} while (n == (int32)G_batch);
+	}
+
+	return(NULL);
+}
+
+/********************************* SigHook **********************************
+ *
+ *  Description: Driver signal (OSS_SigSend), wakes a consumer
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: arg		unused
+ *               sigNbr		signal number
+ *  Output.....: -
+ *  Globals....: G_sigSem, G_sigCount
+ ****************************************************************************/
+static void SigHook(void *arg, int32 sigNbr)
+{
+	G_sigCount++;
+	sem_post(&G_sigSem);
+}
+
+/******************************** DevGetStat ********************************
+ *
+ *  Description: M31_GetStat with device semaphore
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: code		status code
+ *               buf		value (int32) or block buffer
+ *               size		block size (0=value)
+ *  Output.....: return		0 | error code
+ *  Globals....: G_llHdl, G_devSem
+ ****************************************************************************/
+static int32 DevGetStat(int32 code, void *buf, int32 size)
+{
+	M_SG_BLOCK	blk;
+	INT32_OR_64	value = 0;
+	int32		error;
+
+	blk.size = size;
+	blk.data = buf;
+
+	DEV_LOCK();
+	if (size)
+		error = DEV_GETSTAT(G_llHdl, code, 0, (INT32_OR_64*)&blk);
+	else if (!(error = DEV_GETSTAT(G_llHdl, code, 0, &value)))
+		*(int32*)buf = (int32)value;
+	DEV_UNLOCK();
+
+	return(error);
+}
+
+/******************************** InputOpen *********************************
+ *
+ *  Description: Open input file and get the initial state
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: in			input state
+ *               logFile	m31_mon log file (or NULL)
+ *               txtFile	text file (or NULL)
+ *               dev		log device index
+ *  Output.....: *initP		initial state
+ *               return		0 | 1 (error)
+ *  Globals....: -
+ ****************************************************************************/
+static int InputOpen(INPUT *in, char *logFile, char *txtFile, int32 dev,
+					 u_int16 *initP)
+{
+	const M31_EVENT	*ev;
+	u_int64			ns;
+
+	memset(&in->q, 0, sizeof(in->q));
+	in->fp    = NULL;
+	in->isLog = (logFile != NULL);
+
+	if (!in->isLog) {
+		if ((in->fp = fopen(txtFile, "r")) == NULL) {
+			printf("*** can't open %s\n", txtFile);
+			return(1);
+		}
+		/* first line: initial state */
+		if (InputNext(in, &ns, initP) <= 0) {
+			printf("*** %s: no records\n", txtFile);
+			fclose(in->fp);
+			return(1);
+		}
+		return(0);
+	}
+
+	if (M31_LogOpen(&in->log, logFile) < 0) {
+		printf("*** can't open %s: %s\n", logFile, strerror(errno));
+		return(1);
+	}
+	if (dev < 0 || (u_int32)dev >= in->log.hdr.nrDev) {
+		printf("*** %s: no device %d\n", logFile, (int)dev);
+		M31_LogClose(&in->log);
+		return(1);
+	}
+	in->freq = in->log.hdr.tsFreq;
+
+	/* state before the first change */
+	M31_LogQueryInit(&in->q, 0, ~(u_int64)0, 1 << dev, 0xffff);
+	*initP = 0;
+	while ((ev = M31_LogNext(&in->log, &in->q)) != NULL)
+		if (!(ev->flags & (M31_EVF_RULE | M31_EVF_FIELD))) {
+			*initP = (u_int16)(ev->state ^ ev->change);
+			break;
+		}
+
+	M31_LogQueryInit(&in->q, 0, ~(u_int64)0, 1 << dev, 0xffff);
+	return(0);
+}
+
+/******************************** InputNext *********************************
+ *
+ *  Description: Get next record
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: in			input state
+ *  Output.....: *nsP		record time [ns]
+ *               *stateP	channel states
+ *               return		1 | 0 (end) | -1 (format error)
+ *  Globals....: -
+ ****************************************************************************/
+static int InputNext(INPUT *in, u_int64 *nsP, u_int16 *stateP)
+{
+	const M31_EVENT	*ev;
+	char			line[LINE_LEN];
+	double			us;
+	unsigned		state;
+	u_int64			ts;
+
+	if (in->isLog) {
+		while ((ev = M31_LogNext(&in->log, &in->q)) != NULL) {
+			/* rule and field events are no hardware edges */
+			if (ev->flags & (M31_EVF_RULE | M31_EVF_FIELD))
+				continue;
+			ts = ((u_int64)ev->tsHigh << 32) | ev->tsLow;
+			*nsP = (ts / in->freq) * 1000000000 +
+				   (ts % in->freq) * 1000000000 / in->freq;
+			*stateP = ev->state;
+			return(1);
+		}
+		return(0);
+	}
+
+	while (fgets(line, sizeof(line), in->fp)) {
+		if (*line == '#' || *line == '\n')
+			continue;
+		if (sscanf(line, "%lf %x", &us, &state) != 2) {
+			printf("*** illegal line: %s", line);
+			return(-1);
+		}
+		*nsP    = (u_int64)(us * 1000.0);
+		*stateP = (u_int16)state;
+		return(1);
+	}
+
+	return(0);
+}
+
+/******************************** InputClose ********************************
+ *
+ *  Description: Close input file
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: in			input state
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void InputClose(INPUT *in)
+{
+	if (in->isLog)
+		M31_LogClose(&in->log);
+	else if (in->fp)
+		fclose(in->fp);
+}
+
+/********************************* DescLoad *********************************
+ *
+ *  Description: Load descriptor keys from file
+ *
+ *               Lines have the form KEY=value; empty lines and lines
+ *               starting with # are ignored.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: file		descriptor file
+ *               desc		key list
+ *               lines		line buffer (max * LINE_LEN)
+ *               max		max nr of keys
+ *  Output.....: return		nr of keys | -1 (error)
+ *  Globals....: -
+ ****************************************************************************/
+static int DescLoad(char *file, char **desc, char *lines, int max)
+{
+	FILE	*fp;
+	char	*line;
+	int		n = 0;
+
+	if ((fp = fopen(file, "r")) == NULL) {
+		printf("*** can't open %s\n", file);
+		return(-1);
+	}
+
+	while (n < max && fgets(line = lines + n * LINE_LEN, LINE_LEN, fp)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (*line == '#' || !strchr(line, '='))
+			continue;
+		desc[n++] = line;
+	}
+
+	fclose(fp);
+	return(n);
+}
+
+/********************************** NsGet ***********************************
+ *
+ *  Description: Get monotonic time
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: return		time [ns]
+ *  Globals....: -
+ ****************************************************************************/
+static u_int64 NsGet(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return((u_int64)ts.tv_sec * 1000000000 + ts.tv_nsec);
+}
+
+/********************************** NsWait **********************************
+ *
+ *  Description: Wait until monotonic time
+ *
+ *               Sleeps until shortly before, then busy waits, so edges
+ *               closer than the sleep granularity keep their distance.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: ns			time [ns]
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void NsWait(u_int64 ns)
+{
+	struct timespec ts;
+	u_int64 now = NsGet();
+
+	if (ns > now + SPIN_NSEC) {
+		ts.tv_sec  = (time_t)((ns - SPIN_NSEC) / 1000000000);
+		ts.tv_nsec = (long)((ns - SPIN_NSEC) % 1000000000);
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+	}
+
+	while (NsGet() < ns)
+		;
+}
+
+/******************************** PrintHist *********************************
+ *
+ *  Description: Print log2 latency histogram
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: hist		histogram [ts counts]
+ *               max		max latency [ts counts]
+ *               freq		timestamp frequency [Hz]
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintHist(u_int32 *hist, u_int64 max, u_int32 freq)
+{
+	u_int32 n;
+
+	for (n=0; n<M31_HIST_BUCKETS; n++)
+		if (hist[n])
+			printf("  %12.3f us .. %12.3f us : %u\n",
+				   (double)((u_int64)1 << n) * 1e6 / freq,
+				   (double)((u_int64)2 << n) * 1e6 / freq,
+				   (unsigned)hist[n]);
+
+	printf("  max %.3f us\n", (double)max * 1e6 / freq);
+}
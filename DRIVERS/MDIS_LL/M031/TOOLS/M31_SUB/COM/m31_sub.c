@@ -0,0 +1,256 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    M31_SUB                         ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Subscribe to the M31 events published by m31_pub
+ *
+ *               Maps the shared memory ring of m31_pub read-only and
+ *               prints the edges (or, with -q, the event rate only) at
+ *               its own pace with its own cursor. Records overwritten
+ *               before they were read are reported as lost. The devices
+ *               are not opened; if the publisher terminates, the tool
+ *               waits for a new one and attaches again.
+ *
+ *     Required: libraries: usr_oss, usr_utl, m31_util
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <MEN/men_typs.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/m31_drv.h>
+#include <MEN/m31_shm.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define RD_EVENTS		256		/* nr of events per M31_ShmRead call */
+#define ATTACH_MSEC		500		/* retry interval without publisher */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void PrintStates(M31_SHM *shm);
+static void PrintEvent(const M31_EVENT *ev, u_int32 freq);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m31_sub [<opts>]\n");
+	printf("Function: Print M31 events published by m31_pub\n");
+	printf("Options:\n");
+	printf("    -n=<name>    shared memory object     [%s]\n", M31_SHM_NAME);
+	printf("    -d=<n>       device index             [all]\n");
+	printf("    -o           start at oldest record in the ring\n");
+	printf("    -p=<ms>      poll interval [ms]       [10]\n");
+	printf("    -q           quiet, print event rate per second only\n");
+	printf("\n");
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	M31_SHM		shm;
+	M31_SHM_SUB	sub;
+	M31_EVENT	buf[RD_EVENTS];
+	u_int32		pollMs, lastLost = 0, lastSec, cnt = 0, n, i;
+	char		*str, *errstr, *name, errbuf[40];
+	int32		dev;
+	int			quiet, attached = 0;
+
+	if ((errstr = UTL_ILLIOPT("n=d=op=q?", errbuf))) {
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {
+		usage();
+		return(1);
+	}
+
+	name   = ((str = UTL_TSTOPT("n=")) ? str : M31_SHM_NAME);
+	dev    = ((str = UTL_TSTOPT("d=")) ? atoi(str) : -1);
+	pollMs = ((str = UTL_TSTOPT("p=")) ? atoi(str) : 10);
+	quiet  = (UTL_TSTOPT("q") ? 1 : 0);
+
+	if (dev >= M31_SHM_DEV_MAX) {
+		usage();
+		return(1);
+	}
+
+	lastSec = UOS_MsecTimerGet();
+
+	while (UOS_KeyPressed() < 0) {
+		/*--------------------+
+		|  (re)attach         |
+		+--------------------*/
+		if (!attached) {
+			if (M31_ShmAttach(&shm, name) < 0 || !M31_ShmAlive(&shm)) {
+				if (shm.hdr)
+					M31_ShmClose(&shm);
+				UOS_Delay(ATTACH_MSEC);
+				continue;
+			}
+			M31_ShmSubInit(&shm, &sub, UTL_TSTOPT("o") ? 1 : 0);
+			attached = 1;
+			lastLost = 0;
+			printf("attached to %s (pid %u), %u records\n", name,
+				   (unsigned)shm.hdr->pid, (unsigned)shm.hdr->nrRecs);
+			PrintStates(&shm);
+		}
+
+		/*--------------------+
+		|  read events        |
+		+--------------------*/
+		while ((n = M31_ShmRead(&shm, &sub, buf, RD_EVENTS)) != 0) {
+			if (sub.lost != lastLost) {
+				printf("*** %u record(s) lost (overrun)\n",
+					   (unsigned)(sub.lost - lastLost));
+				lastLost = sub.lost;
+			}
+			for (i=0; i<n; i++) {
+				if (dev >= 0 && buf[i].dev != dev)
+					continue;
+				cnt++;
+				if (!quiet)
+					PrintEvent(&buf[i], shm.hdr->tsFreq);
+			}
+		}
+
+		if (quiet && UOS_MsecTimerGet() - lastSec >= 1000) {
+			printf("%u events/s, %u lost\n", (unsigned)cnt,
+				   (unsigned)sub.lost);
+			cnt = 0;
+			lastSec = UOS_MsecTimerGet();
+		}
+
+		if (!M31_ShmAlive(&shm)) {
+			/* read what is left before leaving the old ring */
+			if (M31_ShmRead(&shm, &sub, buf, 1))
+				continue;
+			printf("publisher terminated, %u events read, %u lost\n",
+				   (unsigned)sub.read, (unsigned)sub.lost);
+			M31_ShmClose(&shm);
+			attached = 0;
+			continue;
+		}
+
+		UOS_Delay(pollMs);
+	}
+
+	if (attached) {
+		printf("%u events read, %u lost in %u overrun(s)\n",
+			   (unsigned)sub.read, (unsigned)sub.lost,
+			   (unsigned)sub.overruns);
+		M31_ShmClose(&shm);
+	}
+
+	return(0);
+}
+
+/******************************* PrintStates ********************************
+ *
+ *  Description: Print the current states of all devices
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: shm		ring handle
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintStates(M31_SHM *shm)
+{
+	M31_SHM_STATE	st;
+	u_int32			d;
+
+	for (d=0; d<shm->hdr->nrDev; d++) {
+		M31_ShmStateGet(shm, (u_int8)d, &st);
+		printf("  dev %u: %-16s M%02u, state 0x%04x, %u events, "
+			   "%u lost in driver\n", (unsigned)d, shm->hdr->dev[d].name,
+			   (unsigned)shm->hdr->dev[d].modId, (unsigned)st.state,
+			   (unsigned)st.events, (unsigned)st.lost);
+	}
+}
+
+/******************************* PrintEvent *********************************
+ *
+ *  Description: Print the edges of one event
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: ev			event record
+ *               freq		timestamp frequency [Hz]
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintEvent(const M31_EVENT *ev, u_int32 freq)
+{
+	u_int64 ts = ((u_int64)ev->tsHigh << 32) | ev->tsLow;
+	double  s  = (double)ts / freq;
+	int32   ch;
+
+	if (ev->flags & M31_EVF_OVERRUN)
+		printf("*** events lost in driver before seq %u\n",
+			   (unsigned)ev->seq);
+
+	if (ev->flags & M31_EVF_RULE) {
+		for (ch=0; ch<M31_RULE_MAX; ch++)
+			if (ev->change & (1 << ch))
+				printf("%14.6f s  dev %u  rule %d %s\n", s, ev->dev,
+					   (int)ch, (ev->flags & M31_EVF_VIOLATED) ?
+					   "violated" : "done");
+		return;
+	}
+
+	for (ch=0; ch<16; ch++) {
+		if (!(ev->change & (1 << ch)))
+			continue;
+
+		if (ev->flags & M31_EVF_LOST_EDGE)
+			printf("%14.6f s  dev %u  ch %2d  lost edge?\n", s, ev->dev,
+				   (int)ch);
+		else
+			printf("%14.6f s  dev %u  ch %2d  %s\n", s, ev->dev, (int)ch,
+				   (ev->state & (1 << ch)) ? "rise" : "fall");
+	}
+}
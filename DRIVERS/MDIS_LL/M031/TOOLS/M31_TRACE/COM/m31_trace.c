@@ -0,0 +1,339 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                   M31_TRACE                        ************
+ ************                                                    ************
+ ****************************************************************************
+ *  
+ *       Author: ds
+ *
+ *  Description: Read and decode the binary trace of the M31 driver
+ *
+ *               Reads the trace records via M31_BLK_TRACE and prints them
+ *               with timestamps relative to the first record.
+ *
+ *               With -k, prints the device lock statistics instead
+ *               (M31_BLK_LOCK_STAT, driver variant m31_ownlock).
+ *                      
+ *     Required: libraries: mdis_api, usr_oss, usr_utl
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/m31_drv.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define REC_MAX		256		/* nr of records per M31_BLK_TRACE call */
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void PrintMdisError(char *info);
+static void PrintRec(M31_TRACE_REC *rec, u_int64 ts0, u_int32 freq);
+static int PrintLockStat(MDIS_PATH path, u_int32 freq);
+static void PrintHist(u_int32 *hist, u_int32 freq);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *			   
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m31_trace [<opts>] <device> [<opts>]\n");
+	printf("Function: Read and decode the binary trace of the M31 driver\n");
+	printf("Options:\n");
+	printf("    device       device name\n");
+	printf("    -e           enable trace before reading\n");
+	printf("    -d           disable trace after reading\n");
+	printf("    -l=<ms>      read continuously every <ms> (until keypress)\n");
+	printf("    -k           print lock statistics instead of the trace\n");
+	printf("    -z           clear lock statistics (after -k)\n");
+	printf("\n");
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *			   
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	MDIS_PATH		path = -1;
+	M_SG_BLOCK		blk;
+	M31_TRACE_REC	rec[REC_MAX];
+	char			*device, *str, *errstr, buf[40];
+	int32			n, cnt, freq, loopDelay, ret = 1;
+	u_int64			ts0 = 0;
+	int				first = TRUE;
+
+	/*--------------------+
+	|  check arguments    |
+	+--------------------*/
+	if ((errstr = UTL_ILLIOPT("edl=kz?", buf))) {
+		printf("*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {
+		usage();
+		return(1);
+	}
+
+	for (device=NULL, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+
+	if (!device) {
+		usage();
+		return(1);
+	}
+
+	loopDelay = ((str = UTL_TSTOPT("l=")) ? atoi(str) : 0);
+
+	/*--------------------+
+	|  open path          |
+	+--------------------*/
+	if ((path = M_open(device)) < 0) {
+		PrintMdisError("open");
+		return(1);
+	}
+
+	if (M_getstat(path, M31_TS_FREQ, &freq) < 0) {
+		PrintMdisError("getstat M31_TS_FREQ");
+		goto cleanup;
+	}
+
+	/*--------------------+
+	|  lock statistics    |
+	+--------------------*/
+	if (UTL_TSTOPT("k") || UTL_TSTOPT("z")) {
+		if (UTL_TSTOPT("k") && PrintLockStat(path, (u_int32)freq))
+			goto cleanup;
+
+		if (UTL_TSTOPT("z") && M_setstat(path, M31_LOCK_STAT_CLR, 0) < 0) {
+			PrintMdisError("setstat M31_LOCK_STAT_CLR");
+			goto cleanup;
+		}
+
+		ret = 0;
+		goto cleanup;
+	}
+
+	if (UTL_TSTOPT("e") && M_setstat(path, M31_TRACE_ENABLE, 1) < 0) {
+		PrintMdisError("setstat M31_TRACE_ENABLE");
+		goto cleanup;
+	}
+
+	/*--------------------+
+	|  read records       |
+	+--------------------*/
+	do {
+		do {
+			memset(rec, 0, sizeof(rec));
+			blk.size = sizeof(rec);
+			blk.data = (void*)rec;
+
+			if (M_getstat(path, M31_BLK_TRACE, (int32*)&blk) < 0) {
+				PrintMdisError("getstat M31_BLK_TRACE");
+				goto cleanup;
+			}
+
+			cnt = blk.size / sizeof(M31_TRACE_REC);
+			for (n=0; n<cnt && rec[n].code; n++) {
+				/* first timestamped record is the time reference */
+				if (first && rec[n].code != M31_TR_LOST) {
+					ts0 = ((u_int64)rec[n].tsHigh << 32) | rec[n].tsLow;
+					first = FALSE;
+				}
+				PrintRec(&rec[n], ts0, (u_int32)freq);
+			}
+		} while (cnt == REC_MAX);
+
+		if (loopDelay)
+			UOS_Delay(loopDelay);
+
+	} while (loopDelay && UOS_KeyPressed() < 0);
+
+	if (UTL_TSTOPT("d") && M_setstat(path, M31_TRACE_ENABLE, 0) < 0) {
+		PrintMdisError("setstat M31_TRACE_ENABLE");
+		goto cleanup;
+	}
+
+	ret = 0;
+
+	/*--------------------+
+	|  cleanup            |
+	+--------------------*/
+	cleanup:
+	if (M_close(path) < 0)
+		PrintMdisError("close");
+
+	return(ret);
+}
+
+/********************************* PrintRec *********************************
+ *
+ *  Description: Print one trace record
+ *			   
+ *---------------------------------------------------------------------------
+ *  Input......: rec	trace record
+ *               ts0	reference timestamp
+ *               freq	timestamp frequency [Hz]
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintRec(M31_TRACE_REC *rec, u_int64 ts0, u_int32 freq)
+{
+	u_int64 ts = ((u_int64)rec->tsHigh << 32) | rec->tsLow;
+	double  us = freq ? (double)(int64)(ts - ts0) * 1e6 / freq : 0.0;
+
+	switch (rec->code) {
+	case M31_TR_READ:
+		printf("%14.3f us  Read      ch=%2u state=0x%04x\n",
+			   us, rec->ch, (unsigned)rec->value);
+		break;
+	case M31_TR_BLOCKREAD:
+		printf("%14.3f us  BlockRead ch=%2u size=%u\n",
+			   us, rec->ch, (unsigned)rec->value);
+		break;
+	case M31_TR_SETSTAT:
+		printf("%14.3f us  SetStat   ch=%2u code=0x%04x\n",
+			   us, rec->ch, (unsigned)rec->value);
+		break;
+	case M31_TR_GETSTAT:
+		printf("%14.3f us  GetStat   ch=%2u code=0x%04x\n",
+			   us, rec->ch, (unsigned)rec->value);
+		break;
+	case M31_TR_IRQ:
+		printf("%14.3f us  Irq       state=0x%04x change=0x%04x\n",
+			   us, (unsigned)(rec->value >> 16),
+			   (unsigned)(rec->value & 0xffff));
+		break;
+	case M31_TR_LOST:
+		printf("*** %u records lost\n", (unsigned)rec->value);
+		break;
+	default:
+		printf("%14.3f us  code=0x%04x ch=%2u value=0x%08x\n",
+			   us, rec->code, rec->ch, (unsigned)rec->value);
+	}
+}
+
+/******************************* PrintLockStat ******************************
+ *
+ *  Description: Print the device lock statistics of all entry points
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: path	device path
+ *               freq	timestamp frequency [Hz]
+ *  Output.....: return	0 | 1 on error
+ *  Globals....: -
+ ****************************************************************************/
+static int PrintLockStat(MDIS_PATH path, u_int32 freq)
+{
+	static const char *epName[M31_LOCK_EP_NUM] = {
+		"Read", "Write", "SetStat", "GetStat", "BlockRead", "BlockWrite"
+	};
+	M31_LOCK_STAT	stat[M31_LOCK_EP_NUM];
+	M_SG_BLOCK		blk;
+	u_int32			ep;
+
+	blk.size = sizeof(stat);
+	blk.data = (void*)stat;
+
+	if (M_getstat(path, M31_BLK_LOCK_STAT, (int32*)&blk) < 0) {
+		PrintMdisError("getstat M31_BLK_LOCK_STAT "
+					   "(driver variant m31_ownlock required)");
+		return(1);
+	}
+
+	printf("entry point       calls  contended   max wait [us]"
+		   "   max hold [us]\n");
+	for (ep=0; ep<M31_LOCK_EP_NUM; ep++)
+		printf("%-10s  %11u %10u %15.3f %15.3f\n", epName[ep],
+			   (unsigned)stat[ep].count, (unsigned)stat[ep].contended,
+			   (double)stat[ep].waitMax * 1e6 / freq,
+			   (double)stat[ep].holdMax * 1e6 / freq);
+
+	for (ep=0; ep<M31_LOCK_EP_NUM; ep++) {
+		if (!stat[ep].count)
+			continue;
+		printf("\n%s lock wait:\n", epName[ep]);
+		PrintHist(stat[ep].waitHist, freq);
+		printf("%s lock hold:\n", epName[ep]);
+		PrintHist(stat[ep].holdHist, freq);
+	}
+
+	return(0);
+}
+
+/********************************* PrintHist ********************************
+ *
+ *  Description: Print the non-empty buckets of a log2 histogram
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: hist	histogram [ts counts]
+ *               freq	timestamp frequency [Hz]
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintHist(u_int32 *hist, u_int32 freq)
+{
+	u_int32 n;
+
+	for (n=0; n<M31_HIST_BUCKETS; n++)
+		if (hist[n])
+			printf("  %12.3f us .. %12.3f us : %u\n",
+				   (double)((u_int64)1 << n) * 1e6 / freq,
+				   (double)((u_int64)2 << n) * 1e6 / freq,
+				   (unsigned)hist[n]);
+}
+
+/********************************* PrintMdisError ***************************
+ *
+ *  Description: Print MDIS error message
+ *			   
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintMdisError(char *info)
+{
+	printf("*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
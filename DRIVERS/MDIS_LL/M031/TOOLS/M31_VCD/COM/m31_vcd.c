@@ -0,0 +1,558 @@
+/****************************************************************************
+ ************                                                    ************
+ ************                    M31_VCD                         ************
+ ************                                                    ************
+ ****************************************************************************
+ *
+ *       Author: ds
+ *
+ *  Description: Export M31 input activity as Value Change Dump (VCD)
+ *
+ *               Writes one VCD wire per channel, readable by standard
+ *               waveform viewers. Sources:
+ *
+ *                 device          change events (M31_BLKMODE_EVENT),
+ *                                 timescale 1 ns, time = driver
+ *                                 timestamp (as printed by m31_mon)
+ *                 device -p=<us>  sampled capture (M31_BLKMODE_CAPTURE),
+ *                                 timescale 1 us
+ *                 -l=<file>       log file of m31_mon (one device),
+ *                                 timescale 1 ns
+ *                 -c=<file>       capture file of m31_cap (raw or -r),
+ *                                 timescale 1 us
+ *
+ *               The module ID (ID PROM) and device name are written to
+ *               the VCD header. The input is processed in blocks and only
+ *               the last state is kept, so captures of any length are
+ *               converted in constant memory.
+ *
+ *     Required: libraries: mdis_api, usr_oss, usr_utl, m31_util
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/usr_oss.h>
+#include <MEN/usr_utl.h>
+#include <MEN/m31_drv.h>
+#include <MEN/m31_log.h>
+
+/*--------------------------------------+
+|   DEFINES                             |
++--------------------------------------*/
+#define BLK_EVENTS		1024	/* nr of events per M_getblock call */
+#define BLK_SAMPLES		4096	/* nr of samples per read */
+#define POLL_MSEC		20		/* delay if no data pending */
+#define VCD_ID(ch)		((char)('!' + (ch)))	/* VCD identifier of channel */
+
+/*--------------------------------------+
+|   TYPEDEFS                            |
++--------------------------------------*/
+/* VCD output state */
+typedef struct {
+	FILE	*fp;				/* output file */
+	u_int32	chNbr;				/* nr of channels */
+	u_int64	time;				/* time of last change */
+	u_int16	state;				/* last state */
+	int		valid;				/* state written */
+} VCD;
+
+/*--------------------------------------+
+|   PROTOTYPES                          |
++--------------------------------------*/
+static void usage(void);
+static void VcdHeader(VCD *vcd, const char *name, u_int16 modId,
+					  const char *timescale);
+static void VcdState(VCD *vcd, u_int64 time, u_int16 state);
+static void VcdComment(VCD *vcd, const char *text);
+static u_int64 TsToNs(u_int64 ts, u_int32 freq);
+static int FromDevice(VCD *vcd, char *device, u_int32 period, u_int32 nbr);
+static int FromLog(VCD *vcd, char *file, int32 dev);
+static int FromCapture(VCD *vcd, char *file, u_int32 period, int rle);
+static void PrintMdisError(char *info);
+
+/********************************* usage ************************************
+ *
+ *  Description: Print program usage
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: -
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void usage(void)
+{
+	printf("Usage: m31_vcd [<opts>] <device> [<opts>]\n");
+	printf("       m31_vcd -l=<file> [<opts>]\n");
+	printf("       m31_vcd -c=<file> -p=<us> [<opts>]\n");
+	printf("Function: Export M31 input activity as Value Change Dump\n");
+	printf("Options:\n");
+	printf("    device       device name, record change events\n");
+	printf("    -p=<us>      sample period [us]: device: record captured\n");
+	printf("                 samples, -c: period of capture file\n");
+	printf("    -n=<n>       device: stop after n events/samples [key]\n");
+	printf("    -l=<file>    convert m31_mon log file\n");
+	printf("    -d=<n>       log file: device index             [0]\n");
+	printf("    -c=<file>    convert m31_cap capture file\n");
+	printf("    -r           capture file is run length encoded\n");
+	printf("    -o=<file>    VCD output file                    [stdout]\n");
+	printf("\n");
+}
+
+/********************************* main *************************************
+ *
+ *  Description: Program main function
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: argc,argv	argument counter, data ..
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+int main(int argc, char *argv[])
+{
+	VCD		vcd;
+	char	*device, *str, *errstr, *outFile, *logFile, *capFile, errbuf[40];
+	u_int32	period, nbr;
+	int32	n, dev;
+	int		ret;
+
+	/*--------------------+
+	|  check arguments    |
+	+--------------------*/
+	if ((errstr = UTL_ILLIOPT("p=n=l=d=c=ro=?", errbuf))) {
+		fprintf(stderr, "*** %s\n", errstr);
+		return(1);
+	}
+
+	if (UTL_TSTOPT("?")) {
+		usage();
+		return(1);
+	}
+
+	for (device=NULL, n=1; n<argc; n++)
+		if (*argv[n] != '-') {
+			device = argv[n];
+			break;
+		}
+
+	period  = ((str = UTL_TSTOPT("p=")) ? atoi(str) : 0);
+	nbr     = ((str = UTL_TSTOPT("n=")) ? atoi(str) : 0);
+	dev     = ((str = UTL_TSTOPT("d=")) ? atoi(str) : 0);
+	logFile = UTL_TSTOPT("l=");
+	capFile = UTL_TSTOPT("c=");
+	outFile = UTL_TSTOPT("o=");
+
+	if ((!device && !logFile && !capFile) || (capFile && !period)) {
+		usage();
+		return(1);
+	}
+
+	memset(&vcd, 0, sizeof(vcd));
+	vcd.fp = stdout;
+
+	if (outFile && (vcd.fp = fopen(outFile, "w")) == NULL) {
+		fprintf(stderr, "*** can't open %s\n", outFile);
+		return(1);
+	}
+
+	if (logFile)
+		ret = FromLog(&vcd, logFile, dev);
+	else if (capFile)
+		ret = FromCapture(&vcd, capFile, period, UTL_TSTOPT("r") ? 1 : 0);
+	else
+		ret = FromDevice(&vcd, device, period, nbr);
+
+	if (outFile)
+		fclose(vcd.fp);
+
+	return(ret);
+}
+
+/******************************** FromDevice ********************************
+ *
+ *  Description: Record change events or captured samples of a device
+ *
+ *               Stops after <nbr> events/samples or when a key is pressed.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: vcd		VCD state
+ *               device		device name
+ *               period		sample period [us] (0=events)
+ *               nbr		max nr of events/samples (0=unlimited)
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+static int FromDevice(VCD *vcd, char *device, u_int32 period, u_int32 nbr)
+{
+	MDIS_PATH	path;
+	M_SG_BLOCK	blk;
+	M31_EVENT	ev[BLK_EVENTS];
+	u_int16		buf[BLK_SAMPLES];
+	u_int16		idProm[64], modId = 0, state;
+	u_int64		ts, sample = 0;
+	u_int32		total = 0;
+	int32		freq, chNbr, len, n, i;
+	int			ret = 1;
+
+	if ((path = M_open(device)) < 0) {
+		PrintMdisError("open");
+		return(1);
+	}
+
+	if (M_getstat(path, M31_TS_FREQ, &freq) < 0 ||
+		M_getstat(path, M_LL_CH_NUMBER, &chNbr) < 0) {
+		PrintMdisError("getstat M31_TS_FREQ/M_LL_CH_NUMBER");
+		goto cleanup;
+	}
+	vcd->chNbr = chNbr;
+
+	blk.size = sizeof(idProm);
+	blk.data = (void*)idProm;
+	if (M_getstat(path, M_LL_BLK_ID_DATA, (int32*)&blk) >= 0)
+		modId = idProm[1];
+
+	/*--------------------+
+	|  initial state      |
+	+--------------------*/
+	if (M_setstat(path, M31_BLK_MODE, M31_BLKMODE_STATE) < 0 ||
+		M_getblock(path, (u_int8*)&state, 2) < 0) {
+		PrintMdisError("read state");
+		goto cleanup;
+	}
+
+	/*--------------------+
+	|  start              |
+	+--------------------*/
+	if (period) {
+		if (M_setstat(path, M31_CAP_PERIOD, period) < 0 ||
+			M_setstat(path, M31_CAP_TRIG_MASK, 0) < 0 ||
+			M_setstat(path, M31_CAP_PRETRIG, 0) < 0 ||
+			M_setstat(path, M31_CAP_FORMAT, M31_CAPFMT_RAW) < 0 ||
+			M_setstat(path, M31_BLK_MODE, M31_BLKMODE_CAPTURE) < 0 ||
+			M_setstat(path, M31_CAP_CTRL, M31_CAP_START) < 0) {
+			PrintMdisError("setstat M31_CAP_xxx");
+			goto cleanup;
+		}
+		VcdHeader(vcd, device, modId, "1 us");
+	}
+	else {
+		if (M_setstat(path, M31_BLK_MODE, M31_BLKMODE_EVENT) < 0 ||
+			M_setstat(path, M_MK_IRQ_ENABLE, 1) < 0) {
+			PrintMdisError("setstat M31_BLK_MODE");
+			goto cleanup;
+		}
+		VcdHeader(vcd, device, modId, "1 ns");
+	}
+
+	fprintf(stderr, "Recording... (Press Key to abort)\n");
+
+	/*--------------------+
+	|  convert            |
+	+--------------------*/
+	while (!nbr || total < nbr) {
+		if (period)
+			len = M_getblock(path, (u_int8*)buf, sizeof(buf));
+		else
+			len = M_getblock(path, (u_int8*)ev, sizeof(ev));
+
+		if (len < 0) {
+			PrintMdisError("getblock");
+			goto cleanup;
+		}
+
+		n = len / (period ? sizeof(u_int16) : sizeof(M31_EVENT));
+		if (nbr && (u_int32)n > nbr - total)
+			n = nbr - total;
+
+		if (n == 0) {
+			fflush(vcd->fp);
+			if (UOS_KeyPressed() >= 0)
+				break;
+			UOS_Delay(POLL_MSEC);
+			continue;
+		}
+
+		for (i=0; i<n; i++) {
+			if (period) {
+				VcdState(vcd, sample++ * period, buf[i]);
+				continue;
+			}
+
+			if (ev[i].flags & M31_EVF_RULE)
+				continue;
+
+			ts = TsToNs(((u_int64)ev[i].tsHigh << 32) | ev[i].tsLow, freq);
+			if (!vcd->valid)
+				VcdState(vcd, ts ? ts - 1 : 0, state);	/* initial state */
+
+			if (ev[i].flags & M31_EVF_OVERRUN)
+				VcdComment(vcd, "events lost");
+			VcdState(vcd, ts, ev[i].state);
+		}
+
+		total += n;
+	}
+
+	ret = 0;
+
+	cleanup:
+	if (period)
+		M_setstat(path, M31_CAP_CTRL, M31_CAP_STOP);
+	else
+		M_setstat(path, M_MK_IRQ_ENABLE, 0);
+
+	if (M_close(path) < 0)
+		PrintMdisError("close");
+
+	return(ret);
+}
+
+/********************************* FromLog **********************************
+ *
+ *  Description: Convert the events of one device of an m31_mon log
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: vcd		VCD state
+ *               file		log file
+ *               dev		device index
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+static int FromLog(VCD *vcd, char *file, int32 dev)
+{
+	M31_LOG			log;
+	M31_LOG_QUERY	q;
+	const M31_EVENT	*ev;
+	u_int64			ts;
+	u_int32			freq;
+
+	if (M31_LogOpen(&log, file) < 0) {
+		fprintf(stderr, "*** can't open %s: %s\n", file, strerror(errno));
+		return(1);
+	}
+
+	if (dev < 0 || (u_int32)dev >= log.hdr.nrDev) {
+		fprintf(stderr, "*** %s: no device %d\n", file, (int)dev);
+		M31_LogClose(&log);
+		return(1);
+	}
+
+	freq = log.hdr.tsFreq;
+	vcd->chNbr = log.hdr.dev[dev].chNbr;
+	VcdHeader(vcd, log.hdr.dev[dev].name, log.hdr.dev[dev].modId, "1 ns");
+
+	M31_LogQueryInit(&q, 0, ~(u_int64)0, 1 << dev, 0xffff);
+
+	while ((ev = M31_LogNext(&log, &q)) != NULL) {
+		if (ev->flags & M31_EVF_RULE)
+			continue;
+
+		ts = TsToNs(((u_int64)ev->tsHigh << 32) | ev->tsLow, freq);
+
+		/* state before the first logged change */
+		if (!vcd->valid)
+			VcdState(vcd, ts ? ts - 1 : 0, (u_int16)(ev->state ^ ev->change));
+
+		if (ev->flags & M31_EVF_OVERRUN)
+			VcdComment(vcd, "events lost");
+		VcdState(vcd, ts, ev->state);
+	}
+
+	M31_LogClose(&log);
+	return(0);
+}
+
+/******************************* FromCapture ********************************
+ *
+ *  Description: Convert an m31_cap capture file (raw or run length coded)
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: vcd		VCD state
+ *               file		capture file
+ *               period		sample period [us]
+ *               rle		file is run length encoded (M31_RLE_REC)
+ *  Output.....: return	    success (0) or error (1)
+ *  Globals....: -
+ ****************************************************************************/
+static int FromCapture(VCD *vcd, char *file, u_int32 period, int rle)
+{
+	FILE		*fp;
+	u_int16		buf[BLK_SAMPLES];
+	M31_RLE_REC	*rec = (M31_RLE_REC*)buf;
+	u_int64		sample = 0;
+	size_t		n, i;
+
+	if ((fp = fopen(file, "rb")) == NULL) {
+		fprintf(stderr, "*** can't open %s\n", file);
+		return(1);
+	}
+
+	vcd->chNbr = 16;
+	VcdHeader(vcd, file, 0, "1 us");
+
+	while ((n = fread(buf, rle ? sizeof(M31_RLE_REC) : sizeof(u_int16),
+					  rle ? sizeof(buf) / sizeof(M31_RLE_REC) : BLK_SAMPLES,
+					  fp)) > 0) {
+		for (i=0; i<n; i++) {
+			if (rle) {
+				VcdState(vcd, sample * period, rec[i].state);
+				sample += rec[i].count;
+			}
+			else
+				VcdState(vcd, sample++ * period, buf[i]);
+		}
+	}
+
+	fclose(fp);
+	return(0);
+}
+
+/********************************* TsToNs ***********************************
+ *
+ *  Description: Convert driver timestamp to ns
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: ts			timestamp [counts]
+ *               freq		timestamp frequency [Hz]
+ *  Output.....: return		time [ns]
+ *  Globals....: -
+ ****************************************************************************/
+static u_int64 TsToNs(u_int64 ts, u_int32 freq)
+{
+	return((ts / freq) * 1000000000 + (ts % freq) * 1000000000 / freq);
+}
+
+/******************************** VcdHeader *********************************
+ *
+ *  Description: Write VCD header and variable definitions
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: vcd		VCD state (chNbr set)
+ *               name		device/file name
+ *               modId		module id from ID PROM (0=unknown)
+ *               timescale	VCD timescale
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void VcdHeader(VCD *vcd, const char *name, u_int16 modId,
+					  const char *timescale)
+{
+	time_t	now = time(NULL);
+	u_int32	ch;
+
+	if (vcd->chNbr == 0 || vcd->chNbr > 16)
+		vcd->chNbr = 16;
+
+	fprintf(vcd->fp, "$date %s$end\n", ctime(&now));
+	fprintf(vcd->fp, "$version m31_vcd $end\n");
+	if (modId)
+		fprintf(vcd->fp, "$comment %s: module M%02u (ID PROM) $end\n",
+				name, (unsigned)modId);
+	else
+		fprintf(vcd->fp, "$comment %s: module ID unknown $end\n", name);
+	fprintf(vcd->fp, "$timescale %s $end\n", timescale);
+	fprintf(vcd->fp, "$scope module m31 $end\n");
+
+	for (ch=0; ch<vcd->chNbr; ch++)
+		fprintf(vcd->fp, "$var wire 1 %c ch%u $end\n", VCD_ID(ch),
+				(unsigned)ch);
+
+	fprintf(vcd->fp, "$upscope $end\n");
+	fprintf(vcd->fp, "$enddefinitions $end\n");
+}
+
+/******************************** VcdState **********************************
+ *
+ *  Description: Write the changed channels of a new state
+ *
+ *               The first call dumps all channels. Times lower than the
+ *               last written one are raised to it.
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: vcd		VCD state
+ *               time		time [timescale units]
+ *               state		channel states
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void VcdState(VCD *vcd, u_int64 time, u_int16 state)
+{
+	u_int16	change = (u_int16)(state ^ vcd->state);
+	u_int32	ch;
+
+	if (vcd->valid && !change)
+		return;
+
+	if (time < vcd->time)
+		time = vcd->time;
+
+	if (!vcd->valid) {
+		fprintf(vcd->fp, "#%llu\n$dumpvars\n", (unsigned long long)time);
+		change = 0xffff;
+	}
+	else if (time != vcd->time)
+		fprintf(vcd->fp, "#%llu\n", (unsigned long long)time);
+
+	for (ch=0; ch<vcd->chNbr; ch++)
+		if (change & (1 << ch))
+			fprintf(vcd->fp, "%c%c\n", (state & (1 << ch)) ? '1' : '0',
+					VCD_ID(ch));
+
+	if (!vcd->valid)
+		fprintf(vcd->fp, "$end\n");
+
+	vcd->time  = time;
+	vcd->state = state;
+	vcd->valid = 1;
+}
+
+/******************************* VcdComment *********************************
+ *
+ *  Description: Write a comment at the current time
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: vcd		VCD state
+ *               text		comment
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void VcdComment(VCD *vcd, const char *text)
+{
+	fprintf(vcd->fp, "$comment %s $end\n", text);
+}
+
+/********************************* PrintMdisError ***************************
+ *
+ *  Description: Print MDIS error message
+ *
+ *---------------------------------------------------------------------------
+ *  Input......: info	info string
+ *  Output.....: -
+ *  Globals....: -
+ ****************************************************************************/
+static void PrintMdisError(char *info)
+{
+	fprintf(stderr, "*** can't %s: %s\n", info, M_errstring(UOS_ErrnoGet()));
+}
@@ -0,0 +1,77 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: m31_bits.h
+ *
+ *       Author: ds
+ *
+ *  Description: Header file for the M31 state word decoder (m31_util)
+ *
+ *               Decodes arrays of 16-bit state words (M31_BLKMODE_CAPTURE
+ *               samples, bit n = channel n) into transitions and levels:
+ *
+ *                 M31_BitsXor     XOR delta to the previous word
+ *                 M31_BitsEdges   edge positions of one channel
+ *                 M31_BitsPlanes  one byte (0/1) per sample and channel
+ *                 M31_BitsTally   rising/falling edges per channel
+ *
+ *               Sample 0 is compared with <prev>, the last word of the
+ *               previous buffer, so long captures can be decoded in
+ *               blocks. The functions use SSE2 or AVX2 if the CPU
+ *               supports it (selected at the first call) and a scalar
+ *               implementation otherwise; all yield the same results.
+ *
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _M31_BITS_H
+#define _M31_BITS_H
+
+#ifdef __cplusplus
+      extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+/* implementations (M31_BitsSelect) */
+#define M31_BITS_AUTO       0				 /* best supported */
+#define M31_BITS_SCALAR     1
+#define M31_BITS_SSE2       2
+#define M31_BITS_AVX2       3
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+extern void M31_BitsXor(const u_int16 *in, u_int32 n, u_int16 prev,
+						u_int16 *out);
+extern u_int32 M31_BitsEdges(const u_int16 *in, u_int32 n, u_int16 prev,
+							 u_int32 ch, u_int32 *idx, u_int32 max);
+extern void M31_BitsPlanes(const u_int16 *in, u_int32 n, u_int16 chMask,
+						   u_int8 *plane[16]);
+extern u_int32 M31_BitsTally(const u_int16 *in, u_int32 n, u_int16 prev,
+							 u_int32 rise[16], u_int32 fall[16]);
+extern int32 M31_BitsSelect(int32 impl);
+extern const char *M31_BitsName(void);
+
+#ifdef __cplusplus
+      }
+#endif
+
+#endif /* _M31_BITS_H */
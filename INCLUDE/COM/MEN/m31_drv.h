@@ -45,9 +45,284 @@
 #define M31_SIGCLR		    M_DEV_OF+0x01	 /* S  : clear signal		  */
 #define M31_CHANGE_FLAGS    M_DEV_OF+0x02	 /*   G: get change flags	  */
 #define M31_HYS_MODE	    M_DEV_OF+0x03	 /* S,G: set/get hysteresis mode  (for M82 only!) */
+#define M31_ISR_STAT_CLR    M_DEV_OF+0x04	 /* S  : clear ISR timing statistics */
+#define M31_TS_FREQ         M_DEV_OF+0x05	 /*   G: get timestamp frequency [Hz] */
+#define M31_TRACE_ENABLE    M_DEV_OF+0x06	 /* S,G: enable/disable binary trace */
+#define M31_BLK_MODE        M_DEV_OF+0x07	 /* S,G: set/get block read mode */
+#define M31_EVENT_COUNT     M_DEV_OF+0x08	 /*   G: get nr of pending events */
+#define M31_EVENT_LOST      M_DEV_OF+0x09	 /* S,G: set/get nr of lost events */
+#define M31_LOST_EDGES      M_DEV_OF+0x0a	 /* S,G: set/get lost edges of curr chan */
+#define M31_CAP_PERIOD      M_DEV_OF+0x0b	 /* S,G: set/get sample period [us] */
+#define M31_CAP_TRIG_MASK   M_DEV_OF+0x0c	 /* S,G: set/get trigger mask */
+#define M31_CAP_TRIG_VALUE  M_DEV_OF+0x0d	 /* S,G: set/get trigger value */
+#define M31_CAP_PRETRIG     M_DEV_OF+0x0e	 /* S,G: set/get pre-trigger depth */
+#define M31_CAP_CTRL        M_DEV_OF+0x0f	 /* S,G: start/stop capture, get state */
+#define M31_CAP_FORMAT      M_DEV_OF+0x10	 /* S,G: set/get capture format */
+#define M31_ID_REFRESH      M_DEV_OF+0x11	 /* S  : re-read ID PROM cache */
+#define M31_HYS_MASK        M_DEV_OF+0x12	 /* S,G: set/get hysteresis of all chan (M82 only!) */
+#define M31_SIG_MASK        M_DEV_OF+0x13	 /* S,G: set/get channels sending signal */
+#define M31_EDGE_RISE       M_DEV_OF+0x14	 /* S,G: set/get channels reporting rising edges */
+#define M31_EDGE_FALL       M_DEV_OF+0x15	 /* S,G: set/get channels reporting falling edges */
+#define M31_SIG_COALESCE    M_DEV_OF+0x16	 /* S,G: set/get signal coalescing window [ms] */
+#define M31_AGGR_MEMBERS    M_DEV_OF+0x17	 /*   G: get registered aggregate modules */
+#define M31_DEBOUNCE        M_DEV_OF+0x18	 /* S,G: set/get debounce time of curr chan [us] */
+#define M31_GLITCHES        M_DEV_OF+0x19	 /* S,G: set/get glitch counter of curr chan */
+#define M31_QUAD_MASK       M_DEV_OF+0x1a	 /* S,G: set/get quadrature decoded pairs */
+#define M31_QUAD_POS        M_DEV_OF+0x1b	 /* S,G: set/get position of curr pair */
+#define M31_QUAD_DIR        M_DEV_OF+0x1c	 /*   G: get direction of curr pair */
+#define M31_QUAD_ERRORS     M_DEV_OF+0x1d	 /* S,G: set/get errors of curr pair */
+#define M31_STROBE_CH       M_DEV_OF+0x1e	 /* S,G: set/get strobe channel */
+#define M31_STROBE_EDGE     M_DEV_OF+0x1f	 /* S,G: set/get strobe edge */
+#define M31_STROBE_COUNT    M_DEV_OF+0x20	 /*   G: get nr of pending words */
+#define M31_STROBE_LOST     M_DEV_OF+0x21	 /* S,G: set/get nr of lost words */
+#define M31_FIELD_VALUE     M_DEV_OF+0x22	 /*   G: get value of field of curr ch */
+#define M31_READY_MASK      M_DEV_OF+0x23	 /*   G: get/clear ready mask of group */
+#define M31_LOCK_STAT_CLR   M_DEV_OF+0x24	 /* S  : clear lock statistics */
 
 /* M31 specific status codes (BLK) */        /* S,G: S=setstat, G=getstat */
-/* none */
+#define M31_BLK_ISR_STAT    M_DEV_BLK_OF+0x00 /*   G: get ISR timing statistics */
+#define M31_BLK_TRACE       M_DEV_BLK_OF+0x01 /*   G: get (consume) trace records */
+#define M31_BLK_LOST_EDGES  M_DEV_BLK_OF+0x02 /*   G: get lost edge counters */
+#define M31_BLK_CAP_INFO    M_DEV_BLK_OF+0x03 /*   G: get capture info */
+#define M31_BLK_AGGR_CHANGE M_DEV_BLK_OF+0x04 /*   G: get change flags of all modules */
+#define M31_BLK_GLITCHES    M_DEV_BLK_OF+0x05 /*   G: get glitch counters */
+#define M31_BLK_QUAD        M_DEV_BLK_OF+0x06 /*   G: get quadrature decoders */
+#define M31_BLK_FIELD_DEF   M_DEV_BLK_OF+0x07 /* S,G: set field/get all fields */
+#define M31_BLK_FIELD_STAT  M_DEV_BLK_OF+0x08 /*   G: get values of all fields */
+#define M31_BLK_RULES       M_DEV_BLK_OF+0x09 /* S,G: load/get rule table */
+#define M31_BLK_RULE_STAT   M_DEV_BLK_OF+0x0a /*   G: get rule states */
+#define M31_BLK_LAST_CHANGE M_DEV_BLK_OF+0x0b /*   G: get last change per channel */
+#define M31_BLK_COUNTERS    M_DEV_BLK_OF+0x0c /*   G: get activity counters */
+#define M31_BLK_LOCK_STAT   M_DEV_BLK_OF+0x0d /*   G: get lock statistics */
+
+/* block read modes (M31_BLK_MODE) */
+#define M31_BLKMODE_STATE   0				 /* state of all channels (u_int16) */
+#define M31_BLKMODE_EVENT   1				 /* event records (M31_EVENT)       */
+#define M31_BLKMODE_CAPTURE 2				 /* captured samples (u_int16)      */
+#define M31_BLKMODE_STROBE  3				 /* strobed words (M31_STROBE_REC)  */
+
+/* strobe edges (M31_STROBE_EDGE) */
+#define M31_STROBE_OFF      0				 /* strobed word mode off           */
+#define M31_STROBE_RISE     1				 /* latch on rising edge            */
+#define M31_STROBE_FALL     2				 /* latch on falling edge           */
+#define M31_STROBE_BOTH     3				 /* latch on both edges             */
+
+/* capture control (M31_CAP_CTRL setstat) */
+#define M31_CAP_STOP        0				 /* stop sampling                   */
+#define M31_CAP_START       1				 /* start sampling, arm trigger     */
+#define M31_CAP_FORCE       2				 /* force trigger                   */
+
+/* capture states (M31_CAP_CTRL getstat) */
+#define M31_CAPST_IDLE      0				 /* not started                     */
+#define M31_CAPST_ARMED     1				 /* sampling, waiting for trigger   */
+#define M31_CAPST_TRIGGERED 2				 /* sampling, data readable         */
+#define M31_CAPST_STOPPED   3				 /* stopped, data readable          */
+
+/* capture formats (M31_CAP_FORMAT) */
+#define M31_CAPFMT_RAW      0				 /* one u_int16 per sample          */
+#define M31_CAPFMT_RLE      1				 /* one M31_RLE_REC per run         */
+
+/* event record flags (M31_EVENT.flags) */
+#define M31_EVF_LOST_EDGE   0x01			 /* irq without visible change:
+												change = suspected channel  */
+#define M31_EVF_OVERRUN     0x02			 /* events lost before this one    */
+#define M31_EVF_FIELD       0x04			 /* new field value:
+												change = field channels     */
+#define M31_EVF_RULE        0x08			 /* rule completed:
+												change = 1 << rule          */
+#define M31_EVF_VIOLATED    0x10			 /* with M31_EVF_RULE: violated */
+
+/* rule step ops (M31_RULE_STEP.op) */
+#define M31_ROP_END         0				 /* end of rule                     */
+#define M31_ROP_RISE        1				 /* rising edge (within time)       */
+#define M31_ROP_FALL        2				 /* falling edge (within time)      */
+#define M31_ROP_HIGH        3				 /* high level (for time)           */
+#define M31_ROP_LOW         4				 /* low level (for time)            */
+
+/* channel field codings (M31_FIELD_DEF.code) */
+#define M31_FLDCODE_BIN     0				 /* binary                          */
+#define M31_FLDCODE_GRAY    1				 /* Gray code                       */
+#define M31_FLDCODE_BCD     2				 /* BCD, 4 channels per digit       */
+
+/* trace record codes (M31_TRACE_REC.code) */
+#define M31_TR_READ         0x01			 /* M31_Read      value: state     */
+#define M31_TR_BLOCKREAD    0x02			 /* M31_BlockRead value: size      */
+#define M31_TR_SETSTAT      0x03			 /* M31_SetStat   value: code      */
+#define M31_TR_GETSTAT      0x04			 /* M31_GetStat   value: code      */
+#define M31_TR_IRQ          0x05			 /* M31_Irq       value: state<<16 |
+												change                      */
+#define M31_TR_LOST         0xff			 /* value: nr of overwritten recs  */
+
+/* locked entry points (M31_BLK_LOCK_STAT index) */
+#define M31_LOCK_READ       0				 /* M31_Read                        */
+#define M31_LOCK_WRITE      1				 /* M31_Write                       */
+#define M31_LOCK_SETSTAT    2				 /* M31_SetStat                     */
+#define M31_LOCK_GETSTAT    3				 /* M31_GetStat                     */
+#define M31_LOCK_BLOCKREAD  4				 /* M31_BlockRead                   */
+#define M31_LOCK_BLOCKWRITE 5				 /* M31_BlockWrite                  */
+#define M31_LOCK_EP_NUM     6				 /* nr of locked entry points       */
+
+/* misc */
+#define M31_HIST_BUCKETS    32				 /* nr of log2 histogram buckets */
+#define M31_AGGR_MAX        8				 /* max nr of modules per aggregate */
+/* aggregate members with descriptor key AGGR_EXCLUSIVE=1 reserve their
+   event records and change flags for the master: the member paths get
+   ERR_LL_DEV_BUSY for M31_CHANGE_FLAGS and M31_BLKMODE_EVENT reads */
+#define M31_FIELD_MAX       8				 /* max nr of channel fields */
+#define M31_FIELD_NAME_LEN  16				 /* max field name length incl. 0 */
+#define M31_RULE_MAX        8				 /* max nr of rules */
+#define M31_RULE_STEPS      8				 /* max nr of steps per rule */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/* ISR execution time statistics (M31_BLK_ISR_STAT) */
+typedef struct {
+	u_int32 count;						/* nr of measured interrupts */
+	u_int32 max;						/* max execution time [ts counts] */
+	u_int32 maxTsHigh;					/* timestamp of max, bits 63..32 */
+	u_int32 maxTsLow;					/* timestamp of max, bits 31..0 */
+	u_int32 hist[M31_HIST_BUCKETS];		/* hist[n]: 2^n <= time < 2^(n+1) */
+} M31_ISR_STAT;
+
+/* binary trace record (M31_BLK_TRACE) */
+typedef struct {
+	u_int16 code;						/* M31_TR_xxx */
+	u_int16 ch;							/* current channel */
+	u_int32 value;						/* code specific value */
+	u_int32 tsHigh;						/* timestamp, bits 63..32 */
+	u_int32 tsLow;						/* timestamp, bits 31..0 */
+} M31_TRACE_REC;
+
+/* event record (M31_BlockRead in mode M31_BLKMODE_EVENT) */
+typedef struct {
+	u_int32 tsHigh;						/* timestamp, bits 63..32 */
+	u_int32 tsLow;						/* timestamp, bits 31..0 */
+	u_int16 state;						/* channel states after the edge */
+	u_int16 change;						/* changed channels */
+	u_int8  flags;						/* M31_EVF_xxx */
+	u_int8  dev;						/* device index (0) */
+	u_int16 seq;						/* sequence number */
+} M31_EVENT;
+
+/* lost edge counters (M31_BLK_LOST_EDGES) */
+typedef struct {
+	u_int32 irqs;						/* irqs without visible change */
+	u_int32 unattributed;				/* not attributable to a channel */
+	u_int32 ch[16];						/* possible lost edges per channel */
+} M31_LOST_STAT;
+
+/* capture info (M31_BLK_CAP_INFO) */
+typedef struct {
+	u_int32 state;						/* M31_CAPST_xxx */
+	u_int32 period;						/* effective sample period [us] */
+	u_int32 preTrig;					/* samples stored before trigger */
+	u_int32 count;						/* nr of samples pending */
+	u_int32 lost;						/* samples lost (buffer full) */
+	u_int32 gaps;						/* sampling gaps (late timer calls) */
+	u_int32 trigTsHigh;					/* timestamp of trigger sample, */
+	u_int32 trigTsLow;					/*   bits 63..32 and 31..0      */
+} M31_CAP_INFO;
+
+/* strobed word (M31_BlockRead in mode M31_BLKMODE_STROBE) */
+typedef struct {
+	u_int32 tsHigh;						/* timestamp, bits 63..32 */
+	u_int32 tsLow;						/* timestamp, bits 31..0 */
+	u_int16 data;						/* channel states (strobe bit 0) */
+	u_int8  flags;						/* M31_EVF_LOST_EDGE: strobe edge
+										   lost before this word */
+	u_int8  res;						/* reserved */
+	u_int32 seq;						/* sequence number (gaps: lost) */
+} M31_STROBE_REC;
+
+/* channel field definition (M31_BLK_FIELD_DEF) */
+typedef struct {
+	char    name[M31_FIELD_NAME_LEN];	/* field name (0-terminated) */
+	u_int8  field;						/* field index 0..M31_FIELD_MAX-1 */
+	u_int8  first;						/* first (least significant) chan */
+	u_int8  width;						/* nr of channels (0=undefined) */
+	u_int8  code;						/* M31_FLDCODE_xxx */
+	u_int32 settle;						/* settle time [us] */
+} M31_FIELD_DEF;
+
+/* channel field value (M31_BLK_FIELD_STAT) */
+typedef struct {
+	u_int32 value;						/* settled decoded value */
+	u_int8  valid;						/* value valid */
+	u_int8  pending;					/* in settle window */
+	u_int16 res;						/* reserved */
+	u_int32 changes;					/* nr of reported values */
+	u_int32 invalid;					/* nr of invalid settled codes */
+} M31_FIELD_STAT;
+
+/* last change of a channel (M31_BLK_LAST_CHANGE) */
+typedef struct {
+	u_int32 tsHigh;						/* timestamp, bits 63..32 */
+	u_int32 tsLow;						/* timestamp, bits 31..0 */
+	u_int8  level;						/* level after the change */
+	u_int8  valid;						/* channel changed since init */
+	u_int8  flags;						/* M31_EVF_LOST_EDGE: lost edge
+										   after this change */
+	u_int8  res;						/* reserved */
+} M31_LAST_CHANGE;
+
+/* activity counters (M31_BLK_COUNTERS) */
+typedef struct {
+	u_int32 irqs;						/* interrupts (M_LL_IRQ_COUNT) */
+	u_int32 sigSent;					/* signals sent */
+	u_int32 sigDeferred;				/* signals deferred (coalescing) */
+	u_int32 events;						/* event records stored */
+	u_int32 eventPending;				/* event records pending */
+	u_int32 eventLost;					/* event records lost */
+	u_int32 lostIrqs;					/* irqs without visible change */
+	u_int32 strobeLost;					/* strobed words lost */
+	u_int32 changes[16];				/* level changes per channel */
+} M31_COUNTERS;
+
+/* device lock statistics of an entry point (M31_BLK_LOCK_STAT) */
+typedef struct {
+	u_int32 count;						/* nr of calls */
+	u_int32 contended;					/* calls which found the lock taken */
+	u_int32 waitMax;					/* max wait for the lock [ts counts] */
+	u_int32 holdMax;					/* max lock hold time [ts counts] */
+	u_int32 waitHist[M31_HIST_BUCKETS];	/* hist[n]: 2^n <= time < 2^(n+1) */
+	u_int32 holdHist[M31_HIST_BUCKETS];	/* hist[n]: 2^n <= time < 2^(n+1) */
+} M31_LOCK_STAT;
+
+/* rule step */
+typedef struct {
+	u_int8  op;							/* M31_ROP_xxx */
+	u_int8  ch;							/* channel */
+	u_int16 res;						/* reserved */
+	u_int32 time;						/* window/hold time [ms] */
+} M31_RULE_STEP;
+
+/* rule (M31_BLK_RULES) */
+typedef struct {
+	M31_RULE_STEP step[M31_RULE_STEPS];	/* steps, M31_ROP_END terminated */
+} M31_RULE;
+
+/* rule state (M31_BLK_RULE_STAT) */
+typedef struct {
+	u_int32 done;						/* nr of completions */
+	u_int32 violated;					/* nr of violations */
+	u_int8  step;						/* current step */
+	u_int8  active;						/* rule loaded */
+	u_int16 res;						/* reserved */
+} M31_RULE_STAT;
+
+/* quadrature decoder of a channel pair (M31_BLK_QUAD) */
+typedef struct {
+	int32   pos;						/* position [edges] */
+	int32   dir;						/* last direction (1/-1/0) */
+	u_int32 errors;						/* illegal transitions */
+} M31_QUAD;
+
+/* run of equal samples (capture format M31_CAPFMT_RLE) */
+typedef struct {
+	u_int16 state;						/* channel states */
+	u_int16 count;						/* nr of samples 1..65535 */
+} M31_RLE_REC;
 
 #ifndef  M31_VARIANT
 # define M31_VARIANT M31
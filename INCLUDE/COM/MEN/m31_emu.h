@@ -0,0 +1,169 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: m31_emu.h
+ *
+ *       Author: ds
+ *
+ *  Description: User space emulation of the M31 driver environment
+ *
+ *               With switch M31_EMU the low-level driver m31_drv.c
+ *               includes this file instead of maccess.h, dbg.h, oss.h,
+ *               desc.h and modcom.h, so the unchanged driver source can
+ *               be compiled into a user space program (see m31_replay):
+ *
+ *               - the register window is plain memory (EMU_DEV.regs),
+ *                 the ID PROM is EMU_DEV.idProm
+ *               - interrupt masking and all spin locks are one recursive
+ *                 mutex; the emulated interrupt (EMU_IrqLock) and the OSS
+ *                 timer callbacks run with this mutex held
+ *               - OSS timers are threads, OSS_SigSend calls a hook
+ *               - the descriptor is a NULL terminated list of
+ *                 "KEY=value" strings
+ *               - debug output is compiled out
+ *
+ *     Required: POSIX threads
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _M31_EMU_H
+#define _M31_EMU_H
+
+#ifdef __cplusplus
+      extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define EMU_REG_SIZE        256				 /* register window (A08) */
+#define EMU_ID_SIZE         64				 /* ID PROM words */
+
+/* hardware access (maccess.h) */
+#define MREAD_D16(ma,offs) \
+	(*(volatile u_int16*)((volatile u_int8*)(ma) + (offs)))
+#define MWRITE_D16(ma,offs,val) \
+	(*(volatile u_int16*)((volatile u_int8*)(ma) + (offs)) = (u_int16)(val))
+
+/* debug output (dbg.h) */
+#define DBGINIT(x)
+#define DBGEXIT(x)
+#define DBGWRT_1(x)
+#define DBGWRT_2(x)
+#define DBGWRT_3(x)
+#define DBGWRT_ERR(x)
+#define IDBGWRT_1(x)
+#define IDBGWRT_2(x)
+#define IDBGWRT_ERR(x)
+
+#define OSS_DBG_DEFAULT     0
+#define OSS_SEM_WAITINF     -1
+#define OSS_SEM_NOWAIT      0
+#define OSS_SEM_BIN         0
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+typedef volatile void *MACCESS;
+
+typedef struct EMU_OSS   OSS_HANDLE;
+typedef struct EMU_IRQ   OSS_IRQ_HANDLE;
+typedef struct EMU_SEM   OSS_SEM_HANDLE;
+typedef struct EMU_SIG   OSS_SIG_HANDLE;
+typedef struct EMU_TIMER OSS_TIMER_HANDLE;
+typedef struct EMU_SPINL OSS_SPINL_HANDLE;
+typedef struct EMU_DESC  DESC_HANDLE;
+typedef struct EMU_DBG   DBG_HANDLE;
+typedef const char       *DESC_SPEC;		/* "KEY=value" list */
+typedef int32            OSS_IRQ_STATE;
+
+/* emulated device */
+typedef struct {
+	u_int16 regs[EMU_REG_SIZE/2];		/* register window */
+	u_int16 idProm[EMU_ID_SIZE];		/* ID PROM contents */
+} EMU_DEV;
+
+/* signal hook (OSS_SigSend) */
+typedef void EMU_SIG_HOOK(void *arg, int32 sigNbr);
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+/* oss.h */
+extern void *OSS_MemGet(OSS_HANDLE *oss, u_int32 size, u_int32 *gotSizeP);
+extern int32 OSS_MemFree(OSS_HANDLE *oss, void *addr, u_int32 size);
+extern void OSS_MemFill(OSS_HANDLE *oss, u_int32 size, char *adr, int8 value);
+extern void OSS_MemCopy(OSS_HANDLE *oss, u_int32 size, char *src, char *dst);
+extern int32 OSS_SigCreate(OSS_HANDLE *oss, int32 value,
+						   OSS_SIG_HANDLE **sigP);
+extern int32 OSS_SigSend(OSS_HANDLE *oss, OSS_SIG_HANDLE *sig);
+extern int32 OSS_SigRemove(OSS_HANDLE *oss, OSS_SIG_HANDLE **sigP);
+extern int32 OSS_SigInfo(OSS_HANDLE *oss, OSS_SIG_HANDLE *sig,
+						 int32 *sigNbrP, int32 *pidP);
+extern OSS_IRQ_STATE OSS_IrqMaskR(OSS_HANDLE *oss, OSS_IRQ_HANDLE *irq);
+extern void OSS_IrqRestore(OSS_HANDLE *oss, OSS_IRQ_HANDLE *irq,
+						   OSS_IRQ_STATE state);
+extern u_int32 OSS_TickGet(OSS_HANDLE *oss);
+extern int32 OSS_TickRateGet(OSS_HANDLE *oss);
+extern int32 OSS_Delay(OSS_HANDLE *oss, int32 msec);
+extern int32 OSS_TimerCreate(OSS_HANDLE *oss, void (*func)(void *arg),
+							 void *arg, OSS_TIMER_HANDLE **timerP);
+extern int32 OSS_TimerRemove(OSS_HANDLE *oss, OSS_TIMER_HANDLE **timerP);
+extern int32 OSS_TimerStart(OSS_HANDLE *oss, OSS_TIMER_HANDLE *timer,
+							u_int32 msec, u_int32 cyclic, u_int32 *realMsecP);
+extern int32 OSS_TimerStop(OSS_HANDLE *oss, OSS_TIMER_HANDLE *timer);
+extern int32 OSS_SemCreate(OSS_HANDLE *oss, int32 semType, int32 initVal,
+						   OSS_SEM_HANDLE **semP);
+extern int32 OSS_SemRemove(OSS_HANDLE *oss, OSS_SEM_HANDLE **semP);
+extern int32 OSS_SemWait(OSS_HANDLE *oss, OSS_SEM_HANDLE *sem, int32 msec);
+extern int32 OSS_SemSignal(OSS_HANDLE *oss, OSS_SEM_HANDLE *sem);
+extern int32 OSS_SpinLockCreate(OSS_HANDLE *oss, OSS_SPINL_HANDLE **splP);
+extern int32 OSS_SpinLockRemove(OSS_HANDLE *oss, OSS_SPINL_HANDLE **splP);
+extern int32 OSS_SpinLockAcquire(OSS_HANDLE *oss, OSS_SPINL_HANDLE *spl);
+extern int32 OSS_SpinLockRelease(OSS_HANDLE *oss, OSS_SPINL_HANDLE *spl);
+extern char *OSS_Ident(void);
+
+/* desc.h */
+extern int32 DESC_Init(DESC_SPEC *desc, OSS_HANDLE *oss,
+					   DESC_HANDLE **descP);
+extern int32 DESC_GetUInt32(DESC_HANDLE *desc, u_int32 defVal,
+							u_int32 *valueP, char *keyFmt, ...);
+extern int32 DESC_GetString(DESC_HANDLE *desc, char *defVal, char *buf,
+							u_int32 *lenP, char *keyFmt, ...);
+extern int32 DESC_Exit(DESC_HANDLE **descP);
+extern int32 DESC_DbgLevelSet(DESC_HANDLE *desc, u_int32 level);
+extern char *DESC_Ident(void);
+
+/* modcom.h */
+extern int m_read(U_INT32_OR_64 base, u_int8 index);
+
+/* emulation control */
+extern int32 EMU_Init(EMU_SIG_HOOK *hook, void *arg);
+extern OSS_HANDLE *EMU_Oss(void);
+extern OSS_IRQ_HANDLE *EMU_IrqHdl(void);
+extern OSS_SEM_HANDLE *EMU_SemCreate(void);
+extern void EMU_SemRemove(OSS_SEM_HANDLE *sem);
+extern void EMU_IrqLock(void);
+extern void EMU_IrqUnlock(void);
+
+#ifdef __cplusplus
+      }
+#endif
+
+#endif /* _M31_EMU_H */
@@ -0,0 +1,164 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: m31_log.h
+ *
+ *       Author: ds
+ *
+ *  Description: Header file for the M31 binary event log (m31_util)
+ *
+ *               The log file consists of a header block followed by
+ *               segments of fixed size, all in host byte order:
+ *
+ *                 offs                   size          contents
+ *                 ---------------------  ------------  ------------------
+ *                 0                      hdrSize       M31_LOG_HDR
+ *                 hdrSize + n * segSize  segSize       segment n:
+ *                                        64              M31_LOG_SEG
+ *                                        segRecs * 16    M31_EVENT records
+ *
+ *               hdrSize and segSize are multiples of M31_LOG_ALIGN, so the
+ *               file and each single segment can be memory mapped.
+ *               M31_EVENT.dev of a logged record is the index of the
+ *               device in M31_LOG_HDR.dev[].
+ *
+ *               The segment header is the index of its records: it holds
+ *               the time range (first/last timestamp) and, per device,
+ *               the mask of channels that changed. A query only reads the
+ *               segment headers and skips all segments outside the time
+ *               range or without changes on the requested channels.
+ *
+ *               Segments are written in order of their sequence number
+ *               (M31_LOG_SEG.seq, 1..). With a limited nr of segments
+ *               (M31_LOG_HDR.maxSegs) the log is a ring and the oldest
+ *               segment is reused. Records within a segment are in order
+ *               per device; records of different devices may overlap in
+ *               time. The header of the open segment is rewritten on each
+ *               M31_LogFlush(), so readers only see flushed records.
+ *
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _M31_LOG_H
+#define _M31_LOG_H
+
+#ifdef __cplusplus
+      extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define M31_LOG_MAGIC       0x4c31334d		 /* "M31L" */
+#define M31_LOG_SEG_MAGIC   0x5331334d		 /* "M31S" */
+#define M31_LOG_VERSION     1
+#define M31_LOG_ALIGN       4096			 /* header/segment alignment */
+#define M31_LOG_DEV_MAX     8				 /* max nr of devices */
+#define M31_LOG_NAME_LEN    32				 /* max device name length incl. 0 */
+#define M31_LOG_SEG_RECS(size) (((size) - sizeof(M31_LOG_SEG)) / \
+								sizeof(M31_EVENT))
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/* logged device */
+typedef struct {
+	char    name[M31_LOG_NAME_LEN];		/* MDIS device name */
+	u_int16 modId;						/* module id (ID PROM, 0=unknown) */
+	u_int16 chNbr;						/* nr of channels */
+	u_int32 res;
+} M31_LOG_DEV;
+
+/* file header (padded to hdrSize) */
+typedef struct {
+	u_int32 magic;						/* M31_LOG_MAGIC */
+	u_int32 version;					/* M31_LOG_VERSION */
+	u_int32 hdrSize;					/* offset of segment 0 */
+	u_int32 segSize;					/* segment size [bytes] */
+	u_int32 segRecs;					/* records per segment */
+	u_int32 maxSegs;					/* nr of ring segments (0=unlimited) */
+	u_int32 tsFreq;						/* timestamp frequency [Hz] */
+	u_int32 nrDev;						/* nr of devices */
+	M31_LOG_DEV dev[M31_LOG_DEV_MAX];	/* devices */
+} M31_LOG_HDR;
+
+/* segment header (index of the segment) */
+typedef struct {
+	u_int32 magic;						/* M31_LOG_SEG_MAGIC */
+	u_int32 seq;						/* sequence number (0=unused) */
+	u_int32 nrRecs;						/* nr of valid records */
+	u_int32 devMask;					/* devices with records */
+	u_int32 tsFirstHigh;				/* lowest timestamp, bits 63..32 */
+	u_int32 tsFirstLow;					/* lowest timestamp, bits 31..0 */
+	u_int32 tsLastHigh;					/* highest timestamp, bits 63..32 */
+	u_int32 tsLastLow;					/* highest timestamp, bits 31..0 */
+	u_int32 wallSec;					/* wall clock at segment start [s] */
+	u_int32 wallUsec;					/* wall clock at segment start [us] */
+	u_int16 chMask[M31_LOG_DEV_MAX];	/* changed channels per device */
+	u_int32 res[2];
+} M31_LOG_SEG;
+
+/* open log file (writer or reader) */
+typedef struct {
+	int         fd;						/* file descriptor */
+	int         rdOnly;					/* opened by M31_LogOpen() */
+	M31_LOG_HDR hdr;					/* file header */
+	/* writer */
+	M31_LOG_SEG seg;					/* header of open segment */
+	u_int32     segIdx;					/* index of open segment */
+	u_int32     nrSegs;					/* nr of segments in file */
+	/* reader */
+	u_int8      *map;					/* mapped file */
+	u_int64     mapSize;				/* size of mapping [bytes] */
+	u_int32     *order;					/* valid segments by seq */
+	u_int32     nrOrder;				/* nr of valid segments */
+} M31_LOG;
+
+/* query state */
+typedef struct {
+	u_int64 tsFrom;						/* first timestamp */
+	u_int64 tsTo;						/* last timestamp */
+	u_int32 devMask;					/* devices */
+	u_int16 chMask;						/* channels (change mask) */
+	u_int32 pos;						/* index in M31_LOG.order */
+	u_int32 rec;						/* record in segment */
+	u_int32 segsRead;					/* segments searched */
+	u_int32 segsSkipped;				/* segments skipped by the index */
+} M31_LOG_QUERY;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+extern int32 M31_LogCreate(M31_LOG *log, const char *file,
+						   const M31_LOG_HDR *hdr, int append);
+extern int32 M31_LogWrite(M31_LOG *log, u_int8 dev,
+						  const M31_EVENT *ev, u_int32 nr);
+extern int32 M31_LogFlush(M31_LOG *log);
+extern int32 M31_LogOpen(M31_LOG *log, const char *file);
+extern void M31_LogClose(M31_LOG *log);
+extern void M31_LogQueryInit(M31_LOG_QUERY *q, u_int64 tsFrom, u_int64 tsTo,
+							 u_int32 devMask, u_int16 chMask);
+extern const M31_EVENT *M31_LogNext(M31_LOG *log, M31_LOG_QUERY *q);
+extern const M31_LOG_SEG *M31_LogSeg(M31_LOG *log, u_int32 idx);
+
+#ifdef __cplusplus
+      }
+#endif
+
+#endif /* _M31_LOG_H */
@@ -0,0 +1,134 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: m31_merge.h
+ *
+ *       Author: ds
+ *
+ *  Description: Header file for the M31 multi-device event merge (m31_util)
+ *
+ *               Merges the event batches of several devices (M31_EVENT
+ *               records, each device in timestamp order) online into one
+ *               stream in global timestamp order. The output is one
+ *               record per channel edge, tagged with device and channel
+ *               (M31_MERGE_REC). All devices must share one timestamp
+ *               clock (same M31_TS_FREQ, same host).
+ *
+ *               Each device has a queue of fixed size; the devices with
+ *               queued events are kept in a min-heap by their oldest
+ *               timestamp. The oldest event is released when no older
+ *               one can arrive any more:
+ *
+ *               - every device with an empty queue has a watermark
+ *                 (M31_MergeMark) at or after it, or
+ *               - it is older than the newest timestamp seen on any
+ *                 device minus <slack> (bounded latency), or
+ *               - a queue is full (bounded memory), or the caller
+ *                 flushes.
+ *
+ *               Consecutive events of one device up to the oldest event
+ *               of the next device are released without heap operations,
+ *               so a busy device next to slow ones costs O(1) per event.
+ *               Events arriving older than already released ones are
+ *               counted in M31_MERGE.late and released next.
+ *
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _M31_MERGE_H
+#define _M31_MERGE_H
+
+#ifdef __cplusplus
+      extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define M31_MERGE_DEV_MAX   32				 /* max nr of devices */
+
+/* edge types (M31_MERGE_REC.edge) */
+#define M31_MERGE_FALL      0				 /* channel changed to 0 */
+#define M31_MERGE_RISE      1				 /* channel changed to 1 */
+#define M31_MERGE_LOST      2				 /* M31_EVF_LOST_EDGE */
+#define M31_MERGE_RULE      3				 /* M31_EVF_RULE, ch = rule */
+#define M31_MERGE_FIELD     4				 /* M31_EVF_FIELD, ch = field channel */
+#define M31_MERGE_NO_CH     0xff			 /* ch of an event without channel */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/* merged edge record */
+typedef struct {
+	u_int32 tsHigh;						/* timestamp, bits 63..32 */
+	u_int32 tsLow;						/* timestamp, bits 31..0 */
+	u_int16 state;						/* channel states of the device */
+	u_int8  dev;						/* device index */
+	u_int8  ch;							/* channel (rule, field) */
+	u_int8  edge;						/* M31_MERGE_xxx */
+	u_int8  flags;						/* M31_EVF_xxx of the event */
+	u_int16 seq;						/* event sequence number */
+} M31_MERGE_REC;
+
+/* device queue */
+typedef struct {
+	M31_EVENT *ev;						/* queue buffer */
+	u_int32   get;						/* read index (free running) */
+	u_int32   put;						/* write index (free running) */
+	u_int64   mark;						/* no events older than this follow */
+	u_int32   maxUsed;					/* max queue fill level */
+	u_int32   res;
+} M31_MERGE_DEV;
+
+/* merge state */
+typedef struct {
+	M31_MERGE_DEV dev[M31_MERGE_DEV_MAX];	/* device queues */
+	u_int32   nrDev;					/* nr of devices */
+	u_int32   size;						/* queue size (power of 2) */
+	u_int8    heap[M31_MERGE_DEV_MAX];	/* devices with queued events */
+	u_int32   nrHeap;					/* nr of heap entries */
+	u_int32   nrFull;					/* nr of full queues */
+	u_int64   slack;					/* max wait for slow devices */
+	u_int64   newest;					/* newest timestamp put */
+	u_int64   released;					/* newest timestamp released */
+	u_int32   late;						/* events put after newer ones were
+										   released */
+	/* event partly split into records */
+	M31_EVENT pend;
+	u_int32   pendMask;					/* channels not yet returned */
+} M31_MERGE;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+extern int32 M31_MergeInit(M31_MERGE *m, u_int32 nrDev, u_int32 size,
+						   u_int64 slack);
+extern void M31_MergeExit(M31_MERGE *m);
+extern u_int32 M31_MergeFree(M31_MERGE *m, u_int8 dev);
+extern u_int32 M31_MergePut(M31_MERGE *m, u_int8 dev,
+							const M31_EVENT *ev, u_int32 nr);
+extern void M31_MergeMark(M31_MERGE *m, u_int8 dev, u_int64 ts);
+extern u_int32 M31_MergeGet(M31_MERGE *m, M31_MERGE_REC *rec, u_int32 max,
+							int flush);
+
+#ifdef __cplusplus
+      }
+#endif
+
+#endif /* _M31_MERGE_H */
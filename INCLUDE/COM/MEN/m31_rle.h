@@ -0,0 +1,97 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: m31_rle.h
+ *
+ *       Author: ds
+ *
+ *  Description: Header file for the M31 run length decoder (m31_util)
+ *
+ *               Format of the capture stream M31_CAPFMT_RLE:
+ *               The stream is a sequence of M31_RLE_REC records (see
+ *               m31_drv.h), each 4 bytes in host byte order:
+ *
+ *                 offs  type     name   meaning
+ *                 ----  -------  -----  --------------------------------
+ *                 0     u_int16  state  channel states, bit n = channel n
+ *                 2     u_int16  count  nr of samples 1..65535
+ *
+ *               A record stands for <count> consecutive samples with the
+ *               same <state>, i.e. a duration of count * sample period.
+ *               Longer runs are split into several records, so consecutive
+ *               records may have the same state. The first record starts
+ *               with the first sample after the pre-trigger samples were
+ *               discarded (sample index 0).
+ *
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _M31_RLE_H
+#define _M31_RLE_H
+
+#ifdef __cplusplus
+      extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/* decoder state */
+typedef struct {
+	u_int32 sample;						/* index of next sample */
+	u_int32 lastTrans;					/* sample index of last transition */
+	u_int32 left;						/* samples left of current record */
+	u_int16 state;						/* current state */
+	u_int8  valid;						/* state valid */
+} M31_RLE_DEC;
+
+/* encoder state */
+typedef struct {
+	u_int32 count;						/* samples in open run */
+	u_int16 state;						/* state of open run */
+} M31_RLE_ENC;
+
+/* transition (state change) */
+typedef struct {
+	u_int32 sample;						/* sample index of new state */
+	u_int32 delta;						/* samples since last transition */
+	u_int16 state;						/* new state */
+	u_int16 change;						/* changed channels (0=first state) */
+} M31_RLE_TRANS;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+extern void M31_RleDecInit(M31_RLE_DEC *dec);
+extern u_int32 M31_RleExpand(M31_RLE_DEC *dec, const M31_RLE_REC *rec,
+							 u_int32 nrRec, u_int32 *usedP,
+							 u_int16 *buf, u_int32 max);
+extern u_int32 M31_RleToTrans(M31_RLE_DEC *dec, const M31_RLE_REC *rec,
+							  u_int32 nrRec, M31_RLE_TRANS *trans);
+extern void M31_RleEncInit(M31_RLE_ENC *enc);
+extern u_int32 M31_RleEncode(M31_RLE_ENC *enc, const u_int16 *buf,
+							 u_int32 nrSamples, u_int32 *usedP,
+							 M31_RLE_REC *rec, u_int32 max);
+extern u_int32 M31_RleEncFlush(M31_RLE_ENC *enc, M31_RLE_REC *rec);
+
+#ifdef __cplusplus
+      }
+#endif
+
+#endif /* _M31_RLE_H */
@@ -0,0 +1,161 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: m31_shm.h
+ *
+ *       Author: ds
+ *
+ *  Description: Header file for the M31 shared memory event ring (m31_util)
+ *
+ *               One publisher process (m31_pub) drains the devices and
+ *               writes their events into a POSIX shared memory object.
+ *               Any number of subscribers map the object read-only and
+ *               read at their own pace without touching the driver:
+ *
+ *                 offs            size           contents
+ *                 --------------  -------------  ---------------------
+ *                 0               hdrSize        M31_SHM_HDR
+ *                 hdrSize         nrRecs * 24    M31_SHM_REC ring
+ *
+ *               The ring is lock-free with a single writer. Each record
+ *               carries its sequence number + 1 (0 while written), the
+ *               header holds the sequence number of the next record
+ *               (head). A subscriber keeps its own cursor (M31_SHM_SUB);
+ *               if the publisher laps it, the skipped records are counted
+ *               as lost and the cursor moves to the oldest valid record.
+ *               Sequence numbers wrap at 2^32, so a subscriber must read
+ *               at least once per 2^31 records.
+ *
+ *               The current state of each device is held in the header
+ *               (M31_SHM_STATE), updated with each published event and
+ *               protected by a sequence lock.
+ *
+ *               Subscribers detect a terminated publisher by
+ *               M31_ShmAlive() and attach again to get the new ring.
+ *
+ *     Switches: -
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _M31_SHM_H
+#define _M31_SHM_H
+
+#ifdef __cplusplus
+      extern "C" {
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define M31_SHM_MAGIC       0x5031334d		 /* "M31P" */
+#define M31_SHM_VERSION     1
+#define M31_SHM_NAME        "/m31_events"	 /* default object name */
+#define M31_SHM_DEV_MAX     8				 /* max nr of devices */
+#define M31_SHM_NAME_LEN    32				 /* max device name length incl. 0 */
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+/* published device */
+typedef struct {
+	char    name[M31_SHM_NAME_LEN];		/* MDIS device name */
+	u_int16 modId;						/* module id (ID PROM, 0=unknown) */
+	u_int16 chNbr;						/* nr of channels */
+	u_int32 res;
+} M31_SHM_DEV;
+
+/* current device state */
+typedef struct {
+	u_int32 seq;						/* sequence lock (odd: updating) */
+	u_int32 state;						/* channel states */
+	u_int32 tsHigh;						/* timestamp of state, bits 63..32 */
+	u_int32 tsLow;						/* timestamp of state, bits 31..0 */
+	u_int32 events;						/* nr of published events */
+	u_int32 lost;						/* events lost in the driver */
+	u_int32 res[2];
+} M31_SHM_STATE;
+
+/* shared memory header (padded to hdrSize) */
+typedef struct {
+	u_int32 magic;						/* M31_SHM_MAGIC (set last) */
+	u_int32 version;					/* M31_SHM_VERSION */
+	u_int32 hdrSize;					/* offset of the ring */
+	u_int32 nrRecs;						/* ring records (power of 2) */
+	u_int32 tsFreq;						/* timestamp frequency [Hz] */
+	u_int32 nrDev;						/* nr of devices */
+	u_int32 pid;						/* publisher process (0=closed) */
+	u_int32 beat;						/* publisher heartbeat counter */
+	M31_SHM_DEV   dev[M31_SHM_DEV_MAX];	/* devices */
+	M31_SHM_STATE state[M31_SHM_DEV_MAX];	/* current states */
+	u_int32 res[8];						/* align head to 64 bytes */
+	u_int32 head[16];					/* [0]: seq of next record,
+										   own cache line */
+} M31_SHM_HDR;
+
+/* ring record */
+typedef struct {
+	u_int32   seq;						/* sequence number + 1 (0=writing) */
+	u_int32   res;
+	M31_EVENT ev;						/* event, ev.dev: index in dev[] */
+} M31_SHM_REC;
+
+/* mapped ring (publisher or subscriber) */
+typedef struct {
+	int          fd;					/* shared memory object */
+	int          pub;					/* created by M31_ShmCreate() */
+	char         name[64];				/* object name */
+	M31_SHM_HDR  *hdr;					/* mapped header */
+	M31_SHM_REC  *rec;					/* mapped ring */
+	u_int64      size;					/* size of mapping [bytes] */
+	u_int32      mask;					/* nrRecs - 1 */
+} M31_SHM;
+
+/* subscriber cursor */
+typedef struct {
+	u_int32 cursor;						/* seq of next record to read */
+	u_int32 read;						/* records read */
+	u_int32 lost;						/* records lost by overrun */
+	u_int32 overruns;					/* nr of overruns */
+} M31_SHM_SUB;
+
+/*-----------------------------------------+
+|  PROTOTYPES                              |
++-----------------------------------------*/
+/* publisher */
+extern int32 M31_ShmCreate(M31_SHM *shm, const char *name,
+						   const M31_SHM_HDR *hdr);
+extern void M31_ShmPublish(M31_SHM *shm, u_int8 dev,
+						   const M31_EVENT *ev, u_int32 nr);
+extern void M31_ShmStateSet(M31_SHM *shm, u_int8 dev, u_int32 state,
+							u_int64 ts, u_int32 lost);
+extern void M31_ShmBeat(M31_SHM *shm);
+/* subscriber */
+extern int32 M31_ShmAttach(M31_SHM *shm, const char *name);
+extern void M31_ShmSubInit(M31_SHM *shm, M31_SHM_SUB *sub, int oldest);
+extern u_int32 M31_ShmRead(M31_SHM *shm, M31_SHM_SUB *sub,
+						   M31_EVENT *ev, u_int32 max);
+extern void M31_ShmStateGet(M31_SHM *shm, u_int8 dev, M31_SHM_STATE *st);
+extern int M31_ShmAlive(M31_SHM *shm);
+/* both */
+extern void M31_ShmClose(M31_SHM *shm);
+
+#ifdef __cplusplus
+      }
+#endif
+
+#endif /* _M31_SHM_H */
@@ -0,0 +1,288 @@
+/***********************  I n c l u d e  -  F i l e  ************************
+ *
+ *         Name: m31pp.h
+ *
+ *       Author: ds
+ *
+ *  Description: C++ client library for the M31 driver (m31pp)
+ *
+ *               m31pp::Device owns an MDIS path (closed by the destructor)
+ *               and provides typed accessors for the M31_xxx status codes.
+ *               On the first event subscription it installs the driver
+ *               signal, enables the interrupt, switches the device to
+ *               block mode M31_BLKMODE_EVENT and starts an event thread.
+ *               The signal handler only posts the POSIX semaphore of the
+ *               device owning the signal; the event thread then drains the
+ *               event FIFO in batches and passes each batch to the
+ *               registered callbacks and to waiting coroutines
+ *               (co_await dev.events(), C++20). Exceptions thrown by the
+ *               consumers are passed to the onError() handler (default:
+ *               printed to stderr), the thread continues.
+ *
+ *               Batches arriving while nobody listens are queued (up to
+ *               M31PP_QUEUE_MAX events, oldest dropped) and delivered to
+ *               the next co_await, so a coroutine loop misses no events.
+ *
+ *               Errors are reported as m31pp::Error exceptions holding the
+ *               MDIS error code.
+ *
+ *     Required: C++11 (coroutines: C++20), POSIX threads and semaphores,
+ *               libraries mdis_api, usr_oss
+ *     Switches: -
+ *
+ *               The MDIS make rules compile C inputs only, see library.mak
+ *               for building m31pp.cpp.
+ *
+ *               The library uses the UOS signal handler of the process
+ *               while any Device has subscriptions, so the application
+ *               must not call UOS_SigInit() itself. Each subscribed Device
+ *               gets its own signal: the first UOS_SIG_USR1, the second
+ *               UOS_SIG_USR2, further ones real-time signals SIGRTMIN+n
+ *               (where available, else start() fails).
+ *
+ *---------------------------------------------------------------------------
+ * Copyright 2026, MEN Mikro Elektronik GmbH
+ ****************************************************************************/
+/*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 2 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _M31PP_H
+#define _M31PP_H
+
+#include <semaphore.h>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <MEN/men_typs.h>
+#include <MEN/mdis_api.h>
+#include <MEN/m31_drv.h>
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define M31PP_COROUTINES
+#endif
+#endif
+
+/*-----------------------------------------+
+|  DEFINES                                 |
++-----------------------------------------*/
+#define M31PP_BATCH         64				 /* events read per M_getblock */
+#define M31PP_QUEUE_MAX     4096			 /* max queued events */
+#define M31PP_DEV_MAX       16				 /* max devices with events */
+
+namespace m31pp {
+
+/*-----------------------------------------+
+|  TYPEDEFS                                |
++-----------------------------------------*/
+typedef std::vector<M31_EVENT> EventBatch;
+typedef std::function<void(const EventBatch&)> EventCallback;
+typedef std::function<void(std::exception_ptr)> ErrorCallback;
+
+/* MDIS error */
+class Error : public std::runtime_error {
+public:
+	Error(const std::string &what, int32 code);
+	int32 code() const { return code_; }
+private:
+	int32 code_;
+};
+
+class Device;
+
+#ifdef M31PP_COROUTINES
+/* awaitable for the next event batch (Device::events()) */
+class EventAwaiter {
+public:
+	explicit EventAwaiter(Device &dev) : dev_(dev) {}
+	bool await_ready();
+	bool await_suspend(std::coroutine_handle<> h);
+	EventBatch await_resume() { return std::move(batch_); }
+private:
+	friend class Device;
+	Device                  &dev_;
+	std::coroutine_handle<> handle_;
+	EventBatch              batch_;
+};
+#endif
+
+/* M31 device (one MDIS path) */
+class Device {
+public:
+	explicit Device(const std::string &name);
+	~Device();
+
+	Device(const Device&) = delete;
+	Device &operator=(const Device&) = delete;
+
+	MDIS_PATH path() const { return path_; }
+
+	/* generic access */
+	int32 getStat(int32 code);
+	void setStat(int32 code, INT32_OR_64 value);
+	int32 getStat(int32 ch, int32 code);
+	void setStat(int32 ch, int32 code, INT32_OR_64 value);
+	int32 getBlock(int32 code, void *buf, int32 size);
+	void setBlock(int32 code, const void *buf, int32 size);
+
+	/* states */
+	u_int16 state();
+	bool state(int32 ch);
+	u_int16 changeFlags()			{ return (u_int16)getStat(M31_CHANGE_FLAGS); }
+	u_int32 channels()				{ return (u_int32)getStat(M_LL_CH_NUMBER); }
+
+	/* hysteresis (M82) */
+	int32 hysMode(int32 ch)			{ return getStat(ch, M31_HYS_MODE); }
+	void hysMode(int32 ch, int32 v)	{ setStat(ch, M31_HYS_MODE, v); }
+	u_int16 hysMask()				{ return (u_int16)getStat(M31_HYS_MASK); }
+	void hysMask(u_int16 v)			{ setStat(M31_HYS_MASK, v); }
+
+	/* diagnostics */
+	u_int32 tsFreq()				{ return (u_int32)getStat(M31_TS_FREQ); }
+	bool traceEnable()				{ return getStat(M31_TRACE_ENABLE) != 0; }
+	void traceEnable(bool v)		{ setStat(M31_TRACE_ENABLE, v); }
+	void isrStatClear()				{ setStat(M31_ISR_STAT_CLR, 0); }
+	M31_ISR_STAT isrStat();
+	std::vector<M31_TRACE_REC> trace(u_int32 max = 256);
+	M31_LOST_STAT lostStat();
+	u_int32 lostEdges(int32 ch)		{ return (u_int32)getStat(ch, M31_LOST_EDGES); }
+	std::vector<M31_LAST_CHANGE> lastChange();
+	M31_COUNTERS counters();
+	void idRefresh()				{ setStat(M31_ID_REFRESH, 0); }
+
+	/* event fifo */
+	u_int32 eventCount()			{ return (u_int32)getStat(M31_EVENT_COUNT); }
+	u_int32 eventLost()				{ return (u_int32)getStat(M31_EVENT_LOST); }
+	void eventLost(u_int32 v)		{ setStat(M31_EVENT_LOST, v); }
+
+	/* notification */
+	u_int16 sigMask()				{ return (u_int16)getStat(M31_SIG_MASK); }
+	void sigMask(u_int16 v)			{ setStat(M31_SIG_MASK, v); }
+	u_int16 edgeRise()				{ return (u_int16)getStat(M31_EDGE_RISE); }
+	void edgeRise(u_int16 v)		{ setStat(M31_EDGE_RISE, v); }
+	u_int16 edgeFall()				{ return (u_int16)getStat(M31_EDGE_FALL); }
+	void edgeFall(u_int16 v)		{ setStat(M31_EDGE_FALL, v); }
+	u_int32 sigCoalesce()			{ return (u_int32)getStat(M31_SIG_COALESCE); }
+	void sigCoalesce(u_int32 ms)	{ setStat(M31_SIG_COALESCE, ms); }
+
+	/* capture */
+	u_int32 capPeriod()				{ return (u_int32)getStat(M31_CAP_PERIOD); }
+	void capPeriod(u_int32 us)		{ setStat(M31_CAP_PERIOD, us); }
+	u_int16 capTrigMask()			{ return (u_int16)getStat(M31_CAP_TRIG_MASK); }
+	void capTrigMask(u_int16 v)		{ setStat(M31_CAP_TRIG_MASK, v); }
+	u_int16 capTrigValue()			{ return (u_int16)getStat(M31_CAP_TRIG_VALUE); }
+	void capTrigValue(u_int16 v)	{ setStat(M31_CAP_TRIG_VALUE, v); }
+	u_int32 capPretrig()			{ return (u_int32)getStat(M31_CAP_PRETRIG); }
+	void capPretrig(u_int32 v)		{ setStat(M31_CAP_PRETRIG, v); }
+	int32 capFormat()				{ return getStat(M31_CAP_FORMAT); }
+	void capFormat(int32 v)			{ setStat(M31_CAP_FORMAT, v); }
+	int32 capState()				{ return getStat(M31_CAP_CTRL); }
+	void capCtrl(int32 v)			{ setStat(M31_CAP_CTRL, v); }
+	M31_CAP_INFO capInfo();
+	std::vector<u_int16> capture(u_int32 max);
+	std::vector<M31_RLE_REC> captureRle(u_int32 max);
+
+	/* aggregate device */
+	u_int32 aggrMembers()			{ return (u_int32)getStat(M31_AGGR_MEMBERS); }
+	std::vector<u_int16> aggrChange();
+
+	/* ready group */
+	u_int32 readyMask()				{ return (u_int32)getStat(M31_READY_MASK); }
+
+	/* debounce */
+	u_int32 debounce(int32 ch)		{ return (u_int32)getStat(ch, M31_DEBOUNCE); }
+	void debounce(int32 ch, u_int32 us)	{ setStat(ch, M31_DEBOUNCE, us); }
+	u_int32 glitches(int32 ch)		{ return (u_int32)getStat(ch, M31_GLITCHES); }
+	std::vector<u_int32> glitches();
+
+	/* quadrature decoder */
+	u_int8 quadMask()				{ return (u_int8)getStat(M31_QUAD_MASK); }
+	void quadMask(u_int8 v)			{ setStat(M31_QUAD_MASK, v); }
+	int32 quadPos(int32 ch)			{ return getStat(ch, M31_QUAD_POS); }
+	void quadPos(int32 ch, int32 v)	{ setStat(ch, M31_QUAD_POS, v); }
+	int32 quadDir(int32 ch)			{ return getStat(ch, M31_QUAD_DIR); }
+	u_int32 quadErrors(int32 ch)	{ return (u_int32)getStat(ch, M31_QUAD_ERRORS); }
+	std::vector<M31_QUAD> quad();
+
+	/* strobed words */
+	int32 strobeCh()				{ return getStat(M31_STROBE_CH); }
+	void strobeCh(int32 ch)			{ setStat(M31_STROBE_CH, ch); }
+	int32 strobeEdge()				{ return getStat(M31_STROBE_EDGE); }
+	void strobeEdge(int32 v)		{ setStat(M31_STROBE_EDGE, v); }
+	u_int32 strobeCount()			{ return (u_int32)getStat(M31_STROBE_COUNT); }
+	u_int32 strobeLost()			{ return (u_int32)getStat(M31_STROBE_LOST); }
+	std::vector<M31_STROBE_REC> strobe(u_int32 max);
+
+	/* channel fields */
+	u_int32 fieldValue(int32 ch)	{ return (u_int32)getStat(ch, M31_FIELD_VALUE); }
+	void field(const M31_FIELD_DEF &def);
+	std::vector<M31_FIELD_DEF> fields();
+	std::vector<M31_FIELD_STAT> fieldStat();
+
+	/* sequence rules */
+	void rules(const std::vector<M31_RULE> &rules);
+	std::vector<M31_RULE> rules();
+	std::vector<M31_RULE_STAT> ruleStat();
+
+	/* events */
+	int onEvents(const EventCallback &cb);
+	void removeCallback(int id);
+	void onError(const ErrorCallback &cb);
+#ifdef M31PP_COROUTINES
+	EventAwaiter events()			{ return EventAwaiter(*this); }
+#endif
+	void start();
+	void stop();
+
+private:
+#ifdef M31PP_COROUTINES
+	friend class EventAwaiter;
+#endif
+	void check(int32 ret, const char *what);
+	void blkMode(int32 mode);
+	int32 readBlock(int32 mode, void *buf, int32 size);
+	void eventThread();
+	void dispatch(EventBatch &batch);
+	void report(std::exception_ptr e);
+
+	MDIS_PATH               path_;
+	std::mutex              ioLock_;		/* path io, current channel */
+	int32                   mode_;			/* current block mode (-1=unknown) */
+
+	std::mutex              evLock_;		/* callbacks, waiters, queue */
+	std::vector<std::pair<int, EventCallback> > callbacks_;
+	ErrorCallback           errorCb_;
+	int                     nextId_;
+	EventBatch              queue_;
+#ifdef M31PP_COROUTINES
+	std::vector<EventAwaiter*> waiters_;
+#endif
+	std::mutex              runLock_;		/* start/stop */
+	sem_t                   sem_;
+	std::thread             thread_;
+	std::atomic<bool>       run_;
+	int                     slot_;			/* signal slot (-1=none) */
+};
+
+} /* namespace m31pp */
+
+#endif /* _M31PP_H */